@@ -768,6 +768,29 @@ core.register_chatcommand("status", {
 	end,
 })
 
+core.register_chatcommand("trace", {
+	params = "start | stop | dump [<file name in world directory>]",
+	description = "record timeline of server threads and dump it as Chrome trace JSON",
+	privs = {server=true},
+	func = function(name, param)
+		local action, file = param:match("^(%S+)%s*(.*)$")
+		if action == "start" then
+			core.trace_enable(true)
+			return true, "Tracing started."
+		elseif action == "stop" then
+			core.trace_enable(false)
+			return true, "Tracing stopped."
+		elseif action == "dump" then
+			local path = core.trace_dump(file ~= "" and file or nil)
+			if not path then
+				return false, "Failed to write trace."
+			end
+			return true, "Trace written to " .. path
+		end
+		return false, "Invalid parameters (see /help trace)."
+	end,
+})
+
 core.register_chatcommand("time", {
 	params = "<0..23>:<0..59> | <0..24000>",
 	description = "set time of day",
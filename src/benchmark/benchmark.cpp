@@ -0,0 +1,79 @@
+/*
+  This file is part of Freeminer.
+
+  Freeminer is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Freeminer  is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Freeminer.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "benchmark/benchmark.h"
+
+#include <fstream>
+
+#include "debug.h"
+#include "filesys.h"
+#include "log.h"
+#include "porting.h"
+#include "settings.h"
+#include "version.h"
+
+Json::Value BenchmarkTimer::toJson() const
+{
+	Json::Value json;
+	json["total_ms"] = m_total_us / 1000.0;
+	json["avg_ms"] = m_count ? m_total_us / 1000.0 / m_count : 0.0;
+	json["max_ms"] = m_max_us / 1000.0;
+	json["calls"] = (Json::UInt64)m_count;
+	return json;
+}
+
+bool run_benchmarks(const std::string &filter)
+{
+	DSTACK(FUNCTION_NAME);
+
+	Json::Value root;
+	root["version"] = g_version_hash;
+	root["time"] = (Json::UInt64)time(nullptr);
+
+	bool ok = true;
+	for (auto benchmark : BenchmarkManager::getBenchmarks()) {
+		if (!filter.empty() && filter != benchmark->getName())
+			continue;
+		actionstream << "Benchmark " << benchmark->getName() << "..." << std::endl;
+		u32 t1 = porting::getTimeMs();
+		Json::Value result;
+		bool success = false;
+		try {
+			success = benchmark->run(result);
+		} catch (std::exception &e) {
+			errorstream << "Benchmark " << benchmark->getName()
+				<< ": exception: " << e.what() << std::endl;
+		}
+		result["success"] = success;
+		result["wall_ms"] = porting::getTimeMs() - t1;
+		root["benchmarks"][benchmark->getName()] = result;
+		ok &= success;
+	}
+
+	Json::StyledWriter writer;
+	std::string output = writer.write(root);
+	std::string path = g_settings->get("benchmark_output");
+	if (path.empty()) {
+		rawstream << output;
+	} else if (!fs::safeWriteToFile(path, output)) {
+		errorstream << "Benchmark: unable to write " << path << std::endl;
+		return false;
+	} else {
+		rawstream << "Benchmark results written to " << path << std::endl;
+	}
+	return ok;
+}
@@ -0,0 +1,123 @@
+/*
+  This file is part of Freeminer.
+
+  Freeminer is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Freeminer  is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Freeminer.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef BENCHMARK_HEADER
+#define BENCHMARK_HEADER
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <json/json.h>
+
+#include "irrlichttypes.h"
+#include "irr_v3d.h"
+
+class Server;
+
+/*
+	Benchmarks are registered like unit tests and run with --run-benchmarks.
+	Every benchmark fills a json object, all results are printed (or written
+	to benchmark_output) as one json document so runs of different builds
+	can be compared by scripts.
+	Parameters are normal settings, e.g. -benchmark_ticks=5000
+*/
+
+class BenchmarkBase {
+public:
+	virtual const char *getName() = 0;
+	virtual bool run(Json::Value &result) = 0;
+};
+
+class BenchmarkManager {
+public:
+	static std::vector<BenchmarkBase *> &getBenchmarks()
+	{
+		static std::vector<BenchmarkBase *> m_benchmarks;
+		return m_benchmarks;
+	}
+
+	static void registerBenchmark(BenchmarkBase *benchmark)
+	{
+		getBenchmarks().push_back(benchmark);
+	}
+};
+
+// Accumulates wall time of repeated calls
+class BenchmarkTimer {
+public:
+	template <typename F>
+	auto measure(F f) -> decltype(f())
+	{
+		Scope scope(this);
+		return f();
+	}
+
+	void add(u64 us)
+	{
+		m_total_us += us;
+		if (us > m_max_us)
+			m_max_us = us;
+		++m_count;
+	}
+
+	Json::Value toJson() const;
+
+	u64 m_total_us = 0;
+	u64 m_max_us = 0;
+	u64 m_count = 0;
+
+private:
+	struct Scope {
+		Scope(BenchmarkTimer *timer) :
+			m_timer(timer), m_start(std::chrono::steady_clock::now()) {}
+		~Scope()
+		{
+			m_timer->add(std::chrono::duration_cast<std::chrono::microseconds>(
+					std::chrono::steady_clock::now() - m_start).count());
+		}
+		BenchmarkTimer *m_timer;
+		std::chrono::steady_clock::time_point m_start;
+	};
+};
+
+/*
+	Server on a fresh world of benchmark_game, never started: subsystem
+	threads are created but the benchmark drives everything from its own
+	thread, so every run of the same settings does the same work.
+	The world is deleted on destruction.
+*/
+class BenchmarkWorld {
+public:
+	~BenchmarkWorld();
+
+	// false if the game is not found, game empty for benchmark_game
+	bool create(Json::Value &result, const std::string &game = "");
+	// Generates blocks around center and waits for them
+	void pregenerate(v3s16 center, s16 radius, Json::Value &result);
+
+	Server *server = nullptr;
+	// Ground level at 0,0
+	s16 ground = 0;
+
+private:
+	std::string m_path;
+};
+
+// filter: run only benchmarks with this name, empty for all
+bool run_benchmarks(const std::string &filter);
+
+#endif
@@ -0,0 +1,100 @@
+/*
+  This file is part of Freeminer.
+
+  Freeminer is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Freeminer  is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Freeminer.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "benchmark/benchmark.h"
+
+#include "environment.h"
+#include "noise.h"
+#include "settings.h"
+
+/*
+	ActiveBlockList::update for many players walking around, against
+	building the whole set again on every update like it was done before.
+	Needs no world.
+*/
+
+class BenchmarkActiveBlocks : public BenchmarkBase {
+public:
+	BenchmarkActiveBlocks() { BenchmarkManager::registerBenchmark(this); }
+	const char *getName() { return "ActiveBlocks"; }
+
+	bool run(Json::Value &result);
+};
+
+static BenchmarkActiveBlocks g_benchmark_instance;
+
+bool BenchmarkActiveBlocks::run(Json::Value &result)
+{
+	const u32 players_num = g_settings->getU64("benchmark_active_block_players");
+	const u32 updates = g_settings->getU64("benchmark_active_block_updates");
+	const s16 radius = g_settings->getS16("active_block_range");
+	const u64 seed = g_settings->getU64("benchmark_seed");
+	const float interval = g_settings->getFloat("active_block_mgmt_interval");
+
+	result["players"] = players_num;
+	result["updates"] = updates;
+	result["radius"] = radius;
+
+	PcgRandom rand(seed);
+	// Block positions in nodes / 16 at walking speed, a few flying fast
+	std::vector<v3f> players(players_num), speeds(players_num);
+	for (u32 i = 0; i < players_num; ++i) {
+		players[i] = v3f(rand.range(-100, 100), rand.range(-2, 2), rand.range(-100, 100));
+		float speed = (i % 10 ? 4.0 : 20.0) / MAP_BLOCKSIZE;
+		float angle = rand.range(0, 359) * M_PI / 180;
+		speeds[i] = v3f(cos(angle) * speed, 0, sin(angle) * speed);
+	}
+	std::vector<v3s16> positions(players_num);
+	auto walk = [&]() {
+		for (u32 i = 0; i < players_num; ++i) {
+			players[i] += speeds[i] * interval;
+			positions[i] = v3s16(floor(players[i].X), floor(players[i].Y), floor(players[i].Z));
+		}
+	};
+
+	ActiveBlockList list;
+	BenchmarkTimer update_timer, rebuild_timer;
+	u64 added_total = 0, removed_total = 0, active_total = 0;
+	for (u32 update = 0; update < updates; ++update) {
+		walk();
+		std::set<v3s16> removed, added;
+		update_timer.measure([&] { list.update(positions, radius, removed, added); });
+		added_total += added.size();
+		removed_total += removed.size();
+		active_total += list.m_list.size();
+
+		rebuild_timer.measure([&] {
+			std::set<v3s16> blocks;
+			for (const auto &p0 : positions) {
+				v3s16 p;
+				for (p.X = p0.X - radius; p.X <= p0.X + radius; p.X++)
+				for (p.Y = p0.Y - radius; p.Y <= p0.Y + radius; p.Y++)
+				for (p.Z = p0.Z - radius; p.Z <= p0.Z + radius; p.Z++)
+					if (p.getDistanceFrom(p0) <= radius)
+						blocks.insert(p);
+			}
+			return blocks.size();
+		});
+	}
+
+	result["update"] = update_timer.toJson();
+	result["full_rebuild"] = rebuild_timer.toJson();
+	result["blocks_added"] = (Json::UInt64)added_total;
+	result["blocks_removed"] = (Json::UInt64)removed_total;
+	result["blocks_active_avg"] = updates ? (double)active_total / updates : 0;
+	return true;
+}
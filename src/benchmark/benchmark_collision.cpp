@@ -0,0 +1,141 @@
+/*
+  This file is part of Freeminer.
+
+  Freeminer is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Freeminer  is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Freeminer.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "benchmark/benchmark.h"
+
+#include "collision.h"
+#include "environment.h"
+#include "log.h"
+#include "map.h"
+#include "nodedef.h"
+#include "noise.h"
+#include "server.h"
+#include "settings.h"
+#include "util/string.h"
+
+/*
+	collisionMoveSimple for many mob sized boxes falling and walking on
+	generated terrain sprinkled with benchmark_collision_nodes (fences,
+	slabs, wallmounted nodes...), without the rest of entity stepping.
+*/
+
+class BenchmarkCollision : public BenchmarkBase {
+public:
+	BenchmarkCollision() { BenchmarkManager::registerBenchmark(this); }
+	const char *getName() { return "Collision"; }
+
+	bool run(Json::Value &result);
+};
+
+static BenchmarkCollision g_benchmark_instance;
+
+struct CollisionEntity {
+	v3f pos;
+	v3f speed;
+};
+
+bool BenchmarkCollision::run(Json::Value &result)
+{
+	const u32 entities_num = g_settings->getU64("benchmark_collision_entities");
+	const u32 steps = g_settings->getU64("benchmark_collision_steps");
+	const s16 radius = g_settings->getS16("benchmark_radius");
+	const u64 seed = g_settings->getU64("benchmark_seed");
+	const float dtime = g_settings->getFloat("dedicated_server_step");
+
+	result["entities"] = entities_num;
+	result["steps"] = steps;
+	result["radius"] = radius;
+
+	BenchmarkWorld world;
+	if (!world.create(result))
+		return false;
+	Server &server = *world.server;
+	auto &env = server.getEnv();
+	auto &map = env.getServerMap();
+	auto *ndef = server.getNodeDefManager();
+	world.pregenerate(v3s16(0, world.ground / MAP_BLOCKSIZE, 0), radius, result);
+
+	PcgRandom rand(seed);
+	s32 area = radius * MAP_BLOCKSIZE - MAP_BLOCKSIZE;
+
+	std::vector<content_t> nodes;
+	for (const auto &name : str_split(g_settings->get("benchmark_collision_nodes"), ',')) {
+		content_t c = ndef->getId(trim(name));
+		if (c == CONTENT_IGNORE)
+			warningstream << "Benchmark: unknown node " << name << std::endl;
+		else
+			nodes.push_back(c);
+	}
+	u32 placed = 0;
+	if (!nodes.empty()) {
+		for (s32 i = 0; i < area * area / 4; ++i) {
+			v2POS p2d(rand.range(-area, area), rand.range(-area, area));
+			s16 level = map.findGroundLevel(p2d, false);
+			env.setNode(v3POS(p2d.X, level + 1, p2d.Y),
+					MapNode(nodes[rand.next() % nodes.size()], 0, rand.next() % 24));
+			++placed;
+		}
+	}
+	result["placed_nodes"] = placed;
+
+	auto random_speed = [&]() {
+		// walking, up to 4 nodes per second
+		return v3f(rand.range(-400, 400) / 100.0, 0, rand.range(-400, 400) / 100.0) * BS;
+	};
+
+	std::vector<CollisionEntity> entities(entities_num);
+	for (auto &entity : entities) {
+		v2POS p2d(rand.range(-area, area), rand.range(-area, area));
+		s16 level = map.findGroundLevel(p2d, false);
+		entity.pos = v3f(p2d.X, level + rand.range(2, 20), p2d.Y) * BS;
+		entity.speed = random_speed();
+	}
+
+	// Typical mob
+	const aabb3f box(-0.4 * BS, -1.0 * BS, -0.4 * BS, 0.4 * BS, 1.0 * BS, 0.4 * BS);
+	const v3f gravity(0, -9.81 * BS, 0);
+	const f32 pos_max_d = BS * 0.25;
+
+	BenchmarkTimer step_timer, call_timer;
+	u32 collisions = 0, touching_ground = 0;
+	for (u32 step = 0; step < steps; ++step) {
+		touching_ground = 0;
+		step_timer.measure([&] {
+			for (auto &entity : entities) {
+				auto res = call_timer.measure([&] {
+					return collisionMoveSimple(&env, &server, pos_max_d, box,
+							0.6 * BS, dtime, &entity.pos, &entity.speed, gravity);
+				});
+				collisions += res.collisions.size();
+				if (res.touching_ground) {
+					++touching_ground;
+					// turn at walls, sometimes jump
+					if (res.collides_xz)
+						entity.speed = random_speed();
+					else if (!(rand.next() % 50))
+						entity.speed.Y = 6.5 * BS;
+				}
+			}
+		});
+	}
+
+	result["step"] = step_timer.toJson();
+	result["collision_move"] = call_timer.toJson();
+	result["collisions"] = collisions;
+	result["touching_ground"] = touching_ground;
+	return true;
+}
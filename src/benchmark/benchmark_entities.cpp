@@ -0,0 +1,130 @@
+/*
+  This file is part of Freeminer.
+
+  Freeminer is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Freeminer  is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Freeminer.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "benchmark/benchmark.h"
+
+#include "content_sao.h"
+#include "environment.h"
+#include "map.h"
+#include "noise.h"
+#include "server.h"
+#include "settings.h"
+
+/*
+	Stepping of physical entities without Lua (not registered, so no
+	on_step) with 1, 2 and all threads of active_object_step_threads.
+	Every run starts from the same entities, the threaded runs must end
+	with the same positions.
+*/
+
+class BenchmarkEntities : public BenchmarkBase {
+public:
+	BenchmarkEntities() { BenchmarkManager::registerBenchmark(this); }
+	const char *getName() { return "Entities"; }
+
+	bool run(Json::Value &result);
+};
+
+static BenchmarkEntities g_benchmark_instance;
+
+bool BenchmarkEntities::run(Json::Value &result)
+{
+	const u32 entities_num = g_settings->getU64("benchmark_entities");
+	const u32 steps = g_settings->getU64("benchmark_entities_steps");
+	const s16 radius = g_settings->getS16("benchmark_radius");
+	const u64 seed = g_settings->getU64("benchmark_seed");
+	const float dtime = g_settings->getFloat("dedicated_server_step");
+	const std::string threads_saved = g_settings->get("active_object_step_threads");
+
+	result["entities"] = entities_num;
+	result["steps"] = steps;
+	result["radius"] = radius;
+
+	BenchmarkWorld world;
+	if (!world.create(result))
+		return false;
+	auto &env = world.server->getEnv();
+	auto &map = env.getServerMap();
+	world.pregenerate(v3s16(0, world.ground / MAP_BLOCKSIZE, 0), radius, result);
+
+	struct Start {
+		v3f pos;
+		v3f velocity;
+	};
+	PcgRandom rand(seed);
+	s32 area = radius * MAP_BLOCKSIZE - MAP_BLOCKSIZE;
+	std::vector<Start> start(entities_num);
+	for (auto &entity : start) {
+		v2POS p2d(rand.range(-area, area), rand.range(-area, area));
+		s16 level = map.findGroundLevel(p2d, false);
+		entity.pos = v3f(p2d.X, level + rand.range(2, 20), p2d.Y) * BS;
+		// walking, up to 4 nodes per second
+		entity.velocity = v3f(rand.range(-400, 400) / 100.0, 0, rand.range(-400, 400) / 100.0) * BS;
+	}
+
+	// Not added to the environment: nothing deactivates them and they only collide with the map
+	auto run_steps = [&](const std::string &threads, std::vector<v3f> &end) {
+		g_settings->set("active_object_step_threads", threads);
+		std::vector<ServerActiveObject*> objects;
+		for (const auto &entity : start) {
+			auto obj = new LuaEntitySAO(&env, entity.pos, "__benchmark:entity", "");
+			auto prop = obj->accessObjectProperties();
+			prop->physical = true;
+			prop->collideWithObjects = false;
+			prop->collisionbox = aabb3f(-0.4, -1.0, -0.4, 0.4, 1.0, 0.4);
+			prop->stepheight = 0.6;
+			obj->setVelocity(entity.velocity);
+			obj->setAcceleration(v3f(0, -9.81 * BS, 0));
+			objects.push_back(obj);
+		}
+
+		BenchmarkTimer step_timer, physics_timer;
+		float uptime = 0;
+		for (u32 step = 0; step < steps; ++step) {
+			uptime += dtime;
+			step_timer.measure([&] {
+				physics_timer.measure([&] { env.stepObjectsPhysics(objects, uptime, dtime); });
+				for (auto obj : objects) {
+					obj->step(dtime, false);
+					obj->m_uptime_last = uptime;
+				}
+			});
+		}
+
+		end.clear();
+		for (auto obj : objects) {
+			end.push_back(obj->getBasePosition());
+			delete obj;
+		}
+		Json::Value run;
+		run["step"] = step_timer.toJson();
+		run["physics"] = physics_timer.toJson();
+		return run;
+	};
+
+	std::vector<v3f> end_serial, end_two, end_all;
+	result["serial"] = run_steps("1", end_serial);
+	result["threads_2"] = run_steps("2", end_two);
+	result["threads_all"] = run_steps("0", end_all);
+	g_settings->set("active_object_step_threads", threads_saved);
+
+	bool deterministic = end_two == end_all;
+	result["deterministic"] = deterministic;
+	if (!deterministic)
+		errorstream << "Benchmark: entity positions depend on the number of threads" << std::endl;
+	return deterministic;
+}
@@ -0,0 +1,261 @@
+/*
+  This file is part of Freeminer.
+
+  Freeminer is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Freeminer  is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Freeminer.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "benchmark/benchmark.h"
+
+#include <fstream>
+#include <memory>
+
+#include "emerge.h"
+#include "filesys.h"
+#include "log.h"
+#include "map.h"
+#include "porting.h"
+#include "mapgen.h"
+#include "mapgen_layer_cache.h"
+#include "server.h"
+#include "settings.h"
+#include "util/hex.h"
+#include "util/numeric.h"
+#include "util/serialize.h"
+#include "util/sha1.h"
+#include "util/string.h"
+
+/*
+	Every mapgen of benchmark_mapgens, with its default parameters and
+	benchmark_seed, makes a grid of benchmark_mapgen_chunks^2 chunks at two
+	heights (underground and surface) from a fresh vmanip, twice with new
+	instances. The nodes of all chunks are hashed, both passes must give
+	the same hash.
+	benchmark_mapgen_hashes: json file with the golden hashes to compare
+	with, by default util/benchmark/mapgen_hashes.json of the share
+	directory. A mapgen without a golden hash fails.
+	The committed hashes are of benchmark_mapgen_game "minimal", which is
+	in the tree, seed 1 and 2 chunks, made by a Release build: with
+	-ffast-math another compiler or sanitizer can round noise otherwise,
+	compare builds of the same kind. They are to change only with the
+	generated world: mapgen light spread by levels instead of the depth
+	capped recursion (no dark spots left) and schematics placed from
+	precompiled spans (rows no longer wrap at the area edge) did, and are
+	in them. Record them again after such a change with
+	-benchmark_mapgen_record=true (the file is rewritten) and say why in
+	the commit. Optimizations must keep them: threaded ores and
+	decorations (-mapgen_placement_threads=4), the layer cache and the
+	masked noise caves do.
+	The 2D noise of the upper chunk of every column is copied from the
+	layer cache, -mapgen_layer_cache_size=0 makes all of it.
+	Nodes, biomes, ores and decorations are those of benchmark_mapgen_game,
+	Lua on_generated callbacks are not run.
+*/
+
+class BenchmarkMapgen : public BenchmarkBase {
+public:
+	BenchmarkMapgen() { BenchmarkManager::registerBenchmark(this); }
+	const char *getName() { return "Mapgen"; }
+
+	bool run(Json::Value &result);
+};
+
+static BenchmarkMapgen g_benchmark_instance;
+
+struct MapgenPass {
+	std::string hash;
+	BenchmarkTimer chunks;
+	u64 stage_us[MGSTAGE_COUNT] = {};
+	u64 layer_hits = 0;
+	u64 layer_misses = 0;
+};
+
+static void hash_nodes(SHA1 &sha1, MMVManip *vm)
+{
+	// Byte order independent, the hashes of other machines compare
+	u32 volume = vm->m_area.getVolume();
+	std::string data(volume * 4, 0);
+	u8 *p = (u8 *)&data[0];
+	for (u32 i = 0; i != volume; i++, p += 4) {
+		const MapNode &n = vm->m_data[i];
+		writeU16(p, n.getContent());
+		writeU8(p + 2, n.param1);
+		writeU8(p + 3, n.param2);
+	}
+	sha1.addBytes(data.c_str(), data.size());
+}
+
+static void generate(EmergeManager *emerge, Map *map, MapgenType type,
+	u64 seed, s16 chunks, MapgenPass &pass)
+{
+	// Defaults only, no world or user settings
+	Settings settings;
+	std::unique_ptr<MapgenParams> params(Mapgen::createMapgenParams(type));
+	params->mgtype = type;
+	params->seed = seed;
+	params->MapgenParams::readParams(&settings);
+	params->readParams(&settings);
+
+	std::unique_ptr<Mapgen> mg(Mapgen::createMapgen(type, -1, params.get(), emerge));
+	mg->stage_us = pass.stage_us;
+
+	// Schematic probabilities use the global random numbers
+	mysrand(seed);
+
+	// Every pass finds the same columns cached, the second doesn't copy
+	// the first one
+	MapgenLayerCache *cache = emerge->layer_cache;
+	if (cache) {
+		cache->clear();
+		pass.layer_hits = cache->getHits();
+		pass.layer_misses = cache->getMisses();
+	}
+
+	SHA1 sha1;
+	const s16 chunksize = params->chunksize;
+	for (s16 cz = -chunks / 2; cz != chunks - chunks / 2; cz++)
+	for (s16 cy = -1; cy != 1; cy++)
+	for (s16 cx = -chunks / 2; cx != chunks - chunks / 2; cx++) {
+		BlockMakeData data;
+		data.seed         = seed;
+		data.nodedef      = emerge->ndef;
+		data.blockpos_min = EmergeManager::getContainingChunk(
+			v3s16(cx, cy, cz) * chunksize, chunksize);
+		data.blockpos_max = data.blockpos_min + v3s16(1, 1, 1) * (chunksize - 1);
+		data.blockpos_requested = data.blockpos_min;
+
+		// Like a chunk in a new world, its neighbours not generated. The map
+		// only gets the liquids to transform
+		data.vmanip = new MMVManip(map);
+		data.vmanip->addArea(VoxelArea((data.blockpos_min - 1) * MAP_BLOCKSIZE,
+			(data.blockpos_max + 2) * MAP_BLOCKSIZE - v3s16(1, 1, 1)));
+
+		pass.chunks.measure([&] { mg->makeChunk(&data); });
+		hash_nodes(sha1, data.vmanip);
+	}
+
+	if (cache) {
+		pass.layer_hits = cache->getHits() - pass.layer_hits;
+		pass.layer_misses = cache->getMisses() - pass.layer_misses;
+	}
+
+	unsigned char *digest = sha1.getDigest();
+	pass.hash = hex_encode((char *)digest, 20);
+	free(digest);
+}
+
+bool BenchmarkMapgen::run(Json::Value &result)
+{
+	const u64 seed = g_settings->getU64("benchmark_seed");
+	const s16 chunks = g_settings->getS16("benchmark_mapgen_chunks");
+	std::string hashes_path = g_settings->get("benchmark_mapgen_hashes");
+	if (hashes_path.empty())
+		hashes_path = porting::path_share + DIR_DELIM + "util" + DIR_DELIM +
+			"benchmark" + DIR_DELIM + "mapgen_hashes.json";
+	const bool record = g_settings->getBool("benchmark_mapgen_record");
+	result["chunks"] = chunks * chunks * 2;
+
+	BenchmarkWorld world;
+	if (!world.create(result, g_settings->get("benchmark_mapgen_game")))
+		return false;
+	EmergeManager *emerge = world.server->getEmergeManager();
+
+	Json::Value stored;
+	if (!record) {
+		std::ifstream is(hashes_path.c_str());
+		Json::Reader reader;
+		if (!is.good() || !reader.parse(is, stored)) {
+			errorstream << "Benchmark: unable to read golden hashes " << hashes_path
+				<< ", record them with -benchmark_mapgen_record=true" << std::endl;
+			return false;
+		}
+		// Read back as signed, the values compare, not the json types
+		if (stored["game"] != result["game"] ||
+				stored["seed"].asUInt64() != result["seed"].asUInt64() ||
+				stored["chunks"].asInt() != result["chunks"].asInt()) {
+			errorstream << "Benchmark: " << hashes_path
+				<< " has hashes of another game, seed or chunk count" << std::endl;
+			return false;
+		}
+	}
+
+	bool ok = true;
+	Json::Value hashes;
+	for (std::string name : str_split(g_settings->get("benchmark_mapgens"), ',')) {
+		name = trim(name);
+		MapgenType type = Mapgen::getMapgenType(name);
+		if (type == MAPGEN_INVALID) {
+			errorstream << "Benchmark: unknown mapgen " << name << std::endl;
+			ok = false;
+			continue;
+		}
+
+		MapgenPass passes[2];
+		for (auto &pass : passes)
+			generate(emerge, &world.server->getMap(), type, seed, chunks, pass);
+
+		Json::Value &json = result["mapgens"][name];
+		const MapgenPass &pass = passes[1];
+		json["hash"] = pass.hash;
+		json["chunk"] = pass.chunks.toJson();
+		u64 stages_us = 0;
+		for (int stage = 0; stage != MGSTAGE_COUNT; stage++) {
+			json["stages_ms"][mapgen_stage_names[stage]] = pass.stage_us[stage] / 1000.0;
+			stages_us += pass.stage_us[stage];
+		}
+		// Noise and base terrain mostly, everything not in another stage
+		json["stages_ms"]["terrain"] =
+			(pass.chunks.m_total_us - MYMIN(stages_us, pass.chunks.m_total_us)) / 1000.0;
+
+		const u64 layers = pass.layer_hits + pass.layer_misses;
+		json["layer_cache_hit_rate"] = layers ? (double)pass.layer_hits / layers : 0.0;
+
+		json["deterministic"] = passes[0].hash == passes[1].hash;
+		if (passes[0].hash != passes[1].hash) {
+			errorstream << "Benchmark: mapgen " << name
+				<< " made different chunks from the same seed" << std::endl;
+			ok = false;
+		}
+		hashes[name] = pass.hash;
+		if (record)
+			continue;
+
+		if (!stored["hashes"].isMember(name)) {
+			errorstream << "Benchmark: no golden hash of mapgen " << name << " in "
+				<< hashes_path << std::endl;
+			ok = false;
+			continue;
+		}
+		json["matches_stored"] = stored["hashes"][name] == pass.hash;
+		if (stored["hashes"][name] != pass.hash) {
+			errorstream << "Benchmark: mapgen " << name << " hash " << pass.hash
+				<< " differs from the stored " << stored["hashes"][name].asString()
+				<< std::endl;
+			ok = false;
+		}
+	}
+
+	if (record) {
+		Json::Value json;
+		json["game"] = result["game"];
+		json["seed"] = result["seed"];
+		json["chunks"] = result["chunks"];
+		json["hashes"] = hashes;
+		Json::StyledWriter writer;
+		if (!fs::safeWriteToFile(hashes_path, writer.write(json))) {
+			errorstream << "Benchmark: unable to write " << hashes_path << std::endl;
+			return false;
+		}
+	}
+	return ok;
+}
@@ -0,0 +1,113 @@
+/*
+  This file is part of Freeminer.
+
+  Freeminer is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Freeminer  is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Freeminer.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "benchmark/benchmark.h"
+
+#include "constants.h"
+#include "nodetimer.h"
+#include "noise.h"
+#include "settings.h"
+
+/*
+	NodeTimerList alone: benchmark_nodetimers timers (furnaces, saplings,
+	crops) spread over blocks of up to a full block of timers each, set,
+	stepped at dedicated_server_step with every elapsed timer set again
+	like on_timer returning true, and removed.
+*/
+
+class BenchmarkNodeTimer : public BenchmarkBase {
+public:
+	BenchmarkNodeTimer() { BenchmarkManager::registerBenchmark(this); }
+	const char *getName() { return "NodeTimer"; }
+
+	bool run(Json::Value &result);
+};
+
+static BenchmarkNodeTimer g_benchmark_instance;
+
+bool BenchmarkNodeTimer::run(Json::Value &result)
+{
+	const u32 timers_num = g_settings->getU64("benchmark_nodetimers");
+	const u32 ticks = g_settings->getU64("benchmark_ticks");
+	const u64 seed = g_settings->getU64("benchmark_seed");
+	const float dtime = g_settings->getFloat("dedicated_server_step");
+	const u32 per_block = MAP_BLOCKSIZE * MAP_BLOCKSIZE * MAP_BLOCKSIZE;
+
+	PcgRandom rand(seed);
+	std::vector<NodeTimerList> blocks((timers_num + per_block - 1) / per_block * 4);
+	result["timers"] = timers_num;
+	result["blocks"] = (u32)blocks.size();
+	result["ticks"] = ticks;
+
+	auto random_pos = [&]() {
+		return v3s16(rand.range(0, MAP_BLOCKSIZE - 1), rand.range(0, MAP_BLOCKSIZE - 1),
+				rand.range(0, MAP_BLOCKSIZE - 1));
+	};
+	auto random_timeout = [&]() {
+		// Mostly seconds, some minutes
+		return rand.next() % 10 ? rand.range(10, 1000) / 100.0f : rand.range(60, 1200);
+	};
+
+	BenchmarkTimer set_timer;
+	u32 set = 0;
+	set_timer.measure([&] {
+		for (u32 i = 0; i < timers_num; ++i) {
+			// Crowded blocks first, the rest sparse
+			auto &list = blocks[i < timers_num / 2 ? i / per_block : rand.next() % blocks.size()];
+			list.set(NodeTimer(random_timeout(), 0, random_pos()));
+		}
+	});
+	for (const auto &list : blocks)
+		set += list.size();
+	result["set"] = set_timer.toJson();
+	result["timers_set"] = set;
+
+	BenchmarkTimer step_timer;
+	u64 elapsed = 0;
+	for (u32 tick = 0; tick < ticks; ++tick) {
+		step_timer.measure([&] {
+			for (auto &list : blocks) {
+				for (const auto &timer : list.step(dtime)) {
+					list.set(NodeTimer(timer.timeout, 0, timer.position));
+					++elapsed;
+				}
+			}
+		});
+	}
+	result["step"] = step_timer.toJson();
+	result["elapsed"] = (Json::UInt64)elapsed;
+
+	BenchmarkTimer get_timer;
+	u32 found = 0;
+	get_timer.measure([&] {
+		for (u32 i = 0; i < timers_num; ++i)
+			found += blocks[rand.next() % blocks.size()].get(random_pos()).timeout > 0;
+	});
+	result["get"] = get_timer.toJson();
+	result["found"] = found;
+
+	BenchmarkTimer remove_timer;
+	remove_timer.measure([&] {
+		for (auto &list : blocks) {
+			for (u32 i = 0; i < per_block; ++i)
+				list.remove(v3s16(i % MAP_BLOCKSIZE, i / MAP_BLOCKSIZE % MAP_BLOCKSIZE,
+						i / MAP_BLOCKSIZE / MAP_BLOCKSIZE));
+		}
+	});
+	result["remove"] = remove_timer.toJson();
+	return true;
+}
@@ -0,0 +1,97 @@
+/*
+  This file is part of Freeminer.
+
+  Freeminer is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Freeminer  is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Freeminer.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "benchmark/benchmark.h"
+
+#include "environment.h"
+#include "map.h"
+#include "noise.h"
+#include "pathfinder.h"
+#include "server.h"
+#include "settings.h"
+
+/*
+	find_path between random ground positions of generated terrain like
+	mobs walking around, each search done twice: the second one is what a
+	mob asking again before anything changed costs.
+*/
+
+class BenchmarkPathfinder : public BenchmarkBase {
+public:
+	BenchmarkPathfinder() { BenchmarkManager::registerBenchmark(this); }
+	const char *getName() { return "Pathfinder"; }
+
+	bool run(Json::Value &result);
+};
+
+static BenchmarkPathfinder g_benchmark_instance;
+
+bool BenchmarkPathfinder::run(Json::Value &result)
+{
+	const u32 paths_num = g_settings->getU64("benchmark_paths");
+	const s16 distance = g_settings->getS16("benchmark_path_distance");
+	const s16 radius = g_settings->getS16("benchmark_radius");
+	const u64 seed = g_settings->getU64("benchmark_seed");
+
+	result["paths"] = paths_num;
+	result["distance"] = distance;
+	result["radius"] = radius;
+
+	BenchmarkWorld world;
+	if (!world.create(result))
+		return false;
+	auto &env = world.server->getEnv();
+	auto &map = env.getServerMap();
+	world.pregenerate(v3s16(0, world.ground / MAP_BLOCKSIZE, 0), radius, result);
+
+	PcgRandom rand(seed);
+	s32 area = radius * MAP_BLOCKSIZE - MAP_BLOCKSIZE - distance;
+	if (area < 0)
+		area = 0;
+	auto ground = [&](s32 x, s32 z) {
+		return v3s16(x, map.findGroundLevel(v2POS(x, z), false) + 1, z);
+	};
+
+	std::vector<PathRequest> requests(paths_num);
+	for (auto &request : requests) {
+		s32 x = rand.range(-area, area), z = rand.range(-area, area);
+		request.source = ground(x, z);
+		request.destination = ground(x + rand.range(-distance, distance),
+				z + rand.range(-distance, distance));
+		request.searchdistance = distance;
+		request.max_jump = 1;
+		request.max_drop = 3;
+		request.algo = PA_PLAIN_NP;
+	}
+
+	BenchmarkTimer search_timer, cached_timer;
+	u32 found = 0, nodes = 0;
+	for (const auto &request : requests) {
+		auto path = search_timer.measure([&] {
+			return env.getPathfinder().getPath(request);
+		});
+		cached_timer.measure([&] { return env.getPathfinder().getPath(request); });
+		found += !path.empty();
+		nodes += path.size();
+	}
+
+	result["search"] = search_timer.toJson();
+	result["cached"] = cached_timer.toJson();
+	result["found"] = found;
+	result["path_nodes"] = nodes;
+	return true;
+}
@@ -0,0 +1,176 @@
+/*
+  This file is part of Freeminer.
+
+  Freeminer is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Freeminer  is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Freeminer.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "benchmark/benchmark.h"
+
+#include <memory>
+
+#include "map.h"
+#include "mg_schematic.h"
+#include "nodedef.h"
+#include "noise.h"
+#include "settings.h"
+
+/*
+	Large trees (trunk forced, leaves partly left to chance, air never
+	placed) dropped on a mapchunk sized vmanip, compiled schematics
+	against placing node by node like it was done before.
+	Needs no world.
+*/
+
+class BenchmarkSchematic : public BenchmarkBase {
+public:
+	BenchmarkSchematic() { BenchmarkManager::registerBenchmark(this); }
+	const char *getName() { return "Schematic"; }
+
+	bool run(Json::Value &result);
+};
+
+static BenchmarkSchematic g_benchmark_instance;
+
+static void blit_node_by_node(const Schematic &schem, MMVManip *vm, v3s16 p,
+	Rotation rot, bool force_place, INodeDefManager *ndef)
+{
+	const v3s16 &size = schem.size;
+	v3s16 s = (rot == ROTATE_90 || rot == ROTATE_270) ?
+		v3s16(size.Z, size.Y, size.X) : size;
+	for (s16 y = 0; y != s.Y; y++)
+	for (s16 z = 0; z != s.Z; z++)
+	for (s16 x = 0; x != s.X; x++) {
+		v3s16 o;
+		switch (rot) {
+			case ROTATE_90:  o = v3s16(size.X - 1 - z, y, x); break;
+			case ROTATE_180: o = v3s16(size.X - 1 - x, y, size.Z - 1 - z); break;
+			case ROTATE_270: o = v3s16(z, y, size.Z - 1 - x); break;
+			default:         o = v3s16(x, y, z);
+		}
+		u32 vi = vm->m_area.index(p.X + x, p.Y + y, p.Z + z);
+		if (!vm->m_area.contains(vi))
+			continue;
+
+		const MapNode &n = schem.schemdata[(o.Z * size.Y + o.Y) * size.X + o.X];
+		if (n.getContent() == CONTENT_IGNORE)
+			continue;
+		u8 prob = n.param1 & MTSCHEM_PROB_MASK;
+		if (prob == MTSCHEM_PROB_NEVER)
+			continue;
+		if (!force_place && !(n.param1 & MTSCHEM_FORCE_PLACE)) {
+			content_t c = vm->m_data[vi].getContent();
+			if (c != CONTENT_AIR && c != CONTENT_IGNORE)
+				continue;
+		}
+		if (prob != MTSCHEM_PROB_ALWAYS && prob <= myrand_range(1, MTSCHEM_PROB_ALWAYS))
+			continue;
+
+		vm->m_data[vi] = n;
+		vm->m_data[vi].param1 = 0;
+		if (rot)
+			vm->m_data[vi].rotateAlongYAxis(ndef, rot);
+	}
+}
+
+bool BenchmarkSchematic::run(Json::Value &result)
+{
+	const u32 placements = g_settings->getU64("benchmark_schematic_placements");
+	const u64 seed = g_settings->getU64("benchmark_seed");
+	result["placements"] = placements;
+
+	std::unique_ptr<IWritableNodeDefManager> ndef(createNodeDefManager());
+	ContentFeatures f;
+	f.name = "benchmark:stone";
+	content_t c_stone = ndef->set(f.name, f);
+	f.name = "benchmark:tree";
+	f.param_type_2 = CPT2_FACEDIR;
+	content_t c_tree = ndef->set(f.name, f);
+	f = ContentFeatures();
+	f.name = "benchmark:leaves";
+	f.param_type = CPT_LIGHT;
+	f.light_propagates = true;
+	content_t c_leaves = ndef->set(f.name, f);
+
+	const v3s16 size(16, 32, 16);
+	result["size"] = Json::arrayValue;
+	result["size"].append(size.X);
+	result["size"].append(size.Y);
+	result["size"].append(size.Z);
+
+	Schematic schem;
+	schem.m_ndef      = ndef.get();
+	schem.size        = size;
+	schem.schemdata   = new MapNode[size.X * size.Y * size.Z];
+	schem.slice_probs = new u8[size.Y];
+	v3f center(size.X / 2.0 - 0.5, 20, size.Z / 2.0 - 0.5);
+	u32 i = 0;
+	for (s16 z = 0; z != size.Z; z++)
+	for (s16 y = 0; y != size.Y; y++)
+	for (s16 x = 0; x != size.X; x++, i++) {
+		float d = v3f(x, y * 1.5, z).getDistanceFrom(v3f(center.X, center.Y * 1.5, center.Z));
+		MapNode n(CONTENT_AIR, MTSCHEM_PROB_NEVER, 0);
+		if (std::abs(x - center.X) < 1 && std::abs(z - center.Z) < 1 && y < 26)
+			n = MapNode(c_tree, MTSCHEM_PROB_ALWAYS | MTSCHEM_FORCE_PLACE, 0);
+		else if (d < 5.5)
+			n = MapNode(c_leaves, MTSCHEM_PROB_ALWAYS, 0);
+		else if (d < 8)
+			n = MapNode(c_leaves, 0x50, 0);
+		schem.schemdata[i] = n;
+	}
+	for (s16 y = 0; y != size.Y; y++)
+		schem.slice_probs[y] = MTSCHEM_PROB_ALWAYS;
+
+	// A mapchunk with its border, stone up to y = 40
+	MMVManip start(NULL);
+	start.addArea(VoxelArea(v3s16(-16, -16, -16), v3s16(95, 95, 95)));
+	for (s16 z = -16; z <= 95; z++)
+	for (s16 y = -16; y <= 95; y++)
+	for (s16 x = -16; x <= 95; x++)
+		start.setNodeNoRef(v3s16(x, y, z), MapNode(y < 40 ? c_stone : CONTENT_AIR));
+
+	struct Placement {
+		v3s16 p;
+		Rotation rot;
+	};
+	PcgRandom rand(seed);
+	std::vector<Placement> list(placements);
+	for (auto &placement : list) {
+		placement.p = v3s16(rand.range(-8, 80), rand.range(36, 42), rand.range(-8, 80));
+		placement.rot = (Rotation)rand.range(ROTATE_0, ROTATE_270);
+	}
+
+	auto run_placements = [&](bool compiled) {
+		MMVManip vm(NULL);
+		vm.addArea(start.m_area);
+		vm.copyFrom(start.m_data, start.m_area, start.m_area.MinEdge,
+			start.m_area.MinEdge, start.m_area.getExtent());
+		BenchmarkTimer timer;
+		timer.measure([&] {
+			for (const auto &placement : list) {
+				if (compiled)
+					schem.blitToVManip(&vm, placement.p, placement.rot, false);
+				else
+					blit_node_by_node(schem, &vm, placement.p, placement.rot,
+						false, ndef.get());
+			}
+		});
+		return timer.toJson();
+	};
+
+	// The first placement of every rotation compiles it
+	result["compiled"] = run_placements(true);
+	result["compiled_again"] = run_placements(true);
+	result["node_by_node"] = run_placements(false);
+	return true;
+}
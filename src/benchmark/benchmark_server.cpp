@@ -0,0 +1,212 @@
+/*
+  This file is part of Freeminer.
+
+  Freeminer is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Freeminer  is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Freeminer.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "benchmark/benchmark.h"
+
+#include <cmath>
+
+#include "content_sao.h"
+#include "emerge.h"
+#include "environment.h"
+#include "log.h"
+#include "map.h"
+#include "metrics.h"
+#include "nodedef.h"
+#include "noise.h"
+#include "server.h"
+#include "settings.h"
+#include "util/string.h"
+#include "network/networkprotocol.h"
+
+/*
+	Drives all server subsystems of a BenchmarkWorld with a fixed dtime.
+	Fake clients walk in circles around spawn and dig/place nodes, packets
+	sent to them are built as usual and dropped by the connection.
+*/
+
+class BenchmarkServer : public BenchmarkBase {
+public:
+	BenchmarkServer() { BenchmarkManager::registerBenchmark(this); }
+	const char *getName() { return "ServerTick"; }
+
+	bool run(Json::Value &result);
+
+private:
+	struct FakeClient {
+		u16 peer_id;
+		PlayerSAO *sao;
+		float radius;
+		float phase;
+		v3s16 dug_pos;
+		MapNode dug_node;
+		bool dug;
+	};
+
+	PlayerSAO *addFakeClient(Server &server, u16 peer_id, const std::string &name);
+};
+
+static BenchmarkServer g_benchmark_instance;
+
+PlayerSAO *BenchmarkServer::addFakeClient(Server &server, u16 peer_id, const std::string &name)
+{
+	// Same state transitions as a real client handshake
+	server.m_clients.CreateClient(peer_id);
+	auto client = server.m_clients.getClient(peer_id, CS_Created);
+	if (!client)
+		return nullptr;
+	client->setName(name);
+	client->net_proto_version = LATEST_PROTOCOL_VERSION;
+	client->setPendingSerializationVersion(SER_FMT_VER_HIGHEST_WRITE);
+	client->confirmSerializationVersion();
+	server.m_clients.event(peer_id, CSE_Hello);
+	server.m_clients.event(peer_id, CSE_AuthAccept);
+	server.m_clients.event(peer_id, CSE_GotInit2);
+	auto sao = server.StageTwoClientInit(peer_id);
+	server.m_clients.event(peer_id, CSE_SetDefinitionsSent);
+	server.m_clients.event(peer_id, CSE_SetClientReady);
+	return sao;
+}
+
+bool BenchmarkServer::run(Json::Value &result)
+{
+	const u32 ticks = g_settings->getU64("benchmark_ticks");
+	const u16 clients_num = g_settings->getU16("benchmark_clients");
+	const u32 objects_num = g_settings->getU64("benchmark_objects");
+	const u32 liquids_num = g_settings->getU64("benchmark_liquids");
+	const s16 radius = g_settings->getS16("benchmark_radius");
+	const u64 seed = g_settings->getU64("benchmark_seed");
+	const std::string liquid_name = g_settings->get("benchmark_liquid_node");
+	const float dtime = g_settings->getFloat("dedicated_server_step");
+	const u32 max_cycle_ms = 1000 * dtime;
+
+	result["ticks"] = ticks;
+	result["dtime"] = dtime;
+	result["clients"] = clients_num;
+	result["objects"] = objects_num;
+	result["liquids"] = liquids_num;
+	result["radius"] = radius;
+
+	std::map<std::string, BenchmarkTimer> timers;
+	bool ok = true;
+	{
+		BenchmarkWorld world;
+		if (!world.create(result))
+			return false;
+		Server &server = *world.server;
+		auto &env = server.getEnv();
+		auto &map = env.getServerMap();
+		auto *ndef = server.getNodeDefManager();
+		const s16 ground = world.ground;
+
+		world.pregenerate(v3s16(0, ground / MAP_BLOCKSIZE, 0), radius, result);
+
+		PcgRandom rand(seed);
+		s32 area = radius * MAP_BLOCKSIZE;
+
+		std::vector<FakeClient> clients;
+		for (u16 i = 0; i < clients_num; ++i) {
+			FakeClient client;
+			client.peer_id = PEER_ID_SERVER + 100 + i;
+			client.sao = addFakeClient(server, client.peer_id, "benchmark" + itos(i));
+			if (!client.sao) {
+				errorstream << "Benchmark: failed to add fake client " << i << std::endl;
+				ok = false;
+				break;
+			}
+			client.radius = (float)area * (i + 1) / (clients_num + 1);
+			client.phase = i;
+			client.dug = false;
+			clients.push_back(client);
+		}
+
+		auto random_pos = [&](s16 up) {
+			return v3s16(rand.range(-area, area), ground + up, rand.range(-area, area));
+		};
+
+		for (u32 i = 0; i < objects_num; ++i) {
+			v3f pos = intToFloat(random_pos(rand.range(2, 10)), BS);
+			env.addActiveObject(new LuaEntitySAO(&env, pos, "__builtin:item", ""));
+		}
+
+		content_t liquid = ndef->getId(liquid_name);
+		if (liquids_num && liquid == CONTENT_IGNORE)
+			warningstream << "Benchmark: unknown liquid node " << liquid_name << std::endl;
+		else
+			for (u32 i = 0; i < liquids_num; ++i) {
+				auto pos = random_pos(rand.range(1, 5));
+				env.setNode(pos, MapNode(liquid));
+				map.transforming_liquid_add(pos);
+			}
+
+		// Emerge threads are real threads, take their busy time from metrics
+		auto emerge_busy = [&]() {
+			u64 us = 0;
+			for (size_t i = 0; i < server.m_emerge->getThreadsCount(); ++i)
+				us += g_metrics->threadBusy("EmergeThread" + itos(i))->get();
+			return us;
+		};
+		u64 emerge_busy_start = emerge_busy();
+
+		BenchmarkTimer &total = timers["tick"];
+		const u32 dig_every = MYMAX(1, 1 / dtime);
+		float uptime = 0;
+		for (u32 tick = 0; ok && tick < ticks; ++tick) {
+			uptime += dtime;
+			total.measure([&] {
+				for (auto &client : clients) {
+					// about walking speed, 4 nodes per second
+					float angle = client.phase + tick * dtime * 4 / (client.radius + 1);
+					v3f pos(cos(angle) * client.radius, ground + 1, sin(angle) * client.radius);
+					client.sao->setBasePosition(pos * BS);
+
+					// dig every second and put the node back on the next one
+					if (tick % dig_every)
+						continue;
+					if (!client.dug) {
+						client.dug_pos = floatToInt(pos * BS, BS) + v3s16(1, -1, 0);
+						client.dug_node = map.getNodeNoEx(client.dug_pos);
+						env.removeNode(client.dug_pos);
+					} else {
+						env.setNode(client.dug_pos, client.dug_node);
+					}
+					client.dug = !client.dug;
+				}
+
+				timers["server_step"].measure([&] { server.AsyncRunStep(dtime); });
+				timers["objects"].measure([&] { env.step(dtime, uptime, max_cycle_ms); });
+				timers["abm"].measure([&] { env.analyzeBlocks(dtime, max_cycle_ms); });
+				timers["liquid"].measure([&] { map.transformLiquids(&server, max_cycle_ms); });
+				timers["lighting"].measure([&] {
+					int loopcount = 0;
+					map.updateLightingQueue(max_cycle_ms, loopcount);
+				});
+				timers["send_blocks"].measure([&] { server.SendBlocks(dtime); });
+			});
+		}
+
+		timers["emerge_threads"].add(emerge_busy() - emerge_busy_start);
+		// published by env step
+		result["loaded_blocks"] = g_metrics->gauge("freeminer_loaded_blocks", "")->get();
+		result["active_objects"] = g_metrics->gauge("freeminer_active_objects", "")->get();
+		result["liquid_queue"] = map.transforming_liquid_size();
+	}
+
+	for (const auto &timer : timers)
+		result["subsystems"][timer.first] = timer.second.toJson();
+
+	return ok;
+}
@@ -0,0 +1,93 @@
+/*
+  This file is part of Freeminer.
+
+  Freeminer is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Freeminer  is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Freeminer.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "benchmark/benchmark.h"
+
+#include <atomic>
+#include <thread>
+
+#include "emerge.h"
+#include "filesys.h"
+#include "log.h"
+#include "porting.h"
+#include "server.h"
+#include "settings.h"
+#include "subgame.h"
+#include "network/networkprotocol.h"
+#include "util/string.h"
+
+BenchmarkWorld::~BenchmarkWorld()
+{
+	// Server saves the map on shutdown, delete the world after it
+	delete server;
+	if (!m_path.empty())
+		fs::RecursiveDelete(m_path);
+}
+
+bool BenchmarkWorld::create(Json::Value &result, const std::string &game)
+{
+	const std::string id = game.empty() ? g_settings->get("benchmark_game") : game;
+	SubgameSpec gamespec = findSubgame(id);
+	if (!gamespec.isValid()) {
+		errorstream << "Benchmark: game \"" << id << "\" not found" << std::endl;
+		return false;
+	}
+	result["game"] = gamespec.id;
+
+	u64 seed = g_settings->getU64("benchmark_seed");
+	result["seed"] = (Json::UInt64)seed;
+
+	m_path = fs::TempPath() + DIR_DELIM "fm_benchmark_" + itos(porting::getTimeMs());
+	fs::RecursiveDelete(m_path);
+
+	// Subsystem threads are created but never started, everything runs here
+	g_settings->setBool("more_threads", true);
+	g_settings->set("fixed_map_seed", itos(seed));
+
+	server = new Server(m_path, gamespec, false, false);
+
+	ground = server->m_emerge->getSpawnLevelAtPoint(v2s16(0, 0));
+	if (ground == MAX_MAP_GENERATION_LIMIT)
+		ground = 0;
+	result["ground"] = ground;
+	return true;
+}
+
+static void emerge_done(v3s16 blockpos, EmergeAction action, void *param)
+{
+	++*(std::atomic_uint *)param;
+}
+
+void BenchmarkWorld::pregenerate(v3s16 center, s16 radius, Json::Value &result)
+{
+	std::atomic_uint done(0);
+	u32 total = 0;
+	BenchmarkTimer timer;
+	timer.measure([&] {
+		for (s16 x = center.X - radius; x <= center.X + radius; ++x)
+		for (s16 y = center.Y - 2; y <= center.Y + 2; ++y)
+		for (s16 z = center.Z - radius; z <= center.Z + radius; ++z) {
+			if (server->m_emerge->enqueueBlockEmergeEx(v3s16(x, y, z), PEER_ID_INEXISTENT,
+					BLOCK_EMERGE_ALLOW_GEN | BLOCK_EMERGE_FORCE_QUEUE, emerge_done, &done))
+				++total;
+		}
+		while (done < total)
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	});
+	result["pregenerate"] = timer.toJson();
+	result["pregenerate"]["blocks"] = total;
+}
@@ -34,13 +34,26 @@ along with Freeminer.  If not, see <http://www.gnu.org/licenses/>.
 static NoiseParams nparams_caveliquids(0, 1, v3f(150.0, 150.0, 150.0), 776, 3, 0.6, 2.0);
 
 
+////
+//// GroundContentLookup
+////
+
+GroundContentLookup::GroundContentLookup(INodeDefManager *ndef) :
+	m_ground_content(1 << (sizeof(content_t) * 8))
+{
+	for (u32 c = 0; c != m_ground_content.size(); c++)
+		m_ground_content[c] = ndef->get((content_t)c).is_ground_content;
+}
+
+
 ////
 //// CavesNoiseIntersection
 ////
 
 CavesNoiseIntersection::CavesNoiseIntersection(
 	INodeDefManager *nodedef, BiomeManager *biomemgr, v3s16 chunksize,
-	NoiseParams *np_cave1, NoiseParams *np_cave2, s32 seed, float cave_width)
+	NoiseParams *np_cave1, NoiseParams *np_cave2, s32 seed, float cave_width,
+	const GroundContentLookup *ground_content)
 {
 	assert(nodedef);
 	assert(biomemgr);
@@ -48,6 +61,9 @@ CavesNoiseIntersection::CavesNoiseIntersection(
 	m_ndef = nodedef;
 	m_bmgr = biomemgr;
 
+	m_own_ground_content = ground_content ? NULL : new GroundContentLookup(nodedef);
+	m_ground_content = ground_content ? ground_content : m_own_ground_content;
+
 	m_csize = chunksize;
 	m_cave_width = cave_width;
 
@@ -59,6 +75,9 @@ CavesNoiseIntersection::CavesNoiseIntersection(
 	// re-carving the solid overtop placed for blocking sunlight
 	noise_cave1 = new Noise(np_cave1, seed, m_csize.X, m_csize.Y + 1, m_csize.Z);
 	noise_cave2 = new Noise(np_cave2, seed, m_csize.X, m_csize.Y + 1, m_csize.Z);
+
+	m_tunnel.resize(m_csize.X * (m_csize.Y + 1) * m_csize.Z);
+	m_column_tunnel.resize(m_csize.X * m_csize.Z);
 }
 
 
@@ -66,6 +85,34 @@ CavesNoiseIntersection::~CavesNoiseIntersection()
 {
 	delete noise_cave1;
 	delete noise_cave2;
+	delete m_own_ground_content;
+}
+
+
+void CavesNoiseIntersection::calcTunnelMask()
+{
+	const float *n1 = noise_cave1->result;
+	const float *n2 = noise_cave2->result;
+	u8 *tunnel = &m_tunnel[0];
+	const float width = m_cave_width;
+
+	// Branchless over whole rows so the compiler vectorizes it. Same as
+	// contour(): 1 - |v| clamped to 0, rounded to float in the same way
+	for (s16 z = 0; z < m_csize.Z; z++) {
+		u8 *column = &m_column_tunnel[z * m_csize.X];
+		for (s16 x = 0; x < m_csize.X; x++)
+			column[x] = 0;
+
+		for (s16 y = 0; y <= m_csize.Y; y++) {
+			u32 i = z * m_zstride_1d + y * m_ystride;
+			for (s16 x = 0; x < m_csize.X; x++, i++) {
+				float d1 = std::max(1.0f - std::fabs(n1[i]), 0.0f);
+				float d2 = std::max(1.0f - std::fabs(n2[i]), 0.0f);
+				tunnel[i] = d1 * d2 > width;
+				column[x] |= tunnel[i];
+			}
+		}
+	}
 }
 
 
@@ -78,11 +125,17 @@ void CavesNoiseIntersection::generateCaves(MMVManip *vm,
 	noise_cave1->perlinMap3D(nmin.X, nmin.Y - 1, nmin.Z);
 	noise_cave2->perlinMap3D(nmin.X, nmin.Y - 1, nmin.Z);
 
+	calcTunnelMask();
+
 	v3s16 em = vm->m_area.getExtent();
 	u32 index2d = 0;
 
 	for (s16 z = nmin.Z; z <= nmax.Z; z++)
 	for (s16 x = nmin.X; x <= nmax.X; x++, index2d++) {
+		// Nothing to excavate, and without a tunnel no entrance floor
+		if (!m_column_tunnel[index2d])
+			continue;
+
 		bool column_is_open = false;  // Is column open to overground
 		bool is_under_river = false;  // Is column under river water
 		bool is_tunnel = false;  // Is tunnel or tunnel floor
@@ -111,10 +164,7 @@ void CavesNoiseIntersection::generateCaves(MMVManip *vm,
 				continue;
 			}
 			// Ground
-			float d1 = contour(noise_cave1->result[index3d]);
-			float d2 = contour(noise_cave2->result[index3d]);
-
-			if (d1 * d2 > m_cave_width && m_ndef->get(c).is_ground_content) {
+			if (m_tunnel[index3d] && m_ground_content->get(c)) {
 				// In tunnel and ground content, excavate
 				vm->m_data[vi] = MapNode(CONTENT_AIR);
 				is_tunnel = true;
@@ -157,6 +207,7 @@ CavesRandomWalk::CavesRandomWalk(
 	this->water_level    = water_level;
 	this->np_caveliquids = &nparams_caveliquids;
 	this->lava_depth     = DEFAULT_LAVA_DEPTH;
+	this->ground_content = NULL;
 
 	c_water_source = water_source;
 	if (c_water_source == CONTENT_IGNORE)
@@ -414,7 +465,7 @@ void CavesRandomWalk::carveRoute(v3f vec, float f, bool randomize_xz)
 
 				u32 i = vm->m_area.index(p);
 				content_t c = vm->m_data[i].getContent();
-				if (!ndef->get(c).is_ground_content)
+				if (!isGroundContent(c))
 					continue;
 
 				if (large_cave) {
@@ -444,6 +495,12 @@ void CavesRandomWalk::carveRoute(v3f vec, float f, bool randomize_xz)
 }
 
 
+inline bool CavesRandomWalk::isGroundContent(content_t c)
+{
+	return ground_content ? ground_content->get(c) : ndef->get(c).is_ground_content;
+}
+
+
 inline bool CavesRandomWalk::isPosAboveSurface(v3s16 p)
 {
 	if (heightmap != NULL &&
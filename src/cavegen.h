@@ -28,6 +28,20 @@ along with Freeminer.  If not, see <http://www.gnu.org/licenses/>.
 
 class GenerateNotifier;
 
+/*
+	is_ground_content of every content id, looked up for every node the
+	caves carve. Made once by a mapgen, all nodes are defined by then.
+*/
+class GroundContentLookup {
+public:
+	GroundContentLookup(INodeDefManager *ndef);
+
+	bool get(content_t c) const { return m_ground_content[c]; }
+
+private:
+	std::vector<bool> m_ground_content;
+};
+
 /*
 	CavesNoiseIntersection is a cave digging algorithm that carves smooth,
 	web-like, continuous tunnels at points where the density of the intersection
@@ -42,16 +56,24 @@ class GenerateNotifier;
 */
 class CavesNoiseIntersection {
 public:
+	// If ground_content is NULL, a lookup of its own is made
 	CavesNoiseIntersection(INodeDefManager *nodedef, BiomeManager *biomemgr,
 		v3s16 chunksize, NoiseParams *np_cave1, NoiseParams *np_cave2,
-		s32 seed, float cave_width);
+		s32 seed, float cave_width,
+		const GroundContentLookup *ground_content = NULL);
 	~CavesNoiseIntersection();
 
 	void generateCaves(MMVManip *vm, v3s16 nmin, v3s16 nmax, u8 *biomemap);
 
 private:
+	// Sets m_tunnel from both noises, and m_column_tunnel for every x and z
+	// with a tunnel node
+	void calcTunnelMask();
+
 	INodeDefManager *m_ndef;
 	BiomeManager *m_bmgr;
+	const GroundContentLookup *m_ground_content;
+	GroundContentLookup *m_own_ground_content;
 
 	// configurable parameters
 	v3s16 m_csize;
@@ -63,6 +85,10 @@ class CavesNoiseIntersection {
 
 	Noise *noise_cave1;
 	Noise *noise_cave2;
+
+	// Same index as the noise results, 1 where the noises intersect
+	std::vector<u8> m_tunnel;
+	std::vector<u8> m_column_tunnel;
 };
 
 /*
@@ -122,6 +148,9 @@ class CavesRandomWalk {
 	content_t c_lava_source;
 	content_t c_ice;
 
+	// Used instead of ndef for is_ground_content if set
+	const GroundContentLookup *ground_content;
+
 	// ndef is a mandatory parameter.
 	// If gennotify is NULL, generation events are not logged.
 	CavesRandomWalk(INodeDefManager *ndef,
@@ -142,6 +171,7 @@ class CavesRandomWalk {
 	void carveRoute(v3f vec, float f, bool randomize_xz);
 
 	inline bool isPosAboveSurface(v3s16 p);
+	inline bool isGroundContent(content_t c);
 };
 
 /*
@@ -666,6 +666,9 @@ class Client : public con::PeerHandler, public InventoryManager, public IGameDef
 	//std::queue<ClientEvent> m_client_event_queue;
 	bool m_itemdef_received;
 	bool m_nodedef_received;
+	// Zipped definitions found in the disk cache by TOCLIENT_INIT sha1
+	std::string m_cached_itemdef;
+	std::string m_cached_nodedef;
 	ClientMediaDownloader *m_media_downloader;
 
 	// time_of_day speed approximation for old protocol
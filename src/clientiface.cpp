@@ -39,6 +39,7 @@ along with Freeminer.  If not, see <http://www.gnu.org/licenses/>.
 #include "util/numeric.h"
 #include "util/mathconstants.h"
 #include "profiler.h"
+#include "metrics.h"
 #include "gamedef.h"
 
 
@@ -210,16 +211,16 @@ int RemoteClient::GetNextBlocks (
 
 	//infostream<<"d_start="<<d_start<<std::endl;
 
-	static const u16 max_simul_sends_setting = g_settings->getU16
-			("max_simultaneous_block_sends_per_client");
-	static const u16 max_simul_sends_usually = max_simul_sends_setting;
+	static CachedSetting<u16> max_simul_sends_setting("max_simultaneous_block_sends_per_client");
+	const u16 max_simul_sends_usually = max_simul_sends_setting;
 
 	/*
 		Check the time from last addNode/removeNode.
 
 		Decrease send rate if player is building stuff.
 	*/
-	static const auto full_block_send_enable_min_time_from_building = g_settings->getFloat("full_block_send_enable_min_time_from_building");
+	static CachedSetting<float> full_block_send_enable_min_time_from_building(
+			"full_block_send_enable_min_time_from_building");
 	if(m_time_from_building < full_block_send_enable_min_time_from_building)
 	{
 		/*
@@ -259,7 +260,7 @@ int RemoteClient::GetNextBlocks (
 	if (camera_fov <= 0) camera_fov = ((fov+5)*M_PI/180) * 4./3.;
 
 
-	static const auto max_block_send_distance = g_settings->getS16("max_block_send_distance");
+	static CachedSetting<s16> max_block_send_distance("max_block_send_distance");
 	s16 full_d_max = max_block_send_distance;
 	if (wanted_range) {
 		s16 wanted_blocks = wanted_range / MAP_BLOCKSIZE + 1;
@@ -277,8 +278,8 @@ int RemoteClient::GetNextBlocks (
 	//infostream << "Fov from client " << camera_fov << " full_d_max " << full_d_max << std::endl;
 
 	s16 d_max = full_d_max;
-	static const s16 d_max_gen_s = g_settings->getS16("max_block_generate_distance");
-	s16 d_max_gen = MYMIN(d_max_gen_s, wanted_range);
+	static CachedSetting<s16> max_block_generate_distance("max_block_generate_distance");
+	s16 d_max_gen = MYMIN(max_block_generate_distance.get(), wanted_range);
 
 	// Don't loop very much at a time
 	s16 max_d_increment_at_time = 10;
@@ -298,7 +299,7 @@ int RemoteClient::GetNextBlocks (
 
 	int num_blocks_air = 0;
 	int blocks_occlusion_culled = 0;
-	static const bool server_occlusion = g_settings->getBool("server_occlusion");
+	static CachedSetting<bool> server_occlusion("server_occlusion");
 	bool occlusion_culling_enabled = server_occlusion;
 
 	auto cam_pos_nodes = floatToInt(playerpos, BS);
@@ -953,6 +954,7 @@ void ClientInterface::UpdatePlayerList()
 void ClientInterface::send(u16 peer_id,u8 channelnum,
 		SharedBuffer<u8> data, bool reliable)
 {
+	g_metrics->peerSent(peer_id, data.getSize());
 	m_con->Send(peer_id, channelnum, data, reliable);
 }
 
@@ -968,6 +970,7 @@ void ClientInterface::send(u16 peer_id,u8 channelnum,
 void ClientInterface::send(u16 peer_id, u8 channelnum,
 		NetworkPacket* pkt, bool reliable)
 {
+	g_metrics->peerSent(peer_id, pkt->getSize());
 	m_con->Send(peer_id, channelnum, pkt, reliable);
 }
 
@@ -981,6 +984,7 @@ void ClientInterface::sendToAll(u16 channelnum,
 		RemoteClient *client = i->second.get();
 
 		if (client->net_proto_version != 0) {
+			g_metrics->peerSent(client->peer_id, pkt->getSize());
 			m_con->Send(client->peer_id, channelnum, pkt, reliable);
 		}
 	}
@@ -1000,6 +1004,7 @@ void ClientInterface::sendToAll(u16 channelnum,
 
 		if (client->net_proto_version != 0)
 		{
+			g_metrics->peerSent(client->peer_id, data.getSize());
 			m_con->Send(client->peer_id, channelnum, data, reliable);
 		}
 	}
@@ -1114,6 +1119,7 @@ void ClientInterface::CreateClient(u16 peer_id)
 	// Create client
 	auto client = std::shared_ptr<RemoteClient>(new RemoteClient(m_env));
 	client->peer_id = peer_id;
+	g_metrics->peerReset(peer_id);
 	m_clients.set(client->peer_id, client);
 }
 
@@ -242,6 +242,9 @@ class RemoteClient
 	//
 	std::atomic_ushort net_proto_version;
 	u16 net_proto_version_fm;
+	// Definitions the client has cached, from TOSERVER_INIT2
+	std::string cached_itemdef_sha1;
+	std::string cached_nodedef_sha1;
 
 	std::atomic_int m_nearest_unsent_reset;
 	std::atomic_int wanted_range;
@@ -244,7 +244,11 @@ collisionMoveResult collisionMoveSimple(Environment *env, IGameDef *gamedef,
 	/*
 		Collect node boxes in movement range
 	*/
-	std::vector<NearbyCollisionInfo> cinfo;
+	// Reused between calls, entity stepping does not allocate
+	thread_local std::vector<NearbyCollisionInfo> cinfo;
+	thread_local std::vector<MapBlock *> blocks;
+	thread_local std::vector<aabb3f> nodeboxes;
+	cinfo.clear();
 	{
 	//TimeTaker tt2("collisionMoveSimple collect boxes");
 /*
@@ -260,6 +264,17 @@ collisionMoveResult collisionMoveSimple(Environment *env, IGameDef *gamedef,
 	s16 max_y = MYMAX(oldpos_i.Y, newpos_i.Y) + (box_0.MaxEdge.Y / BS) + 1;
 	s16 max_z = MYMAX(oldpos_i.Z, newpos_i.Z) + (box_0.MaxEdge.Z / BS) + 1;
 
+	// Look up every block of the range once
+	v3s16 min_b = getNodeBlockPos(v3s16(min_x, min_y, min_z));
+	v3s16 max_b = getNodeBlockPos(v3s16(max_x, max_y, max_z));
+	v3s16 size_b = max_b - min_b + v3s16(1, 1, 1);
+	blocks.clear();
+	for (s16 z = min_b.Z; z <= max_b.Z; z++)
+	for (s16 y = min_b.Y; y <= max_b.Y; y++)
+	for (s16 x = min_b.X; x <= max_b.X; x++)
+		blocks.push_back(map->getBlockNoCreateNoEx(v3s16(x, y, z)));
+
+	INodeDefManager *nodedef = gamedef->getNodeDefManager();
 	bool any_position_valid = false;
 
 	for(s16 x = min_x; x <= max_x; x++)
@@ -268,57 +283,66 @@ collisionMoveResult collisionMoveSimple(Environment *env, IGameDef *gamedef,
 	{
 		v3s16 p(x,y,z);
 
-		bool is_position_valid;
-		MapNode n = map->getNodeNoEx(p, &is_position_valid);
+		v3s16 blockpos = getNodeBlockPos(p);
+		v3s16 i = blockpos - min_b;
+		MapBlock *block = blocks[(i.Z * size_b.Y + i.Y) * size_b.X + i.X];
+
+		bool is_position_valid = false;
+		MapNode n;
+		if (block)
+			n = block->getNodeNoCheck(p - blockpos * MAP_BLOCKSIZE, &is_position_valid);
 
 		if (is_position_valid) {
 			// Object collides into walkable nodes
 
 			any_position_valid = true;
-			INodeDefManager *nodedef = gamedef->getNodeDefManager();
-			const ContentFeatures &f = nodedef->get(n);
-			if(f.walkable == false)
+			const CollisionShape &shape = nodedef->getCollisionShape(n.getContent());
+			if (shape.type == CollisionShape::COLLISION_NONE)
 				continue;
-			int n_bouncy_value = itemgroup_get(f.groups, "bouncy");
 
-			int neighbors = 0;
-			if (f.drawtype == NDT_NODEBOX && f.node_box.type == NODEBOX_CONNECTED) {
-				v3s16 p2 = p;
+			const aabb3f *begin, *end;
+			if (shape.type == CollisionShape::COLLISION_PARAM2) {
+				nodeboxes.clear();
+				n.getCollisionBoxes(nodedef, &nodeboxes);
+				begin = nodeboxes.data();
+				end = begin + nodeboxes.size();
+			} else {
+				int neighbors = 0;
+				if (shape.type == CollisionShape::COLLISION_CONNECTED) {
+					v3s16 p2 = p;
 
-				p2.Y++;
-				getNeighborConnectingFace(p2, nodedef, map, n, 1, &neighbors);
+					p2.Y++;
+					getNeighborConnectingFace(p2, nodedef, map, n, 1, &neighbors);
 
-				p2 = p;
-				p2.Y--;
-				getNeighborConnectingFace(p2, nodedef, map, n, 2, &neighbors);
+					p2 = p;
+					p2.Y--;
+					getNeighborConnectingFace(p2, nodedef, map, n, 2, &neighbors);
 
-				p2 = p;
-				p2.Z--;
-				getNeighborConnectingFace(p2, nodedef, map, n, 4, &neighbors);
+					p2 = p;
+					p2.Z--;
+					getNeighborConnectingFace(p2, nodedef, map, n, 4, &neighbors);
 
-				p2 = p;
-				p2.X--;
-				getNeighborConnectingFace(p2, nodedef, map, n, 8, &neighbors);
+					p2 = p;
+					p2.X--;
+					getNeighborConnectingFace(p2, nodedef, map, n, 8, &neighbors);
 
-				p2 = p;
-				p2.Z++;
-				getNeighborConnectingFace(p2, nodedef, map, n, 16, &neighbors);
+					p2 = p;
+					p2.Z++;
+					getNeighborConnectingFace(p2, nodedef, map, n, 16, &neighbors);
 
-				p2 = p;
-				p2.X++;
-				getNeighborConnectingFace(p2, nodedef, map, n, 32, &neighbors);
+					p2 = p;
+					p2.X++;
+					getNeighborConnectingFace(p2, nodedef, map, n, 32, &neighbors);
+				}
+				begin = shape.begin(neighbors);
+				end = shape.end(neighbors);
 			}
-			std::vector<aabb3f> nodeboxes;
-			n.getCollisionBoxes(gamedef->ndef(), &nodeboxes, neighbors);
-			for(std::vector<aabb3f>::iterator
-					i = nodeboxes.begin();
-					i != nodeboxes.end(); ++i)
-			{
-				aabb3f box = *i;
+			for (; begin != end; ++begin) {
+				aabb3f box = *begin;
 				box.MinEdge += v3f(x, y, z)*BS;
 				box.MaxEdge += v3f(x, y, z)*BS;
 				cinfo.push_back(NearbyCollisionInfo(false,
-					false, n_bouncy_value, p, box));
+					false, shape.bouncy, p, box));
 			}
 		} else {
 			// Collide with unloaded nodes
@@ -343,7 +367,8 @@ collisionMoveResult collisionMoveSimple(Environment *env, IGameDef *gamedef,
 
 		/* add object boxes to cinfo */
 
-		std::vector<ActiveObject*> objects;
+		thread_local std::vector<ActiveObject*> objects;
+		objects.clear();
 #ifndef SERVER
 		ClientEnvironment *c_env = dynamic_cast<ClientEnvironment*>(env);
 		if (c_env != 0) {
@@ -362,7 +387,8 @@ collisionMoveResult collisionMoveSimple(Environment *env, IGameDef *gamedef,
 			ServerEnvironment *s_env = dynamic_cast<ServerEnvironment*>(env);
 			if (s_env != NULL) {
 				f32 distance = speed_f->getLength();
-				std::vector<u16> s_objects;
+				thread_local std::vector<u16> s_objects;
+				s_objects.clear();
 				s_env->getObjectsInsideRadius(s_objects, *pos_f, distance * 1.5);
 				for (std::vector<u16>::iterator iter = s_objects.begin(); iter != s_objects.end(); ++iter) {
 					ServerActiveObject *current = s_env->getActiveObject(*iter);
@@ -142,7 +142,8 @@ LuaEntitySAO::LuaEntitySAO(ServerEnvironment *env, v3f pos,
 	m_animation_sent(false),
 	m_bone_position_sent(false),
 	m_attachment_parent_id(0),
-	m_attachment_sent(false)
+	m_attachment_sent(false),
+	m_physics_pending(false)
 {
 	m_hp = -1;
 	// Only register type if no environment supplied
@@ -237,6 +238,64 @@ bool LuaEntitySAO::isAttached()
 	return false;
 }
 
+void LuaEntitySAO::stepMovement(float dtime, Movement &state)
+{
+	if(m_prop.physical){
+		aabb3f box = m_prop.collisionbox;
+		box.MinEdge *= BS;
+		box.MaxEdge *= BS;
+		f32 pos_max_d = BS*0.25; // Distance per iteration
+		collisionMoveSimple(m_env,m_env->getGameDef(),
+				pos_max_d, box, m_prop.stepheight, dtime,
+				&state.pos, &state.velocity, state.acceleration,
+				this, m_prop.collideWithObjects);
+	} else {
+		state.pos += dtime * state.velocity + 0.5 * dtime
+				* dtime * state.acceleration;
+		state.velocity += dtime * state.acceleration;
+	}
+
+	if((m_prop.automatic_face_movement_dir) &&
+			(fabs(state.velocity.Z) > 0.001 || fabs(state.velocity.X) > 0.001))
+	{
+		float optimal_yaw = atan2(state.velocity.Z,state.velocity.X) * 180 / M_PI
+				+ m_prop.automatic_face_movement_dir_offset;
+		float max_rotation_delta =
+				dtime * m_prop.automatic_face_movement_max_rotation_per_sec;
+
+		if ((m_prop.automatic_face_movement_max_rotation_per_sec > 0) &&
+			(fabs(state.yaw - optimal_yaw) > max_rotation_delta)) {
+
+			state.yaw = optimal_yaw < state.yaw ? state.yaw - max_rotation_delta : state.yaw + max_rotation_delta;
+		} else {
+			state.yaw = optimal_yaw;
+		}
+	}
+}
+
+bool LuaEntitySAO::stepPhysics(float dtime)
+{
+	// Attached objects follow their parent in step()
+	if (m_removed || m_attachment_parent_id || dtime <= 0)
+		return false;
+	m_physics = {getBasePosition(), m_velocity, m_acceleration, m_yaw};
+	stepMovement(dtime, m_physics);
+	m_physics_pending = true;
+	m_physics_dtime += dtime;
+	return true;
+}
+
+void LuaEntitySAO::applyPhysics()
+{
+	if (!m_physics_pending)
+		return;
+	m_physics_pending = false;
+	setBasePosition(m_physics.pos);
+	m_velocity = m_physics.velocity;
+	m_acceleration = m_physics.acceleration;
+	m_yaw = m_physics.yaw;
+}
+
 void LuaEntitySAO::step(float dtime, bool send_recommended)
 {
 	if(!m_properties_sent)
@@ -271,49 +330,18 @@ void LuaEntitySAO::step(float dtime, bool send_recommended)
 	}
 	else
 	{
-		if(m_prop.physical){
-			aabb3f box = m_prop.collisionbox;
-			box.MinEdge *= BS;
-			box.MaxEdge *= BS;
-			collisionMoveResult moveresult;
-			f32 pos_max_d = BS*0.25; // Distance per iteration
-			v3f p_pos = getBasePosition();
-			v3f p_velocity = m_velocity;
-			v3f p_acceleration = m_acceleration;
-			moveresult = collisionMoveSimple(m_env,m_env->getGameDef(),
-					pos_max_d, box, m_prop.stepheight, dtime,
-					&p_pos, &p_velocity, p_acceleration,
-					this, m_prop.collideWithObjects);
-
-			// Apply results
-			setBasePosition(p_pos);
-			m_velocity = p_velocity;
-			m_acceleration = p_acceleration;
-		} else {
-			v3f p_pos = getBasePosition();
-			p_pos += dtime * m_velocity + 0.5 * dtime
-					* dtime * m_acceleration;
-			setBasePosition(p_pos);
-			m_velocity += dtime * m_acceleration;
-		}
-
-		if((m_prop.automatic_face_movement_dir) &&
-				(fabs(m_velocity.Z) > 0.001 || fabs(m_velocity.X) > 0.001))
-		{
-			float optimal_yaw = atan2(m_velocity.Z,m_velocity.X) * 180 / M_PI
-					+ m_prop.automatic_face_movement_dir_offset;
-			float max_rotation_delta =
-					dtime * m_prop.automatic_face_movement_max_rotation_per_sec;
-
-			if ((m_prop.automatic_face_movement_max_rotation_per_sec > 0) &&
-				(fabs(m_yaw - optimal_yaw) > max_rotation_delta)) {
-
-				m_yaw = optimal_yaw < m_yaw ? m_yaw - max_rotation_delta : m_yaw + max_rotation_delta;
-			} else {
-				m_yaw = optimal_yaw;
-			}
+		// The part of dtime not already moved by stepPhysics()
+		float move_dtime = dtime - m_physics_dtime;
+		if (move_dtime > 0) {
+			Movement state = {getBasePosition(), m_velocity, m_acceleration, m_yaw};
+			stepMovement(move_dtime, state);
+			setBasePosition(state.pos);
+			m_velocity = state.velocity;
+			m_acceleration = state.acceleration;
+			m_yaw = state.yaw;
 		}
 	}
+	m_physics_dtime = 0;
 
 	if(m_registered && (getType() < ACTIVEOBJECT_TYPE_LUACREATURE
 			|| getType() > ACTIVEOBJECT_TYPE_LUAFALLING)) {
@@ -27,6 +27,8 @@ along with Freeminer.  If not, see <http://www.gnu.org/licenses/>.
 #include "itemgroup.h"
 #include "object_properties.h"
 #include "constants.h"
+#include "threading/mutex.h"
+#include <memory>
 
 class UnitSAO: public ServerActiveObject
 {
@@ -69,6 +71,8 @@ class LuaEntitySAO : public UnitSAO
 			const std::string &data);
 	bool isAttached();
 	void step(float dtime, bool send_recommended);
+	bool stepPhysics(float dtime);
+	void applyPhysics();
 	std::string getClientInitializationData(u16 protocol_version);
 	std::string getStaticData();
 	int punch(v3f dir,
@@ -111,6 +115,15 @@ class LuaEntitySAO : public UnitSAO
 	std::string getPropertyPacket();
 	void sendPosition(bool do_interpolate, bool is_movement_end);
 
+	struct Movement {
+		v3f pos;
+		v3f velocity;
+		v3f acceleration;
+		float yaw;
+	};
+	// Moves state by dtime, reads only the world and m_prop
+	void stepMovement(float dtime, Movement &state);
+
 	std::string m_init_name;
 	std::string m_init_state;
 	bool m_registered;
@@ -148,6 +161,10 @@ class LuaEntitySAO : public UnitSAO
 	v3f m_attachment_position;
 	v3f m_attachment_rotation;
 	bool m_attachment_sent;
+
+	// Result of stepPhysics() waiting for applyPhysics()
+	Movement m_physics;
+	bool m_physics_pending;
 };
 
 /*
@@ -381,6 +398,9 @@ class PlayerSAO : public UnitSAO
 public:
 	v3f m_last_good_position;
 	std::atomic_uint m_ms_from_last_respawn;
+	// Inventory as the client has it, base of delta updates
+	std::unique_ptr<Inventory> m_inventory_sent;
+	Mutex m_inventory_sent_mutex;
 private:
 	float m_time_from_last_punch;
 	v3s16 m_nocheat_dig_pos;
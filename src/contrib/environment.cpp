@@ -347,7 +347,8 @@ void ServerEnvironment::nodeUpdate(const v3s16 pos, u16 recursion_limit, int fas
 #if 0
 	ContentFeatures f;
 #endif
-	ItemGroupList groups;
+	static const ItemGroupId falling_node = itemgroup_id("falling_node");
+	static const ItemGroupId float_group = itemgroup_id("float");
 
 	// update nodes around
 	for (s32 x = pos.X - 1; x <= pos.X + 1; x++) {
@@ -367,14 +368,13 @@ void ServerEnvironment::nodeUpdate(const v3s16 pos, u16 recursion_limit, int fas
 				}
 
 				const ContentFeatures &f = ndef->get(n);
-				groups = f.groups;
 				n_bottom = m_map->getNode(v3s16(x, y - 1, z));
 
 				// Check is the node is considered valid to fall
-				if (n_bottom.getContent() != CONTENT_IGNORE && (destroy || itemgroup_get(groups, "falling_node"))) {
+				if (n_bottom.getContent() != CONTENT_IGNORE && (destroy || itemgroup_get(f.group_ratings, falling_node))) {
 					const ContentFeatures &f_under = ndef->get(n_bottom);
 
-					if ((itemgroup_get(groups, "float") == 0 || f_under.liquid_type == LIQUID_NONE) &&
+					if ((itemgroup_get(f.group_ratings, float_group) == 0 || f_under.liquid_type == LIQUID_NONE) &&
 						(f.name.compare(f_under.name) != 0 || (f_under.leveled &&
 							n_bottom.getLevel(ndef) < n_bottom.getMaxLevel(ndef))) &&
 						(!f_under.walkable || f_under.buildable_to)) {
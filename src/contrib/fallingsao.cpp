@@ -136,7 +136,8 @@ void FallingSAO::step(float dtime, bool send_recommended)
 		return;
 	}
 
-	if ((f_under.walkable || (itemgroup_get(f_under.groups, "float") &&
+	static const ItemGroupId float_group = itemgroup_id("float");
+	if ((f_under.walkable || (itemgroup_get(f_under.group_ratings, float_group) &&
 			f_under.liquid_type == LIQUID_NONE))) {
 		const std::string & n_name = ndef->get(m_node).name;
 		if (f_under.leveled && f_under.name.compare(n_name) == 0) {
@@ -151,7 +152,7 @@ void FallingSAO::step(float dtime, bool send_recommended)
 			return;
 		}
 		else if (f_under.buildable_to &&
-				(itemgroup_get(f.groups,"float") == 0 ||
+				(itemgroup_get(f.group_ratings, float_group) == 0 ||
 				 f_under.liquid_type == LIQUID_NONE)) {
 			m_env->removeNode(floatToInt(p_under, BS), fast);
 			return;
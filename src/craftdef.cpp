@@ -76,7 +76,8 @@ static u64 getHashForGrid(CraftHashType type, const std::vector<std::string> &gr
 // Check if input matches recipe
 // Takes recipe groups into account
 static bool inputItemMatchesRecipe(const std::string &inp_name,
-		const std::string &rec_name, IItemDefManager *idef)
+		const std::string &rec_name, IItemDefManager *idef,
+		const CraftDefinition *def)
 {
 	// Exact name
 	if (inp_name == rec_name)
@@ -84,12 +85,19 @@ static bool inputItemMatchesRecipe(const std::string &inp_name,
 
 	// Group
 	if (isGroupRecipeStr(rec_name) && idef->isKnown(inp_name)) {
-		const struct ItemDefinition &def = idef->get(inp_name);
+		const struct ItemDefinition &def_inp = idef->get(inp_name);
+		const std::vector<ItemGroupId> *group_ids = def->getGroupIds(rec_name);
+		if (group_ids) {
+			for (ItemGroupId id : *group_ids)
+				if (itemgroup_get(def_inp.group_ratings, id) == 0)
+					return false;
+			return true;
+		}
 		Strfnd f(rec_name.substr(6));
 		bool all_groups_match = true;
 		do {
 			std::string check_group = f.next(",");
-			if (itemgroup_get(def.groups, check_group) == 0) {
+			if (itemgroup_get(def_inp.group_ratings, itemgroup_id(check_group)) == 0) {
 				all_groups_match = false;
 				break;
 			}
@@ -199,7 +207,7 @@ static void craftDecrementInput(CraftInput &input, IGameDef *gamedef)
 static void craftDecrementOrReplaceInput(CraftInput &input,
 		std::vector<ItemStack> &output_replacements,
 		const CraftReplacements &replacements,
-		IGameDef *gamedef)
+		const CraftDefinition *def, IGameDef *gamedef)
 {
 	if (replacements.pairs.empty()) {
 		craftDecrementInput(input, gamedef);
@@ -217,7 +225,7 @@ static void craftDecrementOrReplaceInput(CraftInput &input,
 		for (std::vector<std::pair<std::string, std::string> >::iterator
 				j = pairs.begin();
 				j != pairs.end(); ++j) {
-			if (inputItemMatchesRecipe(item.name, j->first, gamedef->idef())) {
+			if (inputItemMatchesRecipe(item.name, j->first, gamedef->idef(), def)) {
 				if (item.count == 1) {
 					item.deSerialize(j->second, gamedef->idef());
 					found_replacement = true;
@@ -326,6 +334,46 @@ std::string CraftReplacements::dump() const
 	return os.str();
 }
 
+/*
+	CraftDefinition
+*/
+
+const std::vector<ItemGroupId> *CraftDefinition::getGroupIds(const std::string &rec_name) const
+{
+	auto i = m_group_ids.find(rec_name);
+	return i != m_group_ids.end() ? &i->second : NULL;
+}
+
+void CraftDefinition::internGroups(const std::string &itemstring)
+{
+	// Matched as it is (cooking, fuel, replacements) and as the item name
+	// of the recipe grid, without count
+	std::string name = trim(itemstring);
+	name = name.substr(0, name.find(' '));
+	if (!isGroupRecipeStr(name))
+		return;
+
+	std::vector<ItemGroupId> ids;
+	Strfnd f(name.substr(6));
+	do {
+		ids.push_back(itemgroup_id(f.next(",")));
+	} while (!f.at_end());
+	m_group_ids[name] = ids;
+	m_group_ids[itemstring] = ids;
+}
+
+void CraftDefinition::internGroups(const std::vector<std::string> &itemstrings)
+{
+	for (const std::string &itemstring : itemstrings)
+		internGroups(itemstring);
+}
+
+void CraftDefinition::internGroups(const CraftReplacements &replacements)
+{
+	for (const auto &pair : replacements.pairs)
+		internGroups(pair.first);
+}
+
 /*
 	CraftDefinitionShaped
 */
@@ -392,7 +440,7 @@ bool CraftDefinitionShaped::check(const CraftInput &input, IGameDef *gamedef) co
 
 			if (!inputItemMatchesRecipe(
 					inp_names[inp_y + inp_x],
-					rec_names[rec_y + rec_x], gamedef->idef())) {
+					rec_names[rec_y + rec_x], gamedef->idef(), this)) {
 				return false;
 			}
 		}
@@ -414,7 +462,7 @@ CraftInput CraftDefinitionShaped::getInput(const CraftOutput &output, IGameDef *
 void CraftDefinitionShaped::decrementInput(CraftInput &input, std::vector<ItemStack> &output_replacements,
 	 IGameDef *gamedef) const
 {
-	craftDecrementOrReplaceInput(input, output_replacements, replacements, gamedef);
+	craftDecrementOrReplaceInput(input, output_replacements, replacements, this, gamedef);
 }
 
 CraftHashType CraftDefinitionShaped::getHashType() const
@@ -510,7 +558,7 @@ bool CraftDefinitionShapeless::check(const CraftInput &input, IGameDef *gamedef)
 		for (size_t i=0; i<recipe.size(); i++) {
 			//dstream<<" ("<<input_filtered[i]<<" == "<<recipe_copy[i]<<")";
 			if (!inputItemMatchesRecipe(input_filtered[i], recipe_copy[i],
-					gamedef->idef())) {
+					gamedef->idef(), this)) {
 				all_match = false;
 				break;
 			}
@@ -536,7 +584,7 @@ CraftInput CraftDefinitionShapeless::getInput(const CraftOutput &output, IGameDe
 void CraftDefinitionShapeless::decrementInput(CraftInput &input, std::vector<ItemStack> &output_replacements,
 	IGameDef *gamedef) const
 {
-	craftDecrementOrReplaceInput(input, output_replacements, replacements, gamedef);
+	craftDecrementOrReplaceInput(input, output_replacements, replacements, this, gamedef);
 }
 
 CraftHashType CraftDefinitionShapeless::getHashType() const
@@ -711,7 +759,7 @@ bool CraftDefinitionCooking::check(const CraftInput &input, IGameDef *gamedef) c
 	}
 
 	// Check the single input item
-	return inputItemMatchesRecipe(input_filtered[0], recipe, gamedef->idef());
+	return inputItemMatchesRecipe(input_filtered[0], recipe, gamedef->idef(), this);
 }
 
 CraftOutput CraftDefinitionCooking::getOutput(const CraftInput &input, IGameDef *gamedef) const
@@ -729,7 +777,7 @@ CraftInput CraftDefinitionCooking::getInput(const CraftOutput &output, IGameDef
 void CraftDefinitionCooking::decrementInput(CraftInput &input, std::vector<ItemStack> &output_replacements,
 	IGameDef *gamedef) const
 {
-	craftDecrementOrReplaceInput(input, output_replacements, replacements, gamedef);
+	craftDecrementOrReplaceInput(input, output_replacements, replacements, this, gamedef);
 }
 
 CraftHashType CraftDefinitionCooking::getHashType() const
@@ -803,7 +851,7 @@ bool CraftDefinitionFuel::check(const CraftInput &input, IGameDef *gamedef) cons
 	}
 
 	// Check the single input item
-	return inputItemMatchesRecipe(input_filtered[0], recipe, gamedef->idef());
+	return inputItemMatchesRecipe(input_filtered[0], recipe, gamedef->idef(), this);
 }
 
 CraftOutput CraftDefinitionFuel::getOutput(const CraftInput &input, IGameDef *gamedef) const
@@ -821,7 +869,7 @@ CraftInput CraftDefinitionFuel::getInput(const CraftOutput &output, IGameDef *ga
 void CraftDefinitionFuel::decrementInput(CraftInput &input, std::vector<ItemStack> &output_replacements,
 	IGameDef *gamedef) const
 {
-	craftDecrementOrReplaceInput(input, output_replacements, replacements, gamedef);
+	craftDecrementOrReplaceInput(input, output_replacements, replacements, this, gamedef);
 }
 
 CraftHashType CraftDefinitionFuel::getHashType() const
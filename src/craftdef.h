@@ -163,6 +163,19 @@ class CraftDefinition
 	virtual void initHash(IGameDef *gamedef) = 0;
 
 	virtual std::string dump() const=0;
+
+	// Group ids of a "group:a,b" recipe item name, NULL if it wasn't interned
+	const std::vector<ItemGroupId> *getGroupIds(const std::string &rec_name) const;
+
+protected:
+	// Interns the groups of the "group:" item strings when the definition
+	// is made, matching only looks them up
+	void internGroups(const std::string &itemstring);
+	void internGroups(const std::vector<std::string> &itemstrings);
+	void internGroups(const CraftReplacements &replacements);
+
+private:
+	UNORDERED_MAP<std::string, std::vector<ItemGroupId> > m_group_ids;
 };
 
 /*
@@ -184,7 +197,10 @@ class CraftDefinitionShaped: public CraftDefinition
 			const CraftReplacements &replacements_):
 		output(output_), width(width_), recipe(recipe_),
 		hash_inited(false), replacements(replacements_)
-	{}
+	{
+		internGroups(recipe);
+		internGroups(replacements);
+	}
 	virtual ~CraftDefinitionShaped(){}
 
 	virtual std::string getName() const;
@@ -233,7 +249,10 @@ class CraftDefinitionShapeless: public CraftDefinition
 			const CraftReplacements &replacements_):
 		output(output_), recipe(recipe_),
 		hash_inited(false), replacements(replacements_)
-	{}
+	{
+		internGroups(recipe);
+		internGroups(replacements);
+	}
 	virtual ~CraftDefinitionShapeless(){}
 
 	virtual std::string getName() const;
@@ -320,7 +339,10 @@ class CraftDefinitionCooking: public CraftDefinition
 			const CraftReplacements &replacements_):
 		output(output_), recipe(recipe_), hash_inited(false),
 		cooktime(cooktime_), replacements(replacements_)
-	{}
+	{
+		internGroups(recipe);
+		internGroups(replacements);
+	}
 	virtual ~CraftDefinitionCooking(){}
 
 	virtual std::string getName() const;
@@ -366,7 +388,10 @@ class CraftDefinitionFuel: public CraftDefinition
 			float burntime_,
 			const CraftReplacements &replacements_):
 		recipe(recipe_), hash_inited(false), burntime(burntime_), replacements(replacements_)
-	{}
+	{
+		internGroups(recipe);
+		internGroups(replacements);
+	}
 	virtual ~CraftDefinitionFuel(){}
 
 	virtual std::string getName() const;
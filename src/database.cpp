@@ -72,6 +72,13 @@ v3s16 Database::getIntegerAsBlock(s64 i)
 	return pos;
 }
 
+void Database::loadBlocks(const std::vector<v3s16> &pos, std::vector<std::string> *blocks)
+{
+	blocks->resize(pos.size());
+	for (size_t i = 0; i != pos.size(); i++)
+		loadBlock(pos[i], &(*blocks)[i]);
+}
+
 std::string Database::getBlockAsString(const v3s16 &pos) const {
 	std::ostringstream os;
 	os << "a" << pos.X << "," << pos.Y << "," << pos.Z;
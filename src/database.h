@@ -40,6 +40,8 @@ class Database
 
 	virtual bool saveBlock(const v3s16 &pos, const std::string &data) = 0;
 	virtual void loadBlock(const v3s16 &pos, std::string *block) = 0;
+	// blocks gets one string for every position, empty if not found
+	virtual void loadBlocks(const std::vector<v3s16> &pos, std::vector<std::string> *blocks);
 	virtual bool deleteBlock(const v3s16 &pos) = 0;
 
 	static s64 getBlockAsInteger(const v3s16 &pos);
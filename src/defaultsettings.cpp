@@ -125,6 +125,38 @@ void fm_set_default_settings(Settings *settings) {
 	settings->setDefault("deprecated_lua_api_handling", debug ? "log" : "legacy"); // "log"
 	settings->setDefault("profiler_print_interval", debug ? "10" : "0"); // "0"
 	settings->setDefault("time_taker_enabled", debug ? "5" : "0");
+	settings->setDefault("trace_enable", "false");
+	settings->setDefault("trace_buffer_size", "65536");
+	settings->setDefault("metrics_interval", "0");
+	settings->setDefault("metrics_path", "");
+
+	// Benchmarks (--run-benchmarks)
+	settings->setDefault("benchmark_filter", "");
+	settings->setDefault("benchmark_output", "");
+	settings->setDefault("benchmark_game", "default");
+	settings->setDefault("benchmark_seed", "1");
+	settings->setDefault("benchmark_ticks", "1000");
+	settings->setDefault("benchmark_radius", "4");
+	settings->setDefault("benchmark_clients", "10");
+	settings->setDefault("benchmark_objects", "200");
+	settings->setDefault("benchmark_liquids", "50");
+	settings->setDefault("benchmark_liquid_node", "default:water_source");
+	settings->setDefault("benchmark_collision_entities", "3000");
+	settings->setDefault("benchmark_collision_steps", "200");
+	settings->setDefault("benchmark_collision_nodes", "default:fence_wood,stairs:slab_wood,default:torch,default:ladder_wood,default:water_source");
+	settings->setDefault("benchmark_nodetimers", "100000");
+	settings->setDefault("benchmark_paths", "200");
+	settings->setDefault("benchmark_path_distance", "32");
+	settings->setDefault("benchmark_entities", "10000");
+	settings->setDefault("benchmark_entities_steps", "100");
+	settings->setDefault("benchmark_active_block_players", "100");
+	settings->setDefault("benchmark_active_block_updates", "500");
+	settings->setDefault("benchmark_schematic_placements", "2000");
+	settings->setDefault("benchmark_mapgens", "v5,v6,v7,flat,fractal,valleys,math,indev");
+	settings->setDefault("benchmark_mapgen_game", "minimal");
+	settings->setDefault("benchmark_mapgen_chunks", "2");
+	settings->setDefault("benchmark_mapgen_hashes", "");
+	settings->setDefault("benchmark_mapgen_record", "false");
 
 	// Keymaps
 	settings->setDefault("keymap_zoom", "KEY_KEY_Z");
@@ -247,6 +279,10 @@ void fm_set_default_settings(Settings *settings) {
 	settings->setDefault("server_map_save_interval", "300"); // "5.3"
 	settings->setDefault("sqlite_synchronous", "1"); // "2"
 	settings->setDefault("save_generated_block", "true");
+	settings->setDefault("map_journal", "true");
+	settings->setDefault("active_object_step_threads", threads ? "0" : "1");
+	settings->setDefault("mapgen_placement_threads", "1");
+	settings->setDefault("mapgen_layer_cache_size", "32");
 	settings->setDefault("block_delete_time", threads && arm ? "60" : threads ? "30" : "10");
 
 #if (ENET_IPV6 || MINETEST_PROTO || USE_SCTP)
@@ -24,7 +24,7 @@ along with Freeminer.  If not, see <http://www.gnu.org/licenses/>.
 #include "emerge.h"
 
 #include <iostream>
-#include <queue>
+#include <deque>
 
 #include "util/container.h"
 #include "util/thread.h"
@@ -36,12 +36,15 @@ along with Freeminer.  If not, see <http://www.gnu.org/licenses/>.
 #include "log_types.h"
 #include "map.h"
 #include "mapblock.h"
+#include "mapgen_layer_cache.h"
 #include "mg_biome.h"
 #include "mg_ore.h"
 #include "mg_decoration.h"
 #include "mg_schematic.h"
 #include "nodedef.h"
 #include "profiler.h"
+#include "metrics.h"
+#include "util/arena.h"
 #include "scripting_game.h"
 #include "server.h"
 #include "serverobject.h"
@@ -50,6 +53,13 @@ along with Freeminer.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "threading/thread_pool.h"
 
+struct EmergeBlock {
+	v3s16 pos;
+	BlockEmergeData bedata;
+	EmergeAction action;
+	MapBlock *block;
+};
+
 class EmergeThread : public thread_pool {
 public:
 	bool enable_mapgen_debug_info;
@@ -62,7 +72,8 @@ class EmergeThread : public thread_pool {
 	void signal();
 
 	// Requires queue mutex held
-	bool pushBlock(v3s16 pos);
+	bool pushBlock(v3s16 pos, v3s16 chunkpos);
+	bool hasChunkQueued(v3s16 chunkpos) const { return m_chunks_queued.count(chunkpos); }
 
 	void cancelPendingItems();
 
@@ -77,13 +88,21 @@ class EmergeThread : public thread_pool {
 	Mapgen *m_mapgen;
 
 	Event m_queue_event;
-	std::queue<v3s16> m_block_queue;
+	std::deque<v3s16> m_block_queue;
+	// Blocks of m_block_queue in each chunk, they are emerged together
+	std::map<v3s16, u32> m_chunks_queued;
+
+	// Mapgen scratch memory, released after every chunk
+	Arena m_arena;
 
-	bool popBlockEmerge(v3s16 *pos, BlockEmergeData *bedata);
+	// The first queued block and all others queued of its chunk
+	bool popChunkEmerge(std::vector<EmergeBlock> *blocks);
 
-	EmergeAction getBlockOrStartGen(
-		v3s16 pos, bool allow_gen, MapBlock **block, BlockMakeData *data);
-	MapBlock *finishGen(v3s16 pos, BlockMakeData *bmdata,
+	// Blocks in memory, then the others with one database query, the
+	// chunk is generated once if some of them are still missing
+	void emergeChunk(std::vector<EmergeBlock> &blocks,
+		std::map<v3s16, MapBlock *> *modified_blocks);
+	void finishGen(BlockMakeData *bmdata,
 		std::map<v3s16, MapBlock *> *modified_blocks);
 
 	friend class EmergeManager;
@@ -102,6 +121,9 @@ EmergeManager::EmergeManager(IGameDef *gamedef)
 	this->schemmgr  = new SchematicManager(gamedef);
 	this->gen_notify_on = 0;
 
+	s32 layer_columns = g_settings->getS32("mapgen_layer_cache_size");
+	this->layer_cache = layer_columns > 0 ? new MapgenLayerCache(layer_columns) : NULL;
+
 	// Note that accesses to this variable are not synchronized.
 	// This is because the *only* thread ever starting or stopping
 	// EmergeThreads should be the ServerThread.
@@ -155,13 +177,17 @@ EmergeManager::~EmergeManager()
 		}
 
 		delete thread;
-		delete m_mapgens[i];
 	}
 
+	// None without initMapgens()
+	for (Mapgen *mg : m_mapgens)
+		delete mg;
+
 	delete biomemgr;
 	delete oremgr;
 	delete decomgr;
 	delete schemmgr;
+	delete layer_cache;
 }
 
 
@@ -269,8 +295,9 @@ bool EmergeManager::enqueueBlockEmergeEx(
 		if (entry_already_exists)
 			return true;
 
-		thread = getOptimalThread();
-		thread->pushBlock(blockpos);
+		v3s16 chunkpos = getContainingChunk(blockpos);
+		thread = getOptimalThread(chunkpos);
+		thread->pushBlock(blockpos, chunkpos);
 	}
 
 	thread->signal();
@@ -338,6 +365,13 @@ bool EmergeManager::isBlockUnderground(v3s16 blockpos)
 	return blockpos.Y * (MAP_BLOCKSIZE + 1) <= mgparams->water_level;
 }
 
+static Metrics::Gauge *emerge_queue_metric()
+{
+	static const auto metric = g_metrics->gauge("freeminer_emerge_queue",
+			"Blocks waiting to be loaded or generated");
+	return metric;
+}
+
 bool EmergeManager::pushBlockEmergeData(
 	v3s16 pos,
 	u16 peer_requested,
@@ -377,6 +411,7 @@ bool EmergeManager::pushBlockEmergeData(
 		count_peer++;
 	}
 
+	emerge_queue_metric()->set(m_blocks_enqueued.size());
 	return true;
 }
 
@@ -401,17 +436,24 @@ bool EmergeManager::popBlockEmergeData(v3s16 pos, BlockEmergeData *bedata)
 	count_peer--;
 
 	m_blocks_enqueued.erase(it);
+	emerge_queue_metric()->set(m_blocks_enqueued.size());
 
 	return true;
 }
 
 
-EmergeThread *EmergeManager::getOptimalThread()
+EmergeThread *EmergeManager::getOptimalThread(v3s16 chunkpos)
 {
 	size_t nthreads = m_threads.size();
 
 	FATAL_ERROR_IF(nthreads == 0, "No emerge threads!");
 
+	// The thread with blocks of the chunk queued emerges this one with them
+	for (size_t i = 0; i < nthreads; i++) {
+		if (m_threads[i]->hasChunkQueued(chunkpos))
+			return m_threads[i];
+	}
+
 	size_t index = 0;
 	size_t nitems_lowest = m_threads[0]->m_block_queue.size();
 
@@ -455,9 +497,10 @@ void EmergeThread::signal()
 }
 
 
-bool EmergeThread::pushBlock(v3s16 pos)
+bool EmergeThread::pushBlock(v3s16 pos, v3s16 chunkpos)
 {
-	m_block_queue.push(pos);
+	m_block_queue.push_back(pos);
+	m_chunks_queued[chunkpos]++;
 	return true;
 }
 
@@ -471,12 +514,13 @@ void EmergeThread::cancelPendingItems()
 		v3s16 pos;
 
 		pos = m_block_queue.front();
-		m_block_queue.pop();
+		m_block_queue.pop_front();
 
 		m_emerge->popBlockEmergeData(pos, &bedata);
 
 		runCompletionCallbacks(pos, EMERGE_CANCELLED, bedata.callbacks);
 	}
+	m_chunks_queued.clear();
 }
 
 
@@ -497,72 +541,131 @@ void EmergeThread::runCompletionCallbacks(
 }
 
 
-bool EmergeThread::popBlockEmerge(v3s16 *pos, BlockEmergeData *bedata)
+bool EmergeThread::popChunkEmerge(std::vector<EmergeBlock> *blocks)
 {
 	MutexAutoLock queuelock(m_emerge->m_queue_mutex);
 
 	if (m_block_queue.empty())
 		return false;
 
-	*pos = m_block_queue.front();
-	m_block_queue.pop();
-
-	m_emerge->popBlockEmergeData(*pos, bedata);
+	v3s16 chunkpos = m_emerge->getContainingChunk(m_block_queue.front());
+	auto chunk = m_chunks_queued.find(chunkpos);
+	u32 count = chunk == m_chunks_queued.end() ? 1 : chunk->second;
+	if (chunk != m_chunks_queued.end())
+		m_chunks_queued.erase(chunk);
+
+	auto pop = [&](v3s16 pos) {
+		EmergeBlock eb;
+		eb.pos    = pos;
+		eb.action = EMERGE_CANCELLED;
+		eb.block  = NULL;
+		m_emerge->popBlockEmergeData(pos, &eb.bedata);
+		blocks->push_back(eb);
+	};
+
+	pop(m_block_queue.front());
+	m_block_queue.pop_front();
+
+	// Blocks queued later of the same chunk, in their order
+	for (auto it = m_block_queue.begin(); --count && it != m_block_queue.end(); ) {
+		while (it != m_block_queue.end() &&
+				m_emerge->getContainingChunk(*it) != chunkpos)
+			++it;
+		if (it == m_block_queue.end())
+			break;
+		pop(*it);
+		it = m_block_queue.erase(it);
+	}
 
 	return true;
 }
 
 
-
-
-EmergeAction EmergeThread::getBlockOrStartGen(
-	v3s16 pos, bool allow_gen, MapBlock **block, BlockMakeData *bmdata)
+void EmergeThread::emergeChunk(std::vector<EmergeBlock> &blocks,
+	std::map<v3s16, MapBlock *> *modified_blocks)
 {
-	//MutexAutoLock envlock(m_server->m_env_mutex);
+	static const auto batched = g_metrics->counter("freeminer_emerge_batched_blocks_total",
+			"Blocks emerged together with an earlier queued block of their chunk");
+	batched->add(blocks.size() - 1);
 
+	// 1). Attempt to fetch blocks from memory
+	std::vector<v3s16> load;
 	{
-	MAP_NOTHREAD_LOCK(m_map);
-	// 1). Attempt to fetch block from memory
-	*block = m_map->getBlockNoCreateNoEx(pos, false, true);
-	}
-	if (*block && !(*block)->isDummy()) {
-		if ((*block)->isGenerated())
-			return EMERGE_FROM_MEMORY;
+		MAP_NOTHREAD_LOCK(m_map);
+		for (auto &eb : blocks) {
+			eb.block = m_map->getBlockNoCreateNoEx(eb.pos, false, true);
+			if (eb.block && !eb.block->isDummy() && eb.block->isGenerated())
+				eb.action = EMERGE_FROM_MEMORY;
+			else
+				load.push_back(eb.pos);
+		}
 	}
 
-	{
+	// 2). Attempt to load the others from disk, one query for all of them
+	if (!load.empty())
+		m_map->loadBlocks(load);
+
+	v3s16 gen_pos;
+	bool gen = false;
+	for (auto &eb : blocks) {
+		if (eb.action != EMERGE_CANCELLED)
+			continue;
 		MAP_NOTHREAD_LOCK(m_map);
-		// 2). Attempt to load block from disk if it was not in the memory
-		*block = m_map->loadBlock(pos);
+		eb.block = m_map->getBlockNoCreateNoEx(eb.pos, false, true);
+		if (eb.block && eb.block->isGenerated()) {
+			m_map->prepareBlock(eb.block);
+			eb.action = EMERGE_FROM_DISK;
+		} else if (!gen && (eb.bedata.flags & BLOCK_EMERGE_ALLOW_GEN)) {
+			gen_pos = eb.pos;
+			gen = true;
+		}
 	}
 
-		if (*block && (*block)->isGenerated())
-		{
-		 	MAP_NOTHREAD_LOCK(m_map);
-			m_map->prepareBlock(*block);
-			return EMERGE_FROM_DISK;
-		}
+	// 3). Attempt to generate the chunk, once for all missing blocks
+	BlockMakeData bmdata;
+	if (gen) {
+		MAP_NOTHREAD_LOCK(m_map);
+		gen = m_map->initBlockMake(gen_pos, &bmdata);
+	}
+	if (!gen)
+		return;
 
 	{
-	MAP_NOTHREAD_LOCK(m_map);
-	// 3). Attempt to start generation
-	if (allow_gen && m_map->initBlockMake(pos, bmdata))
-		return EMERGE_GENERATED;
+		ScopeProfiler sp(g_profiler,
+			"EmergeThread: Mapgen::makeChunk", SPT_AVG);
+		TimeTaker t("mapgen::make_block()");
+
+		m_mapgen->makeChunk(&bmdata);
+
+		if (enable_mapgen_debug_info == false)
+			t.stop(true); // Hide output
 	}
 
-/*
-	verbosestream << "EmergeThread::getBlockOrStartGen : cancel pos=" << pos << " block="<< *block;
-	if (*block)
-		verbosestream << "dummy=" << (*block)->isDummy() << " generated="<< (*block)->isGenerated();
-	verbosestream << std::endl;
-*/
+	finishGen(&bmdata, modified_blocks);
 
-	// All attempts failed; cancel this block emerge
-	return EMERGE_CANCELLED;
+	for (auto &eb : blocks) {
+		if (eb.action != EMERGE_CANCELLED)
+			continue;
+
+		eb.action = EMERGE_GENERATED;
+		eb.block = m_map->getBlockNoCreateNoEx(eb.pos, false, true);
+		if (!eb.block) {
+			errorstream << "EmergeThread::emergeChunk: Couldn't grab block we "
+				"just generated: " << PP(eb.pos) << std::endl;
+			continue;
+		}
+
+		EMERGE_DBG_OUT("ended up with: " << analyze_block(eb.block));
+
+		/*
+			Activate the block
+		*/
+		m_server->m_env->activateBlock(eb.block, 0);
+	}
 }
 
 
-MapBlock *EmergeThread::finishGen(v3s16 pos, BlockMakeData *bmdata,
+void EmergeThread::finishGen(BlockMakeData *bmdata,
 	std::map<v3s16, MapBlock *> *modified_blocks)
 {
 	//MutexAutoLock envlock(m_server->m_env_mutex);
@@ -575,13 +678,6 @@ MapBlock *EmergeThread::finishGen(v3s16 pos, BlockMakeData *bmdata,
 	*/
 	m_map->finishBlockMake(bmdata, modified_blocks);
 
-	MapBlock *block = m_map->getBlockNoCreateNoEx(pos, false, true);
-	if (!block) {
-		errorstream << "EmergeThread::finishGen: Couldn't grab block we "
-			"just generated: " << PP(pos) << std::endl;
-		return NULL;
-	}
-
 	v3s16 minp = bmdata->blockpos_min * MAP_BLOCKSIZE;
 	v3s16 maxp = bmdata->blockpos_max * MAP_BLOCKSIZE +
 				 v3s16(1,1,1) * (MAP_BLOCKSIZE - 1);
@@ -605,15 +701,6 @@ MapBlock *EmergeThread::finishGen(v3s16 pos, BlockMakeData *bmdata,
 	} catch (LuaError &e) {
 		m_server->setAsyncFatalError("Lua: " + std::string(e.what()));
 	}
-
-	EMERGE_DBG_OUT("ended up with: " << analyze_block(block));
-
-	/*
-		Activate the block
-	*/
-	m_server->m_env->activateBlock(block, 0);
-
-	return block;
 }
 
 
@@ -630,48 +717,49 @@ void *EmergeThread::run()
 	enable_mapgen_debug_info = m_emerge->enable_mapgen_debug_info;
 
 	reg("EmergeThread" + itos(id), 5);
+	auto metric_busy = g_metrics->threadBusy(m_name);
+	auto metric_arena = g_metrics->gauge("freeminer_mapgen_arena_peak_bytes",
+			"Largest mapgen scratch memory used by one chunk", "thread=\"" + m_name + "\"");
+	size_t arena_peak = 0;
+	ArenaCurrentScope arena_scope(&m_arena);
 
 	while (!stopRequested()) {
+	if (m_arena.used()) {
+		// Everything of the previous chunk is destroyed at this point
+		if (m_arena.peak() > arena_peak) {
+			arena_peak = m_arena.peak();
+			metric_arena->set(arena_peak);
+		}
+		if (enable_mapgen_debug_info)
+			infostream << m_name << ": arena peak=" << m_arena.peak()
+				<< " reserved=" << m_arena.reserved() << std::endl;
+		m_arena.reset();
+		m_arena.resetPeak();
+	}
 	try {
 		std::map<v3s16, MapBlock *> modified_blocks;
-		BlockEmergeData bedata;
-		BlockMakeData bmdata;
-		EmergeAction action;
-		MapBlock *block;
+		std::vector<EmergeBlock> blocks;
 
-		if (!popBlockEmerge(&pos, &bedata)) {
+		if (!popChunkEmerge(&blocks)) {
 			m_queue_event.wait();
 			continue;
 		}
 
+		pos = blocks.front().pos;
 		if (blockpos_over_limit(pos))
 			continue;
 
-		bool allow_gen = bedata.flags & BLOCK_EMERGE_ALLOW_GEN;
-		EMERGE_DBG_OUT("pos=" PP(pos) " allow_gen=" << allow_gen);
+		ScopeMetric metric(metric_busy);
 
-		action = getBlockOrStartGen(pos, allow_gen, &block, &bmdata);
-		if (action == EMERGE_GENERATED) {
-			{
-				ScopeProfiler sp(g_profiler,
-					"EmergeThread: Mapgen::makeChunk", SPT_AVG);
-				TimeTaker t("mapgen::make_block()");
+		EMERGE_DBG_OUT("pos=" PP(pos) " blocks=" << blocks.size());
 
-				m_mapgen->makeChunk(&bmdata);
-
-				if (enable_mapgen_debug_info == false)
-					t.stop(true); // Hide output
-			}
-
-			block = finishGen(pos, &bmdata, &modified_blocks);
-		}
+		emergeChunk(blocks, &modified_blocks);
 
-		runCompletionCallbacks(pos, action, bedata.callbacks);
+		for (const auto &eb : blocks) {
+			runCompletionCallbacks(eb.pos, eb.action, eb.bedata.callbacks);
 
-		if (block) {
-			//modified_blocks[pos] = block;
-		} else if (allow_gen) {
-			verbosestream<<"nothing generated at "<<pos<< " emerge action="<< action <<std::endl;
+			if (!eb.block && (eb.bedata.flags & BLOCK_EMERGE_ALLOW_GEN))
+				verbosestream<<"nothing generated at "<<eb.pos<< " emerge action="<< eb.action <<std::endl;
 		}
 
 		if (modified_blocks.size() > 0)
@@ -46,6 +46,7 @@ class BiomeManager;
 class OreManager;
 class DecorationManager;
 class SchematicManager;
+class MapgenLayerCache;
 
 // Structure containing inputs/outputs for chunk generation
 struct BlockMakeData {
@@ -119,6 +120,10 @@ class EmergeManager {
 	DecorationManager *decomgr;
 	SchematicManager *schemmgr;
 
+	// freeminer: 2D noise of the chunk columns for all mapgens, NULL if
+	// mapgen_layer_cache_size is 0
+	MapgenLayerCache *layer_cache;
+
 	// Methods
 	EmergeManager(IGameDef *gamedef);
 	~EmergeManager();
@@ -128,6 +133,7 @@ class EmergeManager {
 	void startThreads();
 	void stopThreads();
 	bool isRunning();
+	size_t getThreadsCount() const { return m_threads.size(); }
 
 	bool enqueueBlockEmerge(
 		u16 peer_id,
@@ -168,7 +174,7 @@ class EmergeManager {
 	u16 m_qlimit_generate;
 
 	// Requires m_queue_mutex held
-	EmergeThread *getOptimalThread();
+	EmergeThread *getOptimalThread(v3s16 chunkpos);
 
 	bool pushBlockEmergeData(
 		v3s16 pos,
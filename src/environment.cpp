@@ -20,7 +20,9 @@ You should have received a copy of the GNU General Public License
 along with Freeminer.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <algorithm>
 #include <fstream>
+#include <thread>
 #include "environment.h"
 #include "filesys.h"
 #include "porting.h"
@@ -32,9 +34,12 @@ along with Freeminer.  If not, see <http://www.gnu.org/licenses/>.
 #include "settings.h"
 #include "log_types.h"
 #include "profiler.h"
+#include "metrics.h"
 #include "scripting_game.h"
 #include "nodedef.h"
 #include "nodemetadata.h"
+#include "pathfinder.h"
+#include "player_records.h"
 //#include <fstream>
 #include "gamedef.h"
 #ifndef SERVER
@@ -58,6 +63,7 @@ along with Freeminer.  If not, see <http://www.gnu.org/licenses/>.
 #include <random>
 #include "util/basic_macros.h"
 #include "threading/mutex_auto_lock.h"
+#include "threading/worker_pool.h"
 
 std::random_device random_device; // todo: move me to random.h
 std::mt19937 random_gen(random_device());
@@ -447,19 +453,13 @@ void LBMManager::applyLBMs(ServerEnvironment *env, MapBlock *block, u32 stamp)
 	ActiveBlockList
 */
 
-void fillRadiusBlock(v3s16 p0, s16 r, std::set<v3s16> &list)
+void ActiveBlockList::changeRef(v3POS p, s32 diff)
 {
-	v3s16 p;
-	for(p.X=p0.X-r; p.X<=p0.X+r; p.X++)
-	for(p.Y=p0.Y-r; p.Y<=p0.Y+r; p.Y++)
-	for(p.Z=p0.Z-r; p.Z<=p0.Z+r; p.Z++)
-	{
-		// limit to a sphere
-		if (p.getDistanceFrom(p0) <= r) {
-			// Set in list
-			list.insert(p);
-		}
-	}
+	auto &refs = m_refs[p];
+	refs += diff;
+	if (!refs)
+		m_refs.erase(p);
+	m_touched.insert(p);
 }
 
 void ActiveBlockList::update(std::vector<v3s16> &active_positions,
@@ -467,52 +467,81 @@ void ActiveBlockList::update(std::vector<v3s16> &active_positions,
 		std::set<v3s16> &blocks_removed,
 		std::set<v3s16> &blocks_added)
 {
-	/*
-		Create the new list
-	*/
-	std::set<v3s16> newlist = m_forceloaded_list;
-	for(std::vector<v3s16>::iterator i = active_positions.begin();
-			i != active_positions.end(); ++i)
-	{
-		fillRadiusBlock(*i, radius, newlist);
+	if (radius != m_radius) {
+		// Take the old spheres away, they come back with the new radius below
+		for (const auto &center : m_centers)
+			for (const auto &offset : m_sphere)
+				changeRef(center.first + offset, -(s32)center.second);
+		m_centers.clear();
+
+		m_radius = radius;
+		m_sphere.clear();
+		v3POS p;
+		for (p.X = -radius; p.X <= radius; p.X++)
+		for (p.Y = -radius; p.Y <= radius; p.Y++)
+		for (p.Z = -radius; p.Z <= radius; p.Z++)
+			// limit to a sphere
+			if (p.getDistanceFrom(v3POS(0, 0, 0)) <= radius)
+				m_sphere.push_back(p);
 	}
 
 	/*
-		Find out which blocks on the old list are not on the new list
+		Spheres whose number of sources changed
 	*/
-	// Go through old list
-	for(auto i = m_list.begin();
-			i != m_list.end(); ++i)
-	{
-		v3POS p = i->first;
-		// If not on new list, it's been removed
-		if(newlist.find(p) == newlist.end())
-			blocks_removed.insert(p);
+	std::map<v3POS, u32> centers;
+	for (const auto &p : active_positions)
+		++centers[p];
+	std::map<v3POS, s32> moved;
+	for (const auto &center : centers)
+		moved[center.first] += center.second;
+	for (const auto &center : m_centers)
+		moved[center.first] -= center.second;
+	for (const auto &center : moved) {
+		if (!center.second)
+			continue;
+		for (const auto &offset : m_sphere)
+			changeRef(center.first + offset, center.second);
 	}
+	m_centers.swap(centers);
 
 	/*
-		Find out which blocks on the new list are not on the old list
+		Forceloaded blocks
 	*/
-	// Go through new list
-	for(std::set<v3s16>::iterator i = newlist.begin();
-			i != newlist.end(); ++i)
-	{
-		v3s16 p = *i;
-		// If not on old list, it's been added
-		if(m_list.find(p) == m_list.end())
-			blocks_added.insert(p);
-	}
+	for (const auto &p : m_forceloaded_list)
+		if (!m_forceloaded_applied.count(p))
+			changeRef(p, 1);
+	for (const auto &p : m_forceloaded_applied)
+		if (!m_forceloaded_list.count(p))
+			changeRef(p, -1);
+	m_forceloaded_applied = m_forceloaded_list;
+
+	for (const auto &p : m_missing)
+		m_touched.insert(p);
+	m_missing.clear();
 
 	/*
-		Update m_list
+		Only touched blocks can change state
 	*/
-	m_list.clear();
-	for(std::set<v3s16>::iterator i = newlist.begin();
-			i != newlist.end(); ++i)
-	{
-		v3s16 p = *i;
-		m_list.set(p, 1);
+	for (const auto &p : m_touched) {
+		bool wanted = m_refs.count(p);
+		bool active = contains(p);
+		if (wanted && !active) {
+			m_list.set(p, 1);
+			blocks_added.insert(p);
+		} else if (!wanted && active) {
+			m_list.erase(p);
+			blocks_removed.insert(p);
+			// Left again before its turn to be activated
+			blocks_added.erase(p);
+		}
 	}
+	m_touched.clear();
+}
+
+void ActiveBlockList::setMissing(v3POS p)
+{
+	m_list.erase(p);
+	m_missing.push_back(p);
 }
 
 /*
@@ -529,6 +558,7 @@ ServerEnvironment::ServerEnvironment(ServerMap *map,
 	m_script(scriptIface),
 	m_gamedef(gamedef),
 	m_circuit(m_script, map, gamedef->ndef(), path_world),
+	m_pathfinder(new PathfinderManager(*map, gamedef->ndef())),
 	m_path_world(path_world),
 	m_send_recommended_timer(0),
 	m_active_objects_last(0),
@@ -560,6 +590,10 @@ ServerEnvironment::ServerEnvironment(ServerMap *map,
 
 ServerEnvironment::~ServerEnvironment()
 {
+	// Stops the pathfinder thread before the map goes
+	m_pathfinder.reset();
+	m_objects_step_pool.reset();
+
 	// Clear active block list.
 	// This makes the next one delete all active objects.
 	m_active_blocks.clear();
@@ -620,6 +654,12 @@ KeyValueStorage &ServerEnvironment::getKeyValueStorage(std::string name) {
 	return m_key_value_storage.at(name);
 }
 
+PlayerRecords &ServerEnvironment::getPlayerRecords() {
+	if (!m_player_records)
+		m_player_records.reset(new PlayerRecords(getPlayerStorage()));
+	return *m_player_records;
+}
+
 RemotePlayer *ServerEnvironment::getPlayer(const u16 peer_id)
 {
 	auto lock = m_players.lock_shared_rec();
@@ -667,6 +707,8 @@ void ServerEnvironment::removePlayer(RemotePlayer *player)
 	for (std::vector<RemotePlayer *>::iterator it = m_players.begin();
 			it != m_players.end(); ++it) {
 		if ((*it) == player) {
+			if (m_player_records)
+				m_player_records->forget(player->getName());
 			delete *it;
 			m_players.erase(it);
 			return;
@@ -719,9 +761,11 @@ void ServerEnvironment::saveLoadedPlayers()
 	auto it = m_players.begin();
 	while (it != m_players.end()) {
 		auto *player = *it;
-		//if (player->checkModified())
+		// Writes only what changed since the last save
 		savePlayer(player);
 		if(!player->peer_id && !player->getPlayerSAO() && player->refs <= 0) {
+			if (m_player_records)
+				m_player_records->forget(player->getName());
 			delete player;
 			it = m_players.erase(it);
 		} else {
@@ -746,9 +790,7 @@ void ServerEnvironment::savePlayer(RemotePlayer *player)
 {
 	if (!player || !player->getPlayerSAO())
 		return;
-	Json::Value player_json;
-	player_json << *player;
-	getPlayerStorage().put_json("p." + player->getName(), player_json);
+	getPlayerRecords().save(player);
 /*
 	std::string players_path = m_path_world + DIR_DELIM "players";
 	fs::CreateDir(players_path);
@@ -768,17 +810,17 @@ RemotePlayer *ServerEnvironment::loadPlayer(const std::string &playername, Playe
 	}
 
 	try {
-		Json::Value player_json;
-		getPlayerStorage().get_json("p." + playername, player_json);
 		verbosestream<<"Reading kv player "<<playername<<std::endl;
-		if (!player_json.empty()) {
-			player->setPlayerSAO(sao);
-			player_json >> *player;
+		player->setPlayerSAO(sao);
+		if (getPlayerRecords().load(player, playername)) {
 			if (newplayer) {
 				addPlayer(player);
 			}
 			return player;
 		}
+	} catch (SerializationError &e) {
+		errorstream << "Reading kv player " << playername << " failed: "
+			<< e.what() << std::endl;
 	} catch (...)  {
 	}
 
@@ -980,18 +1022,8 @@ void ServerEnvironment::loadDefaultMeta()
 		return active_object_count;
 	}
 
-	void ABMHandler::apply(MapBlock *block, bool activate)
+	bool ABMHandler::findTriggers(MapBlock *block, bool activate)
 	{
-		if(m_aabms_empty)
-			return;
-
-		//infostream<<"ABMHandler::apply p="<<block->getPos()<<" block->abm_triggers="<<block->abm_triggers<<std::endl;
-		{
-			std::lock_guard<Mutex> lock(block->abm_triggers_mutex);
-			if (block->abm_triggers)
-				block->abm_triggers->clear();
-		}
-
 #if ENABLE_THREADS
 		auto map = std::unique_ptr<VoxelManipulator> (new VoxelManipulator);
 		{
@@ -1005,7 +1037,7 @@ void ServerEnvironment::loadDefaultMeta()
 		{
 		//auto lock = block->try_lock_unique_rec();
 		//if (!lock->owns_lock())
-		//	return;
+		//	return false;
 		}
 
 		ScopeProfiler sp(g_profiler, "ABM select", SPT_ADD);
@@ -1015,18 +1047,12 @@ void ServerEnvironment::loadDefaultMeta()
 		u32 active_object_count = this->countObjects(block, &m_env->getServerMap(), active_object_count_wider);
 		m_env->m_added_objects = 0;
 
-		auto *ndef = m_env->getGameDef()->ndef();
-
 #if !ENABLE_THREADS
 		auto lock_map = m_env->getServerMap().m_nothread_locker.try_lock_shared_rec();
 		if (!lock_map->owns_lock())
-			return;
+			return false;
 #endif
 
-		int heat_num = 0;
-		int heat_sum = 0;
-		int humidity_num = 0;
-
 		v3POS bpr = block->getPosRelative();
 		v3s16 p0;
 		for(p0.X=0; p0.X<MAP_BLOCKSIZE; p0.X++)
@@ -1040,29 +1066,8 @@ void ServerEnvironment::loadDefaultMeta()
 			MapNode n = block->getNodeTry(p0);
 #endif
 			content_t c = n.getContent();
-			if (c == CONTENT_IGNORE)
+			if (c == CONTENT_IGNORE || !m_aabms[c])
 				continue;
-
-			{
-				int hot = ((ItemGroupList) ndef->get(n).groups)["hot"];
-				//todo: int cold = ((ItemGroupList) ndef->get(n).groups)["cold"];
-				if (hot) {
-					++heat_num;
-					heat_sum += hot;
-				}
-
-				int humidity = ((ItemGroupList) ndef->get(n).groups)["water"];
-				if (humidity) {
-					++humidity_num;
-				}
-			}
-
-			if (!m_aabms[c]) {
-				if (block->content_only != CONTENT_IGNORE)
-					return;
-				continue;
-			}
-
 			for(auto & ir: *(m_aabms[c])) {
 				auto i = &ir;
 				// Check neighbors
@@ -1100,6 +1105,59 @@ void ServerEnvironment::loadDefaultMeta()
 				block->abm_triggers->emplace_back(abm_trigger_one{i, p, c, active_object_count, active_object_count_wider, neighbor_pos, activate});
 			}
 		}
+		return true;
+	}
+
+	void ABMHandler::apply(MapBlock *block, bool activate)
+	{
+		if(m_aabms_empty)
+			return;
+
+		//infostream<<"ABMHandler::apply p="<<block->getPos()<<" block->abm_triggers="<<block->abm_triggers<<std::endl;
+		{
+			std::lock_guard<Mutex> lock(block->abm_triggers_mutex);
+			if (block->abm_triggers)
+				block->abm_triggers->clear();
+		}
+
+		auto *ndef = m_env->getGameDef()->ndef();
+		static const ItemGroupId hot_id = itemgroup_id("hot");
+		//todo: static const ItemGroupId cold_id = itemgroup_id("cold");
+		static const ItemGroupId water_id = itemgroup_id("water");
+
+		// Heat and humidity come from the content counts, the nodes are
+		// only read when there is a content with ABMs
+		int heat_num = 0;
+		int heat_sum = 0;
+		int humidity_num = 0;
+		bool triggers = false;
+		auto summary = block->getContentSummary();
+		for (const auto &content : summary->contents) {
+			if (content.first == CONTENT_IGNORE)
+				continue;
+			const ContentFeatures &f = ndef->get(content.first);
+			int hot = f.group_ratings.get(hot_id);
+			if (hot) {
+				heat_num += content.second;
+				heat_sum += hot * content.second;
+			}
+			if (f.group_ratings.get(water_id))
+				humidity_num += content.second;
+			if (m_aabms[content.first])
+				triggers = true;
+		}
+
+		if (triggers) {
+			if (!findTriggers(block, activate))
+				return;
+		} else {
+			if (block->content_only != CONTENT_IGNORE)
+				return;
+			static const auto skipped = g_metrics->counter("freeminer_abm_blocks_skipped_total",
+				"Blocks without content of an ABM, their nodes not read");
+			skipped->add(1);
+		}
+
 		if (heat_num) {
 			float heat_avg = heat_sum/heat_num;
 			const int min = 2 * MAP_BLOCKSIZE;
@@ -1603,6 +1661,14 @@ void ServerEnvironment::step(float dtime, float uptime, unsigned int max_cycle_m
 #if ENABLE_THREADS
 	g_profiler->add("SMap: Blocks", getMap().m_blocks.size());
 #endif
+	{
+		static const auto metric_blocks = g_metrics->gauge("freeminer_loaded_blocks",
+				"Map blocks in memory");
+		static const auto metric_objects = g_metrics->gauge("freeminer_active_objects",
+				"Active objects in environment");
+		metric_blocks->set(getMap().m_blocks.size());
+		metric_objects->set(m_active_objects.size());
+	}
 
 	/*
 		Handle players
@@ -1665,7 +1731,8 @@ void ServerEnvironment::step(float dtime, float uptime, unsigned int max_cycle_m
 			players_blockpos.push_back(blockpos);
 		}
 		}
-		if (!m_blocks_added_last && g_settings->getBool("enable_force_load")) {
+		static CachedSetting<bool> enable_force_load("enable_force_load");
+		if (!m_blocks_added_last && enable_force_load) {
 			//TimeTaker timer_s2("force load");
 			auto lock = m_active_objects.try_lock_shared_rec();
 			if (lock->owns_lock())
@@ -1717,7 +1784,7 @@ void ServerEnvironment::step(float dtime, float uptime, unsigned int max_cycle_m
 			v3s16 p = *i;
 			MapBlock *block = m_map->getBlockOrEmerge(p);
 			if(block==NULL){
-				m_active_blocks.m_list.erase(p);
+				m_active_blocks.setMissing(p);
 				continue;
 			}
 
@@ -1885,6 +1952,7 @@ void ServerEnvironment::step(float dtime, float uptime, unsigned int max_cycle_m
 	/*
 		Step script environment (run global on_step())
 	*/
+	m_pathfinder->step();
 	{
 	ScopeProfiler sp(g_profiler, "SEnv: environment_Step AVG", SPT_AVG);
 	TimeTaker timer("environment_Step");
@@ -1902,15 +1970,21 @@ void ServerEnvironment::step(float dtime, float uptime, unsigned int max_cycle_m
 		auto lock = m_active_objects.try_lock_shared_rec();
 		if (lock->owns_lock()) {
 			for(auto & ir : m_active_objects) {
-				objects.emplace_back(ir.second);
+				if (ir.second)
+					objects.emplace_back(ir.second);
 			}
 		}
 	}
+	// Same order every run, Lua sees the objects stepped deterministically
+	std::sort(objects.begin(), objects.end(),
+			[](ServerActiveObject *a, ServerActiveObject *b) { return a->getId() < b->getId(); });
 
 	if (objects.size())
 	{
 		g_profiler->add("SEnv: Objects", objects.size());
 
+		stepObjectsPhysics(objects, uptime, dtime);
+
 		// This helps the objects to send data at the same time
 		bool send_recommended = false;
 		m_send_recommended_timer += dtime;
@@ -1932,7 +2006,7 @@ void ServerEnvironment::step(float dtime, float uptime, unsigned int max_cycle_m
 			++calls;
 
 			// Don't step if is to be removed or stored statically
-			if(!obj || obj->m_removed || obj->m_pending_deactivation)
+			if(obj->m_removed || obj->m_pending_deactivation)
 				continue;
 			// Step object
 			if (!obj->m_uptime_last)  // not very good place, but minimum modifications
@@ -2050,7 +2124,8 @@ int ServerEnvironment::analyzeBlocks(float dtime, unsigned int max_cycle_ms) {
 	}
 
 
-	if (g_settings->getBool("abm_random") && (!m_abm_random_blocks.empty() || m_abm_random_interval.step(dtime, 10.0))) {
+	static CachedSetting<bool> abm_random("abm_random");
+	if (abm_random && (!m_abm_random_blocks.empty() || m_abm_random_interval.step(dtime, 10.0))) {
 		TimeTaker timer("env: random abm " + itos(m_abm_random_blocks.size()));
 
 		u32 end_ms = porting::getTimeMs() + max_cycle_ms/10;
@@ -2432,6 +2507,63 @@ u16 ServerEnvironment::addActiveObjectRaw(ServerActiveObject *object,
 /*
 	Remove objects that satisfy (m_removed && m_known_by_count==0)
 */
+/*
+	Movement of objects without Lua, in parallel. Objects are sharded by
+	2x2x2 blocks so a worker keeps to the same blocks (and its thread local
+	block cache). Every object moves against the others' positions from
+	before the step, results are published in id order afterwards, so the
+	outcome does not depend on the number of threads. Lua on_step runs
+	later on this thread as before.
+*/
+void ServerEnvironment::stepObjectsPhysics(const std::vector<ServerActiveObject*> &objects,
+		float uptime, float dtime)
+{
+	// Smaller steps are cheaper than waking the workers
+	static const size_t min_objects = 64;
+	static CachedSetting<s16> step_threads("active_object_step_threads");
+
+	int threads = step_threads;
+	if (threads <= 0)
+		threads = std::max<int>(std::thread::hardware_concurrency(), 1);
+	if (threads == 1) {
+		m_objects_step_pool.reset();
+		return;
+	}
+	if (objects.size() < min_objects)
+		return;
+	if (!m_objects_step_pool || (int)m_objects_step_pool->workers.size() != threads - 1)
+		m_objects_step_pool.reset(new WorkerPool("ObjectStep", threads - 1));
+
+	ScopeProfiler sp(g_profiler, "SEnv: step objects physics avg", SPT_AVG);
+
+	std::map<v3POS, std::vector<ServerActiveObject*>> shards_map;
+	for (auto obj : objects) {
+		if (obj->m_removed || obj->m_pending_deactivation)
+			continue;
+		v3POS p = getNodeBlockPos(floatToInt(obj->getBasePosition(), BS));
+		shards_map[v3POS(p.X >> 1, p.Y >> 1, p.Z >> 1)].push_back(obj);
+	}
+	std::vector<std::vector<ServerActiveObject*> *> shards;
+	shards.reserve(shards_map.size());
+	for (auto &i : shards_map)
+		shards.push_back(&i.second);
+	g_profiler->avg("SEnv: Object shards", shards.size());
+
+	m_objects_step_pool->forEach(shards.size(), [&](size_t i) {
+		for (auto obj : *shards[i]) {
+			// Same dtime the object gets from step() below
+			float uptime_last = obj->m_uptime_last ? obj->m_uptime_last : uptime - dtime;
+			float obj_dtime = uptime > uptime_last ? uptime - uptime_last : dtime;
+			obj->stepPhysics(obj_dtime - obj->m_physics_dtime);
+		}
+		// Blocks can be unloaded before the next step reaches this worker
+		m_map->getBlockCacheFlush();
+	});
+
+	for (auto obj : objects)
+		obj->applyPhysics();
+}
+
 void ServerEnvironment::removeRemovedObjects(unsigned int max_cycle_ms)
 {
 	TimeTaker timer("ServerEnvironment::removeRemovedObjects()");
@@ -2603,7 +2735,8 @@ void ServerEnvironment::activateObjects(MapBlock *block, u32 dtime_s)
 			<<" ("<<block->m_static_objects.m_stored.size()
 			<<" objects)"<<std::endl;
 */
-	bool large_amount = (block->m_static_objects.m_stored.size() > g_settings->getU16("max_objects_per_block"));
+	static CachedSetting<u16> max_objects_per_block("max_objects_per_block");
+	bool large_amount = (block->m_static_objects.m_stored.size() > max_objects_per_block);
 	if (large_amount) {
 		errorstream<<"suspiciously large amount of objects detected: "
 				<<block->m_static_objects.m_stored.size()<<" in "
@@ -3053,7 +3186,8 @@ void ClientEnvironment::step(float dtime, float uptime, unsigned int max_cycle_m
 
 	// Get some settings
 	bool fly_allowed = m_gamedef->checkLocalPrivilege("fly");
-	bool free_move = fly_allowed && g_settings->getBool("free_move");
+	static CachedSetting<bool> free_move_setting("free_move");
+	bool free_move = fly_allowed && free_move_setting;
 
 	// Get local player
 	LocalPlayer *lplayer = getLocalPlayer();
@@ -3229,7 +3363,9 @@ void ClientEnvironment::step(float dtime, float uptime, unsigned int max_cycle_m
 			const ContentFeatures &f = m_gamedef->ndef()->
 					get(m_map->getNodeNoEx(info.node_p));
 			// Determine fall damage multiplier
-			int addp = itemgroup_get(f.groups, "fall_damage_add_percent");
+			static const ItemGroupId fall_damage_add_percent =
+					itemgroup_id("fall_damage_add_percent");
+			int addp = itemgroup_get(f.group_ratings, fall_damage_add_percent);
 			pre_factor = 1.0 + (float)addp/100.0;
 		}
 		float speed = pre_factor * speed_diff.getLength();
@@ -3356,7 +3492,8 @@ void ClientEnvironment::step(float dtime, float uptime, unsigned int max_cycle_m
 
 	g_profiler->avg("CEnv: num of objects", m_active_objects.size());
 	bool update_lighting = m_active_object_light_update_interval.step(dtime, 1);
-	u32 n = 0, calls = 0, end_ms = porting::getTimeMs() + u32(500/g_settings->getFloat("wanted_fps"));
+	static CachedSetting<float> wanted_fps("wanted_fps");
+	u32 n = 0, calls = 0, end_ms = porting::getTimeMs() + u32(500/wanted_fps);
 	int skipped = 0;
 	static unsigned int cnt = 0;
 	for(auto i = m_active_objects.begin();
@@ -35,6 +35,7 @@ along with Freeminer.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <set>
 #include <list>
+#include <memory>
 #include <queue>
 #include <map>
 #include "irr_v3d.h"
@@ -50,6 +51,7 @@ along with Freeminer.  If not, see <http://www.gnu.org/licenses/>.
 #include "threading/concurrent_vector.h"
 #include <unordered_set>
 #include "util/container.h" // Queue
+#include "util/unordered_map_hash.h"
 #include <array>
 #include "circuit.h"
 #include "key_value_storage.h"
@@ -62,6 +64,9 @@ along with Freeminer.  If not, see <http://www.gnu.org/licenses/>.
 
 class ServerEnvironment;
 class ActiveBlockModifier;
+class PathfinderManager;
+class PlayerRecords;
+class WorkerPool;
 class ServerActiveObject;
 class ITextureSource;
 class IGameDef;
@@ -285,6 +290,12 @@ class LBMManager
 	List of active blocks, used by ServerEnvironment
 */
 
+/*
+	Blocks within radius of the players, force loading objects and
+	forceloaded blocks. Kept incrementally: every block counts the spheres
+	(and forceloads) covering it, an update only touches spheres whose
+	center moved to another block since the last one.
+*/
 class ActiveBlockList
 {
 public:
@@ -293,18 +304,37 @@ class ActiveBlockList
 			std::set<v3s16> &blocks_removed,
 			std::set<v3s16> &blocks_added);
 
+	// Block could not be loaded, the next update adds it again if still wanted
+	void setMissing(v3POS p);
+
 	bool contains(v3s16 p){
 		return (m_list.find(p) != m_list.end());
 	}
 
 	void clear(){
 		m_list.clear();
+		m_refs.clear();
+		m_centers.clear();
+		m_forceloaded_applied.clear();
+		m_missing.clear();
 	}
 
 	maybe_concurrent_unordered_map<v3POS, bool, v3POSHash, v3POSEqual> m_list;
 	std::set<v3s16> m_forceloaded_list;
 
 private:
+	void changeRef(v3POS p, s32 diff);
+
+	unordered_map_v3POS<u32> m_refs;
+	// Blocks whose count changed during the current update
+	unordered_set_v3POS m_touched;
+	// Sphere centers of the last update, with how many sources are there
+	std::map<v3POS, u32> m_centers;
+	std::set<v3s16> m_forceloaded_applied;
+	std::vector<v3POS> m_missing;
+	// Block offsets within radius
+	std::vector<v3POS> m_sphere;
+	s16 m_radius = -1;
 };
 
 struct ActiveABM
@@ -322,6 +352,8 @@ class ABMHandler
 	std::array<std::vector<ActiveABM> *, CONTENT_ID_CAPACITY> m_aabms;
 	std::list<std::vector<ActiveABM>*> m_aabms_list;
 	bool m_aabms_empty;
+	// Reads the nodes for ABM triggers, false if the map is busy
+	bool findTriggers(MapBlock *block, bool activate);
 public:
 	ABMHandler(ServerEnvironment *env);
 	void init(std::vector<ABMWithState> &abms);
@@ -373,14 +405,22 @@ class ServerEnvironment : public Environment
 	IGameDef *getGameDef()
 		{ return m_gamedef; }
 
+	PathfinderManager &getPathfinder()
+		{ return *m_pathfinder; }
+
 	float getSendRecommendedInterval()
 		{ return m_recommended_send_interval; }
 
+	// Runs stepPhysics() of the objects in parallel and applies the results
+	void stepObjectsPhysics(const std::vector<ServerActiveObject*> &objects,
+			float uptime, float dtime);
+
 	//Player * getPlayer(u16 peer_id) { return Environment::getPlayer(peer_id); };
 	//Player * getPlayer(const std::string &name);
 
 	KeyValueStorage &getKeyValueStorage(std::string name = "key_value_storage");
 	KeyValueStorage &getPlayerStorage() { return getKeyValueStorage("players"); };
+	PlayerRecords &getPlayerRecords();
 
 	void kickAllPlayers(AccessDeniedCode reason,
 		const std::string &str_reason, bool reconnect);
@@ -594,9 +634,12 @@ class ServerEnvironment : public Environment
 
 	// Circuit manager
 	Circuit m_circuit;
+	std::unique_ptr<PathfinderManager> m_pathfinder;
 	// Key-value storage
 public:
 	std::unordered_map<std::string, KeyValueStorage> m_key_value_storage;
+	// Writes to the "players" storage, has to go before it
+	std::unique_ptr<PlayerRecords> m_player_records;
 private:
 
 	// World path
@@ -619,6 +662,7 @@ class ServerEnvironment : public Environment
 	IntervalLimiter m_active_blocks_management_interval;
 	IntervalLimiter m_active_block_modifier_interval;
 	IntervalLimiter m_active_blocks_nodemetadata_interval;
+	std::unique_ptr<WorkerPool> m_objects_step_pool;
 	//loop breakers
 	u32 m_active_objects_last;
 	u32 m_active_block_abm_last;
@@ -84,9 +84,12 @@ u32 Map::transformLiquidsReal(Server *m_server, unsigned int max_cycle_ms) {
 	bool debug = 1;
 #endif
 
-	u8 relax = g_settings->getS16("liquid_relax");
-	static int fast_flood = g_settings->getS16("liquid_fast_flood");
-	static int water_level = g_settings->getS16("water_level");
+	static CachedSetting<s16> liquid_relax("liquid_relax");
+	static CachedSetting<s16> liquid_fast_flood("liquid_fast_flood");
+	static CachedSetting<s16> water_level_setting("water_level");
+	u8 relax = liquid_relax;
+	int fast_flood = liquid_fast_flood;
+	int water_level = water_level_setting;
 	s16 liquid_pressure = m_server->m_emerge->mgparams->liquid_pressure;
 	//g_settings->getS16NoEx("liquid_pressure", liquid_pressure);
 
@@ -19,6 +19,7 @@ along with Freeminer.  If not, see <http://www.gnu.org/licenses/>.
 #include "mapblock.h"
 #include "log_types.h"
 #include "profiler.h"
+#include "metrics.h"
 
 #include "nodedef.h"
 #include "environment.h"
@@ -108,6 +109,9 @@ MapBlock * Map::createBlankBlock(v3POS & p) {
 
 	block = createBlankBlockNoInsert(p);
 
+	// Saved from memory from now on, the database has to be read again
+	// once it is unloaded
+	m_db_miss.erase(p);
 	m_blocks.set(p, block);
 
 	return block;
@@ -128,6 +132,9 @@ bool Map::insertBlock(MapBlock *block) {
 
 	// Insert into container
 	m_blocks.set(block_p, block);
+	// Could be modified before it was reachable by save
+	if (block->getModified() >= MOD_STATE_WRITE_NEEDED)
+		blockModified(block_p);
 	return true;
 }
 
@@ -822,6 +829,8 @@ unsigned int Map::updateLightingQueue(unsigned int max_cycle_ms, int & loopcount
 	}
 
 	{
+		static const auto metric_queue = g_metrics->gauge("freeminer_lighting_queue",
+				"Blocks waiting for light update");
 		MutexAutoLock lock(m_lighting_modified_mutex);
 		for (auto & i : processed) {
 			if (m_lighting_modified_blocks.count(i.first)) {
@@ -829,6 +838,7 @@ unsigned int Map::updateLightingQueue(unsigned int max_cycle_ms, int & loopcount
 				m_lighting_modified_blocks.erase(i.first);
 			}
 		}
+		metric_queue->set(m_lighting_modified_blocks.size());
 	}
 
 	//infostream << "light ret=" << ret << " " << loopcount << std::endl;
@@ -21,6 +21,10 @@ void *ServerThread::run()
 	f32 dedicated_server_step = g_settings->getFloat("dedicated_server_step");
 	m_server->AsyncRunStep(0.1, true);
 
+	auto metric_busy = g_metrics->threadBusy(m_name);
+	auto metric_tick = g_metrics->histogram("freeminer_server_tick_seconds", "Server step duration");
+	auto metric_queue = g_metrics->gauge("freeminer_receive_queue", "Incoming network events not processed yet");
+
 	auto time = porting::getTimeMs();
 	while (!stopRequested()) {
 		try {
@@ -28,6 +32,7 @@ void *ServerThread::run()
 			u32 time_now = porting::getTimeMs();
 			{
 			TimeTaker timer("Server AsyncRunStep()");
+			ScopeMetric metric(metric_busy, metric_tick);
 			m_server->AsyncRunStep((time_now - time)/1000.0f);
 			}
 			time = time_now;
@@ -52,6 +57,7 @@ void *ServerThread::run()
 				}
 			}
 			auto events = m_server->m_con.events_size();
+			metric_queue->set(events);
 			if (events) {
 				g_profiler->add("Server: Queue", events);
 			}
@@ -102,12 +108,18 @@ class MapThread : public thread_pool {
 	void * run() {
 		DSTACK(FUNCTION_NAME);
 
+		auto metric_busy = g_metrics->threadBusy(m_name);
 		auto time = porting::getTimeMs();
 		while(!stopRequested()) {
 			auto time_now = porting::getTimeMs();
 			try {
 				m_server->getEnv().getMap().getBlockCacheFlush();
-				if (!m_server->AsyncRunMapStep((time_now - time) / 1000.0f, 1))
+				int ret;
+				{
+				ScopeMetric metric(metric_busy);
+				ret = m_server->AsyncRunMapStep((time_now - time) / 1000.0f, 1);
+				}
+				if (!ret)
 					std::this_thread::sleep_for(std::chrono::milliseconds(200));
 				else
 					std::this_thread::sleep_for(std::chrono::milliseconds(10));
@@ -140,13 +152,21 @@ class SendBlocksThread : public thread_pool {
 		DSTACK(FUNCTION_NAME);
 		BEGIN_DEBUG_EXCEPTION_HANDLER
 
+		auto metric_busy = g_metrics->threadBusy(m_name);
+		auto metric_sent = g_metrics->counter("freeminer_blocks_sent_total", "Map blocks sent to clients");
 		auto time = porting::getTimeMs();
 		while(!stopRequested()) {
 			//infostream<<"S run d="<<m_server->m_step_dtime<< " myt="<<(porting::getTimeMs() - time)/1000.0f<<std::endl;
 			try {
 				m_server->getEnv().getMap().getBlockCacheFlush();
 				auto time_now = porting::getTimeMs();
-				auto sent = m_server->SendBlocks((time_now - time) / 1000.0f);
+				int sent;
+				{
+				TimeTaker timer("Server SendBlocks()");
+				ScopeMetric metric(metric_busy);
+				sent = m_server->SendBlocks((time_now - time) / 1000.0f);
+				}
+				metric_sent->add(sent);
 				time = time_now;
 				std::this_thread::sleep_for(std::chrono::milliseconds(sent ? 5 : 100));
 #if !EXEPTION_DEBUG
@@ -178,13 +198,20 @@ class LiquidThread : public thread_pool {
 		DSTACK(FUNCTION_NAME);
 		BEGIN_DEBUG_EXCEPTION_HANDLER
 
+		auto metric_busy = g_metrics->threadBusy(m_name);
+		auto metric_queue = g_metrics->gauge("freeminer_liquid_queue", "Liquid nodes waiting for transform");
 		unsigned int max_cycle_ms = 1000;
 		while(!stopRequested()) {
 			try {
 				m_server->getEnv().getMap().getBlockCacheFlush();
 				auto time_start = porting::getTimeMs();
 				m_server->getEnv().getMap().getBlockCacheFlush();
+				{
+				TimeTaker timer("Server transformLiquids()");
+				ScopeMetric metric(metric_busy);
 				m_server->getEnv().getMap().transformLiquids(m_server, max_cycle_ms);
+				}
+				metric_queue->set(m_server->getEnv().getMap().transforming_liquid_size());
 				auto time_spend = porting::getTimeMs() - time_start;
 				std::this_thread::sleep_for(std::chrono::milliseconds(time_spend > 300 ? 1 : 300 - time_spend));
 
@@ -215,6 +242,7 @@ class EnvThread : public thread_pool {
 	void * run() {
 		DSTACK(FUNCTION_NAME);
 
+		auto metric_busy = g_metrics->threadBusy(m_name);
 		unsigned int max_cycle_ms = 1000;
 		unsigned int time = porting::getTimeMs();
 		while(!stopRequested()) {
@@ -223,7 +251,10 @@ class EnvThread : public thread_pool {
 				auto ctime = porting::getTimeMs();
 				unsigned int dtimems = ctime - time;
 				time = ctime;
+				{
+				ScopeMetric metric(metric_busy);
 				m_server->getEnv().step(dtimems / 1000.0f, m_server->m_uptime.get(), max_cycle_ms);
+				}
 				std::this_thread::sleep_for(std::chrono::milliseconds(dtimems > 100 ? 1 : 100 - dtimems));
 #if !EXEPTION_DEBUG
 			} catch(std::exception &e) {
@@ -252,6 +283,7 @@ class AbmThread : public thread_pool {
 		DSTACK(FUNCTION_NAME);
 		BEGIN_DEBUG_EXCEPTION_HANDLER
 
+		auto metric_busy = g_metrics->threadBusy(m_name);
 		unsigned int max_cycle_ms = 10000;
 		unsigned int time = porting::getTimeMs();
 		while(!stopRequested()) {
@@ -259,7 +291,10 @@ class AbmThread : public thread_pool {
 				auto ctime = porting::getTimeMs();
 				unsigned int dtimems = ctime - time;
 				time = ctime;
+				{
+				ScopeMetric metric(metric_busy);
 				m_server->getEnv().analyzeBlocks(dtimems / 1000.0f, max_cycle_ms);
+				}
 				std::this_thread::sleep_for(std::chrono::milliseconds(dtimems > 1000 ? 100 : 1000 - dtimems));
 #if !EXEPTION_DEBUG
 			} catch(std::exception &e) {
@@ -359,12 +394,64 @@ int Server::AsyncRunMapStep(float dtime, float dedicated_server_step, bool async
 	return ret;
 }
 
+// A file of the world directory, empty if name is not a plain file name.
+// Names come from mods and chat commands, they must not reach other paths.
+static std::string world_file(const std::string &world_path, const std::string &name)
+{
+	if (name.empty() || name[0] == '.' ||
+			!string_allowed(name, "abcdefghijklmnopqrstuvwxyz"
+				"ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789._-")) {
+		errorstream << "Server: not a file name of the world directory: " << name << std::endl;
+		return "";
+	}
+	return world_path + DIR_DELIM + name;
+}
+
+std::string Server::dumpTrace(const std::string &name) {
+	std::string file = getWorldPath() + DIR_DELIM + "trace-" + itos(time(nullptr)) + ".json";
+	if (!name.empty())
+		file = world_file(getWorldPath(), name);
+	if (file.empty())
+		return "";
+	if (!g_tracer_enabled)
+		warningstream << "Server: dumping trace while tracing is disabled (trace_enable)" << std::endl;
+	if (!g_tracer->dump(file))
+		return "";
+	return file;
+}
+
+std::string Server::dumpMetrics(const std::string &name) {
+	// metrics_path is set by the admin, any path is fine there
+	std::string file = g_settings->get("metrics_path");
+	if (!name.empty())
+		file = world_file(getWorldPath(), name);
+	else if (file.empty())
+		file = getWorldPath() + DIR_DELIM + "metrics.prom";
+	if (file.empty())
+		return "";
+
+	std::map<u16, std::string> peers;
+	for (const auto &client : m_clients.getClientList())
+		peers[client->peer_id] = client->getName();
+
+	std::ostringstream os;
+	g_metrics->write(os);
+	g_metrics->writePeers(os, peers);
+	if (!fs::safeWriteToFile(file, os.str())) {
+		errorstream << "Server: unable to write metrics to " << file << std::endl;
+		return "";
+	}
+	return file;
+}
+
 void Server::deleteDetachedInventory(const std::string &name) {
 	if(m_detached_inventories.count(name) > 0) {
 		infostream << "Server deleting detached inventory \"" << name << "\"" << std::endl;
 		delete m_detached_inventories[name];
 		m_detached_inventories.erase(name);
 	}
+	// A new inventory of this name starts from a full send again
+	m_detached_inventories_sent.erase(name);
 }
 
 void Server::maintenance_start() {
@@ -374,6 +461,7 @@ void Server::maintenance_start() {
 	m_env->getServerMap().m_map_saving_enabled = false;
 	m_env->getServerMap().m_map_loading_enabled = false;
 	m_env->getServerMap().dbase->close();
+	m_env->m_player_records.reset();
 	m_env->m_key_value_storage.clear();
 	stat.close();
 	actionstream << "Server: Starting maintenance: bases closed now." << std::endl;
@@ -4560,7 +4560,7 @@ void Game::handleDigging(GameRunData *runData,
 	// NOTE: Similar piece of code exists on the server side for
 	// cheat detection.
 	// Get digging parameters
-	DigParams params = getDigParams(nodedef_manager->get(n).groups,
+	DigParams params = getDigParams(nodedef_manager->get(n).group_ratings,
 			&playeritem_toolcap);
 
 	// If can't dig, try hand
@@ -4569,7 +4569,7 @@ void Game::handleDigging(GameRunData *runData,
 		const ToolCapabilities *tp = hand.tool_capabilities;
 
 		if (tp)
-			params = getDigParams(nodedef_manager->get(n).groups, tp);
+			params = getDigParams(nodedef_manager->get(n).group_ratings, tp);
 	}
 
 	if (params.diggable == false) {
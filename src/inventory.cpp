@@ -437,6 +437,12 @@ ItemStack ItemStack::peekItem(u32 peekcount) const
 	Inventory
 */
 
+static inline bool itemStacksEqual(const ItemStack &a, const ItemStack &b)
+{
+	return a.name == b.name && a.count == b.count && a.wear == b.wear &&
+			a.metadata == b.metadata;
+}
+
 InventoryList::InventoryList(std::string name, u32 size, IItemDefManager *itemdef)
 {
 	m_name = name;
@@ -504,6 +510,49 @@ void InventoryList::serialize(std::ostream &os) const
 	os<<"EndInventoryList\n";
 }
 
+/*
+	Delta: u32 size, u32 width, u32 count, count times
+	u32 index, string name, u16 count, u16 wear, long string metadata
+*/
+void InventoryList::serializeDelta(std::ostream &os, const InventoryList *old) const
+{
+	std::vector<u32> changed;
+	for (u32 i = 0; i < m_items.size(); i++) {
+		if (old ? i >= old->m_items.size() || !itemStacksEqual(m_items[i], old->m_items[i]) :
+				!m_items[i].empty())
+			changed.push_back(i);
+	}
+
+	writeU32(os, m_size);
+	writeU32(os, m_width);
+	writeU32(os, changed.size());
+	for (u32 i : changed) {
+		const ItemStack &item = m_items[i];
+		writeU32(os, i);
+		os << serializeString(item.name);
+		writeU16(os, item.count);
+		writeU16(os, item.wear);
+		os << serializeLongString(item.metadata);
+	}
+}
+
+void InventoryList::deSerializeDelta(std::istream &is)
+{
+	setSize(readU32(is));
+	m_width = readU32(is);
+	u32 count = readU32(is);
+	for (u32 n = 0; n < count; n++) {
+		u32 i = readU32(is);
+		if (i >= m_size)
+			throw SerializationError("delta item index out of range");
+		ItemStack &item = m_items[i];
+		item.name = deSerializeString(is);
+		item.count = readU16(is);
+		item.wear = readU16(is);
+		item.metadata = deSerializeLongString(is);
+	}
+}
+
 void InventoryList::deSerialize(std::istream &is)
 {
 	//is.imbue(std::locale("C"));
@@ -582,10 +631,7 @@ bool InventoryList::operator == (const InventoryList &other) const
 		return false;
 	for(u32 i=0; i<m_items.size(); i++)
 	{
-		ItemStack s1 = m_items[i];
-		ItemStack s2 = other.m_items[i];
-		if(s1.name != s2.name || s1.wear!= s2.wear || s1.count != s2.count ||
-				s1.metadata != s2.metadata)
+		if(!itemStacksEqual(m_items[i], other.m_items[i]))
 			return false;
 	}
 
@@ -1007,6 +1053,65 @@ void Inventory::deSerialize(std::istream &is)
 	}
 }
 
+/*
+	Delta: u16 count, count times string list name, u8 state and
+	unless removed the list delta
+*/
+enum {
+	DELTA_LIST_REMOVED,
+	DELTA_LIST_CHANGED,
+	// Receiver starts from an empty list, only the used slots follow
+	DELTA_LIST_NEW,
+};
+
+void Inventory::serializeDelta(std::ostream &os, const Inventory &old) const
+{
+	std::vector<std::pair<const InventoryList *, const InventoryList *> > changed;
+	for (const InventoryList *list : m_lists) {
+		const InventoryList *old_list = old.getList(list->getName());
+		if (!old_list || *list != *old_list)
+			changed.push_back(std::make_pair(list, old_list));
+	}
+	std::vector<std::string> removed;
+	for (const InventoryList *old_list : old.m_lists) {
+		if (getListIndex(old_list->getName()) == -1)
+			removed.push_back(old_list->getName());
+	}
+
+	writeU16(os, changed.size() + removed.size());
+	for (const auto &i : changed) {
+		os << serializeString(i.first->getName());
+		writeU8(os, i.second ? DELTA_LIST_CHANGED : DELTA_LIST_NEW);
+		i.first->serializeDelta(os, i.second);
+	}
+	for (const auto &name : removed) {
+		os << serializeString(name);
+		writeU8(os, DELTA_LIST_REMOVED);
+	}
+}
+
+void Inventory::deSerializeDelta(std::istream &is)
+{
+	u16 count = readU16(is);
+	for (u16 n = 0; n < count; n++) {
+		std::string name = deSerializeString(is);
+		u8 state = readU8(is);
+		if (state == DELTA_LIST_REMOVED) {
+			deleteList(name);
+			continue;
+		}
+		InventoryList *list = getList(name);
+		if (!list) {
+			list = addList(name, 0);
+			if (!list)
+				throw SerializationError("invalid inventory list name: " + name);
+		} else if (state == DELTA_LIST_NEW) {
+			list->setSize(0);
+		}
+		list->deSerializeDelta(is);
+	}
+}
+
 InventoryList * Inventory::addList(const std::string &name, u32 size)
 {
 	m_dirty = true;
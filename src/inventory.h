@@ -183,6 +183,9 @@ class InventoryList
 	void setName(const std::string &name);
 	void serialize(std::ostream &os) const;
 	void deSerialize(std::istream &is);
+	// Binary, only the slots which differ from old (NULL: the used ones)
+	void serializeDelta(std::ostream &os, const InventoryList *old) const;
+	void deSerializeDelta(std::istream &is);
 
 	InventoryList(const InventoryList &other);
 	InventoryList & operator = (const InventoryList &other);
@@ -280,6 +283,10 @@ class Inventory
 
 	void serialize(std::ostream &os) const;
 	void deSerialize(std::istream &is);
+	// Binary update for a receiver which has old: changed slots of changed
+	// lists and the removed lists
+	void serializeDelta(std::ostream &os, const Inventory &old) const;
+	void deSerializeDelta(std::istream &is);
 
 	InventoryList * addList(const std::string &name, u32 size);
 	InventoryList * getList(const std::string &name);
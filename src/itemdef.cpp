@@ -83,6 +83,7 @@ ItemDefinition& ItemDefinition::operator=(const ItemDefinition &def)
 				*def.tool_capabilities);
 	}
 	groups = def.groups;
+	group_ratings = def.group_ratings;
 	node_placement_prediction = def.node_placement_prediction;
 	sound_place = def.sound_place;
 	sound_place_failed = def.sound_place_failed;
@@ -119,6 +120,7 @@ void ItemDefinition::reset()
 		tool_capabilities = NULL;
 	}
 	groups.clear();
+	group_ratings = ItemGroupRatings();
 	sound_place = SimpleSoundSpec();
 	sound_place_failed = SimpleSoundSpec();
 	range = -1;
@@ -523,6 +525,8 @@ class CItemDefManager: public IWritableItemDefManager
 			m_item_definitions[def.name] = new ItemDefinition(def);
 		else
 			*(m_item_definitions[def.name]) = def;
+		ItemDefinition *stored = m_item_definitions[def.name];
+		stored->group_ratings.set(stored->groups);
 
 		// Remove conflicting alias if it exists
 		bool alias_removed = (m_aliases.erase(def.name) != 0);
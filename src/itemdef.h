@@ -98,6 +98,7 @@ struct ItemDefinition
 	// May be NULL. If non-NULL, deleted by destructor
 	ToolCapabilities *tool_capabilities;
 	ItemGroupList groups;
+	ItemGroupRatings group_ratings; // groups by id, set by the manager
 	SimpleSoundSpec sound_place;
 	SimpleSoundSpec sound_place_failed;
 	f32 range;
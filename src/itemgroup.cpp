@@ -0,0 +1,60 @@
+/*
+This file is part of Freeminer.
+
+Freeminer is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Freeminer  is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Freeminer.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "itemgroup.h"
+
+#include <algorithm>
+#include "threading/lock.h"
+
+ItemGroupId itemgroup_id(const std::string &name)
+{
+	static try_shared_mutex mutex;
+	static UNORDERED_MAP<std::string, ItemGroupId> ids;
+
+	{
+		try_shared_lock lock(mutex);
+		auto i = ids.find(name);
+		if (i != ids.end())
+			return i->second;
+	}
+	unique_lock lock(mutex);
+	auto i = ids.find(name);
+	if (i != ids.end())
+		return i->second;
+	if (ids.size() >= ITEMGROUP_INVALID)
+		return ITEMGROUP_INVALID;
+	ItemGroupId id = ids.size();
+	ids.emplace(name, id);
+	return id;
+}
+
+void ItemGroupRatings::set(const ItemGroupList &groups)
+{
+	m_bits.clear();
+	m_ratings.clear();
+	m_ratings.reserve(groups.size());
+	for (const auto &i : groups) {
+		ItemGroupId id = itemgroup_id(i.first);
+		if (id == ITEMGROUP_INVALID)
+			continue;
+		m_ratings.emplace_back(id, i.second);
+		if (m_bits.size() <= id / 64u)
+			m_bits.resize(id / 64 + 1, 0);
+		m_bits[id / 64] |= (u64)1 << (id % 64);
+	}
+	std::sort(m_ratings.begin(), m_ratings.end());
+}
@@ -24,6 +24,9 @@ along with Freeminer.  If not, see <http://www.gnu.org/licenses/>.
 #define ITEMGROUP_HEADER
 
 #include <string>
+#include <utility>
+#include <vector>
+#include "irrlichttypes.h"
 #include "util/cpp11_container.h"
 
 typedef UNORDERED_MAP<std::string, int> ItemGroupList;
@@ -37,5 +40,56 @@ static inline int itemgroup_get(const ItemGroupList &groups,
 	return i->second;
 }
 
+/*
+	Group names interned to small ids, process wide and never freed.
+	Hot paths keep the id of a constant name in a static:
+		static const ItemGroupId id = itemgroup_id("falling_node");
+*/
+typedef u16 ItemGroupId;
+// Returned when the id space is exhausted, no definition has this group
+const ItemGroupId ITEMGROUP_INVALID = 0xffff;
+
+ItemGroupId itemgroup_id(const std::string &name);
+
+/*
+	Ratings of a definition keyed by group id: membership bitset and a
+	sorted flat array, built once at registration from the ItemGroupList.
+*/
+class ItemGroupRatings
+{
+public:
+	void set(const ItemGroupList &groups);
+
+	bool has(ItemGroupId id) const
+	{
+		size_t word = id / 64;
+		return word < m_bits.size() && (m_bits[word] >> (id % 64)) & 1;
+	}
+
+	int get(ItemGroupId id) const
+	{
+		if (!has(id))
+			return 0;
+		size_t lo = 0, hi = m_ratings.size();
+		while (lo < hi) {
+			size_t mid = (lo + hi) / 2;
+			if (m_ratings[mid].first < id)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		return m_ratings[lo].second;
+	}
+
+private:
+	std::vector<u64> m_bits;
+	std::vector<std::pair<ItemGroupId, int> > m_ratings;
+};
+
+static inline int itemgroup_get(const ItemGroupRatings &groups, ItemGroupId id)
+{
+	return groups.get(id);
+}
+
 #endif
 
@@ -23,6 +23,9 @@
 #include "log.h"
 #include "util/pointer.h"
 #include "util/string.h"
+#if USE_LEVELDB
+#include <leveldb/write_batch.h>
+#endif
 
 KeyValueStorage::KeyValueStorage(const std::string &savedir, const std::string &name) :
 	db(nullptr),
@@ -169,6 +172,23 @@ bool KeyValueStorage::del(const std::string &key) {
 #endif
 }
 
+bool KeyValueStorage::write(const std::map<std::string, std::string> &put,
+		const std::set<std::string> &del) {
+	if (!db)
+		return false;
+#if USE_LEVELDB
+	leveldb::WriteBatch batch;
+	for (const auto &i : put)
+		batch.Put(i.first, i.second);
+	for (const auto &key : del)
+		batch.Delete(key);
+	auto status = db->Write(write_options, &batch);
+	return process_status(status);
+#else
+	return true;
+#endif
+}
+
 #if USE_LEVELDB
 leveldb::Iterator* KeyValueStorage::new_iterator() {
 	if (!db)
@@ -18,6 +18,8 @@
 #ifndef KEY_VALUE_STORAGE_H
 #define KEY_VALUE_STORAGE_H
 
+#include <map>
+#include <set>
 #include <string>
 #include "threading/mutex.h"
 
@@ -42,6 +44,9 @@ class KeyValueStorage {
 	bool get(const std::string & key, float &data);
 	bool get_json(const std::string & key, Json::Value & data);
 	bool del(const std::string & key);
+	// Puts and deletes in one write, all or none of them
+	bool write(const std::map<std::string, std::string> &put,
+			const std::set<std::string> &del);
 	std::string get_error();
 #if USE_LEVELDB
 	leveldb::Iterator* new_iterator();
@@ -439,10 +439,12 @@ void LocalPlayer::move(f32 dtime, Environment *env, f32 pos_max_d,
 	const ContentFeatures &f = nodemgr->get(map->getNodeNoEx(getStandingNodePos()));
 	// Determine if jumping is possible
 	m_can_jump = touching_ground && !in_liquid;
-	if(itemgroup_get(f.groups, "disable_jump"))
+	static const ItemGroupId disable_jump = itemgroup_id("disable_jump");
+	static const ItemGroupId bouncy = itemgroup_id("bouncy");
+	if(itemgroup_get(f.group_ratings, disable_jump))
 		m_can_jump = false;
 	// Jump key pressed while jumping off from a bouncy block
-	if (m_can_jump && control.jump && itemgroup_get(f.groups, "bouncy") &&
+	if (m_can_jump && control.jump && itemgroup_get(f.group_ratings, bouncy) &&
 		m_speed.Y >= -0.5 * BS) {
 		float jumpspeed = movement_speed_jump * physics_override_jump;
 		if (m_speed.Y > 1) {
@@ -734,7 +736,8 @@ void LocalPlayer::applyControl(float dtime, ClientEnvironment *env)
 	v3s16 p = floatToInt(getPosition() - v3f(0,BS/2,0), BS);
 	float slippery = 0;
 	try {
-		slippery = itemgroup_get(nodemgr->get(map->getNode(p)).groups, "slippery");
+		static const ItemGroupId slippery_id = itemgroup_id("slippery");
+		slippery = itemgroup_get(nodemgr->get(map->getNode(p)).group_ratings, slippery_id);
 	}
 	catch (...) {}
 	accelerateHorizontal(speedH * physics_override_speed, incH * physics_override_speed, slippery);
@@ -60,6 +60,7 @@ class Logger {
 
 	void registerThread(const std::string &name);
 	void deregisterThread();
+	const std::string getThreadName();
 
 	void log(LogLevel lev, const std::string &text);
 	// Logs without a prefix
@@ -77,8 +78,6 @@ class Logger {
 		const std::string &time, const std::string &thread_name,
 		const std::string &payload_text);
 
-	const std::string getThreadName();
-
 	std::vector<ILogOutput *> m_outputs[LL_MAX];
 
 	// Should implement atomic loads and stores (even though it's only
@@ -30,6 +30,7 @@ along with Freeminer.  If not, see <http://www.gnu.org/licenses/>.
 #include "irrlichttypes_extrabloated.h"
 #include "debug.h"
 #include "unittest/test.h"
+#include "benchmark/benchmark.h"
 #include "server.h"
 #include "filesys.h"
 #include "version.h"
@@ -38,11 +39,13 @@ along with Freeminer.  If not, see <http://www.gnu.org/licenses/>.
 #include "defaultsettings.h"
 #include "gettext.h"
 #include "profiler.h"
+#include "tracer.h"
 #include "log_types.h"
 #include "quicktune.h"
 #include "httpfetch.h"
 #include "guiEngine.h"
 #include "map.h"
+#include "map_pregenerate.h"
 #include "player.h"
 #include "fontengine.h"
 #include "gameparams.h"
@@ -116,6 +119,7 @@ static bool determine_subgame(GameParams *game_params);
 
 static bool run_dedicated_server(const GameParams &game_params, const Settings &cmd_args);
 static bool migrate_database(const GameParams &game_params, const Settings &cmd_args);
+static bool pregenerate_map(const GameParams &game_params, const Settings &cmd_args);
 
 /**********************************************************************/
 
@@ -233,6 +237,11 @@ int main(int argc, char *argv[])
 	if (cmd_args.getFlag("run-unittests")) {
 		return run_tests();
 	}
+
+	// Run benchmarks
+	if (cmd_args.getFlag("run-benchmarks")) {
+		return run_benchmarks(g_settings->get("benchmark_filter")) ? 0 : 1;
+	}
 #endif
 
 	GameParams game_params;
@@ -305,6 +314,8 @@ static void set_allowed_options(OptionList *allowed_options)
 			_("Set network port (UDP)"))));
 	allowed_options->insert(std::make_pair("run-unittests", ValueSpec(VALUETYPE_FLAG,
 			_("Run the unit tests and exit"))));
+	allowed_options->insert(std::make_pair("run-benchmarks", ValueSpec(VALUETYPE_FLAG,
+			_("Run the benchmarks, print json results and exit"))));
 	allowed_options->insert(std::make_pair("map-dir", ValueSpec(VALUETYPE_STRING,
 			_("Same as --world (deprecated)"))));
 	allowed_options->insert(std::make_pair("world", ValueSpec(VALUETYPE_STRING,
@@ -325,6 +336,8 @@ static void set_allowed_options(OptionList *allowed_options)
 			_("Set gameid (\"--gameid list\" prints available ones)"))));
 	allowed_options->insert(std::make_pair("migrate", ValueSpec(VALUETYPE_STRING,
 			_("Migrate from current map backend to another (Only works when using minetestserver or with --server)"))));
+	allowed_options->insert(std::make_pair("pregenerate", ValueSpec(VALUETYPE_STRING,
+			_("Generate the map in \"(x,y,z) (x,y,z)\" and exit (Only works when using minetestserver or with --server)"))));
 
 	allowed_options->insert(std::make_pair("autoexit", ValueSpec(VALUETYPE_STRING,
 			_("Exit after X seconds"))));
@@ -499,6 +512,9 @@ static bool init_common(const Settings &cmd_args, int argc, char *argv[])
 	cmd_args.getS32NoEx("autoexit", autoexit_);
 	g_profiler_enabled = g_settings->getFloat("profiler_print_interval") || autoexit_;
 
+	g_tracer->setBufferSize(g_settings->getS32("trace_buffer_size"));
+	g_tracer->enable(g_settings->getBool("trace_enable"));
+
 	// Initialize random seed
 	srand(time(0));
 	mysrand(time(0));
@@ -898,6 +914,10 @@ static bool run_dedicated_server(const GameParams &game_params, const Settings &
 	if (cmd_args.exists("migrate"))
 		return migrate_database(game_params, cmd_args);
 
+	// Map pregeneration
+	if (cmd_args.exists("pregenerate"))
+		return pregenerate_map(game_params, cmd_args);
+
 	if (cmd_args.exists("terminal")) {
 #if USE_CURSES
 		bool name_ok = true;
@@ -1062,3 +1082,26 @@ static bool migrate_database(const GameParams &game_params, const Settings &cmd_
 	return true;
 }
 
+static bool pregenerate_map(const GameParams &game_params, const Settings &cmd_args)
+{
+	v3POS minp, maxp;
+	if (!MapPregenerator::parseArea(cmd_args.get("pregenerate"), minp, maxp)) {
+		errorstream << "--pregenerate: expected \"(x,y,z) (x,y,z)\" in nodes, got \""
+			<< cmd_args.get("pregenerate") << "\"" << std::endl;
+		return false;
+	}
+
+	try {
+		// Not started: no network and no environment step
+		Server server(game_params.world_path, game_params.game_spec, false, false);
+		MapPregenerator pregenerator(&server, minp, maxp);
+		bool &kill = *porting::signal_handler_killstatus();
+		return pregenerator.run(kill);
+	} catch (const ModError &e) {
+		errorstream << "ModError: " << e.what() << std::endl;
+		return false;
+	} catch (const ServerError &e) {
+		errorstream << "ServerError: " << e.what() << std::endl;
+		return false;
+	}
+}
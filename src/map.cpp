@@ -34,11 +34,13 @@ along with Freeminer.  If not, see <http://www.gnu.org/licenses/>.
 #include "settings.h"
 #include "log_types.h"
 #include "profiler.h"
+#include "metrics.h"
 #include "nodedef.h"
 #include "gamedef.h"
 #include "util/directiontables.h"
 #include "util/mathconstants.h"
 #include "util/basic_macros.h"
+#include "util/arena.h"
 #include "rollback_interface.h"
 #include "environment.h"
 #include "reflowscan.h"
@@ -1734,6 +1736,132 @@ std::vector<v3s16> Map::findNodesWithMetadata(v3s16 p1, v3s16 p2)
 	return positions_with_meta;
 }
 
+/*
+	Tells from the content summaries of the blocks which can have nodes
+	matching the filter of a find_node* call, the others are skipped
+*/
+class FindNodesBlocks
+{
+public:
+	FindNodesBlocks(Map &map, const std::unordered_set<content_t> &filter,
+			v3s16 minp, v3s16 maxp):
+		m_map(map),
+		m_filter(filter)
+	{
+		// A summary is made of all nodes of a block, for a few of them
+		// reading the nodes is cheaper
+		const v3s16 bmin = getNodeBlockPos(minp), bmax = getNodeBlockPos(maxp);
+		const s64 volume = (s64)(maxp.X - minp.X + 1) * (maxp.Y - minp.Y + 1) *
+				(maxp.Z - minp.Z + 1);
+		const s64 blocks = (s64)(bmax.X - bmin.X + 1) * (bmax.Y - bmin.Y + 1) *
+				(bmax.Z - bmin.Z + 1);
+		m_enabled = volume > 0 && volume >= blocks * MapBlock::nodecount / 4;
+	}
+
+	bool mayMatch(v3s16 p)
+	{
+		if (!m_enabled)
+			return true;
+		v3s16 blockpos = getNodeBlockPos(p);
+		if (m_last != m_blocks.end() && m_last->first == blockpos)
+			return m_last->second;
+		m_last = m_blocks.find(blockpos);
+		if (m_last == m_blocks.end())
+			m_last = m_blocks.emplace(blockpos, check(blockpos)).first;
+		return m_last->second;
+	}
+
+private:
+	bool check(v3s16 blockpos)
+	{
+		static const auto skipped = g_metrics->counter("freeminer_find_nodes_blocks_skipped_total",
+			"Blocks find_node* calls did not read, none of their contents matching");
+		// Nodes of missing blocks are ignore
+		MapBlock *block = m_map.getBlockNoCreateNoEx(blockpos);
+		if (!block)
+			return m_filter.count(CONTENT_IGNORE) != 0;
+		for (const auto &content : block->getContentSummary()->contents)
+			if (m_filter.count(content.first))
+				return true;
+		skipped->add(1);
+		return false;
+	}
+
+	Map &m_map;
+	const std::unordered_set<content_t> &m_filter;
+	bool m_enabled;
+	unordered_map_v3POS<bool> m_blocks;
+	unordered_map_v3POS<bool>::iterator m_last = m_blocks.end();
+};
+
+bool Map::findNodeNear(v3s16 pos, int radius,
+	const std::unordered_set<content_t> &filter, v3s16 *found)
+{
+	FindNodesBlocks blocks(*this, filter, pos - radius, pos + radius);
+	for (int d = 1; d <= radius; d++) {
+		for (const v3s16 &offset : FacePositionCache::getFacePositions(d)) {
+			v3s16 p = pos + offset;
+			if (!blocks.mayMatch(p))
+				continue;
+			if (filter.count(getNodeNoEx(p).getContent())) {
+				*found = p;
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+std::vector<v3s16> Map::findNodesInArea(v3s16 minp, v3s16 maxp,
+	const std::unordered_set<content_t> &filter,
+	std::map<content_t, u16> *count)
+{
+	std::vector<v3s16> found;
+	FindNodesBlocks blocks(*this, filter, minp, maxp);
+	for (s16 x = minp.X; x <= maxp.X; x++)
+	for (s16 y = minp.Y; y <= maxp.Y; y++)
+	for (s16 z = minp.Z; z <= maxp.Z; z++) {
+		v3s16 p(x, y, z);
+		if (!blocks.mayMatch(p)) {
+			// On to the next block
+			z = MYMIN(maxp.Z, getNodeBlockPos(p).Z * MAP_BLOCKSIZE + MAP_BLOCKSIZE - 1);
+			continue;
+		}
+		content_t c = getNodeNoEx(p).getContent();
+		if (filter.count(c)) {
+			found.push_back(p);
+			if (count)
+				(*count)[c]++;
+		}
+	}
+	return found;
+}
+
+std::vector<v3s16> Map::findNodesInAreaUnderAir(v3s16 minp, v3s16 maxp,
+	const std::unordered_set<content_t> &filter)
+{
+	std::vector<v3s16> found;
+	FindNodesBlocks blocks(*this, filter, minp, maxp);
+	for (s16 x = minp.X; x <= maxp.X; x++)
+	for (s16 z = minp.Z; z <= maxp.Z; z++) {
+		s16 y = minp.Y;
+		content_t c = getNodeNoEx(v3s16(x, y, z)).getContent();
+		for (; y <= maxp.Y; y++) {
+			if (!blocks.mayMatch(v3s16(x, y, z))) {
+				// On to the last node of the block, above it is read next
+				y = MYMIN(maxp.Y, getNodeBlockPos(v3s16(x, y, z)).Y * MAP_BLOCKSIZE + MAP_BLOCKSIZE - 1);
+				c = getNodeNoEx(v3s16(x, y + 1, z)).getContent();
+				continue;
+			}
+			content_t csurf = getNodeNoEx(v3s16(x, y + 1, z)).getContent();
+			if (c != CONTENT_AIR && csurf == CONTENT_AIR && filter.count(c))
+				found.push_back(v3s16(x, y, z));
+			c = csurf;
+		}
+	}
+	return found;
+}
+
 NodeMetadata *Map::getNodeMetadata(v3s16 p)
 {
 	v3s16 blockpos = getNodeBlockPos(p);
@@ -1882,6 +2010,13 @@ ServerMap::ServerMap(std::string savedir, IGameDef *gamedef, EmergeManager *emer
 	m_map_saving_enabled = false;
 	m_map_loading_enabled = true;
 
+	if (g_settings->getBool("map_journal")) {
+		size_t unsaved = m_journal.open(m_savedir + DIR_DELIM + "map_journal");
+		if (unsaved)
+			warningstream << "ServerMap: " << unsaved << " modified blocks were not saved"
+				<< " by the last run, lighting around them will be updated on load" << std::endl;
+	}
+
 	try
 	{
 		// If directory exists, check contents and load if possible
@@ -2010,26 +2145,28 @@ bool ServerMap::initBlockMake(v3s16 blockpos, BlockMakeData *data)
 	{
 		//TimeTaker timer("initBlockMake() create area");
 
+	std::vector<v3POS> area;
+	area.reserve((full_bpmax.X - full_bpmin.X + 1) *
+		(full_bpmax.Y - full_bpmin.Y + 1) * (full_bpmax.Z - full_bpmin.Z + 1));
 	for (s16 x = full_bpmin.X; x <= full_bpmax.X; x++)
-	for (s16 z = full_bpmin.Z; z <= full_bpmax.Z; z++) {
-/*
-		v2s16 sectorpos(x, z);
-		// Sector metadata is loaded from disk if not already loaded.
-		ServerMapSector *sector = createSector(sectorpos);
-		FATAL_ERROR_IF(sector == NULL, "createSector() failed");
-*/
-		for (s16 y = full_bpmin.Y; y <= full_bpmax.Y; y++) {
-			v3s16 p(x, y, z);
+	for (s16 z = full_bpmin.Z; z <= full_bpmax.Z; z++)
+	for (s16 y = full_bpmin.Y; y <= full_bpmax.Y; y++)
+		area.push_back(v3POS(x, y, z));
 
-			MapBlock *block = emergeBlock(p, false);
-			if (block == NULL) {
-				block = createBlock(p);
+	// One database query for all of them, nothing is found in a new area
+	if (m_map_loading_enabled)
+		loadBlocks(area);
 
-				// Block gets sunlight if this is true.
-				// Refer to the map generator heuristics.
-				bool ug = m_emerge->isBlockUnderground(p);
-				block->setIsUnderground(ug);
-			}
+	MAP_NOTHREAD_LOCK(this);
+	for (const auto &p : area) {
+		MapBlock *block = getBlockNoCreateNoEx(p, false, true);
+		if (block == NULL || block->isDummy()) {
+			block = createBlock(p);
+
+			// Block gets sunlight if this is true.
+			// Refer to the map generator heuristics.
+			bool ug = m_emerge->isBlockUnderground(p);
+			block->setIsUnderground(ug);
 		}
 	}
 	}
@@ -2042,6 +2179,8 @@ bool ServerMap::initBlockMake(v3s16 blockpos, BlockMakeData *data)
 	*/
 
 	data->vmanip = new MMVManip(this);
+	// Emerge thread arena, released after the chunk is finished
+	data->vmanip->setArena(Arena::current());
 	data->vmanip->initialEmerge(full_bpmin, full_bpmax);
 
 	// Note: we may need this again at some point.
@@ -2525,60 +2664,94 @@ s32 ServerMap::save(ModifiedState save_level, float dedicated_server_step, bool
 
 	MAP_NOTHREAD_LOCK(this);
 
-	{
-		auto lock = breakable ? m_blocks.try_lock_shared_rec() : m_blocks.lock_shared_rec();
-		if (!lock->owns_lock())
-			return m_blocks_save_last;
+	std::vector<MapJournal::Entry> dirty;
+	m_journal.take(dirty);
 
-		for(auto &jr : m_blocks)
-		{
-			if (n++ < m_blocks_save_last)
-				continue;
-			else
-				m_blocks_save_last = 0;
-			++calls;
+	auto save_block = [&](MapBlock *block) {
+		// Lazy beginSave()
+		if(!save_started) {
+			beginSave();
+			save_started = true;
+		}
 
-			MapBlock *block = jr.second;
+		//modprofiler.add(block->getModifiedReasonString(), 1);
 
-			if (!block)
-				continue;
+		auto lock = breakable ? block->try_lock_unique_rec() : block->lock_unique_rec();
+		if (!lock->owns_lock())
+			return;
 
-			block_count_all++;
+		saveBlock(block);
+		block_count++;
+	};
 
-			if(block->getModified() >= (u32)save_level) {
-				// Lazy beginSave()
-				if(!save_started) {
-					beginSave();
-					save_started = true;
-				}
+	s32 ret = 0;
+	if (save_level == MOD_STATE_WRITE_NEEDED) {
+		// Only blocks from the journal, cost does not depend on loaded map size
+		for (const auto &entry : dirty) {
+			if (breakable && porting::getTimeMs() > end_ms) {
+				m_journal.putBack(entry);
+				++ret;
+				continue;
+			}
+			MapBlock *block = getBlockNoCreateNoEx(entry.pos);
+			// Unloaded blocks were saved on unload
+			if (!block)
+				continue;
+			if (block->getModified() >= MOD_STATE_WRITE_NEEDED)
+				save_block(block);
+			// Locked, not generated or modified again
+			if (block->getModified() >= MOD_STATE_WRITE_NEEDED)
+				m_journal.putBack(entry);
+		}
+		block_count_all = m_blocks.size();
+	} else {
+		// Whole map walk for shutdown and MOD_STATE_WRITE_AT_UNLOAD blocks
+		auto lock = breakable ? m_blocks.try_lock_shared_rec() : m_blocks.lock_shared_rec();
+		if (lock->owns_lock()) {
+			for(auto &jr : m_blocks) {
+				if (n++ < m_blocks_save_last)
+					continue;
+				else
+					m_blocks_save_last = 0;
+				++calls;
 
-				//modprofiler.add(block->getModifiedReasonString(), 1);
+				MapBlock *block = jr.second;
 
-				auto lock = breakable ? block->try_lock_unique_rec() : block->lock_unique_rec();
-				if (!lock->owns_lock())
+				if (!block)
 					continue;
 
-				saveBlock(block);
-				block_count++;
+				block_count_all++;
+
+				if(block->getModified() >= (u32)save_level)
+					save_block(block);
 
-				/*infostream<<"ServerMap: Written block ("
-						<<block->getPos().X<<","
-						<<block->getPos().Y<<","
-						<<block->getPos().Z<<")"
-						<<std::endl;*/
+				if (breakable && porting::getTimeMs() > end_ms) {
+					m_blocks_save_last = n;
+					break;
+				}
 			}
-		if (breakable && porting::getTimeMs() > end_ms) {
-				m_blocks_save_last = n;
-				break;
+			if (!calls)
+				m_blocks_save_last = 0;
+		}
+		ret = m_blocks_save_last;
+
+		for (const auto &entry : dirty) {
+			MapBlock *block = getBlockNoCreateNoEx(entry.pos);
+			if (block && block->getModified() >= MOD_STATE_WRITE_NEEDED)
+				m_journal.putBack(entry);
 		}
 	}
-	}
-	if (!calls)
-		m_blocks_save_last = 0;
 
 	if(save_started)
 		endSave();
 
+	m_journal.checkpoint();
+	{
+		static const auto metric = g_metrics->gauge("freeminer_map_journal_pending",
+				"Modified blocks waiting for save");
+		metric->set(m_journal.size());
+	}
+
 	/*
 		Only print if something happened or saved whole map
 	*/
@@ -2588,14 +2761,14 @@ s32 ServerMap::save(ModifiedState save_level, float dedicated_server_step, bool
 		infostream<<"ServerMap: Written: "
 				<<block_count<<"/"<<block_count_all<<" blocks from "
 				<<m_blocks.size();
-		if (m_blocks_save_last)
-			infostream<<" to "<< m_blocks_save_last;
+		if (ret)
+			infostream<<" left "<< ret;
 		infostream<<std::endl;
 		PrintInfo(infostream); // ServerMap/ClientMap:
 		//infostream<<"Blocks modified by: "<<std::endl;
 		modprofiler.print(infostream);
 	}
-	return m_blocks_save_last;
+	return ret;
 }
 
 void ServerMap::listAllLoadableBlocks(std::vector<v3s16> &dst)
@@ -2830,7 +3003,10 @@ void ServerMap::endSave()
 
 bool ServerMap::saveBlock(MapBlock *block)
 {
-	return saveBlock(block, dbase);
+	if (!saveBlock(block, dbase))
+		return false;
+	m_db_miss.erase(block->getPos());
+	return true;
 }
 
 bool ServerMap::saveBlock(MapBlock *block, Database *db)
@@ -2854,7 +3030,13 @@ bool ServerMap::saveBlock(MapBlock *block, Database *db)
 	block->serialize(o, version, true);
 
 	std::string data = o.str();
-	bool ret = db->saveBlock(p3d, data);
+	bool ret;
+	{
+		static const auto metric = g_metrics->histogram("freeminer_db_save_seconds",
+				"Map block database write latency");
+		ScopeMetric sm(nullptr, metric);
+		ret = db->saveBlock(p3d, data);
+	}
 	if (ret) {
 		// We just wrote it to the disk so clear modified flag
 		block->resetModified();
@@ -2863,14 +3045,53 @@ bool ServerMap::saveBlock(MapBlock *block, Database *db)
 }
 
 MapBlock * ServerMap::loadBlock(v3s16 p3d)
+{
+	std::string blob;
+	{
+		static const auto metric = g_metrics->histogram("freeminer_db_load_seconds",
+				"Map block database read latency");
+		ScopeMetric sm(nullptr, metric);
+		dbase->loadBlock(p3d, &blob);
+	}
+	return loadBlock(p3d, blob);
+}
+
+void ServerMap::loadBlocks(const std::vector<v3POS> &positions)
+{
+	std::vector<v3POS> query;
+	query.reserve(positions.size());
+	for (const auto &p : positions) {
+		if (m_db_miss.count(p))
+			continue;
+		// Blocks in memory are newer than the database, even not generated
+		// ones (borders of a neighbouring chunk)
+		MapBlock *block = getBlockNoCreateNoEx(p, false, true);
+		if (!block || block->isDummy())
+			query.push_back(p);
+	}
+	if (query.empty())
+		return;
+
+	std::vector<std::string> blobs;
+	{
+		static const auto metric = g_metrics->histogram("freeminer_db_load_batch_seconds",
+				"Map block database read latency of a batch");
+		ScopeMetric sm(nullptr, metric);
+		dbase->loadBlocks(query, &blobs);
+	}
+
+	MAP_NOTHREAD_LOCK(this);
+	for (size_t i = 0; i != query.size(); i++)
+		loadBlock(query[i], blobs[i]);
+}
+
+MapBlock * ServerMap::loadBlock(v3s16 p3d, const std::string &blob)
 {
 	DSTACK(FUNCTION_NAME);
 	ScopeProfiler sp(g_profiler, "ServerMap::loadBlock");
 	const auto sector = this;
 	MapBlock *block = nullptr;
 	try {
-		std::string blob;
-		dbase->loadBlock(p3d, &blob);
 	if(!blob.length()) {
 		m_db_miss.set(p3d, 1);
 		return nullptr;
@@ -2916,6 +3137,10 @@ MapBlock * ServerMap::loadBlock(v3s16 p3d)
 		// We just loaded it from, so it's up-to-date.
 		block->resetModified();
 
+		// Neighbours can be newer than this block after a crash
+		if (m_journal.takeUnsaved(p3d))
+			lighting_modified_add(p3d);
+
 /*
 		if (block->getLightingExpired()) {
 			verbosestream<<"Loaded block with exiried lighting. (maybe sloooow appear), try recalc " << p3d<<std::endl;
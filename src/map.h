@@ -40,6 +40,7 @@ along with Freeminer.  If not, see <http://www.gnu.org/licenses/>.
 #include "util/cpp11_container.h"
 #include "nodetimer.h"
 #include "map_settings_manager.h"
+#include "map_journal.h"
 
 #include "mapblock.h"
 #include <unordered_set>
@@ -286,6 +287,22 @@ class Map /*: public NodeContainer*/
 	*/
 
 	std::vector<v3s16> findNodesWithMetadata(v3s16 p1, v3s16 p2);
+
+	/*
+		Nodes of a content in filter, for the find_node* Lua calls. If the
+		area covers a good part of its blocks, those whose content summary
+		has none of filter are not read.
+	*/
+	// The first one by distance from pos, false if none within radius
+	bool findNodeNear(v3s16 pos, int radius,
+		const std::unordered_set<content_t> &filter, v3s16 *found);
+	// count: nodes found of every content, may be NULL
+	std::vector<v3s16> findNodesInArea(v3s16 minp, v3s16 maxp,
+		const std::unordered_set<content_t> &filter,
+		std::map<content_t, u16> *count = NULL);
+	// Only those with air above them
+	std::vector<v3s16> findNodesInAreaUnderAir(v3s16 minp, v3s16 maxp,
+		const std::unordered_set<content_t> &filter);
 	NodeMetadata *getNodeMetadata(v3s16 p);
 
 	/**
@@ -345,6 +362,8 @@ class Map /*: public NodeContainer*/
 	MapBlock * createBlankBlock(v3s16 & p);
 	bool insertBlock(MapBlock *block);
 	void deleteBlock(MapBlockP block);
+	// Block went from clean to MOD_STATE_WRITE_NEEDED
+	virtual void blockModified(v3POS pos) {}
 	std::unordered_map<MapBlockP, int> * m_blocks_delete;
 	std::unordered_map<MapBlockP, int> m_blocks_delete_1, m_blocks_delete_2;
 	unsigned int m_blocks_delete_time = 0;
@@ -487,6 +506,11 @@ class ServerMap : public Map
 	bool saveBlock(MapBlock *block);
 	static bool saveBlock(MapBlock *block, Database *db);
 	MapBlock* loadBlock(v3s16 p);
+	// Deserializes and inserts a block read from the database
+	MapBlock *loadBlock(v3s16 p, const std::string &blob);
+	// Blocks not in memory (or dummies) are read with one database query,
+	// those known to be missing from it are skipped
+	void loadBlocks(const std::vector<v3POS> &positions);
 
 	bool deleteBlock(v3s16 blockpos);
 
@@ -513,6 +537,9 @@ class ServerMap : public Map
 
 	MapSettingsManager settings_mgr;
 
+	void blockModified(v3POS pos) { m_journal.add(pos); }
+	MapJournal m_journal;
+
 private:
 	// Emerge manager
 	EmergeManager *m_emerge;
@@ -0,0 +1,203 @@
+/*
+  This file is part of Freeminer.
+
+  Freeminer is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Freeminer  is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Freeminer.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "map_journal.h"
+
+#include <algorithm>
+
+#include "filesys.h"
+#include "log.h"
+#include "porting.h"
+#include "threading/mutex_auto_lock.h"
+#include "util/serialize.h"
+
+/*
+	Record: u8 type, u64 seq, v3s16 pos
+	'D' block pos went dirty
+	'C' all records with seq <= this one are saved, pos unused
+*/
+static const u8 RECORD_DIRTY = 'D';
+static const u8 RECORD_CHECKPOINT = 'C';
+static const size_t RECORD_SIZE = 1 + 8 + 6;
+
+// Records are written out at least this often, a crash loses the newer ones
+static const u32 WRITE_INTERVAL_MS = 1000;
+// Start a new file on checkpoint when the log grows over this
+static const size_t REWRITE_SIZE = 1 << 20;
+
+MapJournal::MapJournal()
+{
+}
+
+MapJournal::~MapJournal()
+{
+	close();
+}
+
+size_t MapJournal::open(const std::string &path)
+{
+	MutexAutoLock lock(m_mutex);
+
+	unordered_map_v3POS<u64> last;
+	u64 checkpoint = 0;
+	std::ifstream is(path.c_str(), std::ios_base::binary);
+	u8 record[RECORD_SIZE];
+	// A torn record at the end is dropped by the read failing
+	while (is.read((char *)record, RECORD_SIZE)) {
+		u8 type = readU8(record);
+		u64 seq = readU64(record + 1);
+		if (type == RECORD_DIRTY)
+			last[readV3S16(record + 9)] = seq;
+		else if (type == RECORD_CHECKPOINT)
+			checkpoint = std::max(checkpoint, seq);
+		m_seq = std::max(m_seq, seq);
+	}
+	is.close();
+
+	for (const auto &i : last)
+		if (i.second > checkpoint)
+			m_unsaved.emplace(i.first, i.second);
+
+	m_path = path;
+	rewrite();
+	return m_unsaved.size();
+}
+
+void MapJournal::close()
+{
+	MutexAutoLock lock(m_mutex);
+	writeBuffer();
+	m_file.close();
+	m_path.clear();
+}
+
+bool MapJournal::takeUnsaved(v3POS pos)
+{
+	MutexAutoLock lock(m_mutex);
+	if (m_unsaved.empty())
+		return false;
+	return m_unsaved.erase(pos);
+}
+
+void MapJournal::add(v3POS pos)
+{
+	MutexAutoLock lock(m_mutex);
+	u64 seq = m_seq + 1;
+	if (!m_pending.emplace(pos, seq).second)
+		return;
+	m_seq = seq;
+	append(RECORD_DIRTY, seq, pos);
+	if (porting::getTimeMs() - m_write_time >= WRITE_INTERVAL_MS)
+		writeBuffer();
+}
+
+void MapJournal::take(std::vector<Entry> &dest)
+{
+	MutexAutoLock lock(m_mutex);
+	dest.reserve(dest.size() + m_pending.size());
+	for (const auto &i : m_pending)
+		dest.push_back({i.first, i.second});
+	m_pending.clear();
+	std::sort(dest.begin(), dest.end(),
+			[](const Entry &a, const Entry &b) { return a.seq < b.seq; });
+}
+
+void MapJournal::putBack(const Entry &entry)
+{
+	MutexAutoLock lock(m_mutex);
+	auto ins = m_pending.emplace(entry.pos, entry.seq);
+	// Went dirty again meanwhile, the older record is the unsaved one
+	if (!ins.second && ins.first->second > entry.seq)
+		ins.first->second = entry.seq;
+}
+
+void MapJournal::checkpoint()
+{
+	MutexAutoLock lock(m_mutex);
+	if (m_path.empty())
+		return;
+	if (m_file_size + m_buffer.size() > REWRITE_SIZE) {
+		rewrite();
+		return;
+	}
+	append(RECORD_CHECKPOINT, checkpointSeq(), v3POS(0, 0, 0));
+	writeBuffer();
+}
+
+void MapJournal::flush()
+{
+	MutexAutoLock lock(m_mutex);
+	writeBuffer();
+}
+
+size_t MapJournal::size()
+{
+	MutexAutoLock lock(m_mutex);
+	return m_pending.size();
+}
+
+u64 MapJournal::checkpointSeq()
+{
+	u64 seq = m_seq;
+	for (const auto &i : m_pending)
+		seq = std::min(seq, i.second - 1);
+	return seq;
+}
+
+void MapJournal::append(u8 type, u64 seq, v3POS pos)
+{
+	if (m_path.empty())
+		return;
+	u8 record[RECORD_SIZE];
+	writeU8(record, type);
+	writeU64(record + 1, seq);
+	writeV3S16(record + 9, pos);
+	m_buffer.append((char *)record, RECORD_SIZE);
+}
+
+void MapJournal::writeBuffer()
+{
+	m_write_time = porting::getTimeMs();
+	if (m_buffer.empty() || !m_file.is_open())
+		return;
+	m_file.write(m_buffer.data(), m_buffer.size());
+	m_file.flush();
+	m_file_size += m_buffer.size();
+	m_buffer.clear();
+}
+
+// New file with only what is still pending, replaces the old one atomically
+void MapJournal::rewrite()
+{
+	m_file.close();
+	m_buffer.clear();
+	append(RECORD_CHECKPOINT, checkpointSeq(), v3POS(0, 0, 0));
+	for (const auto &i : m_pending)
+		append(RECORD_DIRTY, i.second, i.first);
+	if (!fs::safeWriteToFile(m_path, m_buffer)) {
+		errorstream << "MapJournal: unable to write " << m_path
+			<< ", journal disabled" << std::endl;
+		m_path.clear();
+		m_buffer.clear();
+		return;
+	}
+	m_file_size = m_buffer.size();
+	m_buffer.clear();
+	m_file.clear();
+	m_file.open(m_path.c_str(), std::ios_base::binary | std::ios_base::app);
+	m_write_time = porting::getTimeMs();
+}
@@ -0,0 +1,88 @@
+/*
+  This file is part of Freeminer.
+
+  Freeminer is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Freeminer  is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Freeminer.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef MAP_JOURNAL_HEADER
+#define MAP_JOURNAL_HEADER
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "irr_v3d.h"
+#include "threading/mutex.h"
+#include "util/unordered_map_hash.h"
+
+/*
+	Journal of blocks which need saving
+
+	Every block going dirty is added once with a sequence number, a save pass
+	takes the pending blocks instead of walking all loaded blocks and puts back
+	what it could not write. After a pass a checkpoint is logged: every record
+	with a lower sequence number is on disk.
+
+	Records are appended to <world>/map_journal, so after a crash the blocks
+	which were dirty and never saved are known. Their data is gone, but the
+	server can repair what depends on them (lighting of the neighbours).
+*/
+
+class MapJournal
+{
+public:
+	struct Entry {
+		v3POS pos;
+		u64 seq;
+	};
+
+	MapJournal();
+	~MapJournal();
+
+	// Starts logging to path, returns number of blocks left unsaved by the last run
+	size_t open(const std::string &path);
+	void close();
+	// True once for every block left unsaved by the last run
+	bool takeUnsaved(v3POS pos);
+
+	void add(v3POS pos);
+	// Moves all pending blocks to dest, oldest first
+	void take(std::vector<Entry> &dest);
+	// Returns a taken block which was not saved
+	void putBack(const Entry &entry);
+	// Taken blocks which were not put back are saved
+	void checkpoint();
+	void flush();
+
+	size_t size();
+
+private:
+	void append(u8 type, u64 seq, v3POS pos);
+	void writeBuffer();
+	void rewrite();
+	u64 checkpointSeq();
+
+	Mutex m_mutex;
+	unordered_map_v3POS<u64> m_pending;
+	unordered_map_v3POS<u64> m_unsaved;
+	u64 m_seq = 0;
+
+	std::string m_path;
+	std::ofstream m_file;
+	std::string m_buffer;
+	size_t m_file_size = 0;
+	u32 m_write_time = 0;
+};
+
+#endif
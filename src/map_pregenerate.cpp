@@ -0,0 +1,213 @@
+/*
+  This file is part of Freeminer.
+
+  Freeminer is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Freeminer  is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Freeminer.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "map_pregenerate.h"
+
+#include <algorithm>
+#include <cstdio>
+
+#include "constants.h"
+#include "environment.h"
+#include "filesys.h"
+#include "log.h"
+#include "map.h"
+#include "mapblock.h"
+#include "porting.h"
+#include "server.h"
+#include "settings.h"
+#include "util/string.h"
+
+// Chunks queued per emerge thread, enough to never leave one idle
+static const u32 IN_FLIGHT_PER_THREAD = 4;
+// Blocks not used by the mapgen for this long are saved and unloaded
+static const float UNLOAD_TIMEOUT = 10;
+static const u32 UNLOAD_INTERVAL_MS = 1000;
+static const u32 REPORT_INTERVAL_MS = 10000;
+static const u32 CHECKPOINT_INTERVAL_MS = 60000;
+
+MapPregenerator::MapPregenerator(Server *server, v3POS minp, v3POS maxp) :
+	m_server(server)
+{
+	v3POS nmin(std::min(minp.X, maxp.X), std::min(minp.Y, maxp.Y), std::min(minp.Z, maxp.Z));
+	v3POS nmax(std::max(minp.X, maxp.X), std::max(minp.Y, maxp.Y), std::max(minp.Z, maxp.Z));
+
+	m_chunksize = server->getEmergeManager()->mgparams->chunksize;
+	m_chunk_min = EmergeManager::getContainingChunk(getNodeBlockPos(nmin), m_chunksize);
+	v3POS chunk_max = EmergeManager::getContainingChunk(getNodeBlockPos(nmax), m_chunksize);
+	m_chunks = (chunk_max - m_chunk_min) / m_chunksize + v3POS(1, 1, 1);
+	m_total = m_chunks.X * m_chunks.Y * m_chunks.Z;
+
+	std::ostringstream os;
+	os << PP(nmin) << " " << PP(nmax);
+	m_area = os.str();
+	m_checkpoint_path = server->getWorldPath() + DIR_DELIM + "pregenerate.txt";
+}
+
+bool MapPregenerator::parseArea(const std::string &str, v3POS &minp, v3POS &maxp)
+{
+	int p[6];
+	if (sscanf(str.c_str(), " ( %d , %d , %d ) ( %d , %d , %d )",
+			&p[0], &p[1], &p[2], &p[3], &p[4], &p[5]) != 6)
+		return false;
+	for (int i = 0; i < 6; ++i)
+		if (p[i] < -MAX_MAP_GENERATION_LIMIT || p[i] > MAX_MAP_GENERATION_LIMIT)
+			return false;
+	minp = v3POS(p[0], p[1], p[2]);
+	maxp = v3POS(p[3], p[4], p[5]);
+	return true;
+}
+
+// Columns of chunks, one row of columns after another
+v3POS MapPregenerator::getChunkBlockPos(u32 i) const
+{
+	v3POS rel(i / m_chunks.Y % m_chunks.X, i % m_chunks.Y, i / m_chunks.Y / m_chunks.X);
+	return m_chunk_min + rel * m_chunksize;
+}
+
+u32 MapPregenerator::getChunkIndex(v3POS blockpos) const
+{
+	v3POS rel = (blockpos - m_chunk_min) / m_chunksize;
+	return (rel.Z * m_chunks.X + rel.X) * m_chunks.Y + rel.Y;
+}
+
+u32 MapPregenerator::loadCheckpoint()
+{
+	Settings checkpoint;
+	if (!checkpoint.readConfigFile(m_checkpoint_path.c_str()))
+		return 0;
+	if (checkpoint.get("area") != m_area) {
+		warningstream << "Pregenerate: " << m_checkpoint_path << " is for area "
+			<< checkpoint.get("area") << ", starting again" << std::endl;
+		return 0;
+	}
+	return std::min<u64>(checkpoint.getU64("next"), m_total);
+}
+
+void MapPregenerator::saveCheckpoint(u32 next)
+{
+	Settings checkpoint;
+	checkpoint.set("area", m_area);
+	checkpoint.setU64("next", next);
+	checkpoint.setU64("total", m_total);
+	if (!checkpoint.updateConfigFile(m_checkpoint_path.c_str()))
+		errorstream << "Pregenerate: failed to write " << m_checkpoint_path << std::endl;
+}
+
+void MapPregenerator::report(u32 start, u32 done, u64 start_ms) const
+{
+	float seconds = (porting::getTimeMs() - start_ms) / 1000.0;
+	float speed = seconds > 0 ? (done - start) / seconds : 0;
+	actionstream << "Pregenerate: " << done << "/" << m_total << " chunks ("
+		<< (100.0 * done / m_total) << "%), " << speed << " chunks/s";
+	if (speed > 0 && done < m_total)
+		actionstream << ", " << (int)((m_total - done) / speed / 60) << " min left";
+	actionstream << ", " << m_server->getEnv().getMap().m_blocks.size()
+		<< " blocks loaded" << std::endl;
+}
+
+void MapPregenerator::emergeDone(v3POS blockpos, EmergeAction action, void *param)
+{
+	MapPregenerator *self = (MapPregenerator *)param;
+	{
+		std::lock_guard<std::mutex> lock(self->m_mutex);
+		self->m_in_flight.erase(self->getChunkIndex(blockpos));
+		if (action == EMERGE_GENERATED)
+			++self->m_generated;
+		else if (action == EMERGE_FROM_MEMORY || action == EMERGE_FROM_DISK)
+			++self->m_existing;
+		else
+			++self->m_failed;
+	}
+	self->m_done_cv.notify_one();
+	if (action == EMERGE_CANCELLED || action == EMERGE_ERRORED)
+		errorstream << "Pregenerate: chunk at block " << PP(blockpos)
+			<< " failed" << std::endl;
+}
+
+bool MapPregenerator::run(bool &kill)
+{
+	EmergeManager *emerge = m_server->getEmergeManager();
+	ServerMap &map = m_server->getEnv().getServerMap();
+
+	u32 next = loadCheckpoint();
+	const u32 start = next;
+	actionstream << "Pregenerate: area " << m_area << ", " << m_total << " chunks of "
+		<< m_chunksize << "^3 blocks, " << emerge->getThreadsCount() << " emerge threads";
+	if (start)
+		actionstream << ", resuming at chunk " << start;
+	actionstream << std::endl;
+
+	const size_t in_flight_max = std::max<size_t>(emerge->getThreadsCount(), 1) * IN_FLIGHT_PER_THREAD;
+	const u64 start_ms = porting::getTimeMs();
+	u64 unload_ms = start_ms, report_ms = start_ms, checkpoint_ms = start_ms;
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	for (;;) {
+		while (!kill && next < m_total && m_in_flight.size() < in_flight_max) {
+			u32 i = next++;
+			m_in_flight.insert(i);
+			lock.unlock();
+			emerge->enqueueBlockEmergeEx(getChunkBlockPos(i), PEER_ID_INEXISTENT,
+					BLOCK_EMERGE_ALLOW_GEN | BLOCK_EMERGE_FORCE_QUEUE, emergeDone, this);
+			lock.lock();
+		}
+		if (m_in_flight.empty() && (kill || next >= m_total))
+			break;
+
+		m_done_cv.wait_for(lock, std::chrono::milliseconds(100));
+
+		const u64 now = porting::getTimeMs();
+		// Every chunk before it is generated
+		const u32 done = m_in_flight.empty() ? next : *m_in_flight.begin();
+		if (now < unload_ms + UNLOAD_INTERVAL_MS && now < checkpoint_ms + CHECKPOINT_INTERVAL_MS &&
+				now < report_ms + REPORT_INTERVAL_MS)
+			continue;
+
+		lock.unlock();
+		if (now >= unload_ms + UNLOAD_INTERVAL_MS) {
+			map.timerUpdate((now - start_ms) / 1000.0, UNLOAD_TIMEOUT, -1);
+			unload_ms = now;
+		}
+		if (now >= checkpoint_ms + CHECKPOINT_INTERVAL_MS) {
+			map.save(MOD_STATE_WRITE_NEEDED);
+			saveCheckpoint(done);
+			checkpoint_ms = now;
+		}
+		if (now >= report_ms + REPORT_INTERVAL_MS) {
+			report(start, done, start_ms);
+			report_ms = now;
+		}
+		lock.lock();
+	}
+	const u32 done = next;
+	lock.unlock();
+
+	map.save(MOD_STATE_WRITE_NEEDED);
+	report(start, done, start_ms);
+	actionstream << "Pregenerate: " << m_generated << " chunks generated, "
+		<< m_existing << " existed, " << m_failed << " failed in "
+		<< (porting::getTimeMs() - start_ms) / 1000 << "s" << std::endl;
+
+	if (done < m_total) {
+		saveCheckpoint(done);
+		actionstream << "Pregenerate: interrupted, run again with the same area to continue"
+			<< std::endl;
+		return false;
+	}
+	fs::DeleteSingleFileOrEmptyDirectory(m_checkpoint_path);
+	return true;
+}
@@ -0,0 +1,82 @@
+/*
+  This file is part of Freeminer.
+
+  Freeminer is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Freeminer  is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Freeminer.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef MAP_PREGENERATE_HEADER
+#define MAP_PREGENERATE_HEADER
+
+#include <condition_variable>
+#include <mutex>
+#include <set>
+#include <string>
+
+#include "emerge.h"
+#include "irr_v3d.h"
+
+class Server;
+
+/*
+	Generates every map chunk of an area without clients (--pregenerate)
+
+	The server is created but not started: no network, no environment
+	step, no ABMs. The emerge threads are kept busy with chunks in a fixed
+	order, one block per chunk is enough to generate it. Unused blocks are
+	saved and unloaded in batches (one database transaction each) so
+	memory stays flat for any area size.
+
+	<world>/pregenerate.txt keeps the area and the first chunk not saved
+	yet, an interrupted run started again with the same area goes on from
+	there. The file is removed when the area is done.
+*/
+
+class MapPregenerator
+{
+public:
+	MapPregenerator(Server *server, v3POS minp, v3POS maxp);
+
+	// Parses "(x,y,z) (x,y,z)" in nodes
+	static bool parseArea(const std::string &str, v3POS &minp, v3POS &maxp);
+
+	// Returns when the area is done or kill is set, false if stopped by kill
+	bool run(bool &kill);
+
+private:
+	v3POS getChunkBlockPos(u32 i) const;
+	u32 getChunkIndex(v3POS blockpos) const;
+	u32 loadCheckpoint();
+	void saveCheckpoint(u32 next);
+	void report(u32 start, u32 done, u64 start_ms) const;
+
+	static void emergeDone(v3POS blockpos, EmergeAction action, void *param);
+
+	Server *m_server;
+	s16 m_chunksize;
+	v3POS m_chunk_min;
+	// Chunks along every axis
+	v3POS m_chunks;
+	u32 m_total;
+	std::string m_area;
+	std::string m_checkpoint_path;
+
+	std::mutex m_mutex;
+	std::condition_variable m_done_cv;
+	std::set<u32> m_in_flight;
+	u32 m_generated = 0;
+	u32 m_existing = 0;
+	u32 m_failed = 0;
+};
+
+#endif
@@ -22,6 +22,7 @@ along with Freeminer.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "mapblock.h"
 
+#include <algorithm>
 #include <sstream>
 #include "map.h"
 #include "light.h"
@@ -72,6 +73,9 @@ static const char *modified_reason_strings[] = {
 	MapBlock
 */
 
+// Source of MapBlock::m_changed_seq
+static std::atomic_uint g_changed_seq(0);
+
 MapBlock::MapBlock(Map *parent, v3s16 pos, IGameDef *gamedef, bool dummy):
 		m_uptime_timer_last(0),
 		m_parent(parent),
@@ -92,6 +96,7 @@ MapBlock::MapBlock(Map *parent, v3s16 pos, IGameDef *gamedef, bool dummy):
 	humidity_add = 0;
 	m_timestamp = BLOCK_TIMESTAMP_UNDEFINED;
 	m_changed_timestamp = 0;
+	m_changed_seq = ++g_changed_seq;
 	m_day_night_differs_expired = true;
 	m_lighting_expired = true;
 	m_refcount = 0;
@@ -398,6 +403,7 @@ void MapBlock::copyFrom(VoxelManipulator &dst)
 	// Copy from VoxelManipulator to data
 	dst.copyTo(data, data_area, v3s16(0,0,0),
 			getPosRelative(), data_size);
+	m_changed_seq = ++g_changed_seq;
 }
 
 void MapBlock::actuallyUpdateDayNightDiff()
@@ -810,6 +816,10 @@ bool MapBlock::deSerialize(std::istream &is, u8 version, bool disk)
 		}
 
 		analyzeContent();
+
+		// Other nodes than those the caches were made of, the summary is
+		// made again on first use
+		m_changed_seq = ++g_changed_seq;
 	}
 
 	TRACESTREAM(<<"MapBlock::deSerialize "<<PP(getPos())
@@ -871,11 +881,15 @@ void MapBlock::deSerializeNetworkSpecific(std::istream &is)
 	{
 		if(mod >= MOD_STATE_WRITE_NEEDED /*&& m_timestamp != BLOCK_TIMESTAMP_UNDEFINED*/) {
 			m_changed_timestamp = (unsigned int)m_parent->time_life;
+			m_changed_seq = ++g_changed_seq;
 		}
 		if(mod > m_modified){
+			bool went_dirty = mod >= MOD_STATE_WRITE_NEEDED && m_modified < MOD_STATE_WRITE_NEEDED;
 			m_modified = mod;
 			if(m_modified >= MOD_STATE_WRITE_AT_UNLOAD)
 				m_disk_timestamp = m_timestamp;
+			if (went_dirty)
+				m_parent->blockModified(m_pos);
 		}
 		if (light == modified_light_yes)
 			setLightingExpired(true);
@@ -901,6 +915,77 @@ void MapBlock::pushElementsToCircuit(Circuit* circuit)
 		return true;
 	}
 
+u16 MapBlockContentSummary::count(content_t c) const
+{
+	auto i = std::lower_bound(contents.begin(), contents.end(),
+			std::make_pair(c, (u16)0));
+	return i != contents.end() && i->first == c ? i->second : 0;
+}
+
+std::shared_ptr<const MapBlockContentSummary> MapBlock::getContentSummary()
+{
+	{
+		std::lock_guard<Mutex> summary_lock(m_content_summary_mutex);
+		if (m_content_summary && m_content_summary->changed_seq == m_changed_seq)
+			return m_content_summary;
+	}
+
+	// Made without m_content_summary_mutex, it is never held while
+	// taking the block lock
+	std::shared_ptr<const MapBlockContentSummary> summary;
+	{
+		auto lock = lock_shared_rec();
+		summary = makeContentSummary();
+	}
+	std::lock_guard<Mutex> summary_lock(m_content_summary_mutex);
+	if (!m_content_summary || m_content_summary->changed_seq < summary->changed_seq)
+		m_content_summary = summary;
+	return summary;
+}
+
+std::shared_ptr<const MapBlockContentSummary> MapBlock::makeContentSummary()
+{
+	auto summary = std::make_shared<MapBlockContentSummary>();
+	summary->changed_seq = m_changed_seq;
+	if (!data) {
+		summary->contents.emplace_back(CONTENT_IGNORE, nodecount);
+		return summary;
+	}
+
+	// Sorted, every content is one run to count
+	content_t ids[nodecount];
+	for (u32 i = 0; i < nodecount; i++) {
+		content_t c = data[i].getContent();
+		ids[i] = c;
+		if (c == CONTENT_AIR || c == CONTENT_IGNORE)
+			continue;
+		s8 y = (i / ystride) % MAP_BLOCKSIZE;
+		if (summary->min_y == -1 || y < summary->min_y)
+			summary->min_y = y;
+		if (y > summary->max_y)
+			summary->max_y = y;
+	}
+	std::sort(ids, ids + nodecount);
+	for (u32 i = 0; i < nodecount; ) {
+		u32 end = i + 1;
+		while (end < nodecount && ids[end] == ids[i])
+			end++;
+		summary->contents.emplace_back(ids[i], end - i);
+		i = end;
+	}
+
+	INodeDefManager *ndef = m_gamedef->ndef();
+	summary->all_air = summary->contents.size() == 1 &&
+			summary->contents[0].first == CONTENT_AIR;
+	summary->all_solid = true;
+	for (const auto &content : summary->contents) {
+		const ContentFeatures &f = ndef->get(content.first);
+		summary->has_liquid |= f.isLiquid();
+		summary->all_solid &= content.first != CONTENT_IGNORE && f.walkable;
+	}
+	return summary;
+}
+
 
 #ifndef SERVER
 MapBlock::mesh_type MapBlock::getMesh(int step) {
@@ -116,6 +116,27 @@ struct abm_trigger_one {
 	bool activate;
 };
 
+/*
+	What the nodes of a block are, so passes looking for some contents skip
+	the blocks without them instead of reading every node
+*/
+struct MapBlockContentSummary {
+	// MapBlock::m_changed_seq of the nodes it was made of
+	u32 changed_seq = 0;
+	// Node count of every content in the block, sorted by content
+	std::vector<std::pair<content_t, u16> > contents;
+	// Lowest and highest relative y of a node not air or ignore, -1 if none
+	s8 min_y = -1;
+	s8 max_y = -1;
+	bool has_liquid = false;
+	bool all_air = false;
+	// Every node walkable
+	bool all_solid = false;
+
+	u16 count(content_t c) const;
+	bool has(content_t c) const { return count(c) != 0; }
+};
+
 ////
 //// MapBlock modified reason flags
 ////
@@ -620,6 +641,9 @@ class MapBlock /*: public NodeContainer*/
 
 	// Last really changed time (need send to client)
 	std::atomic_uint m_changed_timestamp;
+	// Changes with every modification of the nodes, never the same for two
+	// blocks, so caches about the nodes of a block can tell it is still valid
+	std::atomic_uint m_changed_seq;
 	u32 m_next_analyze_timestamp;
 	typedef std::list<abm_trigger_one> abm_triggers_type;
 	std::unique_ptr<abm_triggers_type> abm_triggers;
@@ -641,6 +665,8 @@ class MapBlock /*: public NodeContainer*/
 	content_t content_only;
 	u8 content_only_param1, content_only_param2;
 	bool analyzeContent();
+	// Summary of the current nodes, made again after they changed
+	std::shared_ptr<const MapBlockContentSummary> getContentSummary();
 	std::atomic_short lighting_broken;
 
 	static const u32 ystride = MAP_BLOCKSIZE;
@@ -722,6 +748,12 @@ class MapBlock /*: public NodeContainer*/
 	float m_usage_timer;
 	Mutex m_usage_timer_mutex;
 
+	std::shared_ptr<const MapBlockContentSummary> m_content_summary;
+	// Only guards the pointer, never held while taking the block lock
+	Mutex m_content_summary_mutex;
+	// Caller locks the nodes
+	std::shared_ptr<const MapBlockContentSummary> makeContentSummary();
+
 	/*
 		Reference count; currently used for determining if this block is in
 		the list of blocks to be drawn.
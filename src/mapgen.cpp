@@ -22,12 +22,14 @@ along with Freeminer.  If not, see <http://www.gnu.org/licenses/>.
 */
 
 #include <fstream>
+#include <thread>
 #include "mapgen.h"
 #include "voxel.h"
 #include "noise.h"
 #include "gamedef.h"
 #include "mg_biome.h"
 #include "mapblock.h"
+#include "mapgen_layer_cache.h"
 #include "mapnode.h"
 #include "map.h"
 #include "content_sao.h"
@@ -42,6 +44,7 @@ along with Freeminer.  If not, see <http://www.gnu.org/licenses/>.
 #include "util/serialize.h"
 #include "util/numeric.h"
 #include "filesys.h"
+#include "threading/worker_pool.h"
 
 #include "log_types.h"
 #include "mapgen_indev.h"
@@ -104,6 +107,16 @@ STATIC_ASSERT(
 	ARRLEN(g_reg_mapgens) == MAPGEN_INVALID,
 	registered_mapgens_is_wrong_size);
 
+const char *mapgen_stage_names[MGSTAGE_COUNT] = {
+	"caves",
+	"dungeons",
+	"biomes",
+	"ores",
+	"decorations",
+	"lighting",
+	"liquids",
+};
+
 ////
 //// Mapgen
 ////
@@ -123,6 +136,8 @@ Mapgen::Mapgen()
 	biomegen  = NULL;
 	biomemap  = NULL;
 	heightmap = NULL;
+
+	m_emerge = NULL;
 }
 
 
@@ -158,6 +173,14 @@ Mapgen::Mapgen(int mapgenid, MapgenParams *params, EmergeManager *emerge) :
 	biomegen  = NULL;
 	biomemap  = NULL;
 	heightmap = NULL;
+	layer_cache = emerge->layer_cache;
+
+	// One pool per emerge thread, 1 keeps the placement serial
+	int threads = g_settings->getS16("mapgen_placement_threads");
+	if (threads <= 0)
+		threads = std::max<int>(std::thread::hardware_concurrency(), 1);
+	if (threads > 1)
+		placement_pool.reset(new WorkerPool("MapgenPlacement", threads - 1));
 }
 
 
@@ -166,6 +189,40 @@ Mapgen::~Mapgen()
 }
 
 
+void Mapgen::perlinMap2DColumn(Noise *noise, const char *layer, v3s16 nmin,
+	float *persistmap)
+{
+	if (!layer_cache) {
+		noise->perlinMap2D(nmin.X, nmin.Z, persistmap);
+		return;
+	}
+	// Another mapgen type may use the same name and seed with other params
+	layer_cache->perlinMap2D(noise, std::string(getMapgenName(getType())) + ":" + layer,
+		v2s16(nmin.X, nmin.Z), persistmap);
+}
+
+
+MapgenStageTimer::MapgenStageTimer(Mapgen *mg, MapgenStage stage) :
+	m_mg((mg->stage_us && !mg->stage_timed) ? mg : NULL),
+	m_stage(stage),
+	m_start_us(0)
+{
+	if (!m_mg)
+		return;
+	m_mg->stage_timed = true;
+	m_start_us = porting::getTimeUs();
+}
+
+
+MapgenStageTimer::~MapgenStageTimer()
+{
+	if (!m_mg)
+		return;
+	m_mg->stage_us[m_stage] += (u32)(porting::getTimeUs() - m_start_us);
+	m_mg->stage_timed = false;
+}
+
+
 MapgenType Mapgen::getMapgenType(const std::string &mgname)
 {
 	for (size_t i = 0; i != ARRLEN(g_reg_mapgens); i++) {
@@ -382,6 +439,7 @@ inline bool Mapgen::isLiquidHorizontallyFlowable(u32 vi, v3s16 em)
 
 void Mapgen::updateLiquid(v3POS nmin, v3POS nmax)
 {
+	MapgenStageTimer stage_timer(this, MGSTAGE_LIQUIDS);
 	bool isignored, isliquid, wasignored, wasliquid, waschecked, waspushed;
 	v3s16 em  = vm->m_area.getExtent();
 	bool rare = g_settings->getBool("liquid_real");
@@ -450,59 +508,10 @@ void Mapgen::setLighting(u8 light, v3s16 nmin, v3s16 nmax)
 	}
 }
 
-void Mapgen::lightSpread(VoxelArea &a, v3s16 p, u8 light,
-		unordered_map_v3POS<u8> & skip, int r)
-{
-	if (light <= 1 || !a.contains(p))
-		return;
-
-	u32 vi = vm->m_area.index(p);
-	MapNode &n = vm->m_data[vi];
-
-	// Decay light in each of the banks separately
-	u8 light_day = light & 0x0F;
-	if (light_day > 0)
-		light_day -= 0x01;
-
-	u8 light_night = light & 0xF0;
-	if (light_night > 0x10)
-		light_night -= 0x10;
-
-	// Bail out only if we have no more light from either bank to propogate, or
-	// we hit a solid block that light cannot pass through.
-	if ((light_day  <= (n.param1 & 0x0F) &&
-		light_night <= (n.param1 & 0xF0)) ||
-		!ndef->get(n).light_propagates)
-		return;
-
-	// Since this recursive function only terminates when there is no light from
-	// either bank left, we need to take the max of both banks into account for
-	// the case where spreading has stopped for one light bank but not the other.
-	light = MYMAX(light_day, n.param1 & 0x0F) |
-			MYMAX(light_night, n.param1 & 0xF0);
-
-	n.param1 = light;
-
-	if (++r > 100) {
-		//errorstream<<"mapgen light recursion stop r="<<r << " p=" << p << " lwas=" << (int)n.param1 << " lnow="<< (int )light << " day="<<(int)light_day << " ni="<<(int)light_night<<" skip="<<skip.size() << "\n";
-		return;
-	}
-
-	if (skip.count(p))
-		return;
-	skip.emplace(p, 1);
-
-	lightSpread(a, p + v3s16(0, 0, 1), light, skip, r);
-	lightSpread(a, p + v3s16(0, 1, 0), light, skip, r);
-	lightSpread(a, p + v3s16(1, 0, 0), light, skip, r);
-	lightSpread(a, p - v3s16(0, 0, 1), light, skip, r);
-	lightSpread(a, p - v3s16(0, 1, 0), light, skip, r);
-	lightSpread(a, p - v3s16(1, 0, 0), light, skip, r);
-}
-
 void Mapgen::calcLighting(v3s16 nmin, v3s16 nmax, v3s16 full_nmin, v3s16 full_nmax,
 	bool propagate_shadow)
 {
+	MapgenStageTimer stage_timer(this, MGSTAGE_LIGHTING);
 	ScopeProfiler sp(g_profiler, "EmergeThread: mapgen lighting update", SPT_AVG);
 	//TimeTaker t("updateLighting");
 
@@ -518,46 +527,52 @@ void Mapgen::propagateSunlight(v3s16 nmin, v3s16 nmax, bool propagate_shadow)
 	//TimeTaker t("propagateSunlight");
 	VoxelArea a(nmin, nmax);
 	bool block_is_underground = (water_level >= nmax.Y);
-	v3s16 em = vm->m_area.getExtent();
+	v3s16 ea = a.getExtent();
 
 	// NOTE: Direct access to the low 4 bits of param1 is okay here because,
 	// by definition, sunlight will never be in the night lightbank.
 
-	for (int z = a.MinEdge.Z; z <= a.MaxEdge.Z; z++) {
-		for (int x = a.MinEdge.X; x <= a.MaxEdge.X; x++) {
+	auto sunlit_above = [&](s16 x, s16 z) {
+		const MapNode &n = vm->m_data[vm->m_area.index(x, a.MaxEdge.Y + 1, z)];
+		return n.getContent() != CONTENT_IGNORE && (n.param1 & 0x0F) == LIGHT_SUN;
+	};
+
+	// Columns still in sunlight, the whole area goes down one layer at a
+	// time so the inner loop runs over neighbouring nodes of a row
+	std::vector<u8> lit(ea.X * ea.Z, 0);
+	u32 lit_count = 0;
+	for (s16 z = a.MinEdge.Z; z <= a.MaxEdge.Z; z++) {
+		for (s16 x = a.MinEdge.X; x <= a.MaxEdge.X; x++) {
 			// see if we can get a light value from the overtop
-			u32 i = vm->m_area.index(x, a.MaxEdge.Y + 1, z);
-			if (vm->m_data[i].getContent() == CONTENT_IGNORE) {
+			const MapNode &top = vm->m_data[vm->m_area.index(x, a.MaxEdge.Y + 1, z)];
+			if (top.getContent() == CONTENT_IGNORE) {
 				if (block_is_underground)
 					continue;
-			} else if ((vm->m_data[i].param1 & 0x0F) != LIGHT_SUN &&
-					propagate_shadow) {
-				u32 ii = 0;
-				if (
-				(x < a.MaxEdge.X && (ii = vm->m_area.index(x + 1, a.MaxEdge.Y + 1, z    )) &&
-				(vm->m_data[ii].getContent() != CONTENT_IGNORE) &&
-				((vm->m_data[ii].param1 & 0x0F) == LIGHT_SUN))||
-				(x > a.MinEdge.X && (ii = vm->m_area.index(x - 1, a.MaxEdge.Y + 1, z    )) &&
-				(vm->m_data[ii].getContent() != CONTENT_IGNORE) &&
-				((vm->m_data[ii].param1 & 0x0F) == LIGHT_SUN))||
-				(z > a.MinEdge.Z && (ii = vm->m_area.index(x    , a.MaxEdge.Y + 1, z - 1)) &&
-				(vm->m_data[ii].getContent() != CONTENT_IGNORE) &&
-				((vm->m_data[ii].param1 & 0x0F) == LIGHT_SUN))||
-				(z < a.MaxEdge.Z && (ii = vm->m_area.index(x    , a.MaxEdge.Y + 1, z + 1)) &&
-				(vm->m_data[ii].getContent() != CONTENT_IGNORE) &&
-				((vm->m_data[ii].param1 & 0x0F) == LIGHT_SUN))
-				) {
-				} else
+			} else if ((top.param1 & 0x0F) != LIGHT_SUN && propagate_shadow &&
+					!(x < a.MaxEdge.X && sunlit_above(x + 1, z)) &&
+					!(x > a.MinEdge.X && sunlit_above(x - 1, z)) &&
+					!(z > a.MinEdge.Z && sunlit_above(x, z - 1)) &&
+					!(z < a.MaxEdge.Z && sunlit_above(x, z + 1))) {
 				continue;
 			}
-			vm->m_area.add_y(em, i, -1);
+			lit[(z - a.MinEdge.Z) * ea.X + (x - a.MinEdge.X)] = 1;
+			lit_count++;
+		}
+	}
 
-			for (int y = a.MaxEdge.Y; y >= a.MinEdge.Y; y--) {
-				MapNode &n = vm->m_data[i];
-				if (!ndef->get(n).sunlight_propagates)
-					break;
-				n.param1 = LIGHT_SUN;
-				vm->m_area.add_y(em, i, -1);
+	for (s16 y = a.MaxEdge.Y; y >= a.MinEdge.Y && lit_count; y--) {
+		for (s16 z = a.MinEdge.Z; z <= a.MaxEdge.Z; z++) {
+			u8 *row = &lit[(z - a.MinEdge.Z) * ea.X];
+			MapNode *n = &vm->m_data[vm->m_area.index(a.MinEdge.X, y, z)];
+			for (s16 x = 0; x < ea.X; x++) {
+				if (!row[x])
+					continue;
+				if (!ndef->get(n[x]).sunlight_propagates) {
+					row[x] = 0;
+					lit_count--;
+					continue;
+				}
+				n[x].param1 = LIGHT_SUN;
 			}
 		}
 	}
@@ -569,6 +584,8 @@ void Mapgen::spreadLight(v3s16 nmin, v3s16 nmax)
 {
 	//TimeTaker t("spreadLight");
 	VoxelArea a(nmin, nmax);
+	voxalgo::LightSpreader day(*vm, a, LIGHTBANK_DAY, ndef);
+	voxalgo::LightSpreader night(*vm, a, LIGHTBANK_NIGHT, ndef);
 
 	for (int z = a.MinEdge.Z; z <= a.MaxEdge.Z; z++) {
 		for (int y = a.MinEdge.Y; y <= a.MaxEdge.Y; y++) {
@@ -587,22 +604,21 @@ void Mapgen::spreadLight(v3s16 nmin, v3s16 nmax)
 
 				u8 light_produced = cf.light_source;
 				if (light_produced)
-					n.param1 = light_produced | (light_produced << 4);
-
-				u8 light = n.param1;
-				if (light) {
-					unordered_map_v3POS<u8> skip;
-					lightSpread(a, v3s16(x,     y,     z + 1), light, skip);
-					lightSpread(a, v3s16(x,     y + 1, z    ), light, skip);
-					lightSpread(a, v3s16(x + 1, y,     z    ), light, skip);
-					lightSpread(a, v3s16(x,     y,     z - 1), light, skip);
-					lightSpread(a, v3s16(x,     y - 1, z    ), light, skip);
-					lightSpread(a, v3s16(x - 1, y,     z    ), light, skip);
+					n.param1 = MYMAX(n.param1 & 0x0F, light_produced) |
+						MYMAX(n.param1 & 0xF0, light_produced << 4);
+
+				if (n.param1) {
+					v3s16 p(x, y, z);
+					day.addSource(p, n.param1 & 0x0F);
+					night.addSource(p, n.param1 >> 4);
 				}
 			}
 		}
 	}
 
+	day.spread();
+	night.spread();
+
 	//printf("spreadLight: %dms\n", t.stop());
 }
 
@@ -643,6 +659,7 @@ MapgenBasic::MapgenBasic(int mapgenid, MapgenParams *params, EmergeManager *emer
 	// TODO(hmmmm): should we have a way to disable biomemanager biomes?
 	biomegen = m_bmgr->createBiomeGen(BIOMEGEN_ORIGINAL, params->bparams, csize);
 	biomemap = biomegen->biomemap;
+	biomegen->layer_cache = layer_cache;
 
 	//// Look up some commonly used content
 	c_stone              = ndef->getId("mapgen_stone");
@@ -687,11 +704,15 @@ MapgenBasic::~MapgenBasic()
 {
 	delete biomegen;
 	delete []heightmap;
+	delete m_caves_noise;
+	delete m_ground_content;
 }
 
 
 MgStoneType MapgenBasic::generateBiomes()
 {
+	MapgenStageTimer stage_timer(this, MGSTAGE_BIOMES);
+
 	// can't generate biomes without a biome generator!
 	assert(biomegen);
 	assert(biomemap);
@@ -700,7 +721,7 @@ MgStoneType MapgenBasic::generateBiomes()
 	u32 index = 0;
 	MgStoneType stone_type = MGSTONE_STONE;
 
-	noise_filler_depth->perlinMap2D(node_min.X, node_min.Z);
+	perlinMap2DColumn(noise_filler_depth, "filler_depth", node_min);
 
 	for (s16 z = node_min.Z; z <= node_max.Z; z++)
 	for (s16 x = node_min.X; x <= node_max.X; x++, index++) {
@@ -896,13 +917,19 @@ void MapgenBasic::dustTopNodes()
 
 void MapgenBasic::generateCaves(s16 max_stone_y, s16 large_cave_depth)
 {
+	MapgenStageTimer stage_timer(this, MGSTAGE_CAVES);
+
 	if (max_stone_y < node_min.Y)
 		return;
 
-	CavesNoiseIntersection caves_noise(ndef, m_bmgr, csize,
-		&np_cave1, &np_cave2, seed, cave_width);
+	// The noise params are set by the mapgen after the MapgenBasic constructor
+	if (!m_ground_content)
+		m_ground_content = new GroundContentLookup(ndef);
+	if (!m_caves_noise)
+		m_caves_noise = new CavesNoiseIntersection(ndef, m_bmgr, csize,
+			&np_cave1, &np_cave2, seed, cave_width, m_ground_content);
 
-	caves_noise.generateCaves(vm, node_min, node_max, biomemap);
+	m_caves_noise->generateCaves(vm, node_min, node_max, biomemap);
 
 	if (node_max.Y > large_cave_depth)
 		return;
@@ -912,6 +939,7 @@ void MapgenBasic::generateCaves(s16 max_stone_y, s16 large_cave_depth)
 	for (u32 i = 0; i < bruises_count; i++) {
 		CavesRandomWalk cave(ndef, &gennotify, seed, water_level,
 			c_water_source, CONTENT_IGNORE);
+		cave.ground_content = m_ground_content;
 
 		cave.makeCave(vm, node_min, node_max, &ps, true, max_stone_y, heightmap);
 	}
@@ -920,6 +948,8 @@ void MapgenBasic::generateCaves(s16 max_stone_y, s16 large_cave_depth)
 
 void MapgenBasic::generateDungeons(s16 max_stone_y, MgStoneType stone_type)
 {
+	MapgenStageTimer stage_timer(this, MGSTAGE_DUNGEONS);
+
 	if (max_stone_y < node_min.Y)
 		return;
 
@@ -23,6 +23,7 @@ along with Freeminer.  If not, see <http://www.gnu.org/licenses/>.
 #ifndef MAPGEN_HEADER
 #define MAPGEN_HEADER
 
+#include <memory>
 #include "noise.h"
 #include "nodedef.h"
 #include "mapnode.h"
@@ -60,6 +61,11 @@ class VoxelManipulator;
 struct BlockMakeData;
 class VoxelArea;
 class Map;
+class WorkerPool;
+class CavesNoiseIntersection;
+class GroundContentLookup;
+class MapgenLayerCache;
+class Noise;
 
 enum MapgenObject {
 	MGOBJ_VMANIP,
@@ -88,6 +94,21 @@ enum MgStoneType {
 	MGSTONE_SANDSTONE,
 };
 
+// freeminer: stages of makeChunk timed by MapgenStageTimer, the terrain is
+// what is left of makeChunk
+enum MapgenStage {
+	MGSTAGE_CAVES,
+	MGSTAGE_DUNGEONS,
+	MGSTAGE_BIOMES,
+	MGSTAGE_ORES,
+	MGSTAGE_DECORATIONS,
+	MGSTAGE_LIGHTING,
+	MGSTAGE_LIQUIDS,
+	MGSTAGE_COUNT
+};
+
+extern const char *mapgen_stage_names[MGSTAGE_COUNT];
+
 struct GenNotifyEvent {
 	GenNotifyType type;
 	v3s16 pos;
@@ -198,7 +219,6 @@ class Mapgen {
 	void updateLiquid(v3s16 nmin, v3s16 nmax);
 
 	void setLighting(u8 light, v3s16 nmin, v3s16 nmax);
-	void lightSpread(VoxelArea &a, v3s16 p, u8 light, unordered_map_v3POS<u8> & skip, int r = 0);
 	void calcLighting(v3s16 nmin, v3s16 nmax, v3s16 full_nmin, v3s16 full_nmax,
 		bool propagate_shadow = true);
 	void propagateSunlight(v3s16 nmin, v3s16 nmax, bool propagate_shadow);
@@ -212,6 +232,19 @@ class Mapgen {
 	s16 liquid_pressure;
 	unordered_map_v3POS<s16> heat_cache;
 	unordered_map_v3POS<s16> humidity_cache;
+	// Ores and decorations of a chunk are placed in parallel on it, NULL
+	// places them one after the other
+	std::unique_ptr<WorkerPool> placement_pool;
+	// Microseconds spent in every MapgenStage are added here if set
+	u64 *stage_us = nullptr;
+	bool stage_timed = false;
+	// Shared by the mapgens of all emerge threads, may be NULL
+	MapgenLayerCache *layer_cache = nullptr;
+
+	// noise->perlinMap2D() at the x and z of nmin, copied from the layer
+	// cache if a chunk above or below made it before
+	void perlinMap2DColumn(Noise *noise, const char *layer, v3s16 nmin,
+		float *persistmap = NULL);
 
 	// getSpawnLevelAtPoint() is a function within each mapgen that returns a
 	// suitable y co-ordinate for player spawn ('suitable' usually meaning
@@ -236,6 +269,18 @@ class Mapgen {
 	DISABLE_CLASS_COPY(Mapgen);
 };
 
+// Adds the time of the scope to the stage, stages within stages count once
+class MapgenStageTimer {
+public:
+	MapgenStageTimer(Mapgen *mg, MapgenStage stage);
+	~MapgenStageTimer();
+
+private:
+	Mapgen *m_mg;
+	MapgenStage m_stage;
+	u32 m_start_us;
+};
+
 /*
 	MapgenBasic is a Mapgen implementation that handles basic functionality
 	the majority of conventional mapgens will probably want to use, but isn't
@@ -266,6 +311,10 @@ class MapgenBasic : public Mapgen {
 
 	Noise *noise_filler_depth;
 
+	// freeminer: made once, with the first chunk that has caves
+	CavesNoiseIntersection *m_caves_noise = nullptr;
+	GroundContentLookup *m_ground_content = nullptr;
+
 	v3s16 node_min;
 	v3s16 node_max;
 	v3s16 full_node_min;
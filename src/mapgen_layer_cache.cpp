@@ -0,0 +1,105 @@
+/*
+  This file is part of Freeminer.
+
+  Freeminer is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Freeminer  is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Freeminer.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "mapgen_layer_cache.h"
+
+#include <cstring>
+
+#include "metrics.h"
+#include "noise.h"
+
+MapgenLayerCache::MapgenLayerCache(size_t max_columns) :
+	m_max_columns(max_columns ? max_columns : 1)
+{
+}
+
+bool MapgenLayerCache::get(const std::string &layer, s32 seed, v2s16 pos,
+	v2s16 size, float *dst)
+{
+	static const auto hits = g_metrics->counter("freeminer_mapgen_layer_cache_hits_total",
+			"Mapgen 2D layers copied from the cache");
+	static const auto misses = g_metrics->counter("freeminer_mapgen_layer_cache_misses_total",
+			"Mapgen 2D layers not in the cache");
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto it = m_columns.find(Column{pos, size});
+		if (it != m_columns.end()) {
+			m_lru.splice(m_lru.begin(), m_lru, it->second);
+			auto l = it->second->layers.find(LayerKey(layer, seed));
+			if (l != it->second->layers.end()) {
+				memcpy(dst, l->second.data(), l->second.size() * sizeof(float));
+				++m_hits;
+				hits->add();
+				return true;
+			}
+		}
+	}
+	++m_misses;
+	misses->add();
+	return false;
+}
+
+void MapgenLayerCache::put(const std::string &layer, s32 seed, v2s16 pos,
+	v2s16 size, const float *src)
+{
+	const Column column{pos, size};
+	std::vector<float> data(src, src + (size_t)size.X * size.Y);
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto it = m_columns.find(column);
+	if (it == m_columns.end()) {
+		m_lru.push_front(Layers{column, {}});
+		it = m_columns.emplace(column, m_lru.begin()).first;
+		while (m_lru.size() > m_max_columns) {
+			m_columns.erase(m_lru.back().column);
+			m_lru.pop_back();
+		}
+	} else {
+		m_lru.splice(m_lru.begin(), m_lru, it->second);
+	}
+	it->second->layers[LayerKey(layer, seed)].swap(data);
+}
+
+void MapgenLayerCache::perlinMap2D(Noise *noise, const std::string &layer,
+	v2s16 pos, float *persistmap)
+{
+	const v2s16 size(noise->sx, noise->sy);
+	if (get(layer, noise->seed, pos, size, noise->result))
+		return;
+	noise->perlinMap2D(pos.X, pos.Y, persistmap);
+	put(layer, noise->seed, pos, size, noise->result);
+}
+
+void MapgenLayerCache::clear()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_columns.clear();
+	m_lru.clear();
+}
+
+size_t MapgenLayerCache::getColumnCount()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_lru.size();
+}
+
+float MapgenLayerCache::getHitRate() const
+{
+	const u64 hits = m_hits, total = hits + m_misses;
+	return total ? (float)hits / total : 0;
+}
@@ -0,0 +1,107 @@
+/*
+  This file is part of Freeminer.
+
+  Freeminer is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Freeminer  is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Freeminer.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef MAPGEN_LAYER_CACHE_HEADER
+#define MAPGEN_LAYER_CACHE_HEADER
+
+#include <atomic>
+#include <list>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "irr_v2d.h"
+
+class Noise;
+
+/*
+	The 2D noise layers of a mapchunk (heat, humidity, filler depth and the
+	terrain height noises of the mapgens) are the same for every chunk of
+	its column. The last used columns are kept here for all emerge threads,
+	a chunk above or below one generated before copies the layers instead
+	of calculating the noise again.
+
+	Columns are keyed by the x and z of the chunk and its size, layers
+	within a column by name and noise seed, so all noises of a chunk are
+	one column. The least recently used column is dropped when there are
+	more than mapgen_layer_cache_size.
+
+	Heightmap and biomemap are not cached: they are found from the 3D
+	terrain of each chunk, only the noise they are made of is.
+*/
+
+class MapgenLayerCache
+{
+public:
+	MapgenLayerCache(size_t max_columns);
+
+	// Copies the layer to dst (size.X * size.Y floats), false if not cached
+	bool get(const std::string &layer, s32 seed, v2s16 pos, v2s16 size, float *dst);
+	void put(const std::string &layer, s32 seed, v2s16 pos, v2s16 size, const float *src);
+
+	// noise->perlinMap2D(pos.X, pos.Y, persistmap) or the result of an
+	// earlier one, a persistmap must be the same for the same layer
+	void perlinMap2D(Noise *noise, const std::string &layer, v2s16 pos,
+		float *persistmap = NULL);
+
+	void clear();
+	size_t getColumnCount();
+	u64 getHits() const { return m_hits; }
+	u64 getMisses() const { return m_misses; }
+	// Of all get() since the start, 0 without any
+	float getHitRate() const;
+
+private:
+	struct Column {
+		v2s16 pos;
+		v2s16 size;
+
+		bool operator==(const Column &other) const
+		{
+			return pos == other.pos && size == other.size;
+		}
+	};
+
+	struct ColumnHash {
+		size_t operator()(const Column &c) const
+		{
+			return ((size_t)(u16)c.pos.X << 16 | (u16)c.pos.Y) ^
+				((size_t)(u16)c.size.X << 8);
+		}
+	};
+
+	// Name and noise seed
+	typedef std::pair<std::string, s32> LayerKey;
+
+	struct Layers {
+		Column column;
+		std::map<LayerKey, std::vector<float>> layers;
+	};
+
+	const size_t m_max_columns;
+	std::mutex m_mutex;
+	// Most recently used first
+	std::list<Layers> m_lru;
+	std::unordered_map<Column, std::list<Layers>::iterator, ColumnHash> m_columns;
+
+	std::atomic<u64> m_hits{0};
+	std::atomic<u64> m_misses{0};
+};
+
+#endif
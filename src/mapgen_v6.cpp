@@ -581,6 +581,7 @@ void MapgenV6::makeChunk(BlockMakeData *data)
 
 	// Add dungeons
 	if ((flags & MG_DUNGEONS) && (stone_surface_max_y >= node_min.Y)) {
+		MapgenStageTimer stage_timer(this, MGSTAGE_DUNGEONS);
 		DungeonParams dp;
 
 		dp.seed = seed;
@@ -1099,6 +1100,8 @@ void MapgenV6::growGrass() // Add surface nodes
 
 void MapgenV6::generateCaves(int max_stone_y)
 {
+	MapgenStageTimer stage_timer(this, MGSTAGE_CAVES);
+
 	float cave_amount = NoisePerlin2D(np_cave, node_min.X, node_min.Y, seed);
 	int volume_nodes = (node_max.X - node_min.X + 1) *
 					   (node_max.Y - node_min.Y + 1) * MAP_BLOCKSIZE;
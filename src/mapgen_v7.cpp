@@ -459,24 +459,24 @@ int MapgenV7::generateTerrain()
 	MapNode n_ice(c_ice);
 
 	//// Calculate noise for terrain generation
-	noise_terrain_persist->perlinMap2D(node_min.X, node_min.Z);
+	perlinMap2DColumn(noise_terrain_persist, "terrain_persist", node_min);
 	float *persistmap = noise_terrain_persist->result;
 
-	noise_terrain_base->perlinMap2D(node_min.X, node_min.Z, persistmap);
-	noise_terrain_alt->perlinMap2D(node_min.X, node_min.Z, persistmap);
-	noise_height_select->perlinMap2D(node_min.X, node_min.Z);
+	perlinMap2DColumn(noise_terrain_base, "terrain_base", node_min, persistmap);
+	perlinMap2DColumn(noise_terrain_alt, "terrain_alt", node_min, persistmap);
+	perlinMap2DColumn(noise_height_select, "height_select", node_min);
 
 	if ((spflags & MGV7_MOUNTAINS) || (spflags & MGV7_FLOATLANDS)) {
 		noise_mountain->perlinMap3D(node_min.X, node_min.Y - 1, node_min.Z);
 	}
 
 	if (spflags & MGV7_MOUNTAINS) {
-		noise_mount_height->perlinMap2D(node_min.X, node_min.Z);
+		perlinMap2DColumn(noise_mount_height, "mount_height", node_min);
 	}
 
 	if (spflags & MGV7_FLOATLANDS) {
-		noise_floatland_base->perlinMap2D(node_min.X, node_min.Z);
-		noise_float_base_height->perlinMap2D(node_min.X, node_min.Z);
+		perlinMap2DColumn(noise_floatland_base, "floatland_base", node_min);
+		perlinMap2DColumn(noise_float_base_height, "float_base_height", node_min);
 	}
 
 	//// Place nodes
@@ -565,7 +565,7 @@ void MapgenV7::generateRidgeTerrain()
 		return;
 
 	noise_ridge->perlinMap3D(node_min.X, node_min.Y - 1, node_min.Z);
-	noise_ridge_uwater->perlinMap2D(node_min.X, node_min.Z);
+	perlinMap2DColumn(noise_ridge_uwater, "ridge_uwater", node_min);
 
 	MapNode n_water(c_water_source);
 	MapNode n_ice(c_ice);
@@ -300,11 +300,11 @@ void MapgenValleys::calculateNoise()
 
 	//TimeTaker tcn("actualNoise");
 
-	noise_inter_valley_slope->perlinMap2D(x, z);
-	noise_rivers->perlinMap2D(x, z);
-	noise_terrain_height->perlinMap2D(x, z);
-	noise_valley_depth->perlinMap2D(x, z);
-	noise_valley_profile->perlinMap2D(x, z);
+	perlinMap2DColumn(noise_inter_valley_slope, "inter_valley_slope", node_min);
+	perlinMap2DColumn(noise_rivers, "rivers", node_min);
+	perlinMap2DColumn(noise_terrain_height, "terrain_height", node_min);
+	perlinMap2DColumn(noise_valley_depth, "valley_depth", node_min);
+	perlinMap2DColumn(noise_valley_profile, "valley_profile", node_min);
 
 	noise_inter_valley_fill->perlinMap3D(x, y, z);
 
@@ -601,6 +601,8 @@ int MapgenValleys::generateTerrain()
 
 void MapgenValleys::generateCaves(s16 max_stone_y, s16 large_cave_depth)
 {
+	MapgenStageTimer stage_timer(this, MGSTAGE_CAVES);
+
 	if (max_stone_y < node_min.Y)
 		return;
 
@@ -625,6 +627,9 @@ void MapgenValleys::generateCaves(s16 max_stone_y, s16 large_cave_depth)
 	float yblmax = massive_cave_depth - massive_cave_blend * 1.5f;
 	bool made_a_big_one = false;
 
+	if (!m_ground_content)
+		m_ground_content = new GroundContentLookup(ndef);
+
 	// Cache the tcave values as they only vary by altitude.
 	if (node_max.Y <= massive_cave_depth) {
 		noise_massive_caves->perlinMap3D(node_min.X, node_min.Y - 1, node_min.Z);
@@ -704,7 +709,7 @@ void MapgenValleys::generateCaves(s16 max_stone_y, s16 large_cave_depth)
 			float d1 = contour(noise_cave1->result[index_3d]);
 			float d2 = contour(noise_cave2->result[index_3d]);
 
-			if (d1 * d2 > cave_width && ndef->get(c).is_ground_content) {
+			if (d1 * d2 > cave_width && m_ground_content->get(c)) {
 				// in a tunnel
 				vm->m_data[index_data] = n_air;
 				tunnel_air_above = true;
@@ -752,6 +757,7 @@ void MapgenValleys::generateCaves(s16 max_stone_y, s16 large_cave_depth)
 		for (u32 i = 0; i < bruises_count; i++) {
 			CavesRandomWalk cave(ndef, &gennotify, seed, water_level,
 				c_water_source, c_lava_source);
+			cave.ground_content = m_ground_content;
 
 			cave.makeCave(vm, node_min, node_max, &ps, true, max_stone_y, heightmap);
 		}
@@ -0,0 +1,180 @@
+/*
+  This file is part of Freeminer.
+
+  Freeminer is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Freeminer  is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Freeminer.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "metrics.h"
+
+#include "threading/mutex_auto_lock.h"
+
+static Metrics main_metrics;
+Metrics *g_metrics = &main_metrics;
+
+const std::vector<double> Metrics::time_buckets =
+	{0.001, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10};
+
+Metrics::Histogram::Histogram(const std::vector<double> &bounds) :
+	m_bounds(bounds),
+	m_buckets(new std::atomic<u64>[bounds.size() + 1])
+{
+	for (size_t i = 0; i <= m_bounds.size(); ++i)
+		m_buckets[i].store(0, std::memory_order_relaxed);
+}
+
+void Metrics::Histogram::observe(double value)
+{
+	size_t i = 0;
+	while (i < m_bounds.size() && value > m_bounds[i])
+		++i;
+	m_buckets[i].fetch_add(1, std::memory_order_relaxed);
+	m_count.fetch_add(1, std::memory_order_relaxed);
+	double sum = m_sum.load(std::memory_order_relaxed);
+	while (!m_sum.compare_exchange_weak(sum, sum + value, std::memory_order_relaxed)) {}
+}
+
+Metrics::Family &Metrics::getFamily(const std::string &name, const std::string &help, Type type)
+{
+	auto it = m_families.find(name);
+	if (it != m_families.end())
+		return it->second;
+	auto &family = m_families[name];
+	family.help = help;
+	family.type = type;
+	return family;
+}
+
+Metrics::Counter *Metrics::counter(const std::string &name, const std::string &help,
+		const std::string &labels, double scale)
+{
+	MutexAutoLock lock(m_mutex);
+	auto &counter = getFamily(name, help, METRIC_COUNTER).counters[labels];
+	if (!counter) {
+		counter.reset(new Counter());
+		counter->m_scale = scale;
+	}
+	return counter.get();
+}
+
+Metrics::Gauge *Metrics::gauge(const std::string &name, const std::string &help,
+		const std::string &labels)
+{
+	MutexAutoLock lock(m_mutex);
+	auto &gauge = getFamily(name, help, METRIC_GAUGE).gauges[labels];
+	if (!gauge)
+		gauge.reset(new Gauge());
+	return gauge.get();
+}
+
+Metrics::Histogram *Metrics::histogram(const std::string &name, const std::string &help,
+		const std::vector<double> &bounds)
+{
+	MutexAutoLock lock(m_mutex);
+	auto &family = getFamily(name, help, METRIC_HISTOGRAM);
+	if (!family.histogram)
+		family.histogram.reset(new Histogram(bounds));
+	return family.histogram.get();
+}
+
+Metrics::Counter *Metrics::threadBusy(const std::string &thread)
+{
+	return counter("freeminer_thread_busy_seconds_total",
+			"Time spent working in thread loop",
+			"thread=\"" + thread + "\"", 0.000001);
+}
+
+void Metrics::peerReset(u16 peer_id)
+{
+	m_peer_traffic[peer_id][0].store(0, std::memory_order_relaxed);
+	m_peer_traffic[peer_id][1].store(0, std::memory_order_relaxed);
+}
+
+static void write_label_value(std::ostream &os, const std::string &value)
+{
+	for (auto c : value) {
+		if (c == '"' || c == '\\')
+			os << '\\' << c;
+		else if (c == '\n')
+			os << "\\n";
+		else
+			os << c;
+	}
+}
+
+void Metrics::writePeers(std::ostream &os, const std::map<u16, std::string> &peers)
+{
+	static const char *names[2] = {
+		"freeminer_client_sent_bytes_total",
+		"freeminer_client_received_bytes_total",
+	};
+	for (int dir = 0; dir < 2; ++dir) {
+		os << "# HELP " << names[dir] << " Network traffic per client\n"
+			<< "# TYPE " << names[dir] << " counter\n";
+		for (const auto &peer : peers) {
+			os << names[dir] << "{peer=\"" << peer.first << "\",name=\"";
+			write_label_value(os, peer.second);
+			os << "\"} " << m_peer_traffic[peer.first][dir].load(std::memory_order_relaxed) << "\n";
+		}
+	}
+}
+
+static void write_sample(std::ostream &os, const std::string &name,
+		const std::string &labels, double value)
+{
+	os << name;
+	if (!labels.empty())
+		os << "{" << labels << "}";
+	os << " " << value << "\n";
+}
+
+void Metrics::write(std::ostream &os)
+{
+	MutexAutoLock lock(m_mutex);
+	auto precision = os.precision(15);
+	for (const auto &it : m_families) {
+		const auto &name = it.first;
+		const auto &family = it.second;
+		static const char *types[] = {"counter", "gauge", "histogram"};
+		os << "# HELP " << name << " " << family.help << "\n"
+			<< "# TYPE " << name << " " << types[family.type] << "\n";
+		switch (family.type) {
+		case METRIC_COUNTER:
+			for (const auto &counter : family.counters)
+				write_sample(os, name, counter.first,
+						counter.second->get() * counter.second->m_scale);
+			break;
+		case METRIC_GAUGE:
+			for (const auto &gauge : family.gauges)
+				write_sample(os, name, gauge.first, gauge.second->get());
+			break;
+		case METRIC_HISTOGRAM: {
+			const auto &histogram = *family.histogram;
+			u64 cumulative = 0;
+			for (size_t i = 0; i <= histogram.m_bounds.size(); ++i) {
+				cumulative += histogram.m_buckets[i].load(std::memory_order_relaxed);
+				os << name << "_bucket{le=\"";
+				if (i < histogram.m_bounds.size())
+					os << histogram.m_bounds[i];
+				else
+					os << "+Inf";
+				os << "\"} " << cumulative << "\n";
+			}
+			os << name << "_sum " << histogram.m_sum.load(std::memory_order_relaxed) << "\n"
+				<< name << "_count " << histogram.m_count.load(std::memory_order_relaxed) << "\n";
+			break;
+		}
+		}
+	}
+	os.precision(precision);
+}
@@ -0,0 +1,151 @@
+/*
+  This file is part of Freeminer.
+
+  Freeminer is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Freeminer  is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Freeminer.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef METRICS_HEADER
+#define METRICS_HEADER
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "irrlichttypes.h"
+#include "threading/mutex.h"
+
+/*
+	Server metrics in Prometheus text exposition format
+
+	Metrics are registered once (takes a mutex) and the returned pointer is
+	kept by the owner; updating them afterwards is a relaxed atomic operation,
+	so they can be fed from hot paths without locking.
+*/
+
+class Metrics
+{
+public:
+	class Counter
+	{
+	public:
+		void add(u64 value = 1) { m_value.fetch_add(value, std::memory_order_relaxed); }
+		u64 get() const { return m_value.load(std::memory_order_relaxed); }
+	private:
+		friend class Metrics;
+		std::atomic<u64> m_value {0};
+		double m_scale = 1;
+	};
+
+	class Gauge
+	{
+	public:
+		void set(double value) { m_value.store(value, std::memory_order_relaxed); }
+		double get() const { return m_value.load(std::memory_order_relaxed); }
+	private:
+		std::atomic<double> m_value {0};
+	};
+
+	class Histogram
+	{
+	public:
+		Histogram(const std::vector<double> &bounds);
+		void observe(double value);
+	private:
+		friend class Metrics;
+		std::vector<double> m_bounds;
+		std::unique_ptr<std::atomic<u64>[]> m_buckets; // last one is +Inf
+		std::atomic<u64> m_count {0};
+		std::atomic<double> m_sum {0};
+	};
+
+	// Default buckets for durations, seconds
+	static const std::vector<double> time_buckets;
+
+	// labels are written as is, e.g. "thread=\"Map\""
+	// scale is applied on output, to count integer microseconds as seconds
+	Counter *counter(const std::string &name, const std::string &help,
+			const std::string &labels = "", double scale = 1);
+	Gauge *gauge(const std::string &name, const std::string &help,
+			const std::string &labels = "");
+	Histogram *histogram(const std::string &name, const std::string &help,
+			const std::vector<double> &bounds = time_buckets);
+
+	// Busy time counter of a worker thread loop
+	Counter *threadBusy(const std::string &thread);
+
+	// Network traffic per peer, indexed by peer id
+	void peerSent(u16 peer_id, u64 bytes)
+		{ m_peer_traffic[peer_id][0].fetch_add(bytes, std::memory_order_relaxed); }
+	void peerReceived(u16 peer_id, u64 bytes)
+		{ m_peer_traffic[peer_id][1].fetch_add(bytes, std::memory_order_relaxed); }
+	void peerReset(u16 peer_id);
+	// Call with clients known by caller, peer id -> player name
+	void writePeers(std::ostream &os, const std::map<u16, std::string> &peers);
+
+	void write(std::ostream &os);
+
+private:
+	enum Type {
+		METRIC_COUNTER,
+		METRIC_GAUGE,
+		METRIC_HISTOGRAM,
+	};
+
+	struct Family {
+		std::string help;
+		Type type;
+		std::map<std::string, std::unique_ptr<Counter>> counters;
+		std::map<std::string, std::unique_ptr<Gauge>> gauges;
+		std::unique_ptr<Histogram> histogram;
+	};
+
+	Family &getFamily(const std::string &name, const std::string &help, Type type);
+
+	Mutex m_mutex;
+	std::map<std::string, Family> m_families;
+	// Zero initialized in bss, pages are only touched for used peer ids
+	std::atomic<u64> m_peer_traffic[0x10000][2];
+};
+
+extern Metrics *g_metrics;
+
+// Adds time spent in scope to a counter (microseconds) and/or a histogram (seconds)
+class ScopeMetric
+{
+public:
+	ScopeMetric(Metrics::Counter *counter, Metrics::Histogram *histogram = nullptr) :
+		m_counter(counter),
+		m_histogram(histogram),
+		m_start(std::chrono::steady_clock::now())
+	{}
+	~ScopeMetric()
+	{
+		auto us = std::chrono::duration_cast<std::chrono::microseconds>(
+				std::chrono::steady_clock::now() - m_start).count();
+		if (m_counter)
+			m_counter->add(us);
+		if (m_histogram)
+			m_histogram->observe(us / 1000000.0);
+	}
+private:
+	Metrics::Counter *m_counter;
+	Metrics::Histogram *m_histogram;
+	std::chrono::steady_clock::time_point m_start;
+};
+
+#endif
@@ -26,6 +26,7 @@ along with Freeminer.  If not, see <http://www.gnu.org/licenses/>.
 #include "gamedef.h"
 #include "nodedef.h"
 #include "map.h" //for MMVManip
+#include "mapgen_layer_cache.h"
 #include "log_types.h"
 #include "util/numeric.h"
 #include "util/mathconstants.h"
@@ -182,6 +183,14 @@ void BiomeGenOriginal::calcBiomeNoise(v3s16 pmin)
 {
 	m_pmin = pmin;
 
+	// With the blend added, the same for every chunk of the column
+	const v2s16 pos(pmin.X, pmin.Z), size(m_csize.X, m_csize.Z);
+	if (layer_cache &&
+			layer_cache->get("biome:heat", noise_heat->seed, pos, size, noise_heat->result) &&
+			layer_cache->get("biome:humidity", noise_humidity->seed, pos, size,
+				noise_humidity->result))
+		return;
+
 	noise_heat->perlinMap2D(pmin.X, pmin.Z);
 	noise_humidity->perlinMap2D(pmin.X, pmin.Z);
 	noise_heat_blend->perlinMap2D(pmin.X, pmin.Z);
@@ -191,6 +200,12 @@ void BiomeGenOriginal::calcBiomeNoise(v3s16 pmin)
 		noise_heat->result[i]     += noise_heat_blend->result[i];
 		noise_humidity->result[i] += noise_humidity_blend->result[i];
 	}
+
+	if (layer_cache) {
+		layer_cache->put("biome:heat", noise_heat->seed, pos, size, noise_heat->result);
+		layer_cache->put("biome:humidity", noise_humidity->seed, pos, size,
+			noise_humidity->result);
+	}
 }
 
 
@@ -33,6 +33,7 @@ struct MapgenParams;
 
 class Settings;
 class BiomeManager;
+class MapgenLayerCache;
 
 ////
 //// Biome
@@ -129,6 +130,9 @@ class BiomeGen {
 	// Result of calcBiomes bulk computation.
 	biome_t *biomemap;
 
+	// freeminer: heat and humidity of chunk columns are shared here if set
+	MapgenLayerCache *layer_cache = nullptr;
+
 protected:
 	BiomeManager *m_bmgr;
 	v3s16 m_pmin;
@@ -17,6 +17,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
 */
 
+#include <deque>
 #include "mg_decoration.h"
 #include "mg_schematic.h"
 #include "mapgen.h"
@@ -24,6 +25,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "map.h"
 #include "log.h"
 #include "util/numeric.h"
+#include "threading/worker_pool.h"
 
 FlagDesc flagdesc_deco[] = {
 	{"place_center_x",  DECO_PLACE_CENTER_X},
@@ -47,15 +49,103 @@ DecorationManager::DecorationManager(IGameDef *gamedef) :
 size_t DecorationManager::placeAllDecos(Mapgen *mg, u32 blockseed,
 	v3s16 nmin, v3s16 nmax)
 {
+	MapgenStageTimer stage_timer(mg, MGSTAGE_DECORATIONS);
 	size_t nplaced = 0;
+	WorkerPool *pool = mg->placement_pool.get();
+
+	if (!pool) {
+		for (size_t i = 0; i != m_objects.size(); i++) {
+			Decoration *deco = (Decoration *)m_objects[i];
+			if (!deco)
+				continue;
+
+			nplaced += deco->placeDeco(mg, blockseed, nmin, nmax);
+			blockseed++;
+		}
+
+		return nplaced;
+	}
+
+	/*
+		A row of divisions of one decoration only touches the z range of the
+		row widened by the reach of the decoration. Rows are put in levels:
+		one level after the last earlier row touching the same z (and after
+		the previous row of the decoration, its random numbers go on from
+		there). The rows of a level don't touch each other and are placed in
+		parallel, the levels one after the other.
+		Rows drawing the global random numbers (probabilistic schematics)
+		also come after all earlier such rows, only one of them is placed at
+		a time and they draw in the serial order.
+	*/
+	struct Row {
+		Decoration *deco;
+		size_t random;
+		s16 sidelen;
+		s16 z0;
+		std::vector<v3s16> placed;
+	};
+	std::vector<Row> rows;
+	std::deque<PcgRandom> randoms;
+	std::vector<std::vector<size_t> > levels;
+
+	const VoxelArea &area = mg->vm->m_area;
+	std::vector<size_t> z_levels(area.getExtent().Z, 0);
+	size_t global_random_level = 0;
 
 	for (size_t i = 0; i != m_objects.size(); i++) {
 		Decoration *deco = (Decoration *)m_objects[i];
 		if (!deco)
 			continue;
 
-		nplaced += deco->placeDeco(mg, blockseed, nmin, nmax);
+		randoms.emplace_back(blockseed + 53);
 		blockseed++;
+
+		s16 sidelen = deco->getSidelen(nmin, nmax);
+		s16 divlen  = (nmax.X - nmin.X + 1) / sidelen;
+		int reach   = deco->getReach();
+		bool global_random = deco->usesGlobalRandom();
+		size_t level = 0;
+
+		for (s16 z0 = 0; z0 < divlen; z0++) {
+			int zmin = MYMAX(nmin.Z + sidelen * z0 - reach, area.MinEdge.Z);
+			int zmax = MYMIN(nmin.Z + sidelen * (z0 + 1) - 1 + reach, area.MaxEdge.Z);
+			for (int z = zmin; z <= zmax; z++)
+				level = MYMAX(level, z_levels[z - area.MinEdge.Z]);
+			if (global_random)
+				level = MYMAX(level, global_random_level);
+			level++;
+			for (int z = zmin; z <= zmax; z++)
+				z_levels[z - area.MinEdge.Z] = level;
+			if (global_random)
+				global_random_level = level;
+
+			if (levels.size() < level)
+				levels.resize(level);
+			levels[level - 1].push_back(rows.size());
+
+			Row row;
+			row.deco    = deco;
+			row.random  = randoms.size() - 1;
+			row.sidelen = sidelen;
+			row.z0      = z0;
+			rows.push_back(row);
+		}
+	}
+
+	for (size_t l = 0; l != levels.size(); l++) {
+		const std::vector<size_t> &level = levels[l];
+		pool->forEach(level.size(), [&](size_t i) {
+			Row &row = rows[level[i]];
+			row.deco->placeDivisionRow(mg, randoms[row.random], row.sidelen,
+				row.z0, nmin, nmax, row.placed);
+		});
+	}
+
+	// Notifications in the serial order
+	for (size_t i = 0; i != rows.size(); i++) {
+		for (size_t j = 0; j != rows[i].placed.size(); j++)
+			mg->gennotify.addEvent(GENNOTIFY_DECORATION, rows[i].placed[j],
+				rows[i].deco->index);
 	}
 
 	return nplaced;
@@ -135,20 +225,42 @@ bool Decoration::canPlaceDecoration(MMVManip *vm, v3s16 p)
 }
 
 
-size_t Decoration::placeDeco(Mapgen *mg, u32 blockseed, v3s16 nmin, v3s16 nmax)
+s16 Decoration::getSidelen(v3s16 nmin, v3s16 nmax)
 {
-	PcgRandom ps(blockseed + 53);
-	int carea_size = nmax.X - nmin.X + 1;
-
 	// Divide area into parts
 	// If chunksize is changed it may no longer be divisable by sidelen
+	int carea_size = nmax.X - nmin.X + 1;
 	if (carea_size % sidelen)
-		sidelen = carea_size;
+		return carea_size;
+	return sidelen;
+}
+
+
+size_t Decoration::placeDeco(Mapgen *mg, u32 blockseed, v3s16 nmin, v3s16 nmax)
+{
+	PcgRandom ps(blockseed + 53);
+	s16 sidelen = getSidelen(nmin, nmax);
+	s16 divlen = (nmax.X - nmin.X + 1) / sidelen;
+	std::vector<v3s16> placed;
+
+	for (s16 z0 = 0; z0 < divlen; z0++) {
+		placeDivisionRow(mg, ps, sidelen, z0, nmin, nmax, placed);
+		for (size_t i = 0; i != placed.size(); i++)
+			mg->gennotify.addEvent(GENNOTIFY_DECORATION, placed[i], index);
+		placed.clear();
+	}
 
+	return 0;
+}
+
+
+void Decoration::placeDivisionRow(Mapgen *mg, PcgRandom &ps, s16 sidelen, s16 z0,
+	v3s16 nmin, v3s16 nmax, std::vector<v3s16> &placed)
+{
+	int carea_size = nmax.X - nmin.X + 1;
 	s16 divlen = carea_size / sidelen;
 	int area = sidelen * sidelen;
 
-	for (s16 z0 = 0; z0 < divlen; z0++)
 	for (s16 x0 = 0; x0 < divlen; x0++) {
 		v2s16 p2d_center( // Center position of part of division
 			nmin.X + sidelen / 2 + sidelen * x0,
@@ -217,11 +329,9 @@ size_t Decoration::placeDeco(Mapgen *mg, u32 blockseed, v3s16 nmin, v3s16 nmax)
 
 			v3s16 pos(x, y, z);
 			if (generate(mg->vm, &ps, pos))
-				mg->gennotify.addEvent(GENNOTIFY_DECORATION, pos, index);
+				placed.push_back(pos);
 		}
 	}
-
-	return 0;
 }
 
 
@@ -328,6 +438,13 @@ int DecoSimple::getHeight()
 }
 
 
+int DecoSimple::getReach()
+{
+	// The spawnby neighbours
+	return (nspawnby == -1) ? 0 : 1;
+}
+
+
 ///////////////////////////////////////////////////////////////////////////////
 
 DecoSchematic::DecoSchematic()
@@ -364,6 +481,12 @@ size_t DecoSchematic::generate(MMVManip *vm, PcgRandom *pr, v3s16 p)
 }
 
 
+bool DecoSchematic::usesGlobalRandom()
+{
+	return schematic && schematic->usesGlobalRandom();
+}
+
+
 int DecoSchematic::getHeight()
 {
 	// Account for a schematic being sunk into the ground by flag.
@@ -372,3 +495,15 @@ int DecoSchematic::getHeight()
 	return (flags & DECO_PLACE_CENTER_Y) ?
 		(schematic->size.Y - 1) / 2 : schematic->size.Y - 1;
 }
+
+
+int DecoSchematic::getReach()
+{
+	if (schematic == NULL)
+		return 0;
+
+	// Placed centered or not and rotated, the schematic stays within its
+	// largest side around the position
+	return MYMAX(MYMAX(schematic->size.X, schematic->size.Z),
+		(nspawnby == -1) ? 0 : 1);
+}
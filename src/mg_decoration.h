@@ -72,8 +72,19 @@ class Decoration : public ObjDef, public NodeResolver {
 	size_t placeDeco(Mapgen *mg, u32 blockseed, v3s16 nmin, v3s16 nmax);
 	//size_t placeCutoffs(Mapgen *mg, u32 blockseed, v3s16 nmin, v3s16 nmax);
 
+	// The sidelen used for a chunk, all of it if sidelen doesn't divide it
+	s16 getSidelen(v3s16 nmin, v3s16 nmax);
+	// The divisions at z0 of placeDeco, positions of the placed decorations
+	// are added to placed
+	void placeDivisionRow(Mapgen *mg, PcgRandom &ps, s16 sidelen, s16 z0,
+		v3s16 nmin, v3s16 nmax, std::vector<v3s16> &placed);
+
 	virtual size_t generate(MMVManip *vm, PcgRandom *pr, v3s16 p) = 0;
 	virtual int getHeight() = 0;
+	// How far from the placement position in x and z nodes are read or written
+	virtual int getReach() = 0;
+	// Placing draws the global random numbers, not only those of placeDeco
+	virtual bool usesGlobalRandom() { return false; }
 
 	u32 flags;
 	int mapseed;
@@ -96,6 +107,7 @@ class DecoSimple : public Decoration {
 	virtual void resolveNodeNames();
 	virtual size_t generate(MMVManip *vm, PcgRandom *pr, v3s16 p);
 	virtual int getHeight();
+	virtual int getReach();
 
 	std::vector<content_t> c_decos;
 	s16 deco_height;
@@ -109,6 +121,8 @@ class DecoSchematic : public Decoration {
 
 	virtual size_t generate(MMVManip *vm, PcgRandom *pr, v3s16 p);
 	virtual int getHeight();
+	virtual int getReach();
+	virtual bool usesGlobalRandom();
 
 	Rotation rotation;
 	Schematic *schematic;
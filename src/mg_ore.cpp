@@ -23,6 +23,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "util/numeric.h"
 #include "map.h"
 #include "log.h"
+#include "threading/worker_pool.h"
 
 FlagDesc flagdesc_ore[] = {
 	{"absheight",                 OREFLAG_ABSHEIGHT},
@@ -43,16 +44,63 @@ OreManager::OreManager(IGameDef *gamedef) :
 
 size_t OreManager::placeAllOres(Mapgen *mg, u32 blockseed, v3s16 nmin, v3s16 nmax)
 {
+	MapgenStageTimer stage_timer(mg, MGSTAGE_ORES);
 	size_t nplaced = 0;
+	WorkerPool *pool = mg->placement_pool.get();
+
+	if (!pool) {
+		for (size_t i = 0; i != m_objects.size(); i++) {
+			Ore *ore = (Ore *)m_objects[i];
+			if (!ore)
+				continue;
+
+			nplaced += ore->placeOre(mg, blockseed, nmin, nmax);
+			blockseed++;
+		}
+
+		return nplaced;
+	}
+
+	// A batch is prepared in parallel and then applied in the serial order,
+	// the batches keep the memory of the prepared nodes bounded
+	const size_t batch_size = (pool->workers.size() + 1) * 4;
+	std::vector<OrePlacement> batch;
+	std::vector<content_t> batch_ores;
+
+	auto place_batch = [&]() {
+		pool->forEach(batch.size(), [&](size_t i) {
+			batch[i].ore->prepare(batch[i], mg->vm, mg->seed, mg->biomemap);
+		});
+		for (size_t i = 0; i != batch.size(); i++)
+			batch[i].ore->apply(batch[i], mg->vm, mg->biomemap);
+		batch.clear();
+		batch_ores.clear();
+	};
 
 	for (size_t i = 0; i != m_objects.size(); i++) {
 		Ore *ore = (Ore *)m_objects[i];
 		if (!ore)
 			continue;
 
-		nplaced += ore->placeOre(mg, blockseed, nmin, nmax);
-		blockseed++;
+		OrePlacement placement;
+		placement.ore       = ore;
+		placement.blockseed = blockseed++;
+		placement.nmin      = nmin;
+		placement.nmax      = nmax;
+		if (!ore->getPlacementArea(placement.nmin, placement.nmax))
+			continue;
+
+		for (size_t j = 0; j != batch_ores.size(); j++)
+			placement.wherein_may_grow |= CONTAINS(ore->c_wherein, batch_ores[j]);
+		batch_ores.push_back(ore->c_ore);
+		batch.push_back(std::move(placement));
+		nplaced++;
+
+		if (batch.size() == batch_size)
+			place_batch();
 	}
+	if (!batch.empty())
+		place_batch();
 
 	return nplaced;
 }
@@ -91,7 +139,7 @@ void Ore::resolveNodeNames()
 }
 
 
-size_t Ore::placeOre(Mapgen *mg, u32 blockseed, v3s16 nmin, v3s16 nmax)
+bool Ore::getPlacementArea(v3s16 &nmin, v3s16 &nmax)
 {
 	int in_range = 0;
 
@@ -99,7 +147,7 @@ size_t Ore::placeOre(Mapgen *mg, u32 blockseed, v3s16 nmin, v3s16 nmax)
 	if (flags & OREFLAG_ABSHEIGHT)
 		in_range |= (nmin.Y >= -y_max && nmax.Y <= -y_min) << 1;
 	if (!in_range)
-		return 0;
+		return false;
 
 	int actual_ymin, actual_ymax;
 	if (in_range & ORE_RANGE_MIRROR) {
@@ -110,25 +158,59 @@ size_t Ore::placeOre(Mapgen *mg, u32 blockseed, v3s16 nmin, v3s16 nmax)
 		actual_ymax = MYMIN(nmax.Y, y_max);
 	}
 	if (clust_size >= actual_ymax - actual_ymin + 1)
-		return 0;
+		return false;
 
 	nmin.Y = actual_ymin;
 	nmax.Y = actual_ymax;
-	generate(mg->vm, mg->seed, blockseed, nmin, nmax, mg->biomemap);
+	return true;
+}
+
+
+size_t Ore::placeOre(Mapgen *mg, u32 blockseed, v3s16 nmin, v3s16 nmax)
+{
+	OrePlacement placement;
+	placement.ore       = this;
+	placement.blockseed = blockseed;
+	placement.nmin      = nmin;
+	placement.nmax      = nmax;
+	if (!getPlacementArea(placement.nmin, placement.nmax))
+		return 0;
+
+	prepare(placement, mg->vm, mg->seed, mg->biomemap);
+	apply(placement, mg->vm, mg->biomemap);
 
 	return 1;
 }
 
 
-///////////////////////////////////////////////////////////////////////////////
+bool Ore::isWherein(MMVManip *vm, u32 i)
+{
+	return CONTAINS(c_wherein, vm->m_data[i].getContent());
+}
 
 
-void OreScatter::generate(MMVManip *vm, int mapseed, u32 blockseed,
-	v3s16 nmin, v3s16 nmax, u8 *biomemap)
+void Ore::apply(OrePlacement &placement, MMVManip *vm, u8 *biomemap)
 {
-	PcgRandom pr(blockseed);
 	MapNode n_ore(c_ore, 0, ore_param2);
 
+	for (size_t j = 0; j != placement.nodes.size(); j++) {
+		u32 i = placement.nodes[j];
+		if (isWherein(vm, i))
+			vm->m_data[i] = n_ore;
+	}
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+
+
+void OreScatter::prepare(OrePlacement &placement, MMVManip *vm, int mapseed,
+	u8 *biomemap)
+{
+	const v3s16 &nmin = placement.nmin;
+	const v3s16 &nmax = placement.nmax;
+	PcgRandom pr(placement.blockseed);
+
 	u32 sizex  = (nmax.X - nmin.X + 1);
 	u32 volume = (nmax.X - nmin.X + 1) *
 				 (nmax.Y - nmin.Y + 1) *
@@ -163,10 +245,10 @@ void OreScatter::generate(MMVManip *vm, int mapseed, u32 blockseed,
 				continue;
 
 			u32 i = vm->m_area.index(x0 + x1, y0 + y1, z0 + z1);
-			if (!CONTAINS(c_wherein, vm->m_data[i].getContent()))
+			if (!placement.wherein_may_grow && !isWherein(vm, i))
 				continue;
 
-			vm->m_data[i] = n_ore;
+			placement.nodes.push_back(i);
 		}
 	}
 }
@@ -175,11 +257,12 @@ void OreScatter::generate(MMVManip *vm, int mapseed, u32 blockseed,
 ///////////////////////////////////////////////////////////////////////////////
 
 
-void OreSheet::generate(MMVManip *vm, int mapseed, u32 blockseed,
-	v3s16 nmin, v3s16 nmax, u8 *biomemap)
+void OreSheet::prepare(OrePlacement &placement, MMVManip *vm, int mapseed,
+	u8 *biomemap)
 {
-	PcgRandom pr(blockseed + 4234);
-	MapNode n_ore(c_ore, 0, ore_param2);
+	const v3s16 &nmin = placement.nmin;
+	const v3s16 &nmax = placement.nmax;
+	PcgRandom pr(placement.blockseed + 4234);
 
 	u16 max_height = column_height_max;
 	int y_start_min = nmin.Y + max_height;
@@ -219,10 +302,10 @@ void OreSheet::generate(MMVManip *vm, int mapseed, u32 blockseed,
 			u32 i = vm->m_area.index(x, y, z);
 			if (!vm->m_area.contains(i))
 				continue;
-			if (!CONTAINS(c_wherein, vm->m_data[i].getContent()))
+			if (!placement.wherein_may_grow && !isWherein(vm, i))
 				continue;
 
-			vm->m_data[i] = n_ore;
+			placement.nodes.push_back(i);
 		}
 	}
 }
@@ -245,11 +328,12 @@ OrePuff::~OrePuff()
 }
 
 
-void OrePuff::generate(MMVManip *vm, int mapseed, u32 blockseed,
-	v3s16 nmin, v3s16 nmax, u8 *biomemap)
+void OrePuff::prepare(OrePlacement &placement, MMVManip *vm, int mapseed,
+	u8 *biomemap)
 {
-	PcgRandom pr(blockseed + 4234);
-	MapNode n_ore(c_ore, 0, ore_param2);
+	const v3s16 &nmin = placement.nmin;
+	const v3s16 &nmax = placement.nmax;
+	PcgRandom pr(placement.blockseed + 4234);
 
 	int y_start = pr.range(nmin.Y, nmax.Y);
 
@@ -306,10 +390,10 @@ void OrePuff::generate(MMVManip *vm, int mapseed, u32 blockseed,
 			u32 i = vm->m_area.index(x, y, z);
 			if (!vm->m_area.contains(i))
 				continue;
-			if (!CONTAINS(c_wherein, vm->m_data[i].getContent()))
+			if (!placement.wherein_may_grow && !isWherein(vm, i))
 				continue;
 
-			vm->m_data[i] = n_ore;
+			placement.nodes.push_back(i);
 		}
 	}
 }
@@ -318,11 +402,12 @@ void OrePuff::generate(MMVManip *vm, int mapseed, u32 blockseed,
 ///////////////////////////////////////////////////////////////////////////////
 
 
-void OreBlob::generate(MMVManip *vm, int mapseed, u32 blockseed,
-	v3s16 nmin, v3s16 nmax, u8 *biomemap)
+void OreBlob::prepare(OrePlacement &placement, MMVManip *vm, int mapseed,
+	u8 *biomemap)
 {
-	PcgRandom pr(blockseed + 2404);
-	MapNode n_ore(c_ore, 0, ore_param2);
+	const v3s16 &nmin = placement.nmin;
+	const v3s16 &nmax = placement.nmax;
+	PcgRandom pr(placement.blockseed + 2404);
 
 	u32 sizex  = (nmax.X - nmin.X + 1);
 	u32 volume = (nmax.X - nmin.X + 1) *
@@ -347,14 +432,14 @@ void OreBlob::generate(MMVManip *vm, int mapseed, u32 blockseed,
 		}
 
 		bool noise_generated = false;
-		noise->seed = blockseed + i;
+		noise->seed = placement.blockseed + i;
 
 		size_t index = 0;
 		for (u32 z1 = 0; z1 != csize; z1++)
 		for (u32 y1 = 0; y1 != csize; y1++)
 		for (u32 x1 = 0; x1 != csize; x1++, index++) {
 			u32 i = vm->m_area.index(x0 + x1, y0 + y1, z0 + z1);
-			if (!CONTAINS(c_wherein, vm->m_data[i].getContent()))
+			if (!placement.wherein_may_grow && !isWherein(vm, i))
 				continue;
 
 			// Lazily generate noise only if there's a chance of ore being placed
@@ -375,7 +460,7 @@ void OreBlob::generate(MMVManip *vm, int mapseed, u32 blockseed,
 			if (noiseval < nthresh)
 				continue;
 
-			vm->m_data[i] = n_ore;
+			placement.nodes.push_back(i);
 		}
 	}
 }
@@ -396,13 +481,11 @@ OreVein::~OreVein()
 }
 
 
-void OreVein::generate(MMVManip *vm, int mapseed, u32 blockseed,
-	v3s16 nmin, v3s16 nmax, u8 *biomemap)
+void OreVein::prepare(OrePlacement &placement, MMVManip *vm, int mapseed,
+	u8 *biomemap)
 {
-	PcgRandom pr(blockseed + 520);
-	MapNode n_ore(c_ore, 0, ore_param2);
-
-	u32 sizex = (nmax.X - nmin.X + 1);
+	const v3s16 &nmin = placement.nmin;
+	const v3s16 &nmax = placement.nmax;
 
 	if (!noise) {
 		int sx = nmax.X - nmin.X + 1;
@@ -411,16 +494,31 @@ void OreVein::generate(MMVManip *vm, int mapseed, u32 blockseed,
 		noise  = new Noise(&np, mapseed, sx, sy, sz);
 		noise2 = new Noise(&np, mapseed + 436, sx, sy, sz);
 	}
-	bool noise_generated = false;
 
-	size_t index = 0;
+	// The random values depend on the nodes the earlier ores left, they are
+	// drawn by apply(). Same lazy generation optimization as in OreBlob.
+	placement.noise_generated = placement.wherein_may_grow ||
+		findPlacement(placement, vm, biomemap);
+	if (placement.noise_generated) {
+		noise->perlinMap3D(nmin.X, nmin.Y, nmin.Z);
+		noise2->perlinMap3D(nmin.X, nmin.Y, nmin.Z);
+	}
+}
+
+
+bool OreVein::findPlacement(OrePlacement &placement, MMVManip *vm, u8 *biomemap)
+{
+	const v3s16 &nmin = placement.nmin;
+	const v3s16 &nmax = placement.nmax;
+	u32 sizex = (nmax.X - nmin.X + 1);
+
 	for (int z = nmin.Z; z <= nmax.Z; z++)
 	for (int y = nmin.Y; y <= nmax.Y; y++)
-	for (int x = nmin.X; x <= nmax.X; x++, index++) {
+	for (int x = nmin.X; x <= nmax.X; x++) {
 		u32 i = vm->m_area.index(x, y, z);
 		if (!vm->m_area.contains(i))
 			continue;
-		if (!CONTAINS(c_wherein, vm->m_data[i].getContent()))
+		if (!isWherein(vm, i))
 			continue;
 
 		if (biomemap && !biomes.empty()) {
@@ -430,11 +528,40 @@ void OreVein::generate(MMVManip *vm, int mapseed, u32 blockseed,
 				continue;
 		}
 
-		// Same lazy generation optimization as in OreBlob
-		if (!noise_generated) {
-			noise_generated = true;
-			noise->perlinMap3D(nmin.X, nmin.Y, nmin.Z);
-			noise2->perlinMap3D(nmin.X, nmin.Y, nmin.Z);
+		return true;
+	}
+
+	return false;
+}
+
+
+void OreVein::apply(OrePlacement &placement, MMVManip *vm, u8 *biomemap)
+{
+	if (!placement.noise_generated)
+		return;
+
+	const v3s16 &nmin = placement.nmin;
+	const v3s16 &nmax = placement.nmax;
+	PcgRandom pr(placement.blockseed + 520);
+	MapNode n_ore(c_ore, 0, ore_param2);
+
+	u32 sizex = (nmax.X - nmin.X + 1);
+
+	size_t index = 0;
+	for (int z = nmin.Z; z <= nmax.Z; z++)
+	for (int y = nmin.Y; y <= nmax.Y; y++)
+	for (int x = nmin.X; x <= nmax.X; x++, index++) {
+		u32 i = vm->m_area.index(x, y, z);
+		if (!vm->m_area.contains(i))
+			continue;
+		if (!isWherein(vm, i))
+			continue;
+
+		if (biomemap && !biomes.empty()) {
+			u32 bmapidx = sizex * (z - nmin.Z) + (x - nmin.X);
+			UNORDERED_SET<u8>::iterator it = biomes.find(biomemap[bmapidx]);
+			if (it == biomes.end())
+				continue;
 		}
 
 		// randval ranges from -1..1
@@ -49,6 +49,26 @@ enum OreType {
 
 extern FlagDesc flagdesc_ore[];
 
+class Ore;
+
+/*
+	One ore in one chunk. prepare() only reads the vmanip, so the ores of a
+	chunk can be prepared in parallel, apply() writes them in the serial
+	order and gives the same nodes as placing them one after the other.
+*/
+struct OrePlacement {
+	Ore *ore;
+	u32 blockseed;
+	v3s16 nmin;
+	v3s16 nmax;
+	// An earlier ore of the same pass may place one of our c_wherein, the
+	// vmanip content seen by prepare() can't be used to skip nodes
+	bool wherein_may_grow = false;
+	// Where the ore goes if the node is still one of c_wherein
+	std::vector<u32> nodes;
+	bool noise_generated = false;
+};
+
 class Ore : public ObjDef, public NodeResolver {
 public:
 	static const bool NEEDS_NOISE = false;
@@ -73,16 +93,21 @@ class Ore : public ObjDef, public NodeResolver {
 	virtual void resolveNodeNames();
 
 	size_t placeOre(Mapgen *mg, u32 blockseed, v3s16 nmin, v3s16 nmax);
-	virtual void generate(MMVManip *vm, int mapseed, u32 blockseed,
-		v3s16 nmin, v3s16 nmax, u8 *biomemap) = 0;
+	// Clips the area to the heights of the ore, false if nothing is placed
+	bool getPlacementArea(v3s16 &nmin, v3s16 &nmax);
+	bool isWherein(MMVManip *vm, u32 i);
+
+	virtual void prepare(OrePlacement &placement, MMVManip *vm, int mapseed,
+		u8 *biomemap) = 0;
+	virtual void apply(OrePlacement &placement, MMVManip *vm, u8 *biomemap);
 };
 
 class OreScatter : public Ore {
 public:
 	static const bool NEEDS_NOISE = false;
 
-	virtual void generate(MMVManip *vm, int mapseed, u32 blockseed,
-		v3s16 nmin, v3s16 nmax, u8 *biomemap);
+	virtual void prepare(OrePlacement &placement, MMVManip *vm, int mapseed,
+		u8 *biomemap);
 };
 
 class OreSheet : public Ore {
@@ -93,8 +118,8 @@ class OreSheet : public Ore {
 	u16 column_height_max;
 	float column_midpoint_factor;
 
-	virtual void generate(MMVManip *vm, int mapseed, u32 blockseed,
-		v3s16 nmin, v3s16 nmax, u8 *biomemap);
+	virtual void prepare(OrePlacement &placement, MMVManip *vm, int mapseed,
+		u8 *biomemap);
 };
 
 class OrePuff : public Ore {
@@ -109,16 +134,16 @@ class OrePuff : public Ore {
 	OrePuff();
 	virtual ~OrePuff();
 
-	virtual void generate(MMVManip *vm, int mapseed, u32 blockseed,
-		v3s16 nmin, v3s16 nmax, u8 *biomemap);
+	virtual void prepare(OrePlacement &placement, MMVManip *vm, int mapseed,
+		u8 *biomemap);
 };
 
 class OreBlob : public Ore {
 public:
 	static const bool NEEDS_NOISE = true;
 
-	virtual void generate(MMVManip *vm, int mapseed, u32 blockseed,
-		v3s16 nmin, v3s16 nmax, u8 *biomemap);
+	virtual void prepare(OrePlacement &placement, MMVManip *vm, int mapseed,
+		u8 *biomemap);
 };
 
 class OreVein : public Ore {
@@ -131,8 +156,13 @@ class OreVein : public Ore {
 	OreVein();
 	virtual ~OreVein();
 
-	virtual void generate(MMVManip *vm, int mapseed, u32 blockseed,
-		v3s16 nmin, v3s16 nmax, u8 *biomemap);
+	virtual void prepare(OrePlacement &placement, MMVManip *vm, int mapseed,
+		u8 *biomemap);
+	virtual void apply(OrePlacement &placement, MMVManip *vm, u8 *biomemap);
+
+private:
+	// Some node the vein may be placed in
+	bool findPlacement(OrePlacement &placement, MMVManip *vm, u8 *biomemap);
 };
 
 class OreManager : public ObjDefManager {
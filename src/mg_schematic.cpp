@@ -83,6 +83,7 @@ Schematic::~Schematic()
 
 void Schematic::resolveNodeNames()
 {
+	clearCompiled();
 	getIdsFromNrBacklog(&c_nodes, true, CONTENT_AIR);
 
 	size_t bufsize = size.X * size.Y * size.Z;
@@ -94,9 +95,27 @@ void Schematic::resolveNodeNames()
 }
 
 
-void Schematic::blitToVManip(MMVManip *vm, v3s16 p, Rotation rot, bool force_place)
+void Schematic::clearCompiled()
 {
-	sanity_check(m_ndef != NULL);
+	std::lock_guard<std::mutex> lock(m_compiled_mutex);
+	for (auto &compiled : m_compiled)
+		compiled.reset();
+}
+
+
+std::shared_ptr<const CompiledSchematic> Schematic::getCompiled(Rotation rot)
+{
+	std::lock_guard<std::mutex> lock(m_compiled_mutex);
+	std::shared_ptr<const CompiledSchematic> &compiled = m_compiled[rot];
+	if (!compiled)
+		compiled = compile(rot);
+	return compiled;
+}
+
+
+std::shared_ptr<const CompiledSchematic> Schematic::compile(Rotation rot)
+{
+	auto schem = std::make_shared<CompiledSchematic>();
 
 	int xstride = 1;
 	int ystride = size.X;
@@ -130,51 +149,136 @@ void Schematic::blitToVManip(MMVManip *vm, v3s16 p, Rotation rot, bool force_pla
 			i_step_x = xstride;
 			i_step_z = zstride;
 	}
+	schem->size = v3s16(sx, sy, sz);
 
-	s16 y_map = p.Y;
 	for (s16 y = 0; y != sy; y++) {
-		if ((slice_probs[y] != MTSCHEM_PROB_ALWAYS) &&
-			(slice_probs[y] <= myrand_range(1, MTSCHEM_PROB_ALWAYS)))
-			continue;
+		schem->span_slices.push_back(schem->spans.size());
+		schem->chance_slices.push_back(schem->chances.size());
 
 		for (s16 z = 0; z != sz; z++) {
+			CompiledSchematic::Span *span = NULL;
 			u32 i = z * i_step_z + y * ystride + i_start;
 			for (s16 x = 0; x != sx; x++, i += i_step_x) {
-				u32 vi = vm->m_area.index(p.X + x, y_map, p.Z + z);
-				if (!vm->m_area.contains(vi))
-					continue;
-
-				if (schemdata[i].getContent() == CONTENT_IGNORE)
+				if (schemdata[i].getContent() == CONTENT_IGNORE) {
+					span = NULL;
 					continue;
+				}
 
 				u8 placement_prob     = schemdata[i].param1 & MTSCHEM_PROB_MASK;
 				bool force_place_node = schemdata[i].param1 & MTSCHEM_FORCE_PLACE;
 
-				if (placement_prob == MTSCHEM_PROB_NEVER)
+				if (placement_prob == MTSCHEM_PROB_NEVER) {
+					span = NULL;
 					continue;
+				}
 
-				if (!force_place && !force_place_node) {
-					content_t c = vm->m_data[vi].getContent();
-					if (c != CONTENT_AIR && c != CONTENT_IGNORE)
-						continue;
+				u32 node = schem->nodes.size();
+				schem->nodes.push_back(schemdata[i]);
+				schem->nodes.back().param1 = 0;
+				if (rot)
+					schem->nodes.back().rotateAlongYAxis(m_ndef, rot);
+
+				if (placement_prob != MTSCHEM_PROB_ALWAYS) {
+					CompiledSchematic::Chance chance = {x, z, placement_prob,
+						force_place_node, node};
+					schem->chances.push_back(chance);
+					span = NULL;
+				} else if (span && span->force_place == force_place_node) {
+					span->length++;
+				} else {
+					CompiledSchematic::Span new_span = {x, z, 1,
+						force_place_node, node};
+					schem->spans.push_back(new_span);
+					span = &schem->spans.back();
 				}
+			}
+		}
+	}
+	schem->span_slices.push_back(schem->spans.size());
+	schem->chance_slices.push_back(schem->chances.size());
 
-				if ((placement_prob != MTSCHEM_PROB_ALWAYS) &&
-					(placement_prob <= myrand_range(1, MTSCHEM_PROB_ALWAYS)))
-					continue;
+	return schem;
+}
 
-				vm->m_data[vi] = schemdata[i];
-				vm->m_data[vi].param1 = 0;
 
-				if (rot)
-					vm->m_data[vi].rotateAlongYAxis(m_ndef, rot);
+void Schematic::blitToVManip(MMVManip *vm, v3s16 p, Rotation rot, bool force_place)
+{
+	sanity_check(m_ndef != NULL);
+
+	std::shared_ptr<const CompiledSchematic> schem = getCompiled(rot);
+	const VoxelArea &area = vm->m_area;
+
+	// The part of the vmanip the schematic can reach, in schematic coordinates
+	v3s16 clip_min = area.MinEdge - p;
+	v3s16 clip_max = area.MaxEdge - p;
+
+	auto can_replace = [](const MapNode &n) {
+		content_t c = n.getContent();
+		return c == CONTENT_AIR || c == CONTENT_IGNORE;
+	};
+
+	s16 y_map = p.Y;
+	for (s16 y = 0; y != schem->size.Y; y++) {
+		if ((slice_probs[y] != MTSCHEM_PROB_ALWAYS) &&
+			(slice_probs[y] <= myrand_range(1, MTSCHEM_PROB_ALWAYS)))
+			continue;
+
+		if (y_map < area.MinEdge.Y || y_map > area.MaxEdge.Y) {
+			y_map++;
+			continue;
+		}
+
+		for (u32 k = schem->span_slices[y]; k != schem->span_slices[y + 1]; k++) {
+			const CompiledSchematic::Span &span = schem->spans[k];
+			if (span.z < clip_min.Z || span.z > clip_max.Z)
+				continue;
+			s16 x0 = MYMAX(span.x, clip_min.X);
+			s16 x1 = MYMIN(span.x + span.length - 1, clip_max.X);
+			if (x0 > x1)
+				continue;
+
+			const MapNode *src = &schem->nodes[span.node + x0 - span.x];
+			MapNode *dst = &vm->m_data[area.index(p.X + x0, y_map, p.Z + span.z)];
+			u32 count = x1 - x0 + 1;
+			if (force_place || span.force_place) {
+				std::copy(src, src + count, dst);
+			} else {
+				for (u32 j = 0; j != count; j++)
+					if (can_replace(dst[j]))
+						dst[j] = src[j];
 			}
 		}
+
+		for (u32 k = schem->chance_slices[y]; k != schem->chance_slices[y + 1]; k++) {
+			const CompiledSchematic::Chance &chance = schem->chances[k];
+			if (chance.x < clip_min.X || chance.x > clip_max.X ||
+					chance.z < clip_min.Z || chance.z > clip_max.Z)
+				continue;
+
+			MapNode &dst = vm->m_data[area.index(p.X + chance.x, y_map, p.Z + chance.z)];
+			if (!force_place && !chance.force_place && !can_replace(dst))
+				continue;
+			if (chance.prob <= myrand_range(1, MTSCHEM_PROB_ALWAYS))
+				continue;
+
+			dst = schem->nodes[chance.node];
+		}
 		y_map++;
 	}
 }
 
 
+bool Schematic::usesGlobalRandom()
+{
+	if (!schemdata || !m_ndef)
+		return false;
+	for (s16 y = 0; y != size.Y; y++)
+		if (slice_probs[y] != MTSCHEM_PROB_ALWAYS)
+			return true;
+	return !getCompiled(ROTATE_0)->chances.empty();
+}
+
+
 bool Schematic::placeOnVManip(MMVManip *vm, v3s16 p, u32 flags,
 	Rotation rot, bool force_place)
 {
@@ -274,6 +378,7 @@ void Schematic::placeOnMap(Map *map, v3s16 p, u32 flags,
 bool Schematic::deserializeFromMts(std::istream *is,
 	std::vector<std::string> *names)
 {
+	clearCompiled();
 	std::istream &ss = *is;
 	content_t cignore = CONTENT_IGNORE;
 	bool have_cignore = false;
@@ -525,6 +630,7 @@ bool Schematic::saveSchematicToFile(const std::string &filename,
 
 bool Schematic::getSchematicFromMap(Map *map, v3s16 p1, v3s16 p2)
 {
+	clearCompiled();
 	MMVManip *vm = new MMVManip(map);
 
 	v3s16 bp1 = getNodeBlockPos(p1);
@@ -560,6 +666,7 @@ void Schematic::applyProbabilities(v3s16 p0,
 	std::vector<std::pair<v3s16, u8> > *plist,
 	std::vector<std::pair<s16, u8> > *splist)
 {
+	clearCompiled();
 	for (size_t i = 0; i != plist->size(); i++) {
 		v3s16 p = (*plist)[i].first - p0;
 		int index = p.Z * (size.Y * size.X) + p.Y * size.X + p.X;
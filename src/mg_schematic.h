@@ -21,6 +21,8 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #define MG_SCHEMATIC_HEADER
 
 #include <map>
+#include <memory>
+#include <mutex>
 #include "mg_decoration.h"
 #include "util/string.h"
 
@@ -89,6 +91,38 @@ enum SchematicFormatType {
 	SCHEM_FMT_LUA,
 };
 
+/*
+	Schematic prepared for one rotation, built on first placement: nodes are
+	rotated already, runs along X of nodes placed for sure are kept apart
+	from the nodes left to chance, so placing is mostly copying runs.
+*/
+struct CompiledSchematic {
+	struct Span {
+		s16 x;
+		s16 z;
+		u16 length;
+		bool force_place;
+		// First node in nodes
+		u32 node;
+	};
+	struct Chance {
+		s16 x;
+		s16 z;
+		u8 prob;
+		bool force_place;
+		u32 node;
+	};
+
+	// Rotated size
+	v3s16 size;
+	std::vector<MapNode> nodes;
+	// Spans and chances of slice y are [slices[y], slices[y + 1])
+	std::vector<Span> spans;
+	std::vector<u32> span_slices;
+	std::vector<Chance> chances;
+	std::vector<u32> chance_slices;
+};
+
 class Schematic : public ObjDef, public NodeResolver {
 public:
 	Schematic();
@@ -114,11 +148,25 @@ class Schematic : public ObjDef, public NodeResolver {
 		std::vector<std::pair<v3s16, u8> > *plist,
 		std::vector<std::pair<s16, u8> > *splist);
 
+	// Must be called after changing schemdata directly
+	void clearCompiled();
+	// Placing it draws the global random numbers, some nodes or slices
+	// have a probability
+	bool usesGlobalRandom();
+
 	std::vector<content_t> c_nodes;
 	u32 flags;
 	v3s16 size;
 	MapNode *schemdata;
 	u8 *slice_probs;
+
+private:
+	std::shared_ptr<const CompiledSchematic> getCompiled(Rotation rot);
+	std::shared_ptr<const CompiledSchematic> compile(Rotation rot);
+
+	// Emerge threads place the same schematics at once
+	std::mutex m_compiled_mutex;
+	std::shared_ptr<const CompiledSchematic> m_compiled[ROTATE_RAND];
 };
 
 class SchematicManager : public ObjDefManager {
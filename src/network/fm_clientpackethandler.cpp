@@ -24,6 +24,8 @@ along with Freeminer.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "util/base64.h"
 #include "clientmedia.h"
+#include "filecache.h"
+#include "filesys.h"
 #include "log_types.h"
 #include "map.h"
 #include "mapsector.h"
@@ -31,14 +33,64 @@ along with Freeminer.  If not, see <http://www.gnu.org/licenses/>.
 #include "serialization.h"
 #include "server.h"
 #include "util/strfnd.h"
+#include "util/hex.h"
+#include "util/sha1.h"
+#include "util/string.h"
 #include "network/clientopcodes.h"
 #include "util/serialize.h"
 #include "fm_networkprotocol.h"
 #include "settings.h"
 #include "emerge.h"
 #include "profiler.h"
+#include "porting.h"
 
 
+/*
+	Zipped definitions are kept in <cache>/definitions/<sha1 of the zip>,
+	the same definitions from any server are found by the sha1 it sends
+	in TOCLIENT_INIT.
+*/
+static std::string getDefinitionsCacheDir()
+{
+	return porting::path_cache + DIR_DELIM + "definitions";
+}
+
+// Empty if not cached or the file does not match its sha1
+static std::string loadCachedDefinitions(const std::string &sha1_hex)
+{
+	if (sha1_hex.size() != 40 || !string_allowed(sha1_hex, "0123456789abcdef"))
+		return "";
+	std::ostringstream os(std::ios::binary);
+	if (!FileCache(getDefinitionsCacheDir()).load(sha1_hex, os))
+		return "";
+	std::string data = os.str();
+
+	SHA1 sha1;
+	sha1.addBytes(data.c_str(), data.size());
+	unsigned char *digest = sha1.getDigest();
+	std::string data_sha1_hex = hex_encode((char*)digest, 20);
+	free(digest);
+	if (data_sha1_hex != sha1_hex) {
+		errorstream << "Client: cached definitions " << sha1_hex
+				<< " do not match, ignored" << std::endl;
+		return "";
+	}
+	return data;
+}
+
+static void saveCachedDefinitions(MsgpackPacket &packet, int sha1_field, int zip_field)
+{
+	std::string sha1_hex, data;
+	if (!packet_convert_safe(packet, sha1_field, sha1_hex) ||
+			sha1_hex.size() != 40 || !string_allowed(sha1_hex, "0123456789abcdef"))
+		return;
+	packet[zip_field].convert(data);
+	if (!fs::CreateAllDirs(getDefinitionsCacheDir()) ||
+			!FileCache(getDefinitionsCacheDir()).update(sha1_hex, data))
+		errorstream << "Client: could not cache definitions in "
+				<< getDefinitionsCacheDir() << std::endl;
+}
+
 void Client::handleCommand_Deprecated(NetworkPacket* pkt) {
 }
 
@@ -100,8 +152,20 @@ void Client::handleCommand_InitLegacy(NetworkPacket* pkt)   {
 	//if (packet.count(TOCLIENT_INIT_PROTOCOL_VERSION_FM))
 	//	packet[TOCLIENT_INIT_PROTOCOL_VERSION_FM].convert( not used );
 
+	// Definitions we have from an earlier join need not be sent again
+	std::string itemdef_sha1, nodedef_sha1;
+	packet_convert_safe(packet, TOCLIENT_INIT_ITEMDEF_SHA1, itemdef_sha1);
+	packet_convert_safe(packet, TOCLIENT_INIT_NODEDEF_SHA1, nodedef_sha1);
+	m_cached_itemdef = loadCachedDefinitions(itemdef_sha1);
+	m_cached_nodedef = loadCachedDefinitions(nodedef_sha1);
+
 	// Reply to server
-	MSGPACK_PACKET_INIT((int)TOSERVER_INIT2, 0);
+	MSGPACK_PACKET_INIT((int)TOSERVER_INIT2,
+			!m_cached_itemdef.empty() + !m_cached_nodedef.empty());
+	if (!m_cached_itemdef.empty())
+		PACK(TOSERVER_INIT2_ITEMDEF_SHA1, itemdef_sha1);
+	if (!m_cached_nodedef.empty())
+		PACK(TOSERVER_INIT2_NODEDEF_SHA1, nodedef_sha1);
 	m_con.Send(PEER_ID_SERVER, 1, buffer, true);
 
 	m_state = LC_Init;
@@ -204,18 +268,30 @@ void Client::handleCommand_BlockData(NetworkPacket* pkt)    {
 
 void Client::handleCommand_Inventory(NetworkPacket* pkt)    {
 	auto & packet = *(pkt->packet);
-	std::string datastring = packet[TOCLIENT_INVENTORY_DATA].as<std::string>();
-	std::istringstream is(datastring, std::ios_base::binary);
 	Player *player = m_env.getLocalPlayer();
 	if(!player)
 		return;
 
-	player->inventory.deSerialize(is);
+	if (packet.count(TOCLIENT_INVENTORY_DELTA)) {
+		// Against the last authoritative inventory, local predictions are dropped
+		if (!m_inventory_from_server) {
+			errorstream << "Client: inventory delta without inventory" << std::endl;
+			return;
+		}
+		std::string datastring = packet[TOCLIENT_INVENTORY_DELTA].as<std::string>();
+		std::istringstream is(datastring, std::ios_base::binary);
+		m_inventory_from_server->deSerializeDelta(is);
+		player->inventory = *m_inventory_from_server;
+	} else {
+		std::string datastring = packet[TOCLIENT_INVENTORY_DATA].as<std::string>();
+		std::istringstream is(datastring, std::ios_base::binary);
+		player->inventory.deSerialize(is);
+
+		delete m_inventory_from_server;
+		m_inventory_from_server = new Inventory(player->inventory);
+	}
 
 	m_inventory_updated = true;
-
-	delete m_inventory_from_server;
-	m_inventory_from_server = new Inventory(player->inventory);
 	m_inventory_from_server_age = 0.0;
 }
 
@@ -441,9 +517,16 @@ void Client::handleCommand_NodeDef(NetworkPacket* pkt) {
 
 	if (packet_convert_safe_zip(packet, TOCLIENT_NODEDEF_DEFINITIONS_ZIP, *m_nodedef)) {
 		m_nodedef_received = true;
+		saveCachedDefinitions(packet, TOCLIENT_NODEDEF_SHA1, TOCLIENT_NODEDEF_DEFINITIONS_ZIP);
+	} else if (packet.count(TOCLIENT_NODEDEF_SHA1)) {
+		// Only the sha1: server knows we have them cached
+		m_nodedef_received = msgpack_unzip(m_cached_nodedef, *m_nodedef);
+		if (!m_nodedef_received)
+			errorstream << "Client: cached node definitions are broken" << std::endl;
 	} else if (packet_convert_safe(packet, TOCLIENT_NODEDEF_DEFINITIONS, *m_nodedef)) {
 		m_nodedef_received = true;
 	}
+	m_cached_nodedef.clear();
 }
 
 void Client::handleCommand_CraftItemDef(NetworkPacket* pkt) {
@@ -461,9 +544,15 @@ void Client::handleCommand_ItemDef(NetworkPacket* pkt) {
 
 	if (packet_convert_safe_zip(packet, TOCLIENT_ITEMDEF_DEFINITIONS_ZIP, *m_itemdef)) {
 		m_itemdef_received = true;
+		saveCachedDefinitions(packet, TOCLIENT_ITEMDEF_SHA1, TOCLIENT_ITEMDEF_DEFINITIONS_ZIP);
+	} else if (packet.count(TOCLIENT_ITEMDEF_SHA1)) {
+		m_itemdef_received = msgpack_unzip(m_cached_itemdef, *m_itemdef);
+		if (!m_itemdef_received)
+			errorstream << "Client: cached item definitions are broken" << std::endl;
 	} else if (packet_convert_safe(packet, TOCLIENT_ITEMDEF_DEFINITIONS, *m_itemdef)) {
 		m_itemdef_received = true;
 	}
+	m_cached_itemdef.clear();
 }
 
 void Client::handleCommand_PlaySound(NetworkPacket* pkt)  {
@@ -531,7 +620,9 @@ void Client::handleCommand_InventoryFormSpec(NetworkPacket* pkt) {
 void Client::handleCommand_DetachedInventory(NetworkPacket* pkt) {
 	auto & packet = *(pkt->packet);
 	std::string name = packet[TOCLIENT_DETACHED_INVENTORY_NAME].as<std::string>();
-	std::string datastring = packet[TOCLIENT_DETACHED_INVENTORY_DATA].as<std::string>();
+	bool delta = packet.count(TOCLIENT_DETACHED_INVENTORY_DELTA);
+	std::string datastring = packet[delta ? TOCLIENT_DETACHED_INVENTORY_DELTA :
+			TOCLIENT_DETACHED_INVENTORY_DATA].as<std::string>();
 	std::istringstream is(datastring, std::ios_base::binary);
 
 	infostream << "Client: Detached inventory update: \"" << name << "\"" << std::endl;
@@ -543,7 +634,10 @@ void Client::handleCommand_DetachedInventory(NetworkPacket* pkt) {
 		inv = new Inventory(m_itemdef);
 		m_detached_inventories[name] = inv;
 	}
-	inv->deSerialize(is);
+	if (delta)
+		inv->deSerializeDelta(is);
+	else
+		inv->deSerialize(is);
 }
 
 void Client::handleCommand_ShowFormSpec(NetworkPacket* pkt)           {
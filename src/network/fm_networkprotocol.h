@@ -7,7 +7,7 @@
 #include "../msgpack_fix.h"
 #include "../config.h"
 
-#define CLIENT_PROTOCOL_VERSION_FM 2
+#define CLIENT_PROTOCOL_VERSION_FM 3
 #define SERVER_PROTOCOL_VERSION_FM 0
 
 enum
@@ -23,7 +23,11 @@ enum
 	// json map params
 	TOCLIENT_INIT_MAP_PARAMS,
 	TOCLIENT_INIT_PROTOCOL_VERSION_FM,
-	TOCLIENT_INIT_WEATHER
+	TOCLIENT_INIT_WEATHER,
+	// string sha1 of TOCLIENT_ITEMDEF_DEFINITIONS_ZIP data
+	TOCLIENT_INIT_ITEMDEF_SHA1,
+	// string sha1 of TOCLIENT_NODEDEF_DEFINITIONS_ZIP data
+	TOCLIENT_INIT_NODEDEF_SHA1
 };
 
 enum
@@ -53,7 +57,10 @@ enum
 enum
 {
 	// string, serialized inventory
-	TOCLIENT_INVENTORY_DATA
+	TOCLIENT_INVENTORY_DATA,
+	// string, Inventory::serializeDelta against the previous update
+	// (CLIENT_PROTOCOL_VERSION_FM >= 3), instead of DATA
+	TOCLIENT_INVENTORY_DELTA
 };
 
 enum
@@ -151,7 +158,9 @@ typedef std::vector<std::pair<std::string, std::string>> MediaData;
 enum
 {
 	TOCLIENT_NODEDEF_DEFINITIONS,
-	TOCLIENT_NODEDEF_DEFINITIONS_ZIP
+	TOCLIENT_NODEDEF_DEFINITIONS_ZIP,
+	// string sha1 of the zip data, sent alone if the client has it cached
+	TOCLIENT_NODEDEF_SHA1
 };
 
 enum
@@ -165,7 +174,9 @@ enum
 enum
 {
 	TOCLIENT_ITEMDEF_DEFINITIONS,
-	TOCLIENT_ITEMDEF_DEFINITIONS_ZIP
+	TOCLIENT_ITEMDEF_DEFINITIONS_ZIP,
+	// string sha1 of the zip data, sent alone if the client has it cached
+	TOCLIENT_ITEMDEF_SHA1
 };
 
 typedef std::vector<std::pair<std::string, std::string>> MediaAnnounceList;
@@ -209,7 +220,9 @@ enum
 enum
 {
 	TOCLIENT_DETACHED_INVENTORY_NAME,
-	TOCLIENT_DETACHED_INVENTORY_DATA
+	TOCLIENT_DETACHED_INVENTORY_DATA,
+	// string, as TOCLIENT_INVENTORY_DELTA
+	TOCLIENT_DETACHED_INVENTORY_DELTA
 };
 
 enum
@@ -377,6 +390,14 @@ enum
 	TOSERVER_INIT_LEGACY_PROTOCOL_VERSION_FM
 };
 
+enum
+{
+	// string, TOCLIENT_INIT_ITEMDEF_SHA1 if the client has these cached
+	TOSERVER_INIT2_ITEMDEF_SHA1,
+	// string, TOCLIENT_INIT_NODEDEF_SHA1 if the client has these cached
+	TOSERVER_INIT2_NODEDEF_SHA1
+};
+
 enum
 {
 	// v3f
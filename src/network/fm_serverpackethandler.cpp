@@ -331,7 +331,7 @@ void Server::handleCommand_Init_Legacy(NetworkPacket* pkt) {
 		Answer with a TOCLIENT_INIT
 	*/
 	{
-		MSGPACK_PACKET_INIT((int)TOCLIENT_INIT_LEGACY, 6);
+		MSGPACK_PACKET_INIT((int)TOCLIENT_INIT_LEGACY, 8);
 		PACK(TOCLIENT_INIT_DEPLOYED, deployed);
 		PACK(TOCLIENT_INIT_SEED, m_env->getServerMap().getSeed());
 		PACK(TOCLIENT_INIT_STEP, g_settings->getFloat("dedicated_server_step"));
@@ -348,6 +348,11 @@ void Server::handleCommand_Init_Legacy(NetworkPacket* pkt) {
 
 		PACK(TOCLIENT_INIT_WEATHER, g_settings->getBool("weather"));
 
+		// Client answers with what it has cached in TOSERVER_INIT2
+		const auto &definitions = getContentDefinitions();
+		PACK(TOCLIENT_INIT_ITEMDEF_SHA1, definitions.itemdef_sha1);
+		PACK(TOCLIENT_INIT_NODEDEF_SHA1, definitions.nodedef_sha1);
+
 		// Send as reliable
 		m_clients.send(peer_id, 0, buffer, true);
 		m_clients.event(peer_id, CSE_InitLegacy);
@@ -358,11 +363,16 @@ void Server::handleCommand_Init_Legacy(NetworkPacket* pkt) {
 
 void Server::handleCommand_Init2(NetworkPacket* pkt) {
 	const auto peer_id = pkt->getPeerId();
-	//auto & packet = *(pkt->packet);
+	auto & packet = *(pkt->packet);
 
 	verbosestream << "Server: Got TOSERVER_INIT2 from "
 	              << peer_id << std::endl;
 
+	if (auto client = m_clients.getClient(peer_id, CS_Created)) {
+		packet_convert_safe(packet, TOSERVER_INIT2_ITEMDEF_SHA1, client->cached_itemdef_sha1);
+		packet_convert_safe(packet, TOSERVER_INIT2_NODEDEF_SHA1, client->cached_nodedef_sha1);
+	}
+
 	m_clients.event(peer_id, CSE_GotInit2);
 	u16 protocol_version = m_clients.getProtocolVersion(peer_id);
 
@@ -1163,14 +1173,14 @@ void Server::handleCommand_Interact(NetworkPacket* pkt) {
 				ToolCapabilities playeritem_toolcap =
 				    playeritem.getToolCapabilities(m_itemdef);
 				// Get diggability and expected digging time
-				DigParams params = getDigParams(m_nodedef->get(n).groups,
+				DigParams params = getDigParams(m_nodedef->get(n).group_ratings,
 				                                &playeritem_toolcap);
 				// If can't dig, try hand
 				if(!params.diggable) {
 					const ItemDefinition &hand = m_itemdef->get("");
 					const ToolCapabilities *tp = hand.tool_capabilities;
 					if(tp)
-						params = getDigParams(m_nodedef->get(n).groups, tp);
+						params = getDigParams(m_nodedef->get(n).group_ratings, tp);
 				}
 				// If can't dig, ignore dig
 				if(!params.diggable) {
@@ -15,6 +15,24 @@ You should have received a copy of the GNU General Public License
 along with Freeminer.  If not, see <http://www.gnu.org/licenses/>.
 */
 #include "server.h"
+#include "threading/mutex_auto_lock.h"
+#include "util/hex.h"
+#include "util/sha1.h"
+#include "util/timetaker.h"
+
+static void countInventoryUpdate(bool delta, size_t bytes)
+{
+	static const auto full_packets = g_metrics->counter("freeminer_inventory_updates_total",
+			"Inventory updates sent to clients", "type=\"full\"");
+	static const auto delta_packets = g_metrics->counter("freeminer_inventory_updates_total",
+			"Inventory updates sent to clients", "type=\"delta\"");
+	static const auto full_bytes = g_metrics->counter("freeminer_inventory_update_bytes_total",
+			"Serialized inventory sent to clients", "type=\"full\"");
+	static const auto delta_bytes = g_metrics->counter("freeminer_inventory_update_bytes_total",
+			"Serialized inventory sent to clients", "type=\"delta\"");
+	(delta ? delta_packets : full_packets)->add();
+	(delta ? delta_bytes : full_bytes)->add(bytes);
+}
 
 void Server::SendMovement(u16 peer_id)
 {
@@ -86,23 +104,67 @@ void Server::SendDeathscreen(u16 peer_id,bool set_camera_point_target,
 	m_clients.send(peer_id, 0, buffer, true);
 }
 
+static std::string zip_definitions(const msgpack::sbuffer &data, std::string &sha1_hex)
+{
+	std::string zip;
+	compressZlib(std::string(data.data(), data.size()), zip);
+	SHA1 sha1;
+	sha1.addBytes(zip.c_str(), zip.size());
+	unsigned char *digest = sha1.getDigest();
+	sha1_hex = hex_encode((char*)digest, 20);
+	free(digest);
+	return zip;
+}
+
+const Server::ContentDefinitions &Server::getContentDefinitions()
+{
+	MutexAutoLock lock(m_content_definitions_mutex);
+	if (m_content_definitions)
+		return *m_content_definitions;
+
+	TimeTaker timer("Server: zip definitions");
+	std::unique_ptr<ContentDefinitions> definitions(new ContentDefinitions);
+	{
+		msgpack::sbuffer buffer;
+		msgpack::packer<msgpack::sbuffer> pk(&buffer);
+		pk.pack(*m_itemdef);
+		definitions->itemdef_zip = zip_definitions(buffer, definitions->itemdef_sha1);
+	}
+	{
+		msgpack::sbuffer buffer;
+		msgpack::packer<msgpack::sbuffer> pk(&buffer);
+		pk.pack(*m_nodedef);
+		definitions->nodedef_zip = zip_definitions(buffer, definitions->nodedef_sha1);
+	}
+	infostream << "Server: definitions zipped: items=" << definitions->itemdef_zip.size()
+			<< " nodes=" << definitions->nodedef_zip.size() << " bytes" << std::endl;
+	m_content_definitions = std::move(definitions);
+	return *m_content_definitions;
+}
+
 void Server::SendItemDef(u16 peer_id,
 		IItemDefManager *itemdef, u16 protocol_version)
 {
 	DSTACK(FUNCTION_NAME);
-	MSGPACK_PACKET_INIT((int)TOCLIENT_ITEMDEF, 1);
 
 	auto client = m_clients.getClient(peer_id, CS_InitDone);
 	if (!client)
 		return;
 
 	if (client->net_proto_version_fm >= 2) {
-		PACK_ZIP(TOCLIENT_ITEMDEF_DEFINITIONS_ZIP, *itemdef);
+		const auto &definitions = getContentDefinitions();
+		// Only the sha1 if the client has these cached
+		bool cached = client->cached_itemdef_sha1 == definitions.itemdef_sha1;
+		MSGPACK_PACKET_INIT((int)TOCLIENT_ITEMDEF, cached ? 1 : 2);
+		if (!cached)
+			PACK(TOCLIENT_ITEMDEF_DEFINITIONS_ZIP, definitions.itemdef_zip);
+		PACK(TOCLIENT_ITEMDEF_SHA1, definitions.itemdef_sha1);
+		m_clients.send(peer_id, 0, buffer, true);
 	} else {
+		MSGPACK_PACKET_INIT((int)TOCLIENT_ITEMDEF, 1);
 		PACK(TOCLIENT_ITEMDEF_DEFINITIONS, *itemdef);
+		m_clients.send(peer_id, 0, buffer, true);
 	}
-
-	m_clients.send(peer_id, 0, buffer, true);
 }
 
 void Server::SendNodeDef(u16 peer_id,
@@ -110,19 +172,24 @@ void Server::SendNodeDef(u16 peer_id,
 {
 	DSTACK(FUNCTION_NAME);
 
-	MSGPACK_PACKET_INIT((int)TOCLIENT_NODEDEF, 1);
-
 	auto client = m_clients.getClient(peer_id, CS_InitDone);
 	if (!client)
 		return;
+
+	// Send as reliable
 	if (client->net_proto_version_fm >= 2) {
-		PACK_ZIP(TOCLIENT_NODEDEF_DEFINITIONS_ZIP, *nodedef);
+		const auto &definitions = getContentDefinitions();
+		bool cached = client->cached_nodedef_sha1 == definitions.nodedef_sha1;
+		MSGPACK_PACKET_INIT((int)TOCLIENT_NODEDEF, cached ? 1 : 2);
+		if (!cached)
+			PACK(TOCLIENT_NODEDEF_DEFINITIONS_ZIP, definitions.nodedef_zip);
+		PACK(TOCLIENT_NODEDEF_SHA1, definitions.nodedef_sha1);
+		m_clients.send(peer_id, 0, buffer, true);
 	} else {
+		MSGPACK_PACKET_INIT((int)TOCLIENT_NODEDEF, 1);
 		PACK(TOCLIENT_NODEDEF_DEFINITIONS, *nodedef);
+		m_clients.send(peer_id, 0, buffer, true);
 	}
-
-	// Send as reliable
-	m_clients.send(peer_id, 0, buffer, true);
 }
 
 /*
@@ -135,20 +202,33 @@ void Server::SendInventory(PlayerSAO* playerSAO)
 
 	UpdateCrafting(playerSAO->getPlayer());
 
-	/*
-		Serialize it
-	*/
+	u16 peer_id = playerSAO->getPeerID();
+	auto client = m_clients.getClient(peer_id, CS_InitDone);
+	bool delta_capable = client && client->net_proto_version_fm >= 3;
+	const Inventory *inventory = playerSAO->getInventory();
 
-	std::ostringstream os;
-	playerSAO->getInventory()->serialize(os);
+	// Deltas must reach the client in the order they were made
+	MutexAutoLock lock(playerSAO->m_inventory_sent_mutex);
+	auto &sent = playerSAO->m_inventory_sent;
+	bool delta = delta_capable && sent;
 
+	std::ostringstream os(std::ios_base::binary);
+	if (delta) {
+		inventory->serializeDelta(os, *sent);
+		*sent = *inventory;
+	} else {
+		inventory->serialize(os);
+		if (delta_capable)
+			sent.reset(new Inventory(*inventory));
+	}
 	std::string s = os.str();
+	countInventoryUpdate(delta, s.size());
 
 	MSGPACK_PACKET_INIT((int)TOCLIENT_INVENTORY, 1);
-	PACK(TOCLIENT_INVENTORY_DATA, s);
+	PACK(delta ? TOCLIENT_INVENTORY_DELTA : TOCLIENT_INVENTORY_DATA, s);
 
 	// Send as reliable
-	m_clients.send(playerSAO->getPeerID(), 0, buffer, true);
+	m_clients.send(peer_id, 0, buffer, true);
 }
 
 void Server::SendChatMessage(u16 peer_id, const std::string &message)
@@ -814,20 +894,52 @@ void Server::sendDetachedInventory(const std::string &name, u16 peer_id)
 	}
 	Inventory *inv = m_detached_inventories[name];
 
-	std::ostringstream os(std::ios_base::binary);
-	inv->serialize(os);
-
-	MSGPACK_PACKET_INIT((int)TOCLIENT_DETACHED_INVENTORY, 2);
-	PACK(TOCLIENT_DETACHED_INVENTORY_NAME, name);
-	PACK(TOCLIENT_DETACHED_INVENTORY_DATA, os.str());
+	auto send = [&](u16 peer_id, bool delta, const std::string &data) {
+		MSGPACK_PACKET_INIT((int)TOCLIENT_DETACHED_INVENTORY, 2);
+		PACK(TOCLIENT_DETACHED_INVENTORY_NAME, name);
+		PACK(delta ? TOCLIENT_DETACHED_INVENTORY_DELTA : TOCLIENT_DETACHED_INVENTORY_DATA, data);
+		countInventoryUpdate(delta, data.size());
+		// Send as reliable
+		m_clients.send(peer_id, 0, buffer, true);
+	};
+	auto serialize = [&](const Inventory *old) {
+		std::ostringstream os(std::ios_base::binary);
+		if (old)
+			inv->serializeDelta(os, *old);
+		else
+			inv->serialize(os);
+		return os.str();
+	};
 
 	if (peer_id != PEER_ID_INEXISTENT)
 	{
-		// Send as reliable
-		m_clients.send(peer_id, 0, buffer, true);
+		// Deltas to everyone are made against the last broadcast, this
+		// client gets the current state, so they have to be the same
+		auto sent = m_detached_inventories_sent.find(name);
+		if (sent != m_detached_inventories_sent.end() && *sent->second != *inv)
+			m_detached_inventories_sent.erase(sent);
+		send(peer_id, false, serialize(nullptr));
+		return;
 	}
-	else
-	{
-		m_clients.sendToAll(0,buffer,true);
+
+	auto &sent = m_detached_inventories_sent[name];
+	std::string full, delta;
+	for (u16 id : m_clients.getClientIDs(CS_Created)) {
+		auto client = m_clients.getClient(id, CS_Created);
+		if (!client || !client->net_proto_version)
+			continue;
+		if (sent && client->net_proto_version_fm >= 3) {
+			if (delta.empty())
+				delta = serialize(sent.get());
+			send(id, true, delta);
+		} else {
+			if (full.empty())
+				full = serialize(nullptr);
+			send(id, false, full);
+		}
 	}
+	if (sent)
+		*sent = *inv;
+	else
+		sent.reset(new Inventory(*inv));
 }
@@ -1618,14 +1618,14 @@ void Server::handleCommand_Interact(NetworkPacket* pkt)
 				ToolCapabilities playeritem_toolcap =
 						playeritem.getToolCapabilities(m_itemdef);
 				// Get diggability and expected digging time
-				DigParams params = getDigParams(m_nodedef->get(n).groups,
+				DigParams params = getDigParams(m_nodedef->get(n).group_ratings,
 						&playeritem_toolcap);
 				// If can't dig, try hand
 				if (!params.diggable) {
 					const ItemDefinition &hand = m_itemdef->get("");
 					const ToolCapabilities *tp = hand.tool_capabilities;
 					if (tp)
-						params = getDigParams(m_nodedef->get(n).groups, tp);
+						params = getDigParams(m_nodedef->get(n).group_ratings, tp);
 				}
 				// If can't dig, ignore dig
 				if (!params.diggable) {
@@ -1041,6 +1041,76 @@ void ContentFeatures::updateTextures(ITextureSource *tsrc, IShaderSource *shdsrc
 #endif
 */
 
+/*
+	CollisionShape
+*/
+
+void CollisionShape::update(const ContentFeatures &f)
+{
+	boxes.clear();
+	variants.clear();
+	bouncy = itemgroup_get(f.groups, "bouncy");
+
+	if (!f.walkable) {
+		type = COLLISION_NONE;
+		return;
+	}
+
+	// Same choice and transformations as MapNode::getCollisionBoxes()
+	const NodeBox &nodebox = f.collision_box.fixed.empty() ? f.node_box : f.collision_box;
+	switch (nodebox.type) {
+	case NODEBOX_REGULAR:
+		if (f.param_type_2 == CPT2_LEVELED || f.param_type_2 == CPT2_FLOWINGLIQUID) {
+			type = COLLISION_PARAM2;
+			return;
+		}
+		type = COLLISION_FIXED;
+		boxes.push_back(aabb3f(-BS/2, -BS/2, -BS/2, BS/2, BS/2, BS/2));
+		return;
+	case NODEBOX_FIXED:
+		if (f.param_type_2 == CPT2_FACEDIR) {
+			type = COLLISION_PARAM2;
+			return;
+		}
+		type = COLLISION_FIXED;
+		for (aabb3f box : nodebox.fixed) {
+			box.repair();
+			boxes.push_back(box);
+		}
+		return;
+	case NODEBOX_CONNECTED:
+		// collisionMoveSimple looks for neighbours only for these
+		if (f.drawtype != NDT_NODEBOX || f.node_box.type != NODEBOX_CONNECTED) {
+			type = COLLISION_FIXED;
+			boxes = nodebox.fixed;
+			return;
+		}
+		type = COLLISION_CONNECTED;
+		for (u32 neighbors = 0; neighbors < 64; ++neighbors) {
+			variants.push_back(boxes.size());
+			boxes.insert(boxes.end(), nodebox.fixed.begin(), nodebox.fixed.end());
+			if (neighbors & 1)
+				boxes.insert(boxes.end(), nodebox.connect_top.begin(), nodebox.connect_top.end());
+			if (neighbors & 2)
+				boxes.insert(boxes.end(), nodebox.connect_bottom.begin(), nodebox.connect_bottom.end());
+			if (neighbors & 4)
+				boxes.insert(boxes.end(), nodebox.connect_front.begin(), nodebox.connect_front.end());
+			if (neighbors & 8)
+				boxes.insert(boxes.end(), nodebox.connect_left.begin(), nodebox.connect_left.end());
+			if (neighbors & 16)
+				boxes.insert(boxes.end(), nodebox.connect_back.begin(), nodebox.connect_back.end());
+			if (neighbors & 32)
+				boxes.insert(boxes.end(), nodebox.connect_right.begin(), nodebox.connect_right.end());
+		}
+		variants.push_back(boxes.size());
+		return;
+	default:
+		// NODEBOX_LEVELED, NODEBOX_WALLMOUNTED
+		type = COLLISION_PARAM2;
+		return;
+	}
+}
+
 /*
 	CNodeDefManager
 */
@@ -1081,13 +1151,18 @@ class CNodeDefManager: public IWritableNodeDefManager {
 	virtual void resetNodeResolveState();
 	virtual void mapNodeboxConnections();
 	virtual bool nodeboxConnects(MapNode from, MapNode to, u8 connect_face);
+	inline virtual const CollisionShape &getCollisionShape(content_t c) const;
 
 private:
 	void addNameIdMapping(content_t i, std::string name);
+	void updateDerivedFeatures(content_t c);
 
 	// Features indexed by id
 	std::vector<ContentFeatures> m_content_features;
 
+	// Collision boxes indexed by id, follows m_content_features
+	std::vector<CollisionShape> m_collision_shapes;
+
 	// A mapping for fast converting back and forth between names and ids
 	NameIdMapping m_name_id_mapping;
 
@@ -1206,6 +1281,9 @@ void CNodeDefManager::clear()
 		if (c)
 			m_content_features[0] = f;
 	}
+
+	m_collision_shapes.clear();
+	updateDerivedFeatures(CONTENT_IGNORE);
 }
 
 
@@ -1230,6 +1308,13 @@ inline const ContentFeatures& CNodeDefManager::get(const MapNode &n) const
 }
 
 
+inline const CollisionShape &CNodeDefManager::getCollisionShape(content_t c) const
+{
+	return c < m_collision_shapes.size()
+			? m_collision_shapes[c] : m_collision_shapes[CONTENT_UNKNOWN];
+}
+
+
 bool CNodeDefManager::getId(const std::string &name, content_t &result) const
 {
 	UNORDERED_MAP<std::string, content_t>::const_iterator
@@ -1361,6 +1446,7 @@ content_t CNodeDefManager::set(const std::string &name, const ContentFeatures &d
 		addNameIdMapping(id, name);
 	}
 	m_content_features[id] = def;
+	updateDerivedFeatures(id);
 	verbosestream << "NodeDefManager: registering content id \"" << id
 		<< "\": name=\"" << def.name << "\""<<std::endl;
 
@@ -1595,6 +1681,7 @@ void CNodeDefManager::deSerialize(std::istream &is)
 		if (i >= m_content_features.size())
 			m_content_features.resize((u32)(i) + 1);
 		m_content_features[i] = f;
+		updateDerivedFeatures(i);
 		addNameIdMapping(i, f.name);
 		verbosestream << "deserialized " << f.name << std::endl;
 	}
@@ -1650,12 +1737,28 @@ void CNodeDefManager::msgpack_unpack(msgpack::object o)
 		if(i >= m_content_features.size())
 			m_content_features.resize((u32)(i) + 1);
 		m_content_features[i] = f;
+		updateDerivedFeatures(i);
 		addNameIdMapping(i, f.name);
 		verbosestream<<"deserialized "<<f.name<<std::endl;
 	}
 }
 
 
+void CNodeDefManager::updateDerivedFeatures(content_t c)
+{
+	// Fill the gaps, ids can be allocated without a definition
+	size_t old_size = m_collision_shapes.size();
+	if (old_size < m_content_features.size()) {
+		m_collision_shapes.resize(m_content_features.size());
+		for (size_t i = old_size; i < m_content_features.size(); ++i)
+			m_collision_shapes[i].update(m_content_features[i]);
+	}
+	ContentFeatures &f = m_content_features[c];
+	f.group_ratings.set(f.groups);
+	m_collision_shapes[c].update(f);
+}
+
+
 void CNodeDefManager::addNameIdMapping(content_t i, std::string name)
 {
 	m_name_id_mapping.set(i, name);
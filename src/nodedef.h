@@ -327,6 +327,7 @@ struct ContentFeatures
 
 	std::string name; // "" = undefined node
 	ItemGroupList groups; // Same as in itemdef
+	ItemGroupRatings group_ratings; // groups by id, set by the manager
 
 	// Visual definition
 	enum NodeDrawType drawtype;
@@ -467,6 +468,41 @@ struct ContentFeatures
 //#endif
 };
 
+/*
+	Collision boxes of a content, built once per definition so
+	collisionMoveSimple does not transform node boxes for every node it touches
+*/
+struct CollisionShape
+{
+	enum Type : u8 {
+		// Not walkable
+		COLLISION_NONE,
+		// Same boxes for every param2
+		COLLISION_FIXED,
+		// Connected nodebox, boxes for every neighbour mask
+		COLLISION_CONNECTED,
+		// Depends on param2 (facedir, wallmounted, level): MapNode::getCollisionBoxes
+		COLLISION_PARAM2,
+	};
+
+	Type type = COLLISION_NONE;
+	int bouncy = 0;
+	std::vector<aabb3f> boxes;
+	// COLLISION_CONNECTED: boxes for neighbour mask m are [variants[m], variants[m + 1])
+	std::vector<u32> variants;
+
+	void update(const ContentFeatures &f);
+
+	const aabb3f *begin(u8 neighbors) const
+	{
+		return boxes.data() + (variants.empty() ? 0 : variants[neighbors]);
+	}
+	const aabb3f *end(u8 neighbors) const
+	{
+		return boxes.data() + (variants.empty() ? boxes.size() : variants[neighbors + 1]);
+	}
+};
+
 class INodeDefManager {
 public:
 	INodeDefManager(){}
@@ -493,6 +529,7 @@ class INodeDefManager {
 	virtual void pendNodeResolve(NodeResolver *nr)=0;
 	virtual bool cancelNodeResolveCallback(NodeResolver *nr)=0;
 	virtual bool nodeboxConnects(const MapNode from, const MapNode to, u8 connect_face)=0;
+	virtual const CollisionShape &getCollisionShape(content_t c) const=0;
 };
 
 class IWritableNodeDefManager : public INodeDefManager {
@@ -27,6 +27,8 @@ along with Freeminer.  If not, see <http://www.gnu.org/licenses/>.
 #include "log.h"
 #include "util/serialize.h"
 #include "constants.h" // MAP_BLOCKSIZE
+#include "threading/mutex_auto_lock.h"
+#include <algorithm>
 #include <sstream>
 
 /*
@@ -86,8 +88,54 @@ bool NodeMetadata::empty() const
 	NodeMetadataList
 */
 
+static inline u16 posToIndex(v3s16 p)
+{
+	return p.Z * MAP_BLOCKSIZE * MAP_BLOCKSIZE + p.Y * MAP_BLOCKSIZE + p.X;
+}
+
+static inline v3s16 indexToPos(u16 p16)
+{
+	v3s16 p;
+	p.Z = p16 / MAP_BLOCKSIZE / MAP_BLOCKSIZE;
+	p16 &= MAP_BLOCKSIZE * MAP_BLOCKSIZE - 1;
+	p.Y = p16 / MAP_BLOCKSIZE;
+	p16 &= MAP_BLOCKSIZE - 1;
+	p.X = p16;
+	return p;
+}
+
+// Moves is past one serialized NodeMetadata without decoding it
+static void skipNodeMetadata(std::istream &is)
+{
+	u32 num_vars = readU32(is);
+	for (u32 i = 0; i < num_vars; i++) {
+		is.ignore(readU16(is));
+		is.ignore(readU32(is));
+	}
+
+	// Inventory, see Inventory::deSerialize
+	bool in_list = false;
+	std::string line;
+	while (std::getline(is, line, '\n')) {
+		std::string name = line.substr(0, line.find(' '));
+		if (in_list) {
+			if (name == "EndInventoryList" || name == "end")
+				in_list = false;
+		} else if (name == "EndInventory" || name == "end") {
+			return;
+		} else if (name == "List") {
+			in_list = true;
+		} else {
+			throw SerializationError("invalid inventory specifier: " + name);
+		}
+	}
+	throw SerializationError("unexpected end of node metadata");
+}
+
 void NodeMetadataList::serialize(std::ostream &os) const
 {
+	MutexAutoLock lock(m_mutex);
+
 	/*
 		Version 0 is a placeholder for "nothing to see here; go away."
 	*/
@@ -101,19 +149,16 @@ void NodeMetadataList::serialize(std::ostream &os) const
 	writeU8(os, 1); // version
 	writeU16(os, count);
 
-	for(std::map<v3s16, NodeMetadata*>::const_iterator
-			i = m_data.begin();
-			i != m_data.end(); ++i)
-	{
-		v3s16 p = i->first;
-		NodeMetadata *data = i->second;
-		if (data->empty())
+	for (const auto &entry : m_data) {
+		if (entry.meta && entry.meta->empty())
 			continue;
 
-		u16 p16 = p.Z * MAP_BLOCKSIZE * MAP_BLOCKSIZE + p.Y * MAP_BLOCKSIZE + p.X;
-		writeU16(os, p16);
+		writeU16(os, entry.pos);
 
-		data->serialize(os);
+		if (entry.meta)
+			entry.meta->serialize(os);
+		else
+			os << entry.raw;
 	}
 }
 
@@ -121,6 +166,9 @@ void NodeMetadataList::deSerialize(std::istream &is, IItemDefManager *item_def_m
 {
 	clear();
 
+	MutexAutoLock lock(m_mutex);
+	m_item_def_mgr = item_def_mgr;
+
 	u8 version = readU8(is);
 
 	if (version == 0) {
@@ -136,18 +184,23 @@ void NodeMetadataList::deSerialize(std::istream &is, IItemDefManager *item_def_m
 	}
 
 	u16 count = readU16(is);
+	m_data.reserve(count);
 
 	for (u16 i=0; i < count; i++) {
 		u16 p16 = readU16(is);
 
-		v3s16 p;
-		p.Z = p16 / MAP_BLOCKSIZE / MAP_BLOCKSIZE;
-		p16 &= MAP_BLOCKSIZE * MAP_BLOCKSIZE - 1;
-		p.Y = p16 / MAP_BLOCKSIZE;
-		p16 &= MAP_BLOCKSIZE - 1;
-		p.X = p16;
+		std::streampos start = is.tellg();
+		skipNodeMetadata(is);
+		if (is.eof()) {
+			// Last line without a newline
+			is.clear();
+			is.seekg(0, std::ios_base::end);
+		}
+		std::streampos end = is.tellg();
 
-		if (m_data.find(p) != m_data.end()) {
+		auto it = find(p16);
+		if (it != m_data.end() && it->pos == p16) {
+			v3s16 p = indexToPos(p16);
 			warningstream<<"NodeMetadataList::deSerialize(): "
 					<<"already set data at position"
 					<<"("<<p.X<<","<<p.Y<<","<<p.Z<<"): Ignoring."
@@ -155,9 +208,12 @@ void NodeMetadataList::deSerialize(std::istream &is, IItemDefManager *item_def_m
 			continue;
 		}
 
-		NodeMetadata *data = new NodeMetadata(item_def_mgr);
-		data->deSerialize(is);
-		m_data[p] = data;
+		Entry entry;
+		entry.pos = p16;
+		entry.raw.resize(end - start);
+		is.seekg(start);
+		is.read(&entry.raw[0], entry.raw.size());
+		m_data.insert(it, std::move(entry));
 	}
 }
 
@@ -166,55 +222,87 @@ NodeMetadataList::~NodeMetadataList()
 	clear();
 }
 
+std::vector<NodeMetadataList::Entry>::iterator NodeMetadataList::find(u16 pos)
+{
+	// Stored in the order they were serialized, almost always sorted already
+	if (m_data.empty() || m_data.back().pos < pos)
+		return m_data.end();
+	return std::lower_bound(m_data.begin(), m_data.end(), pos,
+			[](const Entry &entry, u16 pos) { return entry.pos < pos; });
+}
+
 std::vector<v3s16> NodeMetadataList::getAllKeys()
 {
+	MutexAutoLock lock(m_mutex);
 	std::vector<v3s16> keys;
+	keys.reserve(m_data.size());
 
-	std::map<v3s16, NodeMetadata *>::const_iterator it;
-	for (it = m_data.begin(); it != m_data.end(); ++it)
-		keys.push_back(it->first);
+	for (const auto &entry : m_data)
+		keys.push_back(indexToPos(entry.pos));
 
 	return keys;
 }
 
 NodeMetadata *NodeMetadataList::get(v3s16 p)
 {
-	std::map<v3s16, NodeMetadata *>::const_iterator n = m_data.find(p);
-	if (n == m_data.end())
+	MutexAutoLock lock(m_mutex);
+	u16 p16 = posToIndex(p);
+	auto it = find(p16);
+	if (it == m_data.end() || it->pos != p16)
 		return NULL;
-	return n->second;
+
+	if (!it->meta) {
+		it->meta.reset(new NodeMetadata(m_item_def_mgr));
+		try {
+			std::istringstream is(it->raw, std::ios_base::binary);
+			it->meta->deSerialize(is);
+		} catch (SerializationError &e) {
+			warningstream << "NodeMetadataList::get(): Ignoring an error"
+					<< " while deserializing node metadata at ("
+					<< p.X << "," << p.Y << "," << p.Z << "): "
+					<< e.what() << std::endl;
+		}
+		// Serialized from the decoded one from now on
+		std::string().swap(it->raw);
+	}
+	return it->meta.get();
 }
 
 void NodeMetadataList::remove(v3s16 p)
 {
-	NodeMetadata *olddata = get(p);
-	if (olddata) {
-		m_data.erase(p);
-		delete olddata;
-	}
+	MutexAutoLock lock(m_mutex);
+	u16 p16 = posToIndex(p);
+	auto it = find(p16);
+	if (it != m_data.end() && it->pos == p16)
+		m_data.erase(it);
 }
 
 void NodeMetadataList::set(v3s16 p, NodeMetadata *d)
 {
-	remove(p);
-	m_data.insert(std::make_pair(p, d));
+	MutexAutoLock lock(m_mutex);
+	u16 p16 = posToIndex(p);
+	auto it = find(p16);
+	if (it == m_data.end() || it->pos != p16) {
+		it = m_data.insert(it, Entry());
+		it->pos = p16;
+	}
+	it->raw.clear();
+	if (it->meta.get() != d)
+		it->meta.reset(d);
 }
 
 void NodeMetadataList::clear()
 {
-	std::map<v3s16, NodeMetadata*>::iterator it;
-	for (it = m_data.begin(); it != m_data.end(); ++it) {
-		delete it->second;
-	}
+	MutexAutoLock lock(m_mutex);
 	m_data.clear();
 }
 
 int NodeMetadataList::countNonEmpty() const
 {
 	int n = 0;
-	std::map<v3s16, NodeMetadata*>::const_iterator it;
-	for (it = m_data.begin(); it != m_data.end(); ++it) {
-		if (!it->second->empty())
+	for (const auto &entry : m_data) {
+		// Only non-empty ones were serialized
+		if (!entry.meta || !entry.meta->empty())
 			n++;
 	}
 	return n;
@@ -25,7 +25,9 @@ along with Freeminer.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "irr_v3d.h"
 #include <iostream>
+#include <memory>
 #include <vector>
+#include "threading/mutex.h"
 #include "util/string.h"
 
 /*
@@ -76,6 +78,10 @@ class NodeMetadata
 
 /*
 	List of metadata of all the nodes of a block
+
+	Sorted by the index of the node in the block. A loaded entry keeps its
+	serialized bytes and is only decoded when get() asks for it; entries
+	nobody asked for are written back as they were read.
 */
 
 class NodeMetadataList
@@ -97,10 +103,22 @@ class NodeMetadataList
 	// Deletes all
 	void clear();
 
+	size_t size() const { return m_data.size(); }
+
 private:
+	struct Entry {
+		u16 pos; // index of the node in the block
+		std::string raw; // serialized, until decoded
+		std::unique_ptr<NodeMetadata> meta;
+	};
+
+	std::vector<Entry>::iterator find(u16 pos);
 	int countNonEmpty() const;
 
-	std::map<v3s16, NodeMetadata *> m_data;
+	std::vector<Entry> m_data;
+	IItemDefManager *m_item_def_mgr = nullptr;
+	// Decoding on get() must not race a block being serialized for sending
+	mutable Mutex m_mutex;
 };
 
 #endif
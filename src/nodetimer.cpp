@@ -25,6 +25,8 @@ along with Freeminer.  If not, see <http://www.gnu.org/licenses/>.
 #include "serialization.h"
 #include "util/serialize.h"
 #include "constants.h" // MAP_BLOCKSIZE
+#include <algorithm>
+#include <cmath>
 
 /*
 	NodeTimer
@@ -46,33 +48,80 @@ void NodeTimer::deSerialize(std::istream &is)
 	NodeTimerList
 */
 
+static const u32 NONE = (u32)-1;
+static const u16 NO_INDEX = 0xffff;
+static const u32 NODES_PER_BLOCK = MAP_BLOCKSIZE * MAP_BLOCKSIZE * MAP_BLOCKSIZE;
+// Blocks with more timers get a position index
+static const u32 INDEX_MIN = 32;
+
+static const u32 L0_BITS = 8;
+static const u32 L0_MASK = (1 << L0_BITS) - 1;
+static const u32 LN_BITS = 6;
+static const u32 LN_MASK = (1 << LN_BITS) - 1;
+static const u32 UPPER_LEVELS = 3;
+
+// Slots: due now, level 0, upper levels, beyond the last level
+static const u16 SLOT_DUE = 0;
+static const u16 SLOT_L0 = 1;
+static const u16 SLOT_OVERFLOW = SLOT_L0 + (1 << L0_BITS) + UPPER_LEVELS * (1 << LN_BITS);
+static const u16 SLOT_COUNT = SLOT_OVERFLOW + 1;
+static const u16 SLOT_FREE = 0xffff;
+
+static inline u16 levelSlot(u32 level, u64 tick)
+{
+	u32 shift = L0_BITS + (level - 1) * LN_BITS;
+	return SLOT_L0 + (1 << L0_BITS) + (level - 1) * (1 << LN_BITS) +
+			((tick >> shift) & LN_MASK);
+}
+
+static inline u16 posToIndex(v3s16 p)
+{
+	return p.Z * MAP_BLOCKSIZE * MAP_BLOCKSIZE + p.Y * MAP_BLOCKSIZE + p.X;
+}
+
+static inline v3s16 indexToPos(u16 p16)
+{
+	v3s16 p;
+	p.Z = p16 / MAP_BLOCKSIZE / MAP_BLOCKSIZE;
+	p16 &= MAP_BLOCKSIZE * MAP_BLOCKSIZE - 1;
+	p.Y = p16 / MAP_BLOCKSIZE;
+	p16 &= MAP_BLOCKSIZE - 1;
+	p.X = p16;
+	return p;
+}
+
 void NodeTimerList::serialize(std::ostream &os, u8 map_format_version) const
 {
 	if (map_format_version == 24) {
 		// Version 0 is a placeholder for "nothing to see here; go away."
-		if (m_timers.empty()) {
+		if (!m_count) {
 			writeU8(os, 0); // version
 			return;
 		}
 		writeU8(os, 1); // version
-		writeU16(os, m_timers.size());
+		writeU16(os, m_count);
 	}
 
 	if (map_format_version >= 25) {
 		writeU8(os, 2 + 4 + 4); // length of the data for a single timer
-		writeU16(os, m_timers.size());
+		writeU16(os, m_count);
 	}
 
-	for (std::multimap<double, NodeTimer>::const_iterator
-			i = m_timers.begin();
-			i != m_timers.end(); ++i) {
-		NodeTimer t = i->second;
-		NodeTimer nt = NodeTimer(t.timeout,
-			t.timeout - (f32)(i->first - m_time), t.position);
-		v3s16 p = t.position;
+	// Soonest first, as the list was always written
+	std::vector<u32> order;
+	order.reserve(m_count);
+	for (u32 i = 0; i < m_entries.size(); ++i)
+		if (m_entries[i].slot != SLOT_FREE)
+			order.push_back(i);
+	std::sort(order.begin(), order.end(), [this](u32 a, u32 b) {
+		return m_entries[a].trigger_time < m_entries[b].trigger_time;
+	});
 
-		u16 p16 = p.Z * MAP_BLOCKSIZE * MAP_BLOCKSIZE + p.Y * MAP_BLOCKSIZE + p.X;
-		writeU16(os, p16);
+	for (u32 i : order) {
+		const Entry &e = m_entries[i];
+		NodeTimer nt(e.timeout, e.timeout - (f32)(e.trigger_time - m_time),
+				indexToPos(e.pos));
+		writeU16(os, e.pos);
 		nt.serialize(os);
 	}
 }
@@ -100,12 +149,7 @@ void NodeTimerList::deSerialize(std::istream &is, u8 map_format_version)
 	for (u16 i = 0; i < count; i++) {
 		u16 p16 = readU16(is);
 
-		v3s16 p;
-		p.Z = p16 / MAP_BLOCKSIZE / MAP_BLOCKSIZE;
-		p16 &= MAP_BLOCKSIZE * MAP_BLOCKSIZE - 1;
-		p.Y = p16 / MAP_BLOCKSIZE;
-		p16 &= MAP_BLOCKSIZE - 1;
-		p.X = p16;
+		v3s16 p = indexToPos(p16);
 
 		NodeTimer t(p);
 		t.deSerialize(is);
@@ -118,7 +162,7 @@ void NodeTimerList::deSerialize(std::istream &is, u8 map_format_version)
 			continue;
 		}
 
-		if (m_iterators.find(p) != m_iterators.end()) {
+		if (find(posToIndex(p)) != NONE) {
 			warningstream<<"NodeTimerList::deSerialize(): "
 					<<"already set data at position"
 					<<"("<<p.X<<","<<p.Y<<","<<p.Z<<"): Ignoring."
@@ -130,26 +174,207 @@ void NodeTimerList::deSerialize(std::istream &is, u8 map_format_version)
 	}
 }
 
+NodeTimer NodeTimerList::get(const v3s16 &p) const
+{
+	u32 i = find(posToIndex(p));
+	if (i == NONE)
+		return NodeTimer();
+	const Entry &e = m_entries[i];
+	return NodeTimer(e.timeout, e.timeout - (f32)(e.trigger_time - m_time), p);
+}
+
+void NodeTimerList::remove(v3s16 p)
+{
+	u32 i = find(posToIndex(p));
+	if (i == NONE)
+		return;
+	unlink(i);
+	release(i);
+}
+
+void NodeTimerList::insert(NodeTimer timer)
+{
+	if (m_slots.empty())
+		m_slots.assign(SLOT_COUNT, NONE);
+
+	u32 i = m_free;
+	if (i != NONE) {
+		m_free = m_entries[i].next;
+	} else {
+		i = m_entries.size();
+		m_entries.emplace_back();
+	}
+
+	Entry &e = m_entries[i];
+	e.trigger_time = m_time + (double)(timer.timeout - timer.elapsed);
+	e.tick = e.trigger_time > 0 ?
+			(u64)std::ceil(e.trigger_time * TICKS_PER_SECOND) : 0;
+	e.timeout = timer.timeout;
+	e.pos = posToIndex(timer.position);
+	link(i);
+	++m_count;
+
+	if (!m_index.empty()) {
+		m_index[e.pos] = i;
+	} else if (m_count > INDEX_MIN) {
+		m_index.assign(NODES_PER_BLOCK, NO_INDEX);
+		for (u32 j = 0; j < m_entries.size(); ++j)
+			if (m_entries[j].slot != SLOT_FREE)
+				m_index[m_entries[j].pos] = j;
+	}
+}
+
+void NodeTimerList::clear()
+{
+	m_entries.clear();
+	m_slots.clear();
+	m_index.clear();
+	m_free = NONE;
+	m_count = 0;
+}
+
 std::vector<NodeTimer> NodeTimerList::step(float dtime)
 {
 	std::vector<NodeTimer> elapsed_timers;
 	m_time += dtime;
-	if (m_next_trigger_time == -1. || m_time < m_next_trigger_time) {
+	u64 target = m_time > 0 ? (u64)std::floor(m_time * TICKS_PER_SECOND) : 0;
+	if (!m_count) {
+		m_next_tick = std::max(m_next_tick, target + 1);
 		return elapsed_timers;
 	}
-	std::multimap<double, NodeTimer>::iterator i = m_timers.begin();
-	// Process timers
-	for (; i != m_timers.end() && i->first <= m_time; ++i) {
-		NodeTimer t = i->second;
-		t.elapsed = t.timeout + (f32)(m_time - i->first);
-		elapsed_timers.push_back(t);
-		m_iterators.erase(t.position);
+
+	std::vector<Entry> expired;
+	if (target >= m_next_tick + L0_MASK) {
+		// Longer than level 0 spans (block was not active): sort all again
+		m_next_tick = target + 1;
+		m_slots.assign(SLOT_COUNT, NONE);
+		for (u32 i = 0; i < m_entries.size(); ++i) {
+			Entry &e = m_entries[i];
+			if (e.slot == SLOT_FREE)
+				continue;
+			if (e.tick <= target) {
+				expired.push_back(e);
+				release(i);
+			} else {
+				link(i);
+			}
+		}
+	} else {
+		while (m_next_tick <= target) {
+			u16 slot = SLOT_L0 + (m_next_tick & L0_MASK);
+			while (m_slots[slot] != NONE)
+				expire(m_slots[slot], expired);
+			++m_next_tick;
+			if (!(m_next_tick & L0_MASK)) {
+				u32 level = 1;
+				for (; level <= UPPER_LEVELS; ++level) {
+					u16 upper = levelSlot(level, m_next_tick);
+					cascade(upper);
+					if ((m_next_tick >> (L0_BITS + (level - 1) * LN_BITS)) & LN_MASK)
+						break;
+				}
+				if (level > UPPER_LEVELS)
+					cascade(SLOT_OVERFLOW);
+			}
+		}
 	}
-	// Delete elapsed timers
-	m_timers.erase(m_timers.begin(), i);
-	if (m_timers.empty())
-		m_next_trigger_time = -1.;
-	else
-		m_next_trigger_time = m_timers.begin()->first;
+
+	// Due within the current tick
+	u16 slot = SLOT_L0 + (m_next_tick & L0_MASK);
+	for (u32 i = m_slots[slot]; i != NONE;) {
+		u32 next = m_entries[i].next;
+		if (m_entries[i].trigger_time <= m_time)
+			expire(i, expired);
+		i = next;
+	}
+	while (m_slots[SLOT_DUE] != NONE)
+		expire(m_slots[SLOT_DUE], expired);
+
+	std::stable_sort(expired.begin(), expired.end(), [](const Entry &a, const Entry &b) {
+		return a.trigger_time < b.trigger_time;
+	});
+	elapsed_timers.reserve(expired.size());
+	for (const Entry &e : expired)
+		elapsed_timers.push_back(NodeTimer(e.timeout,
+				e.timeout + (f32)(m_time - e.trigger_time), indexToPos(e.pos)));
 	return elapsed_timers;
 }
+
+u32 NodeTimerList::find(u16 pos) const
+{
+	if (!m_index.empty()) {
+		u16 i = m_index[pos];
+		return i == NO_INDEX ? NONE : i;
+	}
+	for (u32 i = 0; i < m_entries.size(); ++i)
+		if (m_entries[i].pos == pos && m_entries[i].slot != SLOT_FREE)
+			return i;
+	return NONE;
+}
+
+void NodeTimerList::link(u32 i)
+{
+	Entry &e = m_entries[i];
+	if (e.trigger_time <= m_time || e.tick < m_next_tick) {
+		e.slot = SLOT_DUE;
+	} else {
+		u64 delta = e.tick - m_next_tick;
+		if (delta <= L0_MASK) {
+			e.slot = SLOT_L0 + (e.tick & L0_MASK);
+		} else {
+			e.slot = SLOT_OVERFLOW;
+			for (u32 level = 1; level <= UPPER_LEVELS; ++level) {
+				if (delta < (u64)1 << (L0_BITS + level * LN_BITS)) {
+					e.slot = levelSlot(level, e.tick);
+					break;
+				}
+			}
+		}
+	}
+	e.prev = NONE;
+	e.next = m_slots[e.slot];
+	if (e.next != NONE)
+		m_entries[e.next].prev = i;
+	m_slots[e.slot] = i;
+}
+
+void NodeTimerList::unlink(u32 i)
+{
+	Entry &e = m_entries[i];
+	if (e.prev != NONE)
+		m_entries[e.prev].next = e.next;
+	else
+		m_slots[e.slot] = e.next;
+	if (e.next != NONE)
+		m_entries[e.next].prev = e.prev;
+}
+
+void NodeTimerList::release(u32 i)
+{
+	Entry &e = m_entries[i];
+	if (!m_index.empty())
+		m_index[e.pos] = NO_INDEX;
+	e.slot = SLOT_FREE;
+	e.next = m_free;
+	m_free = i;
+	--m_count;
+}
+
+// Spreads a slot of an upper level over the lower ones
+void NodeTimerList::cascade(u16 slot)
+{
+	u32 i = m_slots[slot];
+	m_slots[slot] = NONE;
+	while (i != NONE) {
+		u32 next = m_entries[i].next;
+		link(i);
+		i = next;
+	}
+}
+
+void NodeTimerList::expire(u32 i, std::vector<Entry> &dest)
+{
+	unlink(i);
+	dest.push_back(m_entries[i]);
+	release(i);
+}
@@ -56,85 +56,73 @@ class NodeTimer
 
 /*
 	List of timers of all the nodes of a block
+
+	Hierarchical timing wheel: the timers live in a flat array, linked into
+	slots by the tick (1/TICKS_PER_SECOND s) they are due in. Level 0 has a
+	slot per tick for the next 256 ticks, each next level 64 slots covering
+	64 times longer. A step walks the level 0 slots of the ticks passed and
+	expires them whole; every 256 ticks the next level 1 slot is spread over
+	level 0, and so on up. Insert and remove are O(1); a node is found by a
+	scan while a block has few timers and by a position index beyond that.
 */
 
 class NodeTimerList
 {
 public:
-	NodeTimerList(): m_next_trigger_time(-1.), m_time(0.) {}
+	NodeTimerList() {}
 	~NodeTimerList() {}
-	
+
 	void serialize(std::ostream &os, u8 map_format_version) const;
 	void deSerialize(std::istream &is, u8 map_format_version);
-	
+
 	// Get timer
-	NodeTimer get(const v3s16 &p) {
-		std::map<v3s16, std::multimap<double, NodeTimer>::iterator>::iterator n =
-			m_iterators.find(p);
-		if (n == m_iterators.end())
-			return NodeTimer();
-		NodeTimer t = n->second->second;
-		t.elapsed = t.timeout - (n->second->first - m_time);
-		return t;
-	}
+	NodeTimer get(const v3s16 &p) const;
 	// Deletes timer
-	void remove(v3s16 p) {
-		std::map<v3s16, std::multimap<double, NodeTimer>::iterator>::iterator n =
-			m_iterators.find(p);
-		if(n != m_iterators.end()) {
-			double removed_time = n->second->first;
-			m_timers.erase(n->second);
-			m_iterators.erase(n);
-			// Yes, this is float equality, but it is not a problem
-			// since we only test equality of floats as an ordered type
-			// and thus we never lose precision
-			if (removed_time == m_next_trigger_time) {
-				if (m_timers.empty())
-					m_next_trigger_time = -1.;
-				else
-					m_next_trigger_time = m_timers.begin()->first;
-			}
-		}
-	}
+	void remove(v3s16 p);
 	// Undefined behaviour if there already is a timer
-	void insert(NodeTimer timer) {
-		v3s16 p = timer.position;
-		double trigger_time = m_time + (double)(timer.timeout - timer.elapsed);
-		std::multimap<double, NodeTimer>::iterator it =
-			m_timers.insert(std::pair<double, NodeTimer>(
-				trigger_time, timer
-			));
-		m_iterators.insert(
-			std::pair<v3s16, std::multimap<double, NodeTimer>::iterator>(p, it));
-		if (m_next_trigger_time == -1. || trigger_time < m_next_trigger_time)
-			m_next_trigger_time = trigger_time;
-	}
+	void insert(NodeTimer timer);
 	// Deletes old timer and sets a new one
 	inline void set(const NodeTimer &timer) {
 		remove(timer.position);
 		insert(timer);
 	}
 	// Deletes all timers
-	void clear() {
-		m_timers.clear();
-		m_iterators.clear();
-		m_next_trigger_time = -1.;
-	}
+	void clear();
 
-	inline double getNextTriggerTime() {
-		return m_next_trigger_time;
-	}
+	size_t size() const { return m_count; }
 
 	float m_uptime_last = 0;
 
-	// Move forward in time, returns elapsed timers
+	// Move forward in time, returns elapsed timers (oldest first)
 	std::vector<NodeTimer> step(float dtime);
 
+	static const u32 TICKS_PER_SECOND = 100;
+
 private:
-	std::multimap<double, NodeTimer> m_timers;
-	std::map<v3s16, std::multimap<double, NodeTimer>::iterator> m_iterators;
-	double m_next_trigger_time;
-	double m_time;
+	struct Entry {
+		double trigger_time;
+		u64 tick;
+		f32 timeout;
+		u32 prev;
+		u32 next;
+		u16 slot;
+		u16 pos; // index of the node in the block
+	};
+
+	u32 find(u16 pos) const;
+	void link(u32 i);
+	void unlink(u32 i);
+	void release(u32 i);
+	void cascade(u16 slot);
+	void expire(u32 i, std::vector<Entry> &dest);
+
+	std::vector<Entry> m_entries;
+	std::vector<u32> m_slots; // list heads, allocated with the first timer
+	std::vector<u16> m_index; // pos -> entry, only for blocks with many timers
+	u32 m_free = (u32)-1;
+	u32 m_count = 0;
+	double m_time = 0;
+	u64 m_next_tick = 0; // first tick not processed yet
 };
 
 #endif
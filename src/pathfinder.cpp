@@ -23,1393 +23,601 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 /******************************************************************************/
 
 #include "pathfinder.h"
-#include "environment.h"
+#include <queue>
 #include "gamedef.h"
 #include "nodedef.h"
 #include "map.h"
+#include "mapblock.h"
+#include "metrics.h"
 #include "log.h"
+#include "porting.h"
 #include "irr_aabb3d.h"
+#include "threading/mutex_auto_lock.h"
+#include "threading/thread_pool.h"
 #include "util/basic_macros.h"
 
-//#define PATHFINDER_DEBUG
-//#define PATHFINDER_CALC_TIME
-
-#ifdef PATHFINDER_DEBUG
-	#include <string>
-#endif
-#ifdef PATHFINDER_DEBUG
-	#include <iomanip>
-#endif
-#ifdef PATHFINDER_CALC_TIME
-	#include <sys/time.h>
-#endif
-
 /******************************************************************************/
 /* Typedefs and macros                                                        */
 /******************************************************************************/
 
-#define LVL "(" << level << ")" <<
-
-#ifdef PATHFINDER_DEBUG
-#define DEBUG_OUT(a)     std::cout << a
-#define INFO_TARGET      std::cout
-#define VERBOSE_TARGET   std::cout
-#define ERROR_TARGET     std::cout
-#else
-#define DEBUG_OUT(a)     while(0)
-#define INFO_TARGET      infostream << "Pathfinder: "
 #define VERBOSE_TARGET   verbosestream << "Pathfinder: "
 #define ERROR_TARGET     errorstream << "Pathfinder: "
-#endif
-
-/******************************************************************************/
-/* Class definitions                                                          */
-/******************************************************************************/
-
-
-/** representation of cost in specific direction */
-class PathCost {
-public:
-
-	/** default constructor */
-	PathCost();
-
-	/** copy constructor */
-	PathCost(const PathCost &b);
-
-	/** assignment operator */
-	PathCost &operator= (const PathCost &b);
-
-	bool valid;              /**< movement is possible         */
-	int  value;              /**< cost of movement             */
-	int  direction;          /**< y-direction of movement      */
-	bool updated;            /**< this cost has ben calculated */
 
+// Failed searches are answered from the cache for this long
+static const u32 FAILED_PATH_CACHE_MS = 1000;
+// Caches are dropped whole when they grow over this
+static const size_t PATH_CACHE_MAX = 4096;
+static const size_t SUMMARY_CACHE_MAX = 65536;
+
+// Sides of a block, bit i of BlockSummary::faces; i ^ 1 is the opposite side
+static const v3s16 g_sides[6] = {
+	v3s16( 1, 0, 0), v3s16(-1, 0, 0),
+	v3s16( 0, 1, 0), v3s16( 0,-1, 0),
+	v3s16( 0, 0, 1), v3s16( 0, 0,-1),
 };
 
-
-/** representation of a mapnode to be used for pathfinding */
-class PathGridnode {
-
-public:
-	/** default constructor */
-	PathGridnode();
-
-	/** copy constructor */
-	PathGridnode(const PathGridnode &b);
-
-	/**
-	 * assignment operator
-	 * @param b node to copy
-	 */
-	PathGridnode &operator= (const PathGridnode &b);
-
-	/**
-	 * read cost in a specific direction
-	 * @param dir direction of cost to fetch
-	 */
-	PathCost getCost(v3s16 dir);
-
-	/**
-	 * set cost value for movement
-	 * @param dir direction to set cost for
-	 * @cost cost to set
-	 */
-	void      setCost(v3s16 dir, PathCost cost);
-
-	bool      valid;               /**< node is on surface                    */
-	bool      target;              /**< node is target position               */
-	bool      source;              /**< node is stating position              */
-	int       totalcost;           /**< cost to move here from starting point */
-	v3s16     sourcedir;           /**< origin of movement for current cost   */
-	v3s16     pos;                 /**< real position of node                 */
-	PathCost directions[4];        /**< cost in different directions          */
-
-	/* debug values */
-	bool      is_element;          /**< node is element of path detected      */
-	char      type;                /**< type of node                          */
+static const v3s16 g_moves[4] = {
+	v3s16( 1, 0, 0), v3s16(-1, 0, 0),
+	v3s16( 0, 0, 1), v3s16( 0, 0,-1),
 };
 
-class Pathfinder;
-
-/** Abstract class to manage the map data */
-class GridNodeContainer {
-public:
-	virtual PathGridnode &access(v3s16 p)=0;
-	virtual ~GridNodeContainer() {}
-protected:
-	Pathfinder *m_pathf;
-
-	void initNode(v3s16 ipos, PathGridnode *p_node);
-};
+/******************************************************************************/
+/* Class definitions                                                          */
+/******************************************************************************/
 
-class ArrayGridNodeContainer : public GridNodeContainer {
+/** one search, nodes are read from the map as the search reaches them */
+class PathSearch {
 public:
-	virtual ~ArrayGridNodeContainer() {}
-	ArrayGridNodeContainer(Pathfinder *pathf, v3s16 dimensions);
-	virtual PathGridnode &access(v3s16 p);
-private:
-	v3s16 m_dimensions;
+	PathSearch(PathfinderManager *manager, Map &map, INodeDefManager *ndef,
+			const PathRequest &request);
 
-	int m_x_stride;
-	int m_y_stride;
-	std::vector<PathGridnode> m_nodes_array;
-};
+	std::vector<v3s16> run();
 
-class MapGridNodeContainer : public GridNodeContainer {
-public:
-	virtual ~MapGridNodeContainer() {}
-	MapGridNodeContainer(Pathfinder *pathf);
-	virtual PathGridnode &access(v3s16 p);
 private:
-	std::map<v3s16, PathGridnode> m_nodes;
-};
-
-/** class doing pathfinding */
-class Pathfinder {
-
-public:
-	/**
-	 * default constructor
-	 */
-	Pathfinder();
-
-	~Pathfinder();
-
-	/**
-	 * path evaluation function
-	 * @param env environment to look for path
-	 * @param source origin of path
-	 * @param destination end position of path
-	 * @param searchdistance maximum number of nodes to look in each direction
-	 * @param max_jump maximum number of blocks a path may jump up
-	 * @param max_drop maximum number of blocks a path may drop
-	 * @param algo Algorithm to use for finding a path
-	 */
-	std::vector<v3s16> getPath(ServerEnvironment *env,
-			v3s16 source,
-			v3s16 destination,
-			unsigned int searchdistance,
-			unsigned int max_jump,
-			unsigned int max_drop,
-			PathAlgorithm algo);
-
-private:
-	/* helper functions */
-
-	/**
-	 * transform index pos to mappos
-	 * @param ipos a index position
-	 * @return map position
-	 */
-	v3s16          getRealPos(v3s16 ipos);
-
-	/**
-	 * transform mappos to index pos
-	 * @param pos a real pos
-	 * @return index position
-	 */
-	v3s16          getIndexPos(v3s16 pos);
-
-	/**
-	 * get gridnode at a specific index position
-	 * @param ipos index position
-	 * @return gridnode for index
-	 */
-	PathGridnode &getIndexElement(v3s16 ipos);
-
-	/**
-	 * Get gridnode at a specific index position
-	 * @return gridnode for index
-	 */
-	PathGridnode &getIdxElem(s16 x, s16 y, s16 z);
-
-	/**
-	 * invert a 3d position
-	 * @param pos 3d position
-	 * @return pos *-1
-	 */
-	v3s16          invert(v3s16 pos);
-
-	/**
-	 * check if a index is within current search area
-	 * @param index position to validate
-	 * @return true/false
-	 */
-	bool           isValidIndex(v3s16 index);
-
-	/**
-	 * translate position to float position
-	 * @param pos integer position
-	 * @return float position
-	 */
-	v3f            tov3f(v3s16 pos);
+	struct OpenNode {
+		int estimate;   /**< cost so far plus heuristic */
+		int cost;       /**< cost so far                */
+		v3s16 pos;
+
+		bool operator<(const OpenNode &other) const
+		{
+			// lowest estimate on top, the one further on first
+			if (estimate != other.estimate)
+				return estimate > other.estimate;
+			return cost < other.cost;
+		}
+	};
 
+	struct Visit {
+		int cost;
+		v3s16 parent;
+		bool closed;
+	};
 
-	/* algorithm functions */
+	bool isWalkable(MapNode n) { return m_ndef->get(n).walkable; }
 
 	/**
-	 * calculate 2d manahttan distance to target on the xz plane
-	 * @param pos position to calc distance
-	 * @return integer distance
+	 * node can be stood in: not solid itself, solid below
 	 */
-	int           getXZManhattanDist(v3s16 pos);
+	bool isStandable(v3s16 pos);
 
 	/**
-	 * get best direction based uppon heuristics
-	 * @param directions list of unchecked directions
-	 * @param g_pos mapnode to start from
-	 * @return direction to check
+	 * step from a standable node to a neighbour column, jumping up or
+	 * dropping down to the surface there
+	 * @return false if that is not possible
 	 */
-	v3s16         getDirHeuristic(std::vector<v3s16> &directions, PathGridnode &g_pos);
+	bool move(v3s16 pos, v3s16 dir, v3s16 &dest, int &cost);
 
-	/**
-	 * build internal data representation of search area
-	 * @return true/false if costmap creation was successfull
-	 */
-	bool          buildCostmap();
+	int heuristic(v3s16 pos);
 
 	/**
-	 * calculate cost of movement
-	 * @param pos real world position to start movement
-	 * @param dir direction to move to
-	 * @return cost information
+	 * A* over the block summaries
 	 */
-	PathCost     calcCost(v3s16 pos, v3s16 dir);
+	bool findBlockPath(std::vector<v3s16> &blocks);
 
 	/**
-	 * recursive update whole search areas total cost information
-	 * @param ipos position to check next
-	 * @param srcdir positionc checked last time
-	 * @param total_cost cost of moving to ipos
-	 * @param level current recursion depth
-	 * @return true/false path to destination has been found
+	 * A* over the nodes
+	 * @param corridor blocks the path may go through, all if NULL
 	 */
-	bool          updateAllCosts(v3s16 ipos, v3s16 srcdir, int total_cost, int level);
-
-	/**
-	 * recursive try to find a patrh to destionation
-	 * @param ipos position to check next
-	 * @param srcdir positionc checked last time
-	 * @param total_cost cost of moving to ipos
-	 * @param level current recursion depth
-	 * @return true/false path to destination has been found
-	 */
-	bool          updateCostHeuristic(v3s16 ipos, v3s16 srcdir, int current_cost, int level);
-
-	/**
-	 * recursive build a vector containing all nodes from source to destination
-	 * @param path vector to add nodes to
-	 * @param pos pos to check next
-	 * @param level recursion depth
-	 */
-	void          buildPath(std::vector<v3s16> &path, v3s16 pos, int level);
-
-	/* variables */
-	int m_max_index_x;            /**< max index of search area in x direction  */
-	int m_max_index_y;            /**< max index of search area in y direction  */
-	int m_max_index_z;            /**< max index of search area in z direction  */
-
-
-	int m_searchdistance;         /**< max distance to search in each direction */
-	int m_maxdrop;                /**< maximum number of blocks a path may drop */
-	int m_maxjump;                /**< maximum number of blocks a path may jump */
-	int m_min_target_distance;    /**< current smalest path to target           */
-
-	bool m_prefetch;              /**< prefetch cost data                       */
-
-	v3s16 m_start;                /**< source position                          */
-	v3s16 m_destination;          /**< destination position                     */
+	bool findPath(const unordered_set_v3POS *corridor, std::vector<v3s16> &path);
 
+	PathfinderManager *m_manager;
+	Map &m_map;
+	INodeDefManager *m_ndef;
+	PathRequest m_request;
 	core::aabbox3d<s16> m_limits; /**< position limits in real map coordinates  */
+};
 
-	/** contains all map data already collected and analyzed.
-		Access it via the getIndexElement/getIdxElem methods. */
-	friend class GridNodeContainer;
-	GridNodeContainer *m_nodes_container;
-
-	ServerEnvironment *m_env;     /**< minetest environment pointer             */
-
-#ifdef PATHFINDER_DEBUG
-
-	/**
-	 * print collected cost information
-	 */
-	void printCost();
-
-	/**
-	 * print collected cost information in a specific direction
-	 * @param dir direction to print
-	 */
-	void printCost(PathDirections dir);
-
-	/**
-	 * print type of node as evaluated
-	 */
-	void printType();
-
-	/**
-	 * print pathlenght for all nodes in search area
-	 */
-	void printPathLen();
-
-	/**
-	 * print a path
-	 * @param path path to show
-	 */
-	void printPath(std::vector<v3s16> path);
-
-	/**
-	 * print y direction for all movements
-	 */
-	void printYdir();
-
-	/**
-	 * print y direction for moving in a specific direction
-	 * @param dir direction to show data
-	 */
-	void printYdir(PathDirections dir);
+/** runs the searches of PathfinderManager::getPathAsync */
+class PathfinderThread : public thread_pool {
+public:
+	PathfinderThread(PathfinderManager *manager, Map &map) :
+		thread_pool("Pathfinder"),
+		m_manager(manager),
+		m_map(map)
+	{}
+
+	void *run()
+	{
+		while (!stopRequested()) {
+			PathfinderManager::AsyncRequest request =
+					m_manager->m_async_requests.pop_frontNoEx(100);
+			if (!request.callback)
+				continue;
+
+			PathfinderManager::AsyncResult result;
+			result.callback = request.callback;
+			try {
+				result.path = m_manager->getPath(request.request);
+			} catch (std::exception &e) {
+				ERROR_TARGET << "exception: " << e.what() << std::endl;
+			}
+			m_manager->m_async_results.push_back(result);
+			m_map.getBlockCacheFlush();
+		}
+		return nullptr;
+	}
 
-	/**
-	 * helper function to translate a direction to speaking text
-	 * @param dir direction to translate
-	 * @return textual name of direction
-	 */
-	std::string dirToName(PathDirections dir);
-#endif
+private:
+	PathfinderManager *m_manager;
+	Map &m_map;
 };
 
 /******************************************************************************/
 /* implementation                                                             */
 /******************************************************************************/
 
-std::vector<v3s16> get_path(ServerEnvironment* env,
-							v3s16 source,
-							v3s16 destination,
-							unsigned int searchdistance,
-							unsigned int max_jump,
-							unsigned int max_drop,
-							PathAlgorithm algo)
-{
-	Pathfinder searchclass;
-
-	return searchclass.getPath(env,
-				source, destination,
-				searchdistance, max_jump, max_drop, algo);
-}
-
-/******************************************************************************/
-PathCost::PathCost()
-:	valid(false),
-	value(0),
-	direction(0),
-	updated(false)
-{
-	//intentionaly empty
-}
-
 /******************************************************************************/
-PathCost::PathCost(const PathCost &b)
+bool PathRequest::operator==(const PathRequest &other) const
 {
-	valid     = b.valid;
-	direction = b.direction;
-	value     = b.value;
-	updated   = b.updated;
+	return source == other.source &&
+			destination == other.destination &&
+			searchdistance == other.searchdistance &&
+			max_jump == other.max_jump &&
+			max_drop == other.max_drop &&
+			algo == other.algo;
 }
 
 /******************************************************************************/
-PathCost &PathCost::operator= (const PathCost &b)
+std::size_t PathRequestHash::operator()(const PathRequest &r) const
 {
-	valid     = b.valid;
-	direction = b.direction;
-	value     = b.value;
-	updated   = b.updated;
-
-	return *this;
+	v3POSHash hash;
+	return hash(r.source) ^ (hash(r.destination) << 1) ^
+			(r.searchdistance << 8) ^ (r.max_jump << 16) ^
+			(r.max_drop << 20) ^ (r.algo << 24);
 }
 
 /******************************************************************************/
-PathGridnode::PathGridnode()
-:	valid(false),
-	target(false),
-	source(false),
-	totalcost(-1),
-	sourcedir(v3s16(0, 0, 0)),
-	pos(v3s16(0, 0, 0)),
-	is_element(false),
-	type('u')
+PathfinderManager::PathfinderManager(Map &map, INodeDefManager *ndef) :
+	m_map(map),
+	m_ndef(ndef)
 {
-	//intentionaly empty
 }
 
-/******************************************************************************/
-PathGridnode::PathGridnode(const PathGridnode &b)
-:	valid(b.valid),
-	target(b.target),
-	source(b.source),
-	totalcost(b.totalcost),
-	sourcedir(b.sourcedir),
-	pos(b.pos),
-	is_element(b.is_element),
-	type(b.type)
+PathfinderManager::~PathfinderManager()
 {
-
-	directions[DIR_XP] = b.directions[DIR_XP];
-	directions[DIR_XM] = b.directions[DIR_XM];
-	directions[DIR_ZP] = b.directions[DIR_ZP];
-	directions[DIR_ZM] = b.directions[DIR_ZM];
+	if (m_thread)
+		m_thread->join();
 }
 
 /******************************************************************************/
-PathGridnode &PathGridnode::operator= (const PathGridnode &b)
+std::vector<v3s16> PathfinderManager::getPath(const PathRequest &request)
 {
-	valid      = b.valid;
-	target     = b.target;
-	source     = b.source;
-	is_element = b.is_element;
-	totalcost  = b.totalcost;
-	sourcedir  = b.sourcedir;
-	pos        = b.pos;
-	type       = b.type;
-
-	directions[DIR_XP] = b.directions[DIR_XP];
-	directions[DIR_XM] = b.directions[DIR_XM];
-	directions[DIR_ZP] = b.directions[DIR_ZP];
-	directions[DIR_ZM] = b.directions[DIR_ZM];
-
-	return *this;
-}
+	static const auto searches_cached = g_metrics->counter("freeminer_pathfinder_searches_total",
+			"Pathfinder searches", "result=\"cached\"");
+	static const auto searches_found = g_metrics->counter("freeminer_pathfinder_searches_total",
+			"Pathfinder searches", "result=\"found\"");
+	static const auto searches_failed = g_metrics->counter("freeminer_pathfinder_searches_total",
+			"Pathfinder searches", "result=\"failed\"");
 
-/******************************************************************************/
-PathCost PathGridnode::getCost(v3s16 dir)
-{
-	if (dir.X > 0) {
-		return directions[DIR_XP];
-	}
-	if (dir.X < 0) {
-		return directions[DIR_XM];
-	}
-	if (dir.Z > 0) {
-		return directions[DIR_ZP];
-	}
-	if (dir.Z < 0) {
-		return directions[DIR_ZM];
-	}
-	PathCost retval;
-	return retval;
-}
-
-/******************************************************************************/
-void PathGridnode::setCost(v3s16 dir, PathCost cost)
-{
-	if (dir.X > 0) {
-		directions[DIR_XP] = cost;
-	}
-	if (dir.X < 0) {
-		directions[DIR_XM] = cost;
-	}
-	if (dir.Z > 0) {
-		directions[DIR_ZP] = cost;
-	}
-	if (dir.Z < 0) {
-		directions[DIR_ZM] = cost;
-	}
-}
-
-void GridNodeContainer::initNode(v3s16 ipos, PathGridnode *p_node)
-{
-	INodeDefManager *ndef = m_pathf->m_env->getGameDef()->ndef();
-	PathGridnode &elem = *p_node;
-
-	v3s16 realpos = m_pathf->getRealPos(ipos);
-
-	MapNode current = m_pathf->m_env->getMap().getNodeNoEx(realpos);
-	MapNode below   = m_pathf->m_env->getMap().getNodeNoEx(realpos + v3s16(0, -1, 0));
-
-
-	if ((current.param0 == CONTENT_IGNORE) ||
-			(below.param0 == CONTENT_IGNORE)) {
-		DEBUG_OUT("Pathfinder: " << PP(realpos) <<
-			" current or below is invalid element" << std::endl);
-		if (current.param0 == CONTENT_IGNORE) {
-			elem.type = 'i';
-			DEBUG_OUT(PP(ipos) << ": " << 'i' << std::endl);
-		}
-		return;
-	}
-
-	//don't add anything if it isn't an air node
-	if (ndef->get(current).walkable || !ndef->get(below).walkable) {
-			DEBUG_OUT("Pathfinder: " << PP(realpos)
-				<< " not on surface" << std::endl);
-			if (ndef->get(current).walkable) {
-				elem.type = 's';
-				DEBUG_OUT(PP(ipos) << ": " << 's' << std::endl);
-			} else {
-				elem.type = '-';
-				DEBUG_OUT(PP(ipos) << ": " << '-' << std::endl);
-			}
-			return;
+	std::vector<v3s16> path;
+	if (getCached(request, path)) {
+		searches_cached->add();
+		return path;
 	}
 
-	elem.valid = true;
-	elem.pos   = realpos;
-	elem.type  = 'g';
-	DEBUG_OUT(PP(ipos) << ": " << 'a' << std::endl);
+	PathSearch search(this, m_map, m_ndef, request);
+	path = search.run();
+	(path.empty() ? searches_failed : searches_found)->add();
 
-	if (m_pathf->m_prefetch) {
-		elem.directions[DIR_XP] = m_pathf->calcCost(realpos, v3s16( 1, 0, 0));
-		elem.directions[DIR_XM] = m_pathf->calcCost(realpos, v3s16(-1, 0, 0));
-		elem.directions[DIR_ZP] = m_pathf->calcCost(realpos, v3s16( 0, 0, 1));
-		elem.directions[DIR_ZM] = m_pathf->calcCost(realpos, v3s16( 0, 0,-1));
-	}
+	addCached(request, path);
+	return path;
 }
 
-ArrayGridNodeContainer::ArrayGridNodeContainer(Pathfinder *pathf, v3s16 dimensions) :
-	m_x_stride(dimensions.Y * dimensions.Z),
-	m_y_stride(dimensions.Z)
+/******************************************************************************/
+void PathfinderManager::getPathAsync(const PathRequest &request, Callback callback)
 {
-	m_pathf = pathf;
-
-	m_nodes_array.resize(dimensions.X * dimensions.Y * dimensions.Z);
-	INFO_TARGET << "Pathfinder ArrayGridNodeContainer constructor." << std::endl;
-	for (int x = 0; x < dimensions.X; x++) {
-		for (int y = 0; y < dimensions.Y; y++) {
-			for (int z= 0; z < dimensions.Z; z++) {
-				v3s16 ipos(x, y, z);
-				initNode(ipos, &access(ipos));
-			}
-		}
+	if (!m_thread) {
+		m_thread.reset(new PathfinderThread(this, m_map));
+		m_thread->start();
 	}
-}
 
-PathGridnode &ArrayGridNodeContainer::access(v3s16 p)
-{
-	return m_nodes_array[p.X * m_x_stride + p.Y * m_y_stride + p.Z];
+	AsyncRequest async;
+	async.request = request;
+	async.callback = callback;
+	m_async_requests.push_back(async);
 }
 
-MapGridNodeContainer::MapGridNodeContainer(Pathfinder *pathf)
-{
-	m_pathf = pathf;
-}
-
-PathGridnode &MapGridNodeContainer::access(v3s16 p)
+/******************************************************************************/
+void PathfinderManager::step()
 {
-	std::map<v3s16, PathGridnode>::iterator it = m_nodes.find(p);
-	if (it != m_nodes.end()) {
-		return it->second;
+	while (!m_async_results.empty()) {
+		AsyncResult result = m_async_results.pop_frontNoEx(0);
+		if (result.callback)
+			result.callback(result.path);
 	}
-	PathGridnode &n = m_nodes[p];
-	initNode(p, &n);
-	return n;
 }
 
-
-
 /******************************************************************************/
-std::vector<v3s16> Pathfinder::getPath(ServerEnvironment *env,
-							v3s16 source,
-							v3s16 destination,
-							unsigned int searchdistance,
-							unsigned int max_jump,
-							unsigned int max_drop,
-							PathAlgorithm algo)
+PathfinderManager::BlockSummary PathfinderManager::getBlockSummary(v3s16 blockpos)
 {
-#ifdef PATHFINDER_CALC_TIME
-	timespec ts;
-	clock_gettime(CLOCK_REALTIME, &ts);
-#endif
-	std::vector<v3s16> retval;
-
-	//check parameters
-	if (env == 0) {
-		ERROR_TARGET << "missing environment pointer" << std::endl;
-		return retval;
-	}
+	BlockSummary summary;
+	MapBlock *block = m_map.getBlockNoCreateNoEx(blockpos);
+	if (!block)
+		return summary;
+	MapBlock *below = m_map.getBlockNoCreateNoEx(blockpos - v3s16(0, 1, 0));
 
-	m_searchdistance = searchdistance;
-	m_env = env;
-	m_maxjump = max_jump;
-	m_maxdrop = max_drop;
-	m_start       = source;
-	m_destination = destination;
-	m_min_target_distance = -1;
-	m_prefetch = true;
-
-	if (algo == PA_PLAIN_NP) {
-		m_prefetch = false;
+	summary.changed_seq = block->m_changed_seq;
+	summary.changed_seq_below = below ? (u32)below->m_changed_seq : 0;
+	{
+		MutexAutoLock lock(m_summaries_mutex);
+		auto it = m_summaries.find(blockpos);
+		if (it != m_summaries.end() &&
+				it->second.changed_seq == summary.changed_seq &&
+				it->second.changed_seq_below == summary.changed_seq_below)
+			return it->second;
 	}
 
-	int min_x = MYMIN(source.X, destination.X);
-	int max_x = MYMAX(source.X, destination.X);
-
-	int min_y = MYMIN(source.Y, destination.Y);
-	int max_y = MYMAX(source.Y, destination.Y);
-
-	int min_z = MYMIN(source.Z, destination.Z);
-	int max_z = MYMAX(source.Z, destination.Z);
-
-	m_limits.MinEdge.X = min_x - searchdistance;
-	m_limits.MinEdge.Y = min_y - searchdistance;
-	m_limits.MinEdge.Z = min_z - searchdistance;
-
-	m_limits.MaxEdge.X = max_x + searchdistance;
-	m_limits.MaxEdge.Y = max_y + searchdistance;
-	m_limits.MaxEdge.Z = max_z + searchdistance;
-
-	v3s16 diff = m_limits.MaxEdge - m_limits.MinEdge;
-
-	m_max_index_x = diff.X;
-	m_max_index_y = diff.Y;
-	m_max_index_z = diff.Z;
-
-	delete m_nodes_container;
-	if (diff.getLength() > 5) {
-		m_nodes_container = new MapGridNodeContainer(this);
-	} else {
-		m_nodes_container = new ArrayGridNodeContainer(this, diff);
-	}
-#ifdef PATHFINDER_DEBUG
-	printType();
-	printCost();
-	printYdir();
-#endif
-
-	//validate and mark start and end pos
-	v3s16 StartIndex  = getIndexPos(source);
-	v3s16 EndIndex    = getIndexPos(destination);
-
-	PathGridnode &startpos = getIndexElement(StartIndex);
-	PathGridnode &endpos   = getIndexElement(EndIndex);
-
-	if (!startpos.valid) {
-		VERBOSE_TARGET << "invalid startpos" <<
-				"Index: " << PP(StartIndex) <<
-				"Realpos: " << PP(getRealPos(StartIndex)) << std::endl;
-		return retval;
-	}
-	if (!endpos.valid) {
-		VERBOSE_TARGET << "invalid stoppos" <<
-				"Index: " << PP(EndIndex) <<
-				"Realpos: " << PP(getRealPos(EndIndex)) << std::endl;
-		return retval;
-	}
+	INodeDefManager *ndef = m_ndef;
+	auto walkable = [ndef](MapNode n) {
+		return n.getContent() != CONTENT_IGNORE && ndef->get(n).walkable;
+	};
 
-	endpos.target      = true;
-	startpos.source    = true;
-	startpos.totalcost = 0;
-
-	bool update_cost_retval = false;
-
-	switch (algo) {
-		case PA_DIJKSTRA:
-			update_cost_retval = updateAllCosts(StartIndex, v3s16(0, 0, 0), 0, 0);
-			break;
-		case PA_PLAIN_NP:
-		case PA_PLAIN:
-			update_cost_retval = updateCostHeuristic(StartIndex, v3s16(0, 0, 0), 0, 0);
-			break;
-		default:
-			ERROR_TARGET << "missing PathAlgorithm"<< std::endl;
-			break;
+	bool walkable_below[MAP_BLOCKSIZE][MAP_BLOCKSIZE] = {};
+	if (below) {
+		auto lock = below->lock_shared_rec();
+		for (s16 z = 0; z < MAP_BLOCKSIZE; z++)
+		for (s16 x = 0; x < MAP_BLOCKSIZE; x++)
+			walkable_below[z][x] = walkable(
+					below->getNodeNoLock(v3s16(x, MAP_BLOCKSIZE - 1, z)));
 	}
 
-	if (update_cost_retval) {
-
-#ifdef PATHFINDER_DEBUG
-		std::cout << "Path to target found!" << std::endl;
-		printPathLen();
-#endif
-
-		//find path
-		std::vector<v3s16> path;
-		buildPath(path, EndIndex, 0);
-
-#ifdef PATHFINDER_DEBUG
-		std::cout << "Full index path:" << std::endl;
-		printPath(path);
-#endif
-
-		//finalize path
-		std::vector<v3s16> full_path;
-		for (std::vector<v3s16>::iterator i = path.begin();
-					i != path.end(); ++i) {
-			full_path.push_back(getIndexElement(*i).pos);
+	auto lock = block->lock_shared_rec();
+	for (s16 z = 0; z < MAP_BLOCKSIZE; z++)
+	for (s16 x = 0; x < MAP_BLOCKSIZE; x++) {
+		bool solid_below = walkable_below[z][x];
+		for (s16 y = 0; y < MAP_BLOCKSIZE; y++) {
+			MapNode n = block->getNodeNoLock(v3s16(x, y, z));
+			bool solid = walkable(n);
+			if (solid_below && !solid && n.getContent() != CONTENT_IGNORE) {
+				summary.standable++;
+				if (x == MAP_BLOCKSIZE - 1) summary.faces |= 1 << 0;
+				if (x == 0)                 summary.faces |= 1 << 1;
+				if (y == MAP_BLOCKSIZE - 1) summary.faces |= 1 << 2;
+				if (y == 0)                 summary.faces |= 1 << 3;
+				if (z == MAP_BLOCKSIZE - 1) summary.faces |= 1 << 4;
+				if (z == 0)                 summary.faces |= 1 << 5;
+			}
+			solid_below = solid;
 		}
-
-#ifdef PATHFINDER_DEBUG
-		std::cout << "full path:" << std::endl;
-		printPath(full_path);
-#endif
-#ifdef PATHFINDER_CALC_TIME
-		timespec ts2;
-		clock_gettime(CLOCK_REALTIME, &ts2);
-
-		int ms = (ts2.tv_nsec - ts.tv_nsec)/(1000*1000);
-		int us = ((ts2.tv_nsec - ts.tv_nsec) - (ms*1000*1000))/1000;
-		int ns = ((ts2.tv_nsec - ts.tv_nsec) - ( (ms*1000*1000) + (us*1000)));
-
-
-		std::cout << "Calculating path took: " << (ts2.tv_sec - ts.tv_sec) <<
-				"s " << ms << "ms " << us << "us " << ns << "ns " << std::endl;
-#endif
-		return full_path;
 	}
-	else {
-#ifdef PATHFINDER_DEBUG
-		printPathLen();
-#endif
-		ERROR_TARGET << "failed to update cost map"<< std::endl;
-	}
-
-
-	//return
-	return retval;
-}
 
-/******************************************************************************/
-Pathfinder::Pathfinder() :
-	m_max_index_x(0),
-	m_max_index_y(0),
-	m_max_index_z(0),
-	m_searchdistance(0),
-	m_maxdrop(0),
-	m_maxjump(0),
-	m_min_target_distance(0),
-	m_prefetch(true),
-	m_start(0, 0, 0),
-	m_destination(0, 0, 0),
-	m_nodes_container(NULL),
-	m_env(0)
-{
-	//intentionaly empty
-}
-
-Pathfinder::~Pathfinder()
-{
-	delete m_nodes_container;
-}
-/******************************************************************************/
-v3s16 Pathfinder::getRealPos(v3s16 ipos)
-{
-	return m_limits.MinEdge + ipos;
+	MutexAutoLock summaries_lock(m_summaries_mutex);
+	if (m_summaries.size() >= SUMMARY_CACHE_MAX)
+		m_summaries.clear();
+	m_summaries[blockpos] = summary;
+	return summary;
 }
 
 /******************************************************************************/
-PathCost Pathfinder::calcCost(v3s16 pos, v3s16 dir)
+bool PathfinderManager::getCached(const PathRequest &request, std::vector<v3s16> &path)
 {
-	INodeDefManager *ndef = m_env->getGameDef()->ndef();
-	PathCost retval;
-
-	retval.updated = true;
-
-	v3s16 pos2 = pos + dir;
-
-	//check limits
-	if (!m_limits.isPointInside(pos2)) {
-		DEBUG_OUT("Pathfinder: " << PP(pos2) <<
-				" no cost -> out of limits" << std::endl);
-		return retval;
-	}
-
-	MapNode node_at_pos2 = m_env->getMap().getNodeNoEx(pos2);
-
-	//did we get information about node?
-	if (node_at_pos2.param0 == CONTENT_IGNORE ) {
-			VERBOSE_TARGET << "Pathfinder: (1) area at pos: "
-					<< PP(pos2) << " not loaded";
-			return retval;
-	}
-
-	if (!ndef->get(node_at_pos2).walkable) {
-		MapNode node_below_pos2 =
-							m_env->getMap().getNodeNoEx(pos2 + v3s16(0, -1, 0));
+	MutexAutoLock lock(m_paths_mutex);
+	auto it = m_paths.find(request);
+	if (it == m_paths.end())
+		return false;
 
-		//did we get information about node?
-		if (node_below_pos2.param0 == CONTENT_IGNORE ) {
-				VERBOSE_TARGET << "Pathfinder: (2) area at pos: "
-					<< PP((pos2 + v3s16(0, -1, 0))) << " not loaded";
-				return retval;
-		}
-
-		if (ndef->get(node_below_pos2).walkable) {
-			retval.valid = true;
-			retval.value = 1;
-			retval.direction = 0;
-			DEBUG_OUT("Pathfinder: "<< PP(pos)
-					<< " cost same height found" << std::endl);
-		}
-		else {
-			v3s16 testpos = pos2 - v3s16(0, -1, 0);
-			MapNode node_at_pos = m_env->getMap().getNodeNoEx(testpos);
-
-			while ((node_at_pos.param0 != CONTENT_IGNORE) &&
-					(!ndef->get(node_at_pos).walkable) &&
-					(testpos.Y > m_limits.MinEdge.Y)) {
-				testpos += v3s16(0, -1, 0);
-				node_at_pos = m_env->getMap().getNodeNoEx(testpos);
-			}
-
-			//did we find surface?
-			if ((testpos.Y >= m_limits.MinEdge.Y) &&
-					(node_at_pos.param0 != CONTENT_IGNORE) &&
-					(ndef->get(node_at_pos).walkable)) {
-				if ((pos2.Y - testpos.Y - 1) <= m_maxdrop) {
-					retval.valid = true;
-					retval.value = 2;
-					//difference of y-pos +1 (target node is ABOVE solid node)
-					retval.direction = ((testpos.Y - pos2.Y) +1);
-					DEBUG_OUT("Pathfinder cost below height found" << std::endl);
-				}
-				else {
-					INFO_TARGET << "Pathfinder:"
-							" distance to surface below to big: "
-							<< (testpos.Y - pos2.Y) << " max: " << m_maxdrop
-							<< std::endl;
-				}
-			}
-			else {
-				DEBUG_OUT("Pathfinder: no surface below found" << std::endl);
-			}
+	const CachedPath &cached = it->second;
+	if (cached.path.empty()) {
+		if (porting::getTimeMs() - cached.time_ms > FAILED_PATH_CACHE_MS) {
+			m_paths.erase(it);
+			return false;
 		}
+		path.clear();
+		return true;
 	}
-	else {
-		v3s16 testpos = pos2;
-		MapNode node_at_pos = m_env->getMap().getNodeNoEx(testpos);
-
-		while ((node_at_pos.param0 != CONTENT_IGNORE) &&
-				(ndef->get(node_at_pos).walkable) &&
-				(testpos.Y < m_limits.MaxEdge.Y)) {
-			testpos += v3s16(0, 1, 0);
-			node_at_pos = m_env->getMap().getNodeNoEx(testpos);
-		}
 
-		//did we find surface?
-		if ((testpos.Y <= m_limits.MaxEdge.Y) &&
-				(!ndef->get(node_at_pos).walkable)) {
-
-			if (testpos.Y - pos2.Y <= m_maxjump) {
-				retval.valid = true;
-				retval.value = 2;
-				retval.direction = (testpos.Y - pos2.Y);
-				DEBUG_OUT("Pathfinder cost above found" << std::endl);
-			}
-			else {
-				DEBUG_OUT("Pathfinder: distance to surface above to big: "
-						<< (testpos.Y - pos2.Y) << " max: " << m_maxjump
-						<< std::endl);
-			}
-		}
-		else {
-			DEBUG_OUT("Pathfinder: no surface above found" << std::endl);
+	for (const auto &block : cached.blocks) {
+		MapBlock *b = m_map.getBlockNoCreateNoEx(block.first);
+		if (!b || b->m_changed_seq != block.second) {
+			m_paths.erase(it);
+			return false;
 		}
 	}
-	return retval;
-}
-
-/******************************************************************************/
-v3s16 Pathfinder::getIndexPos(v3s16 pos)
-{
-	return pos - m_limits.MinEdge;
+	path = cached.path;
+	return true;
 }
 
 /******************************************************************************/
-PathGridnode &Pathfinder::getIndexElement(v3s16 ipos)
+void PathfinderManager::addCached(const PathRequest &request, const std::vector<v3s16> &path)
 {
-	return m_nodes_container->access(ipos);
-}
-
-/******************************************************************************/
-inline PathGridnode &Pathfinder::getIdxElem(s16 x, s16 y, s16 z)
-{
-	return m_nodes_container->access(v3s16(x,y,z));
-}
+	CachedPath cached;
+	cached.path = path;
+	cached.time_ms = porting::getTimeMs();
 
-/******************************************************************************/
-bool Pathfinder::isValidIndex(v3s16 index)
-{
-	if (	(index.X < m_max_index_x) &&
-			(index.Y < m_max_index_y) &&
-			(index.Z < m_max_index_z) &&
-			(index.X >= 0) &&
-			(index.Y >= 0) &&
-			(index.Z >= 0))
-		return true;
+	// The nodes of the path and the ones they stand on
+	unordered_set_v3POS blocks;
+	for (const auto &p : path) {
+		blocks.insert(getNodeBlockPos(p));
+		blocks.insert(getNodeBlockPos(p - v3s16(0, 1, 0)));
+	}
+	for (const auto &blockpos : blocks) {
+		MapBlock *block = m_map.getBlockNoCreateNoEx(blockpos);
+		if (!block)
+			return;
+		cached.blocks.emplace_back(blockpos, block->m_changed_seq);
+	}
 
-	return false;
+	MutexAutoLock lock(m_paths_mutex);
+	if (m_paths.size() >= PATH_CACHE_MAX)
+		m_paths.clear();
+	m_paths[request] = cached;
 }
 
 /******************************************************************************/
-v3s16 Pathfinder::invert(v3s16 pos)
+PathSearch::PathSearch(PathfinderManager *manager, Map &map,
+		INodeDefManager *ndef, const PathRequest &request) :
+	m_manager(manager),
+	m_map(map),
+	m_ndef(ndef),
+	m_request(request)
 {
-	v3s16 retval = pos;
-
-	retval.X *=-1;
-	retval.Y *=-1;
-	retval.Z *=-1;
+	m_limits.MinEdge.X = MYMIN(request.source.X, request.destination.X) - request.searchdistance;
+	m_limits.MinEdge.Y = MYMIN(request.source.Y, request.destination.Y) - request.searchdistance;
+	m_limits.MinEdge.Z = MYMIN(request.source.Z, request.destination.Z) - request.searchdistance;
 
-	return retval;
+	m_limits.MaxEdge.X = MYMAX(request.source.X, request.destination.X) + request.searchdistance;
+	m_limits.MaxEdge.Y = MYMAX(request.source.Y, request.destination.Y) + request.searchdistance;
+	m_limits.MaxEdge.Z = MYMAX(request.source.Z, request.destination.Z) + request.searchdistance;
 }
 
 /******************************************************************************/
-bool Pathfinder::updateAllCosts(v3s16 ipos,
-								v3s16 srcdir,
-								int current_cost,
-								int level)
+std::vector<v3s16> PathSearch::run()
 {
-	PathGridnode &g_pos = getIndexElement(ipos);
-	g_pos.totalcost = current_cost;
-	g_pos.sourcedir = srcdir;
-
-	level ++;
+	std::vector<v3s16> path;
 
-	//check if target has been found
-	if (g_pos.target) {
-		m_min_target_distance = current_cost;
-		DEBUG_OUT(LVL " Pathfinder: target found!" << std::endl);
-		return true;
+	if (!isStandable(m_request.source)) {
+		VERBOSE_TARGET << "invalid startpos " << PP(m_request.source) << std::endl;
+		return path;
+	}
+	if (!isStandable(m_request.destination)) {
+		VERBOSE_TARGET << "invalid stoppos " << PP(m_request.destination) << std::endl;
+		return path;
 	}
 
-	bool retval = false;
-
-	std::vector<v3s16> directions;
-
-	directions.push_back(v3s16( 1,0, 0));
-	directions.push_back(v3s16(-1,0, 0));
-	directions.push_back(v3s16( 0,0, 1));
-	directions.push_back(v3s16( 0,0,-1));
-
-	for (unsigned int i=0; i < directions.size(); i++) {
-		if (directions[i] != srcdir) {
-			PathCost cost = g_pos.getCost(directions[i]);
-
-			if (cost.valid) {
-				directions[i].Y = cost.direction;
-
-				v3s16 ipos2 = ipos + directions[i];
-
-				if (!isValidIndex(ipos2)) {
-					DEBUG_OUT(LVL " Pathfinder: " << PP(ipos2) <<
-						" out of range, max=" << PP(m_limits.MaxEdge) << std::endl);
-					continue;
-				}
-
-				PathGridnode &g_pos2 = getIndexElement(ipos2);
-
-				if (!g_pos2.valid) {
-					VERBOSE_TARGET << LVL "Pathfinder: no data for new position: "
-												<< PP(ipos2) << std::endl;
-					continue;
-				}
-
-				assert(cost.value > 0);
-
-				int new_cost = current_cost + cost.value;
-
-				// check if there already is a smaller path
-				if ((m_min_target_distance > 0) &&
-						(m_min_target_distance < new_cost)) {
-					return false;
-				}
-
-				if ((g_pos2.totalcost < 0) ||
-						(g_pos2.totalcost > new_cost)) {
-					DEBUG_OUT(LVL "Pathfinder: updating path at: "<<
-							PP(ipos2) << " from: " << g_pos2.totalcost << " to "<<
-							new_cost << std::endl);
-					if (updateAllCosts(ipos2, invert(directions[i]),
-											new_cost, level)) {
-						retval = true;
-						}
-					}
-				else {
-					DEBUG_OUT(LVL "Pathfinder:"
-							" already found shorter path to: "
-							<< PP(ipos2) << std::endl);
-				}
-			}
-			else {
-				DEBUG_OUT(LVL "Pathfinder:"
-						" not moving to invalid direction: "
-						<< PP(directions[i]) << std::endl);
-			}
+	v3s16 blocks = getNodeBlockPos(m_request.destination) -
+			getNodeBlockPos(m_request.source);
+	if (MYMAX(abs(blocks.X), MYMAX(abs(blocks.Y), abs(blocks.Z))) > 1) {
+		std::vector<v3s16> block_path;
+		if (findBlockPath(block_path)) {
+			// The blocks of the coarse path and the ones around them
+			unordered_set_v3POS corridor;
+			for (const auto &blockpos : block_path)
+				for (s16 z = -1; z <= 1; z++)
+				for (s16 y = -1; y <= 1; y++)
+				for (s16 x = -1; x <= 1; x++)
+					corridor.insert(blockpos + v3s16(x, y, z));
+			if (findPath(&corridor, path))
+				return path;
 		}
 	}
-	return retval;
+
+	// Near, or the summaries were too coarse
+	if (!findPath(NULL, path))
+		VERBOSE_TARGET << "no path from " << PP(m_request.source)
+				<< " to " << PP(m_request.destination) << std::endl;
+	return path;
 }
 
 /******************************************************************************/
-int Pathfinder::getXZManhattanDist(v3s16 pos)
+bool PathSearch::isStandable(v3s16 pos)
 {
-	int min_x = MYMIN(pos.X, m_destination.X);
-	int max_x = MYMAX(pos.X, m_destination.X);
-	int min_z = MYMIN(pos.Z, m_destination.Z);
-	int max_z = MYMAX(pos.Z, m_destination.Z);
-
-	return (max_x - min_x) + (max_z - min_z);
+	MapNode n = m_map.getNodeNoEx(pos);
+	if (n.getContent() == CONTENT_IGNORE || isWalkable(n))
+		return false;
+	MapNode below = m_map.getNodeNoEx(pos - v3s16(0, 1, 0));
+	return below.getContent() != CONTENT_IGNORE && isWalkable(below);
 }
 
 /******************************************************************************/
-v3s16 Pathfinder::getDirHeuristic(std::vector<v3s16> &directions, PathGridnode &g_pos)
+bool PathSearch::move(v3s16 pos, v3s16 dir, v3s16 &dest, int &cost)
 {
-	int   minscore = -1;
-	v3s16 retdir   = v3s16(0, 0, 0);
-	v3s16 srcpos = g_pos.pos;
-	DEBUG_OUT("Pathfinder: remaining dirs at beginning:"
-				<< directions.size() << std::endl);
-
-	for (std::vector<v3s16>::iterator iter = directions.begin();
-			iter != directions.end();
-			++iter) {
-
-		v3s16 pos1 = v3s16(srcpos.X + iter->X, 0, srcpos.Z+iter->Z);
-
-		int cur_manhattan = getXZManhattanDist(pos1);
-		PathCost cost    = g_pos.getCost(*iter);
-
-		if (!cost.updated) {
-			cost = calcCost(g_pos.pos, *iter);
-			g_pos.setCost(*iter, cost);
-		}
-
-		if (cost.valid) {
-			int score = cost.value + cur_manhattan;
+	v3s16 pos2 = pos + dir;
 
-			if ((minscore < 0)|| (score < minscore)) {
-				minscore = score;
-				retdir = *iter;
-			}
+	//check limits
+	if (!m_limits.isPointInside(pos2))
+		return false;
+
+	MapNode node_at_pos2 = m_map.getNodeNoEx(pos2);
+	if (node_at_pos2.getContent() == CONTENT_IGNORE)
+		return false;
+
+	if (!isWalkable(node_at_pos2)) {
+		v3s16 testpos = pos2 - v3s16(0, 1, 0);
+		MapNode node_at_pos = m_map.getNodeNoEx(testpos);
+		if (node_at_pos.getContent() == CONTENT_IGNORE)
+			return false;
+
+		// same height
+		if (isWalkable(node_at_pos)) {
+			dest = pos2;
+			cost = 1;
+			return true;
 		}
-	}
 
-	if (retdir != v3s16(0, 0, 0)) {
-		for (std::vector<v3s16>::iterator iter = directions.begin();
-					iter != directions.end();
-					++iter) {
-			if(*iter == retdir) {
-				DEBUG_OUT("Pathfinder: removing return direction" << std::endl);
-				directions.erase(iter);
-				break;
-			}
+		// drop down to the surface
+		while ((node_at_pos.getContent() != CONTENT_IGNORE) &&
+				(!isWalkable(node_at_pos)) &&
+				(testpos.Y > m_limits.MinEdge.Y)) {
+			testpos += v3s16(0, -1, 0);
+			node_at_pos = m_map.getNodeNoEx(testpos);
 		}
-	}
-	else {
-		DEBUG_OUT("Pathfinder: didn't find any valid direction clearing"
-					<< std::endl);
-		directions.clear();
-	}
-	DEBUG_OUT("Pathfinder: remaining dirs at end:" << directions.size()
-				<< std::endl);
-	return retdir;
-}
-
-/******************************************************************************/
-bool Pathfinder::updateCostHeuristic(	v3s16 ipos,
-										v3s16 srcdir,
-										int current_cost,
-										int level)
-{
-
-	PathGridnode &g_pos = getIndexElement(ipos);
-	g_pos.totalcost = current_cost;
-	g_pos.sourcedir = srcdir;
-
-	level ++;
-
-	//check if target has been found
-	if (g_pos.target) {
-		m_min_target_distance = current_cost;
-		DEBUG_OUT(LVL " Pathfinder: target found!" << std::endl);
-		return true;
-	}
-
-	bool retval = false;
-
-	std::vector<v3s16> directions;
-
-	directions.push_back(v3s16( 1, 0,  0));
-	directions.push_back(v3s16(-1, 0,  0));
-	directions.push_back(v3s16( 0, 0,  1));
-	directions.push_back(v3s16( 0, 0, -1));
-
-	v3s16 direction = getDirHeuristic(directions, g_pos);
-
-	while (direction != v3s16(0, 0, 0) && (!retval)) {
-
-		if (direction != srcdir) {
-			PathCost cost = g_pos.getCost(direction);
-
-			if (cost.valid) {
-				direction.Y = cost.direction;
 
-				v3s16 ipos2 = ipos + direction;
-
-				if (!isValidIndex(ipos2)) {
-					DEBUG_OUT(LVL " Pathfinder: " << PP(ipos2) <<
-						" out of range, max=" << PP(m_limits.MaxEdge) << std::endl);
-					direction = getDirHeuristic(directions, g_pos);
-					continue;
-				}
-
-				PathGridnode &g_pos2 = getIndexElement(ipos2);
-
-				if (!g_pos2.valid) {
-					VERBOSE_TARGET << LVL "Pathfinder: no data for new position: "
-												<< PP(ipos2) << std::endl;
-					direction = getDirHeuristic(directions, g_pos);
-					continue;
-				}
-
-				assert(cost.value > 0);
-
-				int new_cost = current_cost + cost.value;
-
-				// check if there already is a smaller path
-				if ((m_min_target_distance > 0) &&
-						(m_min_target_distance < new_cost)) {
-					DEBUG_OUT(LVL "Pathfinder:"
-							" already longer than best already found path "
-							<< PP(ipos2) << std::endl);
-					return false;
-				}
-
-				if ((g_pos2.totalcost < 0) ||
-						(g_pos2.totalcost > new_cost)) {
-					DEBUG_OUT(LVL "Pathfinder: updating path at: "<<
-							PP(ipos2) << " from: " << g_pos2.totalcost << " to "<<
-							new_cost << " srcdir=" <<
-							PP(invert(direction))<< std::endl);
-					if (updateCostHeuristic(ipos2, invert(direction),
-											new_cost, level)) {
-						retval = true;
-						}
-					}
-				else {
-					DEBUG_OUT(LVL "Pathfinder:"
-							" already found shorter path to: "
-							<< PP(ipos2) << std::endl);
-				}
-			}
-			else {
-				DEBUG_OUT(LVL "Pathfinder:"
-						" not moving to invalid direction: "
-						<< PP(direction) << std::endl);
-			}
-		}
-		else {
-			DEBUG_OUT(LVL "Pathfinder:"
-							" skipping srcdir: "
-							<< PP(direction) << std::endl);
+		if ((testpos.Y >= m_limits.MinEdge.Y) &&
+				(node_at_pos.getContent() != CONTENT_IGNORE) &&
+				isWalkable(node_at_pos) &&
+				(pos2.Y - testpos.Y - 1 <= (int)m_request.max_drop)) {
+			dest = testpos + v3s16(0, 1, 0);
+			cost = 2;
+			return true;
 		}
-		direction = getDirHeuristic(directions, g_pos);
-	}
-	return retval;
-}
-
-/******************************************************************************/
-void Pathfinder::buildPath(std::vector<v3s16> &path, v3s16 pos, int level)
-{
-	level ++;
-	if (level > 700) {
-		ERROR_TARGET
-			<< LVL "Pathfinder: path is too long aborting" << std::endl;
-		return;
+		return false;
 	}
 
-	PathGridnode &g_pos = getIndexElement(pos);
-	if (!g_pos.valid) {
-		ERROR_TARGET
-			<< LVL "Pathfinder: invalid next pos detected aborting" << std::endl;
-		return;
+	// jump up to the surface
+	v3s16 testpos = pos2;
+	MapNode node_at_pos = node_at_pos2;
+	while ((node_at_pos.getContent() != CONTENT_IGNORE) &&
+			isWalkable(node_at_pos) &&
+			(testpos.Y < m_limits.MaxEdge.Y)) {
+		testpos += v3s16(0, 1, 0);
+		node_at_pos = m_map.getNodeNoEx(testpos);
 	}
 
-	g_pos.is_element = true;
-
-	//check if source reached
-	if (g_pos.source) {
-		path.push_back(pos);
-		return;
+	if ((testpos.Y <= m_limits.MaxEdge.Y) &&
+			(node_at_pos.getContent() != CONTENT_IGNORE) &&
+			!isWalkable(node_at_pos) &&
+			(testpos.Y - pos2.Y <= (int)m_request.max_jump)) {
+		dest = testpos;
+		cost = 2;
+		return true;
 	}
-
-	buildPath(path, pos + g_pos.sourcedir, level);
-	path.push_back(pos);
-}
-
-/******************************************************************************/
-v3f Pathfinder::tov3f(v3s16 pos)
-{
-	return v3f(BS * pos.X, BS * pos.Y, BS * pos.Z);
-}
-
-#ifdef PATHFINDER_DEBUG
-
-/******************************************************************************/
-void Pathfinder::printCost()
-{
-	printCost(DIR_XP);
-	printCost(DIR_XM);
-	printCost(DIR_ZP);
-	printCost(DIR_ZM);
-}
-
-/******************************************************************************/
-void Pathfinder::printYdir()
-{
-	printYdir(DIR_XP);
-	printYdir(DIR_XM);
-	printYdir(DIR_ZP);
-	printYdir(DIR_ZM);
+	return false;
 }
 
 /******************************************************************************/
-void Pathfinder::printCost(PathDirections dir)
-{
-	std::cout << "Cost in direction: " << dirToName(dir) << std::endl;
-	std::cout << std::setfill('-') << std::setw(80) << "-" << std::endl;
-	std::cout << std::setfill(' ');
-	for (int y = 0; y < m_max_index_y; y++) {
-
-		std::cout << "Level: " << y << std::endl;
-
-		std::cout << std::setw(4) << " " << "  ";
-		for (int x = 0; x < m_max_index_x; x++) {
-			std::cout << std::setw(4) << x;
+int PathSearch::heuristic(v3s16 pos)
+{
+	if (m_request.algo == PA_DIJKSTRA)
+		return 0;
+	// every move is one node on the xz plane and costs at least 1
+	return abs(pos.X - m_request.destination.X) + abs(pos.Z - m_request.destination.Z);
+}
+
+/******************************************************************************/
+bool PathSearch::findBlockPath(std::vector<v3s16> &blocks)
+{
+	v3s16 min = getNodeBlockPos(m_limits.MinEdge);
+	v3s16 max = getNodeBlockPos(m_limits.MaxEdge);
+	v3s16 start = getNodeBlockPos(m_request.source);
+	v3s16 goal = getNodeBlockPos(m_request.destination);
+
+	unordered_map_v3POS<u8> faces;
+	auto getFaces = [&](v3s16 blockpos) {
+		auto it = faces.find(blockpos);
+		if (it != faces.end())
+			return it->second;
+		u8 f = m_manager->getBlockSummary(blockpos).faces;
+		faces[blockpos] = f;
+		return f;
+	};
+	auto estimate = [&](v3s16 blockpos) {
+		return abs(blockpos.X - goal.X) + abs(blockpos.Y - goal.Y) +
+				abs(blockpos.Z - goal.Z);
+	};
+
+	unordered_map_v3POS<Visit> visited;
+	std::priority_queue<OpenNode> open;
+	visited[start] = {0, start, false};
+	open.push({estimate(start), 0, start});
+
+	while (!open.empty()) {
+		OpenNode current = open.top();
+		open.pop();
+		Visit &visit = visited[current.pos];
+		if (visit.closed || current.cost > visit.cost)
+			continue;
+		visit.closed = true;
+
+		if (current.pos == goal) {
+			for (v3s16 p = goal; p != start; p = visited[p].parent)
+				blocks.push_back(p);
+			blocks.push_back(start);
+			std::reverse(blocks.begin(), blocks.end());
+			return true;
 		}
-		std::cout << std::endl;
-
-		for (int z = 0; z < m_max_index_z; z++) {
-			std::cout << std::setw(4) << z <<": ";
-			for (int x = 0; x < m_max_index_x; x++) {
-				if (getIdxElem(x, y, z).directions[dir].valid)
-					std::cout << std::setw(4)
-						<< getIdxElem(x, y, z).directions[dir].value;
-				else
-					std::cout << std::setw(4) << "-";
-				}
-			std::cout << std::endl;
-		}
-		std::cout << std::endl;
-	}
-}
-
-/******************************************************************************/
-void Pathfinder::printYdir(PathDirections dir)
-{
-	std::cout << "Height difference in direction: " << dirToName(dir) << std::endl;
-	std::cout << std::setfill('-') << std::setw(80) << "-" << std::endl;
-	std::cout << std::setfill(' ');
-	for (int y = 0; y < m_max_index_y; y++) {
 
-		std::cout << "Level: " << y << std::endl;
-
-		std::cout << std::setw(4) << " " << "  ";
-		for (int x = 0; x < m_max_index_x; x++) {
-			std::cout << std::setw(4) << x;
-		}
-		std::cout << std::endl;
-
-		for (int z = 0; z < m_max_index_z; z++) {
-			std::cout << std::setw(4) << z <<": ";
-			for (int x = 0; x < m_max_index_x; x++) {
-				if (getIdxElem(x, y, z).directions[dir].valid)
-					std::cout << std::setw(4)
-						<< getIdxElem(x, y, z).directions[dir].direction;
-				else
-					std::cout << std::setw(4) << "-";
-				}
-			std::cout << std::endl;
+		u8 current_faces = getFaces(current.pos);
+		for (u8 side = 0; side < 6; side++) {
+			if (!(current_faces & (1 << side)))
+				continue;
+			v3s16 next = current.pos + g_sides[side];
+			if (next.X < min.X || next.Y < min.Y || next.Z < min.Z ||
+					next.X > max.X || next.Y > max.Y || next.Z > max.Z)
+				continue;
+			if (!(getFaces(next) & (1 << (side ^ 1))))
+				continue;
+
+			int cost = current.cost + 1;
+			auto ins = visited.insert(std::make_pair(next, Visit{cost, current.pos, false}));
+			if (!ins.second) {
+				if (ins.first->second.closed || ins.first->second.cost <= cost)
+					continue;
+				ins.first->second.cost = cost;
+				ins.first->second.parent = current.pos;
+			}
+			open.push({cost + estimate(next), cost, next});
 		}
-		std::cout << std::endl;
 	}
+	return false;
 }
 
 /******************************************************************************/
-void Pathfinder::printType()
+bool PathSearch::findPath(const unordered_set_v3POS *corridor, std::vector<v3s16> &path)
 {
-	std::cout << "Type of node:" << std::endl;
-	std::cout << std::setfill('-') << std::setw(80) << "-" << std::endl;
-	std::cout << std::setfill(' ');
-	for (int y = 0; y < m_max_index_y; y++) {
+	const v3s16 &start = m_request.source;
+	const v3s16 &goal = m_request.destination;
 
-		std::cout << "Level: " << y << std::endl;
+	unordered_map_v3POS<Visit> visited;
+	std::priority_queue<OpenNode> open;
+	visited[start] = {0, start, false};
+	open.push({heuristic(start), 0, start});
 
-		std::cout << std::setw(3) << " " << "  ";
-		for (int x = 0; x < m_max_index_x; x++) {
-			std::cout << std::setw(3) << x;
-		}
-		std::cout << std::endl;
+	while (!open.empty()) {
+		OpenNode current = open.top();
+		open.pop();
+		Visit &visit = visited[current.pos];
+		if (visit.closed || current.cost > visit.cost)
+			continue;
+		visit.closed = true;
 
-		for (int z = 0; z < m_max_index_z; z++) {
-			std::cout << std::setw(3) << z <<": ";
-			for (int x = 0; x < m_max_index_x; x++) {
-				char toshow = getIdxElem(x, y, z).type;
-				std::cout << std::setw(3) << toshow;
-			}
-			std::cout << std::endl;
+		if (current.pos == goal) {
+			path.clear();
+			for (v3s16 p = goal; p != start; p = visited[p].parent)
+				path.push_back(p);
+			path.push_back(start);
+			std::reverse(path.begin(), path.end());
+			return true;
 		}
-		std::cout << std::endl;
-	}
-	std::cout << std::endl;
-}
 
-/******************************************************************************/
-void Pathfinder::printPathLen()
-{
-	std::cout << "Pathlen:" << std::endl;
-		std::cout << std::setfill('-') << std::setw(80) << "-" << std::endl;
-		std::cout << std::setfill(' ');
-		for (int y = 0; y < m_max_index_y; y++) {
-
-			std::cout << "Level: " << y << std::endl;
-
-			std::cout << std::setw(3) << " " << "  ";
-			for (int x = 0; x < m_max_index_x; x++) {
-				std::cout << std::setw(3) << x;
-			}
-			std::cout << std::endl;
-
-			for (int z = 0; z < m_max_index_z; z++) {
-				std::cout << std::setw(3) << z <<": ";
-				for (int x = 0; x < m_max_index_x; x++) {
-					std::cout << std::setw(3) << getIdxElem(x, y, z).totalcost;
-				}
-				std::cout << std::endl;
+		for (const auto &dir : g_moves) {
+			v3s16 next;
+			int move_cost;
+			if (!move(current.pos, dir, next, move_cost))
+				continue;
+			if (corridor && !corridor->count(getNodeBlockPos(next)))
+				continue;
+
+			int cost = current.cost + move_cost;
+			auto ins = visited.insert(std::make_pair(next, Visit{cost, current.pos, false}));
+			if (!ins.second) {
+				if (ins.first->second.closed || ins.first->second.cost <= cost)
+					continue;
+				ins.first->second.cost = cost;
+				ins.first->second.parent = current.pos;
 			}
-			std::cout << std::endl;
+			open.push({cost + heuristic(next), cost, next});
 		}
-		std::cout << std::endl;
-}
-
-/******************************************************************************/
-std::string Pathfinder::dirToName(PathDirections dir)
-{
-	switch (dir) {
-	case DIR_XP:
-		return "XP";
-		break;
-	case DIR_XM:
-		return "XM";
-		break;
-	case DIR_ZP:
-		return "ZP";
-		break;
-	case DIR_ZM:
-		return "ZM";
-		break;
-	default:
-		return "UKN";
-	}
-}
-
-/******************************************************************************/
-void Pathfinder::printPath(std::vector<v3s16> path)
-{
-	unsigned int current = 0;
-	for (std::vector<v3s16>::iterator i = path.begin();
-			i != path.end(); ++i) {
-		std::cout << std::setw(3) << current << ":" << PP((*i)) << std::endl;
-		current++;
 	}
+	return false;
 }
-
-#endif
@@ -23,26 +23,27 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 /******************************************************************************/
 /* Includes                                                                   */
 /******************************************************************************/
+#include <functional>
+#include <memory>
+#include <unordered_map>
 #include <vector>
 #include "irr_v3d.h"
+#include "threading/mutex.h"
+#include "util/container.h"
+#include "util/unordered_map_hash.h"
 
 /******************************************************************************/
 /* Forward declarations                                                       */
 /******************************************************************************/
 
-class ServerEnvironment;
+class Map;
+class INodeDefManager;
+class PathfinderThread;
 
 /******************************************************************************/
 /* Typedefs and macros                                                        */
 /******************************************************************************/
 
-typedef enum {
-	DIR_XP,
-	DIR_XM,
-	DIR_ZP,
-	DIR_ZM
-} PathDirections;
-
 /** List of supported algorithms */
 typedef enum {
 	PA_DIJKSTRA,           /**< Dijkstra shortest path algorithm             */
@@ -50,17 +51,93 @@ typedef enum {
 	PA_PLAIN_NP          /**< A* algorithm without prefetching of map data */
 } PathAlgorithm;
 
+struct PathRequest {
+	v3s16 source;
+	v3s16 destination;
+	unsigned int searchdistance;
+	unsigned int max_jump;
+	unsigned int max_drop;
+	PathAlgorithm algo;
+
+	bool operator==(const PathRequest &other) const;
+};
+
+struct PathRequestHash {
+	std::size_t operator()(const PathRequest &r) const;
+};
+
 /******************************************************************************/
 /* declarations                                                               */
 /******************************************************************************/
 
-/** c wrapper function to use from scriptapi */
-std::vector<v3s16> get_path(ServerEnvironment *env,
-							v3s16 source,
-							v3s16 destination,
-							unsigned int searchdistance,
-							unsigned int max_jump,
-							unsigned int max_drop,
-							PathAlgorithm algo);
+/*
+	Pathfinder of a server environment (or any map, as in the tests)
+
+	A* over the nodes one can stand in, guided by a coarse A* over map
+	blocks: every block gets a summary of where in it one can stand, blocks
+	next to each other are linked when both can be stood in at the shared
+	face. The node search is then limited to the blocks around the coarse
+	path and only widened to the whole search area when that fails.
+
+	Block summaries are kept until the block changes, found paths until one
+	of the blocks they go through changes, failed searches for a second.
+*/
+
+class PathfinderManager
+{
+public:
+	typedef std::function<void(const std::vector<v3s16> &path)> Callback;
+
+	PathfinderManager(Map &map, INodeDefManager *ndef);
+	~PathfinderManager();
+
+	std::vector<v3s16> getPath(const PathRequest &request);
+	// Searches on the pathfinder thread, callback is called from step()
+	void getPathAsync(const PathRequest &request, Callback callback);
+	// Calls the callbacks of finished asynchronous searches
+	void step();
+
+	struct BlockSummary {
+		u32 changed_seq = 0; // of the block, see MapBlock::m_changed_seq
+		u32 changed_seq_below = 0; // the layer below is in the block below
+		u16 standable = 0; // nodes one can stand in
+		u8 faces = 0; // bit per side having such nodes on its outer layer
+	};
+	BlockSummary getBlockSummary(v3s16 blockpos);
+
+private:
+	struct CachedPath {
+		std::vector<v3s16> path;
+		// Blocks the path goes through and their MapBlock::m_changed_seq
+		std::vector<std::pair<v3s16, u32>> blocks;
+		u32 time_ms;
+	};
+
+	bool getCached(const PathRequest &request, std::vector<v3s16> &path);
+	void addCached(const PathRequest &request, const std::vector<v3s16> &path);
+
+	friend class PathfinderThread;
+	struct AsyncRequest {
+		PathRequest request;
+		Callback callback;
+	};
+	struct AsyncResult {
+		Callback callback;
+		std::vector<v3s16> path;
+	};
+
+	Map &m_map;
+	INodeDefManager *m_ndef;
+
+	Mutex m_summaries_mutex;
+	unordered_map_v3POS<BlockSummary> m_summaries;
+
+	Mutex m_paths_mutex;
+	std::unordered_map<PathRequest, CachedPath, PathRequestHash> m_paths;
+
+	MutexedQueue<AsyncRequest> m_async_requests;
+	MutexedQueue<AsyncResult> m_async_results;
+	std::unique_ptr<PathfinderThread> m_thread;
+};
 
 #endif /* PATHFINDER_H_ */
@@ -0,0 +1,318 @@
+/*
+  This file is part of Freeminer.
+
+  Freeminer is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Freeminer  is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Freeminer.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "player_records.h"
+
+#include <sstream>
+
+#include "content_sao.h"
+#include "exceptions.h"
+#include "key_value_storage.h"
+#include "log.h"
+#include "metrics.h"
+#include "remoteplayer.h"
+#include "threading/thread_pool.h"
+#include "util/serialize.h"
+#include "util/string.h"
+
+#define PLAYER_RECORD_VERSION 1
+
+class PlayerRecordsThread : public thread_pool {
+public:
+	PlayerRecordsThread(PlayerRecords *records) :
+		thread_pool("PlayerRecords"),
+		m_records(records)
+	{}
+
+	void *run()
+	{
+		while (!stopRequested())
+			m_records->writeQueued(100);
+		// What was queued before the stop
+		m_records->writeQueued(0);
+		return nullptr;
+	}
+
+private:
+	PlayerRecords *m_records;
+};
+
+static std::string record_key(const std::string &name)
+{
+	return "pb." + name;
+}
+
+static std::string serialize_header(RemotePlayer *player, PlayerSAO *sao)
+{
+	std::ostringstream os(std::ios_base::binary);
+	writeU8(os, PLAYER_RECORD_VERSION);
+	os << serializeString(player->getName());
+	writeS16(os, sao->getHP());
+	writeU16(os, sao->getBreath());
+	writeV3F1000(os, sao->getBasePosition());
+	writeF1000(os, sao->getPitch());
+	writeF1000(os, sao->getYaw());
+	std::vector<const InventoryList *> lists = player->inventory.getLists();
+	writeU16(os, lists.size());
+	for (const InventoryList *list : lists)
+		os << serializeString(list->getName());
+	return os.str();
+}
+
+static std::string serialize_attributes(PlayerSAO *sao)
+{
+	// Sorted, the same attributes always give the same record
+	const PlayerAttributes &attributes = sao->getExtendedAttributes();
+	std::map<std::string, std::string> sorted(attributes.begin(), attributes.end());
+	std::ostringstream os(std::ios_base::binary);
+	writeU16(os, sorted.size());
+	for (const auto &attribute : sorted) {
+		os << serializeString(attribute.first);
+		os << serializeLongString(attribute.second);
+	}
+	return os.str();
+}
+
+PlayerRecords::PlayerRecords(KeyValueStorage &storage) :
+	m_storage(storage),
+	m_thread(new PlayerRecordsThread(this))
+{
+	m_thread->start();
+}
+
+PlayerRecords::~PlayerRecords()
+{
+	m_thread->stop();
+	m_queue_cv.notify_all();
+	m_thread->join();
+}
+
+u32 PlayerRecords::save(RemotePlayer *player)
+{
+	PlayerSAO *sao = player->getPlayerSAO();
+	if (!sao)
+		return 0;
+	const std::string &name = player->getName();
+	const std::string key = record_key(name);
+	Batch batch;
+
+	std::lock_guard<std::mutex> lock(m_saved_mutex);
+	Saved &saved = m_saved[name];
+
+	std::string header = serialize_header(player, sao);
+	if (header != saved.header) {
+		batch.put[key] = header;
+		saved.header.swap(header);
+	}
+
+	if (sao->extendedAttributesModified() || saved.attributes.empty()) {
+		std::string attributes = serialize_attributes(sao);
+		sao->setExtendedAttributeModified(false);
+		if (attributes != saved.attributes) {
+			batch.put[key + ".a"] = attributes;
+			saved.attributes.swap(attributes);
+		}
+	}
+
+	std::set<std::string> names;
+	for (const InventoryList *list : player->inventory.getLists()) {
+		names.insert(list->getName());
+		auto it = saved.lists.find(list->getName());
+		if (it != saved.lists.end() && it->second == *list)
+			continue;
+		std::ostringstream os(std::ios_base::binary);
+		list->serializeDelta(os, NULL);
+		batch.put[key + ".i." + list->getName()] = os.str();
+		if (it == saved.lists.end())
+			saved.lists.emplace(list->getName(), *list);
+		else
+			it->second = *list;
+	}
+	for (auto it = saved.lists.begin(); it != saved.lists.end(); ) {
+		if (names.count(it->first)) {
+			++it;
+			continue;
+		}
+		batch.del.insert(key + ".i." + it->first);
+		it = saved.lists.erase(it);
+	}
+
+	if (saved.legacy && !batch.empty()) {
+		batch.del.insert("p." + name);
+		saved.legacy = false;
+	}
+
+	u32 records = batch.put.size();
+	if (!batch.empty())
+		queue(batch);
+	return records;
+}
+
+bool PlayerRecords::load(RemotePlayer *player, const std::string &name)
+{
+	// A save of this player may still be on its way
+	flush();
+
+	PlayerSAO *sao = player->getPlayerSAO();
+	const std::string key = record_key(name);
+	std::string header;
+	if (!m_storage.get(key, header) || header.empty()) {
+		Json::Value json;
+		if (!m_storage.get_json("p." + name, json) || json.empty())
+			return false;
+		json >> *player;
+		// Nothing of it is saved in the binary records yet
+		std::lock_guard<std::mutex> lock(m_saved_mutex);
+		Saved &saved = m_saved[name];
+		saved = Saved();
+		saved.legacy = true;
+		return true;
+	}
+
+	std::istringstream is(header, std::ios_base::binary);
+	u8 version = readU8(is);
+	if (version != PLAYER_RECORD_VERSION)
+		throw SerializationError("unsupported player record version " + itos(version));
+	player->m_name = deSerializeString(is);
+	s16 hp = readS16(is);
+	u16 breath = readU16(is);
+	v3f position = readV3F1000(is);
+	f32 pitch = readF1000(is);
+	f32 yaw = readF1000(is);
+	std::vector<std::string> list_names(readU16(is));
+	for (auto &list_name : list_names)
+		list_name = deSerializeString(is);
+	if (is.fail())
+		throw SerializationError("truncated player record of " + name);
+
+	player->inventory.clear();
+	for (const auto &list_name : list_names) {
+		std::string data;
+		if (!m_storage.get(key + ".i." + list_name, data) || data.empty())
+			throw SerializationError("inventory list " + list_name + " of " + name + " not found");
+		InventoryList *list = player->inventory.addList(list_name, 0);
+		if (!list)
+			throw SerializationError("invalid inventory list name: " + list_name);
+		std::istringstream list_is(data, std::ios_base::binary);
+		list->deSerializeDelta(list_is);
+	}
+
+	if (!sao)
+		return true;
+
+	sao->setHPRaw(hp);
+	sao->setBreath(breath);
+	sao->setBasePosition(position);
+	sao->setPitch(pitch);
+	sao->setYaw(yaw);
+
+	std::string attributes;
+	if (m_storage.get(key + ".a", attributes) && !attributes.empty()) {
+		std::istringstream attributes_is(attributes, std::ios_base::binary);
+		for (u16 count = readU16(attributes_is); count; --count) {
+			std::string attribute = deSerializeString(attributes_is);
+			sao->setExtendedAttribute(attribute, deSerializeLongString(attributes_is));
+		}
+	}
+	sao->setExtendedAttributeModified(false);
+
+	remember(player);
+	return true;
+}
+
+void PlayerRecords::remember(RemotePlayer *player)
+{
+	PlayerSAO *sao = player->getPlayerSAO();
+	Saved saved;
+	saved.header = serialize_header(player, sao);
+	saved.attributes = serialize_attributes(sao);
+	for (const InventoryList *list : player->inventory.getLists())
+		saved.lists.emplace(list->getName(), *list);
+
+	std::lock_guard<std::mutex> lock(m_saved_mutex);
+	m_saved[player->getName()] = std::move(saved);
+}
+
+void PlayerRecords::forget(const std::string &name)
+{
+	std::lock_guard<std::mutex> lock(m_saved_mutex);
+	m_saved.erase(name);
+}
+
+void PlayerRecords::queue(Batch &batch)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_queue_mutex);
+		for (auto &record : batch.put) {
+			m_queued.del.erase(record.first);
+			m_queued.put[record.first].swap(record.second);
+		}
+		for (const auto &key : batch.del) {
+			m_queued.put.erase(key);
+			m_queued.del.insert(key);
+		}
+	}
+	m_queue_cv.notify_all();
+}
+
+void PlayerRecords::flush()
+{
+	std::unique_lock<std::mutex> lock(m_queue_mutex);
+	m_queue_cv.wait(lock, [this] { return m_queued.empty() && !m_writing; });
+}
+
+void PlayerRecords::writeQueued(u32 wait_ms)
+{
+	static const auto records_written = g_metrics->counter("freeminer_player_records_written_total",
+			"Player records written");
+	static const auto bytes_written = g_metrics->counter("freeminer_player_record_bytes_written_total",
+			"Bytes of player records written");
+
+	Batch batch;
+	{
+		std::unique_lock<std::mutex> lock(m_queue_mutex);
+		if (m_queued.empty() && wait_ms)
+			m_queue_cv.wait_for(lock, std::chrono::milliseconds(wait_ms));
+		if (m_queued.empty())
+			return;
+		std::swap(batch, m_queued);
+		m_writing = true;
+	}
+
+	bool ok = m_storage.write(batch.put, batch.del);
+	if (ok) {
+		records_written->add(batch.put.size());
+		for (const auto &record : batch.put)
+			bytes_written->add(record.second.size());
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_queue_mutex);
+		m_writing = false;
+	}
+	m_queue_cv.notify_all();
+
+	if (!ok) {
+		if (!m_write_failed)
+			errorstream << "PlayerRecords: writing " << batch.put.size()
+				<< " records failed: " << m_storage.get_error() << std::endl;
+		// Everything is written again by the next saves
+		std::lock_guard<std::mutex> lock(m_saved_mutex);
+		m_saved.clear();
+	}
+	m_write_failed = !ok;
+}
@@ -0,0 +1,107 @@
+/*
+  This file is part of Freeminer.
+
+  Freeminer is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Freeminer  is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Freeminer.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PLAYER_RECORDS_HEADER
+#define PLAYER_RECORDS_HEADER
+
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+
+#include "inventory.h"
+
+class KeyValueStorage;
+class PlayerRecordsThread;
+class RemotePlayer;
+
+/*
+	Players in the "players" key value storage, binary:
+
+	"pb.<name>"           u8 version, string name, s16 hp, u16 breath,
+	                      v3f1000 position, f1000 pitch, f1000 yaw,
+	                      u16 count, count times string inventory list name
+	"pb.<name>.a"         u16 count, count times string attribute name
+	                      and long string value
+	"pb.<name>.i.<list>"  the used slots, see InventoryList::serializeDelta
+
+	What was saved last is kept for every loaded player and a save only
+	writes the records which differ from it, nothing for a player who did
+	nothing. Records are made on the calling thread and written by the
+	storage thread, all records of a save in one batch. Saves queued while
+	the thread is busy are merged, only the last version of a record is
+	written.
+
+	"p.<name>" JSON records of older versions are still read, the first
+	save writes the binary records and removes the JSON one.
+*/
+
+class PlayerRecords
+{
+public:
+	PlayerRecords(KeyValueStorage &storage);
+	// Writes what is queued
+	~PlayerRecords();
+
+	// Queues the records which changed, returns how many
+	u32 save(RemotePlayer *player);
+	// Reads the player (into its PlayerSAO if it has one), false if there
+	// is no record. Throws SerializationError for broken ones.
+	bool load(RemotePlayer *player, const std::string &name);
+	// For players which are not loaded anymore
+	void forget(const std::string &name);
+	// Waits until everything queued is written
+	void flush();
+
+private:
+	friend class PlayerRecordsThread;
+
+	struct Saved {
+		std::string header;
+		std::string attributes;
+		std::map<std::string, InventoryList> lists;
+		// The JSON record is still there
+		bool legacy = false;
+	};
+	struct Batch {
+		std::map<std::string, std::string> put;
+		std::set<std::string> del;
+		bool empty() const { return put.empty() && del.empty(); }
+	};
+
+	void remember(RemotePlayer *player);
+	void queue(Batch &batch);
+	// Called by the storage thread
+	void writeQueued(u32 wait_ms);
+
+	KeyValueStorage &m_storage;
+
+	std::mutex m_saved_mutex;
+	std::map<std::string, Saved> m_saved;
+
+	std::mutex m_queue_mutex;
+	std::condition_variable m_queue_cv;
+	Batch m_queued;
+	bool m_writing = false;
+	bool m_write_failed = false;
+
+	std::unique_ptr<PlayerRecordsThread> m_thread;
+};
+
+#endif
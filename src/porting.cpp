@@ -75,7 +75,7 @@ bool * signal_handler_killstatus(void)
 	return &g_killed;
 }
 
-std::atomic_bool g_sighup, g_siginfo;
+std::atomic_bool g_sighup, g_siginfo, g_sigusr2;
 
 #if !defined(_WIN32) // POSIX
 	#include <signal.h>
@@ -91,6 +91,9 @@ void signal_handler(int sig)
 		case SIGHUP:
 			g_sighup = true;
 		break;
+		case SIGUSR2:
+			g_sigusr2 = true;
+		break;
 		case SIGINT:
 		case SIGTERM:
 
@@ -121,10 +124,12 @@ void signal_handler_init(void)
 {
 	g_sighup = false;
 	g_siginfo = false;
+	g_sigusr2 = false;
 
 	(void)signal(SIGINT, signal_handler);
 	(void)signal(SIGTERM, signal_handler);
 	(void)signal(SIGHUP, signal_handler);
+	(void)signal(SIGUSR2, signal_handler);
 #if defined(SIGINFO)
 	(void)signal(SIGINFO, signal_handler);
 #endif
@@ -157,7 +157,7 @@ void signal_handler_init(void);
 // When the bool is true, program should quit.
 bool * signal_handler_killstatus(void);
 
-extern std::atomic_bool g_sighup, g_siginfo;
+extern std::atomic_bool g_sighup, g_siginfo, g_sigusr2;
 /*
 	Path of static data directory.
 */
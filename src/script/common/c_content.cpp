@@ -1048,6 +1048,7 @@ ToolCapabilities read_tool_capabilities(
 				}
 				lua_pop(L, 1);
 				// Insert groupcap into toolcap
+				groupcap.group_id = itemgroup_id(groupname);
 				toolcap.groupcaps[groupname] = groupcap;
 			}
 			// removes value, keeps key for next iteration
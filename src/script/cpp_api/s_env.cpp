@@ -87,6 +87,45 @@ void ScriptApiEnv::player_event(ServerActiveObject *player, const std::string &t
 	}
 }
 
+void ScriptApiEnv::on_find_path_completion(const std::vector<v3s16> &path,
+	ScriptCallbackState *state)
+{
+	Server *server = getServer();
+
+	// Called from ServerEnvironment::step, envlock is held already
+
+	SCRIPTAPI_PRECHECKHEADER
+
+	int error_handler = PUSH_ERROR_HANDLER(L);
+
+	lua_rawgeti(L, LUA_REGISTRYINDEX, state->callback_ref);
+	luaL_checktype(L, -1, LUA_TFUNCTION);
+
+	if (path.empty()) {
+		lua_pushnil(L);
+	} else {
+		lua_createtable(L, path.size(), 0);
+		for (size_t i = 0; i < path.size(); i++) {
+			push_v3s16(L, path[i]);
+			lua_rawseti(L, -2, i + 1);
+		}
+	}
+	lua_rawgeti(L, LUA_REGISTRYINDEX, state->args_ref);
+
+	setOriginDirect(state->origin.c_str());
+
+	try {
+		PCALL_RES(lua_pcall(L, 2, 0, error_handler));
+	} catch (LuaError &e) {
+		server->setAsyncFatalError(e.what());
+	}
+
+	lua_pop(L, 1); // Pop error handler
+
+	luaL_unref(L, LUA_REGISTRYINDEX, state->callback_ref);
+	luaL_unref(L, LUA_REGISTRYINDEX, state->args_ref);
+}
+
 void ScriptApiEnv::initializeEnvironment(ServerEnvironment *env)
 {
 	SCRIPTAPI_PRECHECKHEADER
@@ -25,6 +25,7 @@ along with Freeminer.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "cpp_api/s_base.h"
 #include "irr_v3d.h"
+#include <vector>
 
 class ServerEnvironment;
 struct ScriptCallbackState;
@@ -45,6 +46,10 @@ class ScriptApiEnv : virtual public ScriptApiBase
 	void on_emerge_area_completion(v3s16 blockpos, int action,
 		ScriptCallbackState *state);
 
+	// Called when a search queued from core.find_path_async() is done
+	void on_find_path_completion(const std::vector<v3s16> &path,
+		ScriptCallbackState *state);
+
 	void initializeEnvironment(ServerEnvironment *env);
 };
 
@@ -672,17 +672,10 @@ int ModApiEnvMod::l_find_node_near(lua_State *L)
 		ndef->getIds(lua_tostring(L, 3), filter);
 	}
 
-	for(int d=1; d<=radius; d++){
-		std::vector<v3s16> list = FacePositionCache::getFacePositions(d);
-		for(std::vector<v3s16>::iterator i = list.begin();
-				i != list.end(); ++i){
-			v3s16 p = pos + (*i);
-			content_t c = env->getMap().getNodeNoEx(p).getContent();
-			if(filter.count(c) != 0){
-				push_v3s16(L, p);
-				return 1;
-			}
-		}
+	v3s16 found;
+	if (env->getMap().findNodeNear(pos, radius, filter, &found)) {
+		push_v3s16(L, found);
+		return 1;
 	}
 	return 0;
 }
@@ -713,18 +706,12 @@ int ModApiEnvMod::l_find_nodes_in_area(lua_State *L)
 
 	std::map<content_t, u16> individual_count;
 
+	std::vector<v3s16> found = env->getMap().findNodesInArea(minp, maxp, filter,
+			&individual_count);
 	lua_newtable(L);
-	u64 i = 0;
-	for (s16 x = minp.X; x <= maxp.X; x++)
-		for (s16 y = minp.Y; y <= maxp.Y; y++)
-			for (s16 z = minp.Z; z <= maxp.Z; z++) {
-				v3s16 p(x, y, z);
-				content_t c = env->getMap().getNodeNoEx(p).getContent();
-				if (filter.count(c) != 0) {
-					push_v3s16(L, p);
-					lua_rawseti(L, -2, ++i);
-					individual_count[c]++;
-				}
+	for (size_t i = 0; i != found.size(); i++) {
+		push_v3s16(L, found[i]);
+		lua_rawseti(L, -2, i + 1);
 	}
 	lua_newtable(L);
 	for (auto it = filter.begin();
@@ -767,23 +754,12 @@ int ModApiEnvMod::l_find_nodes_in_area_under_air(lua_State *L)
 		ndef->getIds(lua_tostring(L, 3), filter);
 	}
 
+	std::vector<v3s16> found = env->getMap().findNodesInAreaUnderAir(minp, maxp,
+			filter);
 	lua_newtable(L);
-	u64 i = 0;
-	for (s16 x = minp.X; x <= maxp.X; x++)
-	for (s16 z = minp.Z; z <= maxp.Z; z++) {
-		s16 y = minp.Y;
-		v3s16 p(x, y, z);
-		content_t c = env->getMap().getNodeNoEx(p).getContent();
-		for (; y <= maxp.Y; y++) {
-			v3s16 psurf(x, y + 1, z);
-			content_t csurf = env->getMap().getNodeNoEx(psurf).getContent();
-			if(c != CONTENT_AIR && csurf == CONTENT_AIR &&
-					filter.count(c) != 0) {
-				push_v3s16(L, v3s16(x, y, z));
-				lua_rawseti(L, -2, ++i);
-			}
-			c = csurf;
-		}
+	for (size_t i = 0; i != found.size(); i++) {
+		push_v3s16(L, found[i]);
+		lua_rawseti(L, -2, i + 1);
 	}
 	return 1;
 }
@@ -971,30 +947,35 @@ int ModApiEnvMod::l_delete_area(lua_State *L)
 	return 1;
 }
 
-// find_path(pos1, pos2, searchdistance,
-//     max_jump, max_drop, algorithm) -> table containing path
-int ModApiEnvMod::l_find_path(lua_State *L)
+static void read_path_request(lua_State *L, PathRequest &request)
 {
-	GET_ENV_PTR;
-
-	v3s16 pos1                  = read_v3s16(L, 1);
-	v3s16 pos2                  = read_v3s16(L, 2);
-	unsigned int searchdistance = luaL_checkint(L, 3);
-	unsigned int max_jump       = luaL_checkint(L, 4);
-	unsigned int max_drop       = luaL_checkint(L, 5);
-	PathAlgorithm algo          = PA_PLAIN_NP;
+	request.source         = read_v3s16(L, 1);
+	request.destination    = read_v3s16(L, 2);
+	request.searchdistance = luaL_checkint(L, 3);
+	request.max_jump       = luaL_checkint(L, 4);
+	request.max_drop       = luaL_checkint(L, 5);
+	request.algo           = PA_PLAIN_NP;
 	if (!lua_isnil(L, 6)) {
 		std::string algorithm = luaL_checkstring(L,6);
 
 		if (algorithm == "A*")
-			algo = PA_PLAIN;
+			request.algo = PA_PLAIN;
 
 		if (algorithm == "Dijkstra")
-			algo = PA_DIJKSTRA;
+			request.algo = PA_DIJKSTRA;
 	}
+}
 
-	std::vector<v3s16> path = get_path(env, pos1, pos2,
-		searchdistance, max_jump, max_drop, algo);
+// find_path(pos1, pos2, searchdistance,
+//     max_jump, max_drop, algorithm) -> table containing path
+int ModApiEnvMod::l_find_path(lua_State *L)
+{
+	GET_ENV_PTR;
+
+	PathRequest request;
+	read_path_request(L, request);
+
+	std::vector<v3s16> path = env->getPathfinder().getPath(request);
 
 	if (path.size() > 0)
 	{
@@ -1014,6 +995,40 @@ int ModApiEnvMod::l_find_path(lua_State *L)
 	return 0;
 }
 
+// find_path_async(pos1, pos2, searchdistance,
+//     max_jump, max_drop, algorithm, callback, param)
+// searches off the server thread, calls callback(path, param) when done
+int ModApiEnvMod::l_find_path_async(lua_State *L)
+{
+	GET_ENV_PTR;
+
+	PathRequest request;
+	read_path_request(L, request);
+	luaL_checktype(L, 7, LUA_TFUNCTION);
+
+	lua_pushvalue(L, 7);
+	int callback_ref = luaL_ref(L, LUA_REGISTRYINDEX);
+
+	lua_pushvalue(L, 8);
+	int args_ref = luaL_ref(L, LUA_REGISTRYINDEX);
+
+	ScriptCallbackState *state = new ScriptCallbackState;
+	state->script       = getServer(L)->getScriptIface();
+	state->callback_ref = callback_ref;
+	state->args_ref     = args_ref;
+	state->refcount     = 1;
+	state->origin       = getScriptApiBase(L)->getOrigin();
+
+	env->getPathfinder().getPathAsync(request,
+		[state](const std::vector<v3s16> &path) {
+			state->refcount--;
+			state->script->on_find_path_completion(path, state);
+			delete state;
+		});
+
+	return 0;
+}
+
 // get_surface(basepos,yoffset,walkable_only=false)
 int ModApiEnvMod::l_get_surface(lua_State *L)
 {
@@ -1191,6 +1206,7 @@ void ModApiEnvMod::Initialize(lua_State *L, int top)
 	API_FCT(clear_objects);
 	API_FCT(spawn_tree);
 	API_FCT(find_path);
+	API_FCT(find_path_async);
 	API_FCT(line_of_sight);
 	API_FCT(transforming_liquid_add);
 	API_FCT(get_heat);
@@ -166,6 +166,10 @@ class ModApiEnvMod : public ModApiBase {
 	//     max_jump, max_drop, algorithm) -> table containing path
 	static int l_find_path(lua_State *L);
 
+	// find_path_async(pos1, pos2, searchdistance,
+	//     max_jump, max_drop, algorithm, callback, param)
+	static int l_find_path_async(lua_State *L);
+
 	// transforming_liquid_add(pos)
 	static int l_transforming_liquid_add(lua_State *L);
 
@@ -28,6 +28,7 @@ along with Freeminer.  If not, see <http://www.gnu.org/licenses/>.
 #include "server.h"
 #include "environment.h"
 #include "player.h"
+#include "tracer.h"
 #include "log.h"
 
 // request_shutdown()
@@ -56,6 +57,28 @@ int ModApiServer::l_get_server_uptime(lua_State *L)
 	return 1;
 }
 
+// trace_enable(enable)
+int ModApiServer::l_trace_enable(lua_State *L)
+{
+	NO_MAP_LOCK_REQUIRED;
+	g_tracer->enable(lua_toboolean(L, 1));
+	return 0;
+}
+
+// trace_dump([name])
+int ModApiServer::l_trace_dump(lua_State *L)
+{
+	NO_MAP_LOCK_REQUIRED;
+	std::string name;
+	if (lua_isstring(L, 1))
+		name = lua_tostring(L, 1);
+	std::string written = getServer(L)->dumpTrace(name);
+	if (written.empty())
+		return 0;
+	lua_pushstring(L, written.c_str());
+	return 1;
+}
+
 
 // print(text)
 int ModApiServer::l_print(lua_State *L)
@@ -520,6 +543,8 @@ void ModApiServer::Initialize(lua_State *L, int top)
 	API_FCT(request_shutdown);
 	API_FCT(get_server_status);
 	API_FCT(get_server_uptime);
+	API_FCT(trace_enable);
+	API_FCT(trace_dump);
 	API_FCT(get_worldpath);
 	API_FCT(is_singleplayer);
 
@@ -36,6 +36,12 @@ class ModApiServer : public ModApiBase {
 	// get_server_uptime()
 	static int l_get_server_uptime(lua_State *L);
 
+	// trace_enable(enable)
+	static int l_trace_enable(lua_State *L);
+
+	// trace_dump([path])
+	static int l_trace_dump(lua_State *L);
+
 	// get_worldpath()
 	static int l_get_worldpath(lua_State *L);
 
@@ -40,6 +40,8 @@ along with Freeminer.  If not, see <http://www.gnu.org/licenses/>.
 #include "genericobject.h"
 #include "settings.h"
 #include "profiler.h"
+#include "tracer.h"
+#include "metrics.h"
 #include "log_types.h"
 #include "scripting_game.h"
 #include "nodedef.h"
@@ -74,6 +76,7 @@ along with Freeminer.  If not, see <http://www.gnu.org/licenses/>.
 #include <chrono>
 #include "threading/thread_pool.h"
 #include "key_value_storage.h"
+#include "player_records.h"
 #include "database.h"
 
 
@@ -218,6 +221,7 @@ Server::Server(
 	m_masterserver_timer = 0.0;
 	//m_emergethread_trigger_timer = 5.0; // to start emerge threads instantly
 	m_savemap_timer = 0.0;
+	m_metrics_timer = 0.0;
 
 	m_step_dtime = 0.0;
 	m_lag = g_settings->getFloat("dedicated_server_step");
@@ -501,6 +505,11 @@ void Server::start(Address bind_addr)
 
 	m_bind_addr = bind_addr;
 
+#if !MINETEST_PROTO
+	// Before the first client has to wait for it
+	getContentDefinitions();
+#endif
+
 	infostream<<"Starting server on "
 			<< bind_addr.serializeString() <<"..."<<std::endl;
 
@@ -661,7 +670,12 @@ void Server::AsyncRunStep(float dtime, bool initial_step)
 		m_uptime.set(m_uptime.get() + dtime);
 	}
 
-	f32 dedicated_server_step = g_settings->getFloat("dedicated_server_step");
+	static CachedSetting<float> dedicated_server_step_setting("dedicated_server_step");
+	static CachedSetting<float> time_speed("time_speed");
+	static CachedSetting<float> time_send_interval("time_send_interval");
+	static CachedSetting<bool> server_announce("server_announce");
+
+	f32 dedicated_server_step = dedicated_server_step_setting;
 	//u32 max_cycle_ms = 1000 * (m_lag > dedicated_server_step ? dedicated_server_step/(m_lag/dedicated_server_step) : dedicated_server_step);
 	u32 max_cycle_ms = 1000 * (dedicated_server_step/(m_lag/dedicated_server_step));
 	if (max_cycle_ms < 40)
@@ -681,7 +695,7 @@ void Server::AsyncRunStep(float dtime, bool initial_step)
 		TimeTaker timer_step("Server step: pdate time of day and overall game time");
 		//MutexAutoLock envlock(m_env_mutex);
 
-		m_env->setTimeOfDaySpeed(g_settings->getFloat("time_speed"));
+		m_env->setTimeOfDaySpeed(time_speed);
 
 		/*
 			Send to clients at constant intervals
@@ -690,9 +704,8 @@ void Server::AsyncRunStep(float dtime, bool initial_step)
 		m_time_of_day_send_timer -= dtime;
 		if(m_time_of_day_send_timer < 0.0)
 		{
-			m_time_of_day_send_timer = g_settings->getFloat("time_send_interval");
+			m_time_of_day_send_timer = time_send_interval;
 			u16 time = m_env->getTimeOfDay();
-			float time_speed = g_settings->getFloat("time_speed");
 			SendTimeOfDay(PEER_ID_INEXISTENT, time, time_speed);
 
 			// bad place, but every 5s ok
@@ -764,7 +777,7 @@ void Server::AsyncRunStep(float dtime, bool initial_step)
 	{
 		float &counter = m_masterserver_timer;
 		if(!isSingleplayer() && (!counter || counter >= 300.0) &&
-				g_settings->getBool("server_announce"))
+				server_announce)
 		{
 			ServerList::sendAnnounce(counter ? "update" : "start",
 					m_bind_addr.getPort(),
@@ -780,6 +793,17 @@ void Server::AsyncRunStep(float dtime, bool initial_step)
 		counter += dtime;
 	}
 
+	// write metrics file for external scrapers
+	{
+		static const float metrics_interval = g_settings->getFloat("metrics_interval");
+		float &counter = m_metrics_timer;
+		counter += dtime;
+		if (metrics_interval > 0 && counter >= metrics_interval) {
+			counter = 0.0;
+			dumpMetrics();
+		}
+	}
+
 	/*
 		Check added and deleted active objects
 	*/
@@ -1269,6 +1293,10 @@ void Server::AsyncRunStep(float dtime, bool initial_step)
 			g_profiler->print(infostream);
 			g_profiler->clear();
 		}
+		if (porting::g_sigusr2) {
+			porting::g_sigusr2 = false;
+			dumpTrace();
+		}
 	}
 }
 
@@ -1289,7 +1317,7 @@ int Server::save(float dtime, float dedicated_server_step, bool breakable) {
 			// Save changed parts of map
 			if(m_env->getMap().save(MOD_STATE_WRITE_NEEDED, dedicated_server_step, breakable)) {
 				// partial save, will continue on next step
-				counter = g_settings->getFloat("server_map_save_interval");
+				counter = save_interval;
 				++ret;
 				if (breakable)
 					goto save_break;
@@ -1326,6 +1354,7 @@ u16 Server::Receive(int ms)
 		auto size = m_con.Receive(&pkt, ms);
 		peer_id = pkt.getPeerId();
 		if (size) {
+			g_metrics->peerReceived(peer_id, size);
 			ProcessData(&pkt);
 			++received;
 		}
@@ -1805,7 +1834,8 @@ void Server::SendMovement(u16 peer_id)
 
 void Server::SendPlayerHPOrDie(PlayerSAO *playersao)
 {
-	if (!g_settings->getBool("enable_damage"))
+	static CachedSetting<bool> enable_damage("enable_damage");
+	if (!enable_damage)
 		return;
 
 	u16 peer_id   = playersao->getPeerID();
@@ -3614,6 +3644,7 @@ Inventory* Server::createDetachedInventory(const std::string &name, const std::s
 	} else {
 		infostream<<"Server creating detached inventory \""<<name<<"\""<<std::endl;
 	}
+	m_detached_inventories_sent.erase(name);
 	Inventory *inv = new Inventory(m_itemdef);
 	assert(inv);
 	m_detached_inventories[name] = inv;
@@ -235,6 +235,12 @@ class Server : public con::PeerHandler, public MapEventReceiver,
 
 	// Connection must be locked when called
 	std::string getStatusString();
+	// Writes the timeline trace, returns written file or empty string on error.
+	// name is a file name in the world directory, paths are refused.
+	std::string dumpTrace(const std::string &name = "");
+	// Write metrics in Prometheus text format, default path is metrics_path,
+	// name is a file name in the world directory like for dumpTrace
+	std::string dumpMetrics(const std::string &name = "");
 	inline double getUptime() const { return m_uptime.m_value; }
 
 	// read shutdown state
@@ -412,6 +418,19 @@ class Server : public con::PeerHandler, public MapEventReceiver,
 	void SendItemDef(u16 peer_id,IItemDefManager *itemdef, u16 protocol_version);
 	void SendNodeDef(u16 peer_id,INodeDefManager *nodedef, u16 protocol_version);
 
+	/*
+		Item and node definitions as sent to clients: serialized and zipped
+		once, with sha1 of the zip data for clients to cache them by.
+		Definitions do not change after mods are loaded.
+	*/
+	struct ContentDefinitions {
+		std::string itemdef_zip;
+		std::string itemdef_sha1;
+		std::string nodedef_zip;
+		std::string nodedef_sha1;
+	};
+	const ContentDefinitions &getContentDefinitions();
+
 	/* mark blocks not sent for all clients */
 	void SetBlocksNotSent(std::map<v3s16, MapBlock *>& block);
 	void SetBlocksNotSent();
@@ -559,6 +578,7 @@ class Server : public con::PeerHandler, public MapEventReceiver,
 	float m_masterserver_timer;
 	//float m_emergethread_trigger_timer;
 	float m_savemap_timer;
+	float m_metrics_timer;
 	IntervalLimiter m_map_timer_and_unload_interval;
 
 	// Environment
@@ -698,6 +718,9 @@ class Server : public con::PeerHandler, public MapEventReceiver,
 	// media files known to server
 	UNORDERED_MAP<std::string, MediaInfo> m_media;
 
+	std::unique_ptr<ContentDefinitions> m_content_definitions;
+	Mutex m_content_definitions_mutex;
+
 	/*
 		Sounds
 	*/
@@ -711,6 +734,8 @@ class Server : public con::PeerHandler, public MapEventReceiver,
 	std::map<std::string, Inventory*> m_detached_inventories;
 	// value = "" (visible to all players) or player name
 	std::map<std::string, std::string> m_detached_inventories_player;
+	// As last sent to all clients, base of delta updates
+	std::map<std::string, std::unique_ptr<Inventory> > m_detached_inventories_sent;
 
 	// freeminer:
 public:
@@ -33,6 +33,7 @@ ServerActiveObject::ServerActiveObject(ServerEnvironment *env, v3f pos):
 	m_static_block(1337,1337,1337),
 	m_messages_out(env ? env->m_active_object_messages : dummy_queue),
 	m_uptime_last(0),
+	m_physics_dtime(0),
 	m_env(env),
 	m_base_position(pos)
 {
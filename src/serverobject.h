@@ -119,6 +119,18 @@ class ServerActiveObject : public ActiveObject
 	*/
 	virtual void step(float dtime, bool send_recommended){}
 
+	/*
+		Movement which does not run Lua, split out of step() so the
+		environment can run it for many objects in parallel.
+		stepPhysics() may only read the world and other objects and keeps
+		its result to itself, applyPhysics() publishes it afterwards on the
+		environment thread. Returns false if there was nothing to do.
+		The time stepped is added to m_physics_dtime, step() moves only by
+		what is left of its own dtime.
+	*/
+	virtual bool stepPhysics(float dtime){ return false; }
+	virtual void applyPhysics(){}
+
 	/*
 		The return value of this is passed to the client-side object
 		when it is created
@@ -253,6 +265,7 @@ class ServerActiveObject : public ActiveObject
 	*/
 	Queue<ActiveObjectMessage> & m_messages_out;
 	float m_uptime_last;
+	float m_physics_dtime;
 
 protected:
 	// Used for creating objects based on type
@@ -159,40 +159,52 @@ bool Settings::readConfigFile(const std::string &filename)
 
 bool Settings::parseConfigLines(std::istream &is, const std::string &end)
 {
-	MutexAutoLock lock(m_mutex);
-
-	std::string line, name, value;
+	std::vector<std::string> changed;
+	bool ok = end.empty();
 
-	while (is.good()) {
-		std::getline(is, line);
-		SettingsParseEvent event = parseConfigObject(line, end, name, value);
+	{
+		MutexAutoLock lock(m_mutex);
 
-		switch (event) {
-		case SPE_NONE:
-		case SPE_INVALID:
-		case SPE_COMMENT:
-			break;
-		case SPE_KVPAIR:
-			m_settings[name] = SettingsEntry(value);
-			break;
-		case SPE_END:
-			return true;
-		case SPE_GROUP: {
-			Settings *group = new Settings;
-			if (!group->parseConfigLines(is, "}")) {
-				delete group;
-				return false;
+		std::string line, name, value;
+
+		while (is.good()) {
+			std::getline(is, line);
+			SettingsParseEvent event = parseConfigObject(line, end, name, value);
+
+			switch (event) {
+			case SPE_NONE:
+			case SPE_INVALID:
+			case SPE_COMMENT:
+				break;
+			case SPE_KVPAIR:
+				m_settings[name] = SettingsEntry(value);
+				changed.push_back(name);
+				break;
+			case SPE_END:
+				ok = true;
+				break;
+			case SPE_GROUP: {
+				Settings *group = new Settings;
+				if (!group->parseConfigLines(is, "}")) {
+					delete group;
+					return false;
+				}
+				m_settings[name] = SettingsEntry(group);
+				break;
 			}
-			m_settings[name] = SettingsEntry(group);
-			break;
-		}
-		case SPE_MULTILINE:
-			m_settings[name] = SettingsEntry(getMultiline(is));
-			break;
+			case SPE_MULTILINE:
+				m_settings[name] = SettingsEntry(getMultiline(is));
+				changed.push_back(name);
+				break;
+			}
+			if (event == SPE_END)
+				break;
 		}
 	}
 
-	return end.empty();
+	for (const auto &name : changed)
+		doCallbacks(name);
+	return ok;
 }
 
 
@@ -801,7 +813,12 @@ bool Settings::set(const std::string &name, const std::string &value)
 
 bool Settings::setDefault(const std::string &name, const std::string &value)
 {
-	return setEntry(name, &value, false, true);
+	if (!setEntry(name, &value, false, true))
+		return false;
+
+	// Also the value while the setting is not set
+	doCallbacks(name);
+	return true;
 }
 
 
@@ -914,17 +931,20 @@ bool Settings::setNoiseParams(const std::string &name,
 
 bool Settings::remove(const std::string &name)
 {
-	MutexAutoLock lock(m_mutex);
+	{
+		MutexAutoLock lock(m_mutex);
 
-	m_json.removeMember(name);
-	SettingEntries::iterator it = m_settings.find(name);
-	if (it != m_settings.end()) {
+		m_json.removeMember(name);
+		SettingEntries::iterator it = m_settings.find(name);
+		if (it == m_settings.end())
+			return false;
 		delete it->second.group;
 		m_settings.erase(it);
-		return true;
-	} else {
-		return false;
 	}
+
+	// Back to the default
+	doCallbacks(name);
+	return true;
 }
 
 
@@ -945,11 +965,13 @@ void Settings::updateValue(const Settings &other, const std::string &name)
 	if (&other == this)
 		return;
 
-	MutexAutoLock lock(m_mutex);
-
 	try {
 		std::string val = other.get(name);
-		m_settings[name] = val;
+		{
+			MutexAutoLock lock(m_mutex);
+			m_settings[name] = val;
+		}
+		doCallbacks(name);
 	} catch (SettingNotFoundException &e) {
 	}
 }
@@ -960,10 +982,20 @@ void Settings::update(const Settings &other)
 	if (&other == this)
 		return;
 
-	MutexAutoLock lock(m_mutex);
-	MutexAutoLock lock2(other.m_mutex);
+	std::vector<std::string> changed;
+	{
+		MutexAutoLock lock(m_mutex);
+		MutexAutoLock lock2(other.m_mutex);
 
-	updateNoLock(other);
+		updateNoLock(other);
+		for (const auto &it : other.m_settings)
+			changed.push_back(it.first);
+		for (const auto &it : other.m_defaults)
+			changed.push_back(it.first);
+	}
+
+	for (const auto &name : changed)
+		doCallbacks(name);
 }
 
 
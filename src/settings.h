@@ -25,6 +25,7 @@ along with Freeminer.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "irrlichttypes_bloated.h"
 #include "util/string.h"
+#include "util/basic_macros.h"
 #include "threading/mutex.h"
 #include <string>
 #include "util/cpp11_container.h"
@@ -35,6 +36,7 @@ along with Freeminer.  If not, see <http://www.gnu.org/licenses/>.
 #include "json/json.h" // for json config values
 #include "msgpack_fix.h"
 #include <stdint.h>
+#include <atomic>
 
 class Settings;
 struct NoiseParams;
@@ -274,4 +276,63 @@ class Settings {
 extern Settings *g_settings;
 extern std::string g_settings_path;
 
+/*
+	Typed setting for hot paths: parsed once, kept up to date by a changed
+	callback, get() is a relaxed atomic load without the settings mutex.
+	set(), setDefault(), remove(), update() and config files call it,
+	clear() does not.
+		static CachedSetting<s16> liquid_relax("liquid_relax");
+		u8 relax = liquid_relax;
+	The setting must exist (have a default) and outlive the handle.
+*/
+template <typename T>
+class CachedSetting
+{
+public:
+	CachedSetting(const std::string &name, Settings *settings = g_settings):
+		m_name(name),
+		m_settings(settings)
+	{
+		// Register first, a change in between is not lost
+		m_settings->registerChangedCallback(m_name, changed, this);
+		update();
+	}
+
+	~CachedSetting()
+	{
+		m_settings->deregisterChangedCallback(m_name, changed, this);
+	}
+
+	T get() const { return m_value.load(std::memory_order_relaxed); }
+	operator T() const { return get(); }
+
+private:
+	static void changed(const std::string &name, void *data)
+	{
+		((CachedSetting<T> *)data)->update();
+	}
+
+	void update() { m_value.store(read(), std::memory_order_relaxed); }
+	T read() const;
+
+	const std::string m_name;
+	Settings *m_settings;
+	std::atomic<T> m_value;
+
+	DISABLE_CLASS_COPY(CachedSetting);
+};
+
+template <> inline bool CachedSetting<bool>::read() const
+	{ return m_settings->getBool(m_name); }
+template <> inline u16 CachedSetting<u16>::read() const
+	{ return m_settings->getU16(m_name); }
+template <> inline s16 CachedSetting<s16>::read() const
+	{ return m_settings->getS16(m_name); }
+template <> inline s32 CachedSetting<s32>::read() const
+	{ return m_settings->getS32(m_name); }
+template <> inline u64 CachedSetting<u64>::read() const
+	{ return m_settings->getU64(m_name); }
+template <> inline float CachedSetting<float>::read() const
+	{ return m_settings->getFloat(m_name); }
+
 #endif
@@ -0,0 +1,96 @@
+/*
+This file is part of Freeminer.
+
+Freeminer is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Freeminer  is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Freeminer.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "threading/worker_pool.h"
+
+#include "log.h"
+
+WorkerPool::WorkerPool(const std::string &name, int threads) :
+	thread_pool(name)
+{
+	if (threads > 0)
+		start(threads);
+}
+
+WorkerPool::~WorkerPool()
+{
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		stop();
+	}
+	m_wake.notify_all();
+	join();
+}
+
+void WorkerPool::forEach(size_t count, const std::function<void(size_t)> &job)
+{
+	if (workers.empty() || count < 2) {
+		for (size_t i = 0; i < count; ++i)
+			job(i);
+		return;
+	}
+
+	auto batch = std::make_shared<Batch>();
+	batch->job = &job;
+	batch->count = count;
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_batch = batch;
+	}
+	m_wake.notify_all();
+
+	work(*batch);
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_done.wait(lock, [&] { return batch->done == batch->count; });
+	m_batch.reset();
+}
+
+void WorkerPool::work(Batch &batch)
+{
+	for (;;) {
+		size_t i = batch.next++;
+		if (i >= batch.count)
+			return;
+		try {
+			(*batch.job)(i);
+		} catch (const std::exception &e) {
+			errorstream << m_name << ": job " << i << " failed: " << e.what() << std::endl;
+		}
+		if (++batch.done == batch.count) {
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_done.notify_all();
+		}
+	}
+}
+
+void *WorkerPool::run()
+{
+	std::shared_ptr<Batch> last;
+	while (!stopRequested()) {
+		std::shared_ptr<Batch> batch;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_wake.wait(lock, [&] { return stopRequested() || (m_batch && m_batch != last); });
+			if (stopRequested())
+				break;
+			batch = last = m_batch;
+		}
+		work(*batch);
+	}
+	return nullptr;
+}
@@ -0,0 +1,62 @@
+/*
+This file is part of Freeminer.
+
+Freeminer is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Freeminer  is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Freeminer.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef THREADING_WORKER_POOL_HEADER
+#define THREADING_WORKER_POOL_HEADER
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+#include "threading/thread_pool.h"
+
+/*
+	Parallel for: forEach(count, job) calls job(0) .. job(count - 1) on the
+	workers and the calling thread and returns when all calls are done.
+	Parts are handed out one at a time, so uneven parts balance themselves.
+	Only one forEach at a time.
+*/
+class WorkerPool : public thread_pool
+{
+public:
+	// threads: workers besides the calling thread
+	WorkerPool(const std::string &name, int threads);
+	~WorkerPool();
+
+	void forEach(size_t count, const std::function<void(size_t)> &job);
+
+	void *run();
+
+private:
+	struct Batch {
+		const std::function<void(size_t)> *job;
+		size_t count;
+		std::atomic_size_t next{0};
+		std::atomic_size_t done{0};
+	};
+	void work(Batch &batch);
+
+	std::mutex m_mutex;
+	std::condition_variable m_wake;
+	std::condition_variable m_done;
+	// Workers late for a batch hold their own reference and find nothing left
+	std::shared_ptr<Batch> m_batch;
+};
+
+#endif
@@ -80,6 +80,7 @@ void ToolCapabilities::deSerialize(std::istream &is)
 			float time = readF1000(is);
 			cap.times[level] = time;
 		}
+		cap.group_id = itemgroup_id(name);
 		groupcaps[name] = cap;
 	}
 	if(version == 2)
@@ -109,14 +110,23 @@ void ToolCapabilities::msgpack_unpack(msgpack::object o)
 	packet[TOOLCAP_MAX_DROP_LEVEL].convert(max_drop_level);
 	packet[TOOLCAP_GROUPCAPS].convert(groupcaps);
 	packet[TOOLCAP_DAMAGEGROUPS].convert(damageGroups);
+	internGroupIds();
 }
 
-DigParams getDigParams(const ItemGroupList &groups,
+void ToolCapabilities::internGroupIds()
+{
+	for (auto &groupcap : groupcaps)
+		groupcap.second.group_id = itemgroup_id(groupcap.first);
+}
+
+DigParams getDigParams(const ItemGroupRatings &groups,
 		const ToolCapabilities *tp, float time_from_last_punch)
 {
 	//infostream<<"getDigParams"<<std::endl;
 	/* Check group dig_immediate */
-	switch(itemgroup_get(groups, "dig_immediate")){
+	static const ItemGroupId dig_immediate = itemgroup_id("dig_immediate");
+	static const ItemGroupId level_id = itemgroup_id("level");
+	switch(itemgroup_get(groups, dig_immediate)){
 	case 2:
 		//infostream<<"dig_immediate=2"<<std::endl;
 		return DigParams(true, 0.5, 0, "dig_immediate");
@@ -133,14 +143,15 @@ DigParams getDigParams(const ItemGroupList &groups,
 	float result_wear = 0.0;
 	std::string result_main_group = "";
 
-	int level = itemgroup_get(groups, "level");
+	int level = itemgroup_get(groups, level_id);
 	//infostream<<"level="<<level<<std::endl;
 	for (ToolGCMap::const_iterator i = tp->groupcaps.begin();
 		 	i != tp->groupcaps.end(); ++i) {
 		const std::string &name = i->first;
 		//infostream<<"group="<<name<<std::endl;
 		const ToolGroupCap &cap = i->second;
-		int rating = itemgroup_get(groups, name);
+		// Interned when the capabilities were read
+		int rating = itemgroup_get(groups, cap.group_id);
 		float time = 0;
 		bool time_exists = cap.getTime(rating, &time);
 		if(!result_diggable || time < result_time){
@@ -172,6 +183,20 @@ DigParams getDigParams(const ItemGroupList &groups,
 }
 
 DigParams getDigParams(const ItemGroupList &groups,
+		const ToolCapabilities *tp, float time_from_last_punch)
+{
+	ItemGroupRatings ratings;
+	ratings.set(groups);
+	return getDigParams(ratings, tp, time_from_last_punch);
+}
+
+DigParams getDigParams(const ItemGroupList &groups,
+		const ToolCapabilities *tp)
+{
+	return getDigParams(groups, tp, 1000000);
+}
+
+DigParams getDigParams(const ItemGroupRatings &groups,
 		const ToolCapabilities *tp)
 {
 	return getDigParams(groups, tp, 1000000);
@@ -43,10 +43,14 @@ struct ToolGroupCap
 	UNORDERED_MAP<int, float> times;
 	int maxlevel;
 	int uses;
+	// Id of the group name it is stored under in ToolCapabilities::groupcaps,
+	// set when the capabilities are read, not serialized
+	ItemGroupId group_id;
 
 	ToolGroupCap():
 		maxlevel(1),
-		uses(20)
+		uses(20),
+		group_id(ITEMGROUP_INVALID)
 	{}
 
 	bool getTime(int rating, float *time) const
@@ -107,7 +111,12 @@ struct ToolCapabilities
 		max_drop_level(max_drop_level_),
 		groupcaps(groupcaps_),
 		damageGroups(damageGroups_)
-	{}
+	{
+		internGroupIds();
+	}
+
+	// Sets ToolGroupCap::group_id of all groupcaps
+	void internGroupIds();
 
 	void serialize(std::ostream &os, u16 version) const;
 	void deSerialize(std::istream &is);
@@ -140,6 +149,13 @@ DigParams getDigParams(const ItemGroupList &groups,
 DigParams getDigParams(const ItemGroupList &groups,
 		const ToolCapabilities *tp);
 
+// Same with the ratings of a registered definition, no string lookups
+DigParams getDigParams(const ItemGroupRatings &groups,
+		const ToolCapabilities *tp, float time_from_last_punch);
+
+DigParams getDigParams(const ItemGroupRatings &groups,
+		const ToolCapabilities *tp);
+
 struct HitParams
 {
 	s16 hp;
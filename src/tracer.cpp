@@ -0,0 +1,174 @@
+/*
+  This file is part of Freeminer.
+
+  Freeminer is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Freeminer  is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Freeminer.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "tracer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+
+#include "log.h"
+#include "threading/mutex_auto_lock.h"
+
+std::atomic_bool g_tracer_enabled(false);
+
+static Tracer main_tracer;
+Tracer *g_tracer = &main_tracer;
+
+static const auto tracer_start = std::chrono::steady_clock::now();
+
+thread_local Tracer::ThreadBuffer *Tracer::t_buffer = nullptr;
+
+Tracer::Tracer() :
+	m_buffer_size(65536)
+{
+}
+
+void Tracer::setBufferSize(u32 spans)
+{
+	MutexAutoLock lock(m_mutex);
+	m_buffer_size = spans ? spans : 1;
+}
+
+void Tracer::enable(bool enable)
+{
+	g_tracer_enabled.store(enable, std::memory_order_relaxed);
+}
+
+u64 Tracer::now()
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(
+			std::chrono::steady_clock::now() - tracer_start).count();
+}
+
+Tracer::ThreadBuffer *Tracer::getThreadBuffer()
+{
+	if (t_buffer)
+		return t_buffer;
+
+	auto buffer = new ThreadBuffer();
+	buffer->thread_name = g_logger.getThreadName();
+	buffer->next = 0;
+	buffer->wrapped = false;
+	{
+		MutexAutoLock lock(m_mutex);
+		buffer->tid = m_buffers.size() + 1;
+		buffer->spans.resize(m_buffer_size);
+		m_buffers.emplace_back(buffer);
+	}
+	t_buffer = buffer;
+	return buffer;
+}
+
+void Tracer::span(const std::string &name, u64 begin, u64 end)
+{
+	auto buffer = getThreadBuffer();
+
+	// Only the owning thread writes, this lock is contended only while dumping
+	MutexAutoLock lock(buffer->mutex);
+	auto &span = buffer->spans[buffer->next];
+	size_t len = std::min(name.size(), sizeof(span.name) - 1);
+	memcpy(span.name, name.c_str(), len);
+	span.name[len] = 0;
+	span.begin = begin;
+	span.duration = end > begin ? end - begin : 0;
+	if (++buffer->next >= buffer->spans.size()) {
+		buffer->next = 0;
+		buffer->wrapped = true;
+	}
+}
+
+static void write_json_string(std::ostream &os, const char *s)
+{
+	os << '"';
+	for (; *s; ++s) {
+		if (*s == '"' || *s == '\\')
+			os << '\\' << *s;
+		else if ((unsigned char)*s < 0x20)
+			os << ' ';
+		else
+			os << *s;
+	}
+	os << '"';
+}
+
+void Tracer::dump(std::ostream &os)
+{
+	std::vector<ThreadBuffer *> buffers;
+	{
+		MutexAutoLock lock(m_mutex);
+		for (auto &buffer : m_buffers)
+			buffers.push_back(buffer.get());
+	}
+
+	os << "{\"traceEvents\":[";
+	bool first = true;
+	std::vector<Span> spans;
+	for (auto buffer : buffers) {
+		{
+			// Copy out so writers are blocked as short as possible
+			MutexAutoLock lock(buffer->mutex);
+			if (buffer->wrapped) {
+				spans.assign(buffer->spans.begin() + buffer->next, buffer->spans.end());
+				spans.insert(spans.end(), buffer->spans.begin(),
+						buffer->spans.begin() + buffer->next);
+			} else {
+				spans.assign(buffer->spans.begin(),
+						buffer->spans.begin() + buffer->next);
+			}
+		}
+
+		if (!first)
+			os << ",";
+		first = false;
+		os << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":"
+			<< buffer->tid << ",\"args\":{\"name\":";
+		write_json_string(os, buffer->thread_name.c_str());
+		os << "}}";
+
+		for (const auto &span : spans) {
+			os << ",\n{\"name\":";
+			write_json_string(os, span.name);
+			os << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->tid
+				<< ",\"ts\":" << span.begin << ",\"dur\":" << span.duration << "}";
+		}
+	}
+	os << "\n],\"displayTimeUnit\":\"ms\"}\n";
+}
+
+bool Tracer::dump(const std::string &path)
+{
+	std::ofstream os(path.c_str(), std::ios_base::binary);
+	if (!os.good()) {
+		errorstream << "Tracer: unable to open " << path << std::endl;
+		return false;
+	}
+	dump(os);
+	actionstream << "Tracer: trace written to " << path << std::endl;
+	return os.good();
+}
+
+void Tracer::clear()
+{
+	MutexAutoLock lock(m_mutex);
+	for (auto &buffer : m_buffers) {
+		MutexAutoLock lock_buffer(buffer->mutex);
+		buffer->next = 0;
+		buffer->wrapped = false;
+	}
+}
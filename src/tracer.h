@@ -0,0 +1,86 @@
+/*
+  This file is part of Freeminer.
+
+  Freeminer is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Freeminer  is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Freeminer.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef TRACER_HEADER
+#define TRACER_HEADER
+
+#include <atomic>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "irrlichttypes.h"
+#include "threading/mutex.h"
+
+/*
+	Timeline tracer
+
+	Every TimeTaker (and so every ScopeProfiler) records a begin/end span
+	into a ring buffer owned by the current thread while tracing is on.
+	Buffers are dumped in Chrome trace event format, viewable in
+	chrome://tracing or ui.perfetto.dev.
+	When tracing is off the only cost is one relaxed atomic load per TimeTaker.
+*/
+
+extern std::atomic_bool g_tracer_enabled;
+
+class Tracer
+{
+public:
+	struct Span {
+		char name[48];
+		u64 begin;    // us since tracer start
+		u32 duration; // us
+	};
+
+	Tracer();
+
+	// Number of spans kept per thread, applies to threads registered later
+	void setBufferSize(u32 spans);
+	void enable(bool enable);
+
+	static u64 now();
+
+	void span(const std::string &name, u64 begin, u64 end);
+
+	void dump(std::ostream &os);
+	bool dump(const std::string &path);
+	void clear();
+
+private:
+	struct ThreadBuffer {
+		Mutex mutex;
+		std::string thread_name;
+		u32 tid;
+		std::vector<Span> spans;
+		u32 next;
+		bool wrapped;
+	};
+
+	ThreadBuffer *getThreadBuffer();
+
+	static thread_local ThreadBuffer *t_buffer;
+
+	Mutex m_mutex;
+	std::vector<std::unique_ptr<ThreadBuffer>> m_buffers;
+	u32 m_buffer_size;
+};
+
+extern Tracer *g_tracer;
+
+#endif
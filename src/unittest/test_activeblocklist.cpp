@@ -0,0 +1,132 @@
+/*
+  This file is part of Freeminer.
+
+  Freeminer is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Freeminer  is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Freeminer.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "test.h"
+
+#include "environment.h"
+#include "noise.h"
+
+class TestActiveBlockList : public TestBase {
+public:
+	TestActiveBlockList() { TestManager::registerTestModule(this); }
+	const char *getName() { return "TestActiveBlockList"; }
+
+	void runTests(IGameDef *gamedef);
+
+	void testMoveAndLeave();
+	void testRandomWalk();
+};
+
+static TestActiveBlockList g_test_instance;
+
+void TestActiveBlockList::runTests(IGameDef *gamedef)
+{
+	TEST(testMoveAndLeave);
+	TEST(testRandomWalk);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// What the list has to contain, built from scratch
+static std::set<v3s16> expected_blocks(const std::vector<v3s16> &positions,
+		s16 radius, const std::set<v3s16> &forceloaded)
+{
+	std::set<v3s16> blocks = forceloaded;
+	for (const auto &p0 : positions) {
+		v3s16 p;
+		for (p.X = p0.X - radius; p.X <= p0.X + radius; p.X++)
+		for (p.Y = p0.Y - radius; p.Y <= p0.Y + radius; p.Y++)
+		for (p.Z = p0.Z - radius; p.Z <= p0.Z + radius; p.Z++)
+			if (p.getDistanceFrom(p0) <= radius)
+				blocks.insert(p);
+	}
+	return blocks;
+}
+
+void TestActiveBlockList::testMoveAndLeave()
+{
+	ActiveBlockList list;
+	std::set<v3s16> removed, added;
+
+	std::vector<v3s16> positions = {v3s16(0, 0, 0)};
+	const auto around_zero = expected_blocks(positions, 1, {});
+	list.update(positions, 1, removed, added);
+	UASSERT(added == around_zero);
+	UASSERTEQ(size_t, removed.size(), 0);
+	UASSERT(list.contains(v3s16(0, 1, 0)));
+
+	// A second player on the same block changes nothing
+	added.clear();
+	positions.push_back(v3s16(0, 0, 0));
+	list.update(positions, 1, removed, added);
+	UASSERTEQ(size_t, added.size(), 0);
+
+	// One of them moves on, the block stays for the other
+	positions[1] = v3s16(2, 0, 0);
+	list.update(positions, 1, removed, added);
+	UASSERTEQ(size_t, removed.size(), 0);
+	UASSERT(list.contains(v3s16(2, 0, 0)));
+	UASSERT(list.contains(v3s16(-1, 0, 0)));
+
+	positions.pop_back();
+	removed.clear();
+	added.clear();
+	list.update(positions, 1, removed, added);
+	UASSERTEQ(size_t, added.size(), 0);
+	UASSERTEQ(size_t, removed.size(),
+			expected_blocks({v3s16(0, 0, 0), v3s16(2, 0, 0)}, 1, {}).size() - around_zero.size());
+	UASSERT(!list.contains(v3s16(2, 0, 0)));
+
+	// Not loadable, offered again by the next update
+	list.setMissing(v3s16(0, 0, 0));
+	UASSERT(!list.contains(v3s16(0, 0, 0)));
+	list.update(positions, 1, removed, added);
+	UASSERT(added.count(v3s16(0, 0, 0)));
+	UASSERT(list.contains(v3s16(0, 0, 0)));
+}
+
+void TestActiveBlockList::testRandomWalk()
+{
+	PcgRandom rand(42);
+	ActiveBlockList list;
+	std::vector<v3s16> positions(20);
+	for (auto &p : positions)
+		p = v3s16(rand.range(-10, 10), rand.range(-3, 3), rand.range(-10, 10));
+
+	std::set<v3s16> active;
+	for (int step = 0; step < 100; ++step) {
+		for (auto &p : positions)
+			if (!(rand.next() % 3))
+				p.X += rand.range(-1, 1);
+		s16 radius = step < 50 ? 2 : 3;
+		if (step % 10 == 0)
+			list.m_forceloaded_list.insert(v3s16(step, 20, 0));
+		if (step % 10 == 5)
+			list.m_forceloaded_list.erase(v3s16(step - 5, 20, 0));
+
+		std::set<v3s16> removed, added;
+		list.update(positions, radius, removed, added);
+		for (const auto &p : removed)
+			UASSERT(active.erase(p));
+		for (const auto &p : added)
+			UASSERT(active.insert(p).second);
+
+		auto expected = expected_blocks(positions, radius, list.m_forceloaded_list);
+		UASSERT(active == expected);
+		UASSERTEQ(size_t, list.m_list.size(), expected.size());
+	}
+}
@@ -0,0 +1,172 @@
+/*
+  This file is part of Freeminer.
+
+  Freeminer is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Freeminer  is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Freeminer.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "test.h"
+
+#include "gamedef.h"
+#include "map.h"
+#include "mapgen.h"
+#include "mg_biome.h"
+#include "nodedef.h"
+#include "cavegen.h"
+
+class TestCavegen : public TestBase {
+public:
+	TestCavegen() { TestManager::registerTestModule(this); }
+	const char *getName() { return "TestCavegen"; }
+
+	void runTests(IGameDef *gamedef);
+
+	void testNoiseIntersectionIsScalar(IGameDef *gamedef);
+};
+
+static TestCavegen g_test_instance;
+
+void TestCavegen::runTests(IGameDef *gamedef)
+{
+	TEST(testNoiseIntersectionIsScalar, gamedef);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// CavesNoiseIntersection::generateCaves() as it was, per node
+static void carve_scalar(INodeDefManager *ndef, MMVManip *vm, v3s16 nmin,
+	v3s16 nmax, Biome *biome, Noise *noise_cave1, Noise *noise_cave2,
+	float cave_width)
+{
+	const v3s16 csize = nmax - nmin + v3s16(1, 1, 1);
+	const u32 ystride = csize.X;
+	const u32 zstride_1d = csize.X * (csize.Y + 1);
+	v3s16 em = vm->m_area.getExtent();
+
+	for (s16 z = nmin.Z; z <= nmax.Z; z++)
+	for (s16 x = nmin.X; x <= nmax.X; x++) {
+		bool column_is_open = false;
+		bool is_under_river = false;
+		bool is_tunnel = false;
+		u32 vi = vm->m_area.index(x, nmax.Y, z);
+		u32 index3d = (z - nmin.Z) * zstride_1d + csize.Y * ystride + (x - nmin.X);
+
+		for (s16 y = nmax.Y; y >= nmin.Y - 1; y--,
+				index3d -= ystride,
+				vm->m_area.add_y(em, vi, -1)) {
+			content_t c = vm->m_data[vi].getContent();
+			if (c == CONTENT_AIR || c == biome->c_water_top ||
+					c == biome->c_water) {
+				column_is_open = true;
+				continue;
+			} else if (c == biome->c_river_water) {
+				column_is_open = true;
+				is_under_river = true;
+				continue;
+			}
+			float d1 = contour(noise_cave1->result[index3d]);
+			float d2 = contour(noise_cave2->result[index3d]);
+
+			if (d1 * d2 > cave_width && ndef->get(c).is_ground_content) {
+				vm->m_data[vi] = MapNode(CONTENT_AIR);
+				is_tunnel = true;
+			} else {
+				if (is_tunnel && column_is_open &&
+						(c == biome->c_filler || c == biome->c_stone)) {
+					if (is_under_river)
+						vm->m_data[vi] = MapNode(biome->c_riverbed);
+					else
+						vm->m_data[vi] = MapNode(biome->c_top);
+				}
+				column_is_open = false;
+				is_tunnel = false;
+			}
+		}
+	}
+}
+
+void TestCavegen::testNoiseIntersectionIsScalar(IGameDef *gamedef)
+{
+	INodeDefManager *ndef = gamedef->getNodeDefManager();
+	const v3s16 csize(32, 32, 32);
+	const v3s16 nmin(-16, -16, -16);
+	const v3s16 nmax = nmin + csize - v3s16(1, 1, 1);
+	NoiseParams np_cave1(0, 12, v3f(16, 16, 16), 52534, 3, 0.5, 2.0);
+	NoiseParams np_cave2(0, 12, v3f(16, 16, 16), 10325, 3, 0.5, 2.0);
+	const s32 seed = 1234;
+	const float cave_width = 0.09;
+
+	BiomeManager bmgr(gamedef);
+	Biome *biome = new Biome;
+	biome->c_top         = t_CONTENT_GRASS;
+	biome->c_filler      = t_CONTENT_STONE;
+	biome->c_stone       = t_CONTENT_STONE;
+	biome->c_water_top   = t_CONTENT_WATER;
+	biome->c_water       = t_CONTENT_WATER;
+	biome->c_river_water = t_CONTENT_LAVA;
+	biome->c_riverbed    = t_CONTENT_BRICK;
+	bmgr.add(biome);
+	std::vector<u8> biomemap(csize.X * csize.Z, biome->index);
+
+	// Ground of stone with bricks that are not ground content, rivers and
+	// a lake above it
+	MMVManip start(NULL);
+	start.addArea(VoxelArea(nmin - v3s16(1, 1, 1), nmax + v3s16(1, 1, 1)));
+	for (s16 z = start.m_area.MinEdge.Z; z <= start.m_area.MaxEdge.Z; z++)
+	for (s16 x = start.m_area.MinEdge.X; x <= start.m_area.MaxEdge.X; x++) {
+		s16 ground = 4 + (x * 5 + z * 3) % 7;
+		for (s16 y = start.m_area.MinEdge.Y; y <= start.m_area.MaxEdge.Y; y++) {
+			content_t c = CONTENT_AIR;
+			if (y == ground)
+				c = t_CONTENT_GRASS;
+			else if (y < ground)
+				c = (x + y + z) % 13 ? t_CONTENT_STONE : t_CONTENT_BRICK;
+			else if (y < 8)
+				c = x % 9 == 0 ? t_CONTENT_LAVA : z < 0 ? t_CONTENT_WATER : CONTENT_AIR;
+			start.setNodeNoRef(v3s16(x, y, z), MapNode(c));
+		}
+	}
+
+	auto copy = [&](MMVManip &vm) {
+		vm.addArea(start.m_area);
+		vm.copyFrom(start.m_data, start.m_area, start.m_area.MinEdge,
+			start.m_area.MinEdge, start.m_area.getExtent());
+	};
+
+	MMVManip scalar(NULL);
+	copy(scalar);
+	Noise noise_cave1(&np_cave1, seed, csize.X, csize.Y + 1, csize.Z);
+	Noise noise_cave2(&np_cave2, seed, csize.X, csize.Y + 1, csize.Z);
+	noise_cave1.perlinMap3D(nmin.X, nmin.Y - 1, nmin.Z);
+	noise_cave2.perlinMap3D(nmin.X, nmin.Y - 1, nmin.Z);
+	carve_scalar(ndef, &scalar, nmin, nmax, biome, &noise_cave1, &noise_cave2,
+		cave_width);
+
+	// Twice with the same instance, it is kept by the mapgen
+	GroundContentLookup ground_content(ndef);
+	CavesNoiseIntersection caves(ndef, &bmgr, csize, &np_cave1, &np_cave2,
+		seed, cave_width, &ground_content);
+	for (int pass = 0; pass != 2; pass++) {
+		MMVManip vm(NULL);
+		copy(vm);
+		caves.generateCaves(&vm, nmin, nmax, &biomemap[0]);
+
+		u32 carved = 0;
+		for (u32 i = 0; i != start.m_area.getVolume(); i++) {
+			UASSERTEQ(content_t, vm.m_data[i].getContent(),
+				scalar.m_data[i].getContent());
+			carved += vm.m_data[i].getContent() != start.m_data[i].getContent();
+		}
+		UASSERT(carved > 0);
+	}
+}
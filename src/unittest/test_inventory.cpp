@@ -32,6 +32,7 @@ class TestInventory : public TestBase {
 	void runTests(IGameDef *gamedef);
 
 	void testSerializeDeserialize(IItemDefManager *idef);
+	void testDelta(IItemDefManager *idef);
 
 	static const char *serialized_inventory;
 	static const char *serialized_inventory_2;
@@ -42,6 +43,7 @@ static TestInventory g_test_instance;
 void TestInventory::runTests(IGameDef *gamedef)
 {
 	TEST(testSerializeDeserialize, gamedef->getItemDefManager());
+	TEST(testDelta, gamedef->getItemDefManager());
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -66,6 +68,39 @@ void TestInventory::testSerializeDeserialize(IItemDefManager *idef)
 	UASSERTEQ(std::string, inv_os.str(), serialized_inventory_2);
 }
 
+void TestInventory::testDelta(IItemDefManager *idef)
+{
+	Inventory server(idef);
+	std::istringstream is(serialized_inventory, std::ios::binary);
+	server.deSerialize(is);
+	Inventory client(server);
+	Inventory sent(server);
+
+	server.getList("0")->changeItem(1, ItemStack("default:stone", 5, 0, "", idef));
+	server.getList("0")->deleteItem(9);
+	server.addList("craft", 9)->setWidth(3);
+
+	std::ostringstream delta_os(std::ios::binary);
+	server.serializeDelta(delta_os, sent);
+	std::ostringstream full_os(std::ios::binary);
+	server.serialize(full_os);
+	UASSERT(delta_os.str().size() < full_os.str().size() / 2);
+
+	std::istringstream delta_is(delta_os.str(), std::ios::binary);
+	client.deSerializeDelta(delta_is);
+	UASSERT(client == server);
+
+	// Removed list, nothing else changed
+	sent = server;
+	server.deleteList("craft");
+	std::ostringstream delta2_os(std::ios::binary);
+	server.serializeDelta(delta2_os, sent);
+	std::istringstream delta2_is(delta2_os.str(), std::ios::binary);
+	client.deSerializeDelta(delta2_is);
+	UASSERT(client == server);
+	UASSERT(!client.getList("craft"));
+}
+
 const char *TestInventory::serialized_inventory =
 	"List 0 32\n"
 	"Width 3\n"
@@ -0,0 +1,158 @@
+/*
+  This file is part of Freeminer.
+
+  Freeminer is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Freeminer  is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Freeminer.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "test.h"
+
+#include "gamedef.h"
+#include "map.h"
+#include "mapblock.h"
+#include "metrics.h"
+
+class TestMap : public TestBase {
+public:
+	TestMap() { TestManager::registerTestModule(this); }
+	const char *getName() { return "TestMap"; }
+
+	void runTests(IGameDef *gamedef);
+
+	void testFindNodes(IGameDef *gamedef);
+};
+
+static TestMap g_test_instance;
+
+void TestMap::runTests(IGameDef *gamedef)
+{
+	TEST(testFindNodes, gamedef);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Node by node, as find_nodes_in_area read them before the summaries
+static std::vector<v3s16> find_nodes_naive(Map &map, v3s16 minp, v3s16 maxp,
+	const std::unordered_set<content_t> &filter)
+{
+	std::vector<v3s16> found;
+	for (s16 x = minp.X; x <= maxp.X; x++)
+	for (s16 y = minp.Y; y <= maxp.Y; y++)
+	for (s16 z = minp.Z; z <= maxp.Z; z++)
+		if (filter.count(map.getNodeNoEx(v3s16(x, y, z)).getContent()))
+			found.push_back(v3s16(x, y, z));
+	return found;
+}
+
+static std::vector<v3s16> find_nodes_under_air_naive(Map &map, v3s16 minp,
+	v3s16 maxp, const std::unordered_set<content_t> &filter)
+{
+	std::vector<v3s16> found;
+	for (s16 x = minp.X; x <= maxp.X; x++)
+	for (s16 z = minp.Z; z <= maxp.Z; z++)
+	for (s16 y = minp.Y; y <= maxp.Y; y++) {
+		content_t c = map.getNodeNoEx(v3s16(x, y, z)).getContent();
+		content_t above = map.getNodeNoEx(v3s16(x, y + 1, z)).getContent();
+		if (c != CONTENT_AIR && above == CONTENT_AIR && filter.count(c))
+			found.push_back(v3s16(x, y, z));
+	}
+	return found;
+}
+
+void TestMap::testFindNodes(IGameDef *gamedef)
+{
+	static const auto skipped = g_metrics->counter("freeminer_find_nodes_blocks_skipped_total",
+		"Blocks find_node* calls did not read, none of their contents matching");
+
+	// 2x3x2 blocks, the top one of x = z = 1 missing:
+	// - bottom: stone up to a height changing with x and z, reaching the
+	//   top node of the block in some columns
+	// - middle: air, a stone on the top node of x = z = 1 and one on the
+	//   first z of x = 0, z = 1, right after a block without any
+	// - top: stone on the bottom layer of every third x, water above it
+	//   in every second z, so some of the first nodes after the skipped
+	//   middle blocks are under air
+	Map map(gamedef);
+	for (s16 bz = 0; bz != 2; bz++)
+	for (s16 by = 0; by != 3; by++)
+	for (s16 bx = 0; bx != 2; bx++) {
+		v3s16 blockpos(bx, by, bz);
+		if (blockpos == v3s16(1, 2, 1))
+			continue;
+		MapBlock *block = map.createBlankBlock(blockpos);
+		for (s16 z = 0; z < MAP_BLOCKSIZE; z++)
+		for (s16 y = 0; y < MAP_BLOCKSIZE; y++)
+		for (s16 x = 0; x < MAP_BLOCKSIZE; x++) {
+			v3s16 p = blockpos * MAP_BLOCKSIZE + v3s16(x, y, z);
+			MapNode n(CONTENT_AIR);
+			if (by == 0 && p.Y < 10 + (p.X + p.Z) % 7)
+				n = MapNode(t_CONTENT_STONE);
+			else if (by == 1 && (p == v3s16(20, 31, 25) || p == v3s16(5, 20, 16)))
+				n = MapNode(t_CONTENT_STONE);
+			else if (by == 2 && y == 0 && p.X % 3 == 0)
+				n = MapNode(t_CONTENT_STONE);
+			else if (by == 2 && y == 1 && p.Z % 2 == 0)
+				n = MapNode(t_CONTENT_WATER);
+			block->setNodeNoCheck(v3s16(x, y, z), n);
+		}
+	}
+
+	const std::unordered_set<content_t> stone = {t_CONTENT_STONE};
+	const std::unordered_set<content_t> water = {t_CONTENT_WATER};
+	const v3s16 areas[][2] = {
+		// Every block, starting and ending on block edges
+		{v3s16(0, 0, 0), v3s16(31, 47, 31)},
+		// Starting and ending within blocks
+		{v3s16(3, 5, 7), v3s16(28, 40, 20)},
+		{v3s16(-2, 14, 9), v3s16(33, 33, 30)},
+		// Too little of its blocks for the summaries
+		{v3s16(18, 28, 22), v3s16(22, 33, 27)},
+	};
+
+	const u64 skipped_before = skipped->get();
+	for (const auto &area : areas) {
+		for (const auto &filter : {stone, water}) {
+			std::map<content_t, u16> count;
+			std::vector<v3s16> found = map.findNodesInArea(area[0], area[1],
+					filter, &count);
+			std::vector<v3s16> expected = find_nodes_naive(map, area[0],
+					area[1], filter);
+			UASSERT(found == expected);
+			UASSERTEQ(size_t, count[*filter.begin()], expected.size());
+
+			UASSERT(map.findNodesInAreaUnderAir(area[0], area[1], filter) ==
+					find_nodes_under_air_naive(map, area[0], area[1], filter));
+		}
+	}
+	// The middle and top blocks without stone, the bottom ones without water
+	UASSERT(skipped->get() > skipped_before);
+
+	const u64 small_before = skipped->get();
+	UASSERT(map.findNodesInArea(v3s16(20, 30, 25), v3s16(20, 31, 25), stone) ==
+			std::vector<v3s16>{v3s16(20, 31, 25)});
+	UASSERTEQ(u64, skipped->get(), small_before);
+
+	v3s16 found;
+	UASSERT(map.findNodeNear(v3s16(20, 28, 25), 4, stone, &found));
+	UASSERT(found == v3s16(20, 31, 25));
+	UASSERT(!map.findNodeNear(v3s16(8, 24, 8), 4, stone, &found));
+	UASSERT(map.findNodeNear(v3s16(8, 24, 8), 12, stone, &found));
+	UASSERTEQ(content_t, map.getNodeNoEx(found).getContent(), t_CONTENT_STONE);
+
+	// A node set later is found, the summary of its block is made again
+	MapNode n(t_CONTENT_STONE);
+	map.getBlockNoCreateNoEx(v3s16(0, 1, 0))->setNodeNoCheck(v3s16(4, 8, 2), n);
+	std::vector<v3s16> all = map.findNodesInArea(v3s16(0, 16, 0),
+			v3s16(15, 31, 15), stone);
+	UASSERT(all == std::vector<v3s16>{v3s16(4, 24, 2)});
+}
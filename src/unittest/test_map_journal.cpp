@@ -0,0 +1,102 @@
+/*
+  This file is part of Freeminer.
+
+  Freeminer is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Freeminer  is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Freeminer.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "test.h"
+
+#include "filesys.h"
+#include "map_journal.h"
+
+class TestMapJournal : public TestBase {
+public:
+	TestMapJournal() { TestManager::registerTestModule(this); }
+	const char *getName() { return "TestMapJournal"; }
+
+	void runTests(IGameDef *gamedef);
+
+	void testTakePutBack();
+	void testRecovery();
+};
+
+static TestMapJournal g_test_instance;
+
+void TestMapJournal::runTests(IGameDef *gamedef)
+{
+	TEST(testTakePutBack);
+	TEST(testRecovery);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void TestMapJournal::testTakePutBack()
+{
+	MapJournal journal;
+	journal.add(v3POS(1, 2, 3));
+	journal.add(v3POS(4, 5, 6));
+	journal.add(v3POS(1, 2, 3));
+	UASSERTEQ(size_t, journal.size(), 2);
+
+	std::vector<MapJournal::Entry> dirty;
+	journal.take(dirty);
+	UASSERTEQ(size_t, journal.size(), 0);
+	UASSERTEQ(size_t, dirty.size(), 2);
+	UASSERT(dirty[0].pos == v3POS(1, 2, 3));
+	UASSERT(dirty[0].seq < dirty[1].seq);
+
+	journal.putBack(dirty[1]);
+	journal.checkpoint();
+	UASSERTEQ(size_t, journal.size(), 1);
+}
+
+void TestMapJournal::testRecovery()
+{
+	std::string path = getTestTempFile();
+	fs::DeleteSingleFileOrEmptyDirectory(path);
+
+	{
+		MapJournal journal;
+		UASSERTEQ(size_t, journal.open(path), 0);
+		journal.add(v3POS(1, 0, 0));
+		journal.add(v3POS(2, 0, 0));
+		std::vector<MapJournal::Entry> dirty;
+		journal.take(dirty);
+		// (1,0,0) saved, (2,0,0) not
+		journal.putBack(dirty[1]);
+		journal.checkpoint();
+		journal.add(v3POS(3, 0, 0));
+		// Server dies here
+		journal.flush();
+		journal.close();
+	}
+
+	{
+		MapJournal journal;
+		UASSERTEQ(size_t, journal.open(path), 2);
+		UASSERT(!journal.takeUnsaved(v3POS(1, 0, 0)));
+		UASSERT(journal.takeUnsaved(v3POS(2, 0, 0)));
+		UASSERT(!journal.takeUnsaved(v3POS(2, 0, 0)));
+		UASSERT(journal.takeUnsaved(v3POS(3, 0, 0)));
+		journal.close();
+	}
+
+	// Clean run leaves nothing behind
+	{
+		MapJournal journal;
+		UASSERTEQ(size_t, journal.open(path), 0);
+	}
+
+	fs::DeleteSingleFileOrEmptyDirectory(path);
+}
@@ -0,0 +1,101 @@
+/*
+  This file is part of Freeminer.
+
+  Freeminer is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Freeminer  is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Freeminer.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "test.h"
+
+#include "gamedef.h"
+#include "mapblock.h"
+#include "voxel.h"
+
+class TestMapBlock : public TestBase {
+public:
+	TestMapBlock() { TestManager::registerTestModule(this); }
+	const char *getName() { return "TestMapBlock"; }
+
+	void runTests(IGameDef *gamedef);
+
+	void testContentSummary(IGameDef *gamedef);
+};
+
+static TestMapBlock g_test_instance;
+
+void TestMapBlock::runTests(IGameDef *gamedef)
+{
+	TEST(testContentSummary, gamedef);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Sets every node of the block to fill(relative position)
+template <typename F>
+static void fill_block(MapBlock &block, F fill)
+{
+	v3s16 pos = block.getPosRelative();
+	VoxelManipulator vm;
+	vm.addArea(VoxelArea(pos, pos + v3s16(1, 1, 1) * (MAP_BLOCKSIZE - 1)));
+	for (s16 z = 0; z < MAP_BLOCKSIZE; z++)
+	for (s16 y = 0; y < MAP_BLOCKSIZE; y++)
+	for (s16 x = 0; x < MAP_BLOCKSIZE; x++)
+		vm.setNodeNoRef(pos + v3s16(x, y, z), fill(v3s16(x, y, z)));
+	block.copyFrom(vm);
+}
+
+void TestMapBlock::testContentSummary(IGameDef *gamedef)
+{
+	MapBlock block(NULL, v3s16(1, -2, 3), gamedef);
+
+	auto summary = block.getContentSummary();
+	UASSERT(summary->contents.size() == 1);
+	UASSERTEQ(u16, summary->count(CONTENT_IGNORE), MapBlock::nodecount);
+	UASSERTEQ(int, summary->min_y, -1);
+	UASSERT(!summary->all_air && !summary->all_solid && !summary->has_liquid);
+
+	// Stone below 4, a row of water on it
+	fill_block(block, [](v3s16 p) {
+		if (p.Y < 4)
+			return MapNode(t_CONTENT_STONE);
+		if (p.Y == 4 && p.X == 0)
+			return MapNode(t_CONTENT_WATER);
+		return MapNode(CONTENT_AIR);
+	});
+	summary = block.getContentSummary();
+	UASSERTEQ(u32, summary->changed_seq, (u32)block.m_changed_seq);
+	UASSERT(summary->contents.size() == 3);
+	UASSERTEQ(u16, summary->count(t_CONTENT_STONE), 4 * 16 * 16);
+	UASSERTEQ(u16, summary->count(t_CONTENT_WATER), 16);
+	UASSERTEQ(u16, summary->count(CONTENT_AIR), 16 * 16 * 16 - 4 * 16 * 16 - 16);
+	UASSERT(!summary->has(t_CONTENT_LAVA));
+	UASSERT(!summary->has(CONTENT_IGNORE));
+	UASSERTEQ(int, summary->min_y, 0);
+	UASSERTEQ(int, summary->max_y, 4);
+	UASSERT(summary->has_liquid);
+	UASSERT(!summary->all_air && !summary->all_solid);
+
+	// Made again only after the nodes changed
+	UASSERT(block.getContentSummary() == summary);
+
+	fill_block(block, [](v3s16 p) { return MapNode(t_CONTENT_STONE); });
+	summary = block.getContentSummary();
+	UASSERT(summary->all_solid && !summary->has_liquid);
+	UASSERTEQ(int, summary->min_y, 0);
+	UASSERTEQ(int, summary->max_y, MAP_BLOCKSIZE - 1);
+
+	fill_block(block, [](v3s16 p) { return MapNode(CONTENT_AIR); });
+	summary = block.getContentSummary();
+	UASSERT(summary->all_air && !summary->all_solid);
+	UASSERTEQ(int, summary->max_y, -1);
+}
@@ -0,0 +1,116 @@
+/*
+  This file is part of Freeminer.
+
+  Freeminer is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Freeminer  is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Freeminer.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "test.h"
+
+#include "mapgen_layer_cache.h"
+#include "noise.h"
+
+class TestMapgenLayerCache : public TestBase {
+public:
+	TestMapgenLayerCache() { TestManager::registerTestModule(this); }
+	const char *getName() { return "TestMapgenLayerCache"; }
+
+	void runTests(IGameDef *gamedef);
+
+	void testGetPut();
+	void testEviction();
+	void testNoise();
+};
+
+static TestMapgenLayerCache g_test_instance;
+
+void TestMapgenLayerCache::runTests(IGameDef *gamedef)
+{
+	TEST(testGetPut);
+	TEST(testEviction);
+	TEST(testNoise);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void TestMapgenLayerCache::testGetPut()
+{
+	MapgenLayerCache cache(4);
+	const v2s16 size(2, 3);
+	const float heat[6] = {1, 2, 3, 4, 5, 6};
+	float out[6] = {};
+
+	UASSERT(!cache.get("heat", 1, v2s16(0, 0), size, out));
+	cache.put("heat", 1, v2s16(0, 0), size, heat);
+	UASSERT(cache.get("heat", 1, v2s16(0, 0), size, out));
+	for (int i = 0; i != 6; i++)
+		UASSERTEQ(float, out[i], heat[i]);
+
+	// Another layer, seed, position or size is another entry
+	UASSERT(!cache.get("humidity", 1, v2s16(0, 0), size, out));
+	UASSERT(!cache.get("heat", 2, v2s16(0, 0), size, out));
+	UASSERT(!cache.get("heat", 1, v2s16(80, 0), size, out));
+	UASSERT(!cache.get("heat", 1, v2s16(0, 0), v2s16(3, 2), out));
+	UASSERTEQ(size_t, cache.getColumnCount(), 1);
+
+	// Layers of other seeds are in the same column
+	cache.put("heat", 2, v2s16(0, 0), size, heat);
+	cache.put("humidity", 3, v2s16(0, 0), size, heat);
+	UASSERTEQ(size_t, cache.getColumnCount(), 1);
+
+	UASSERTEQ(u64, cache.getHits(), 1);
+	UASSERTEQ(u64, cache.getMisses(), 5);
+	UASSERT(cache.getHitRate() > 0.16 && cache.getHitRate() < 0.17);
+}
+
+void TestMapgenLayerCache::testEviction()
+{
+	MapgenLayerCache cache(2);
+	const v2s16 size(1, 1);
+	float value = 0;
+
+	cache.put("heat", 1, v2s16(0, 0), size, &value);
+	cache.put("heat", 1, v2s16(1, 0), size, &value);
+	// The first one is used again, the second is the oldest now
+	UASSERT(cache.get("heat", 1, v2s16(0, 0), size, &value));
+	cache.put("heat", 1, v2s16(2, 0), size, &value);
+	UASSERTEQ(size_t, cache.getColumnCount(), 2);
+
+	UASSERT(cache.get("heat", 1, v2s16(0, 0), size, &value));
+	UASSERT(!cache.get("heat", 1, v2s16(1, 0), size, &value));
+	UASSERT(cache.get("heat", 1, v2s16(2, 0), size, &value));
+
+	cache.clear();
+	UASSERTEQ(size_t, cache.getColumnCount(), 0);
+	UASSERT(!cache.get("heat", 1, v2s16(0, 0), size, &value));
+}
+
+void TestMapgenLayerCache::testNoise()
+{
+	NoiseParams np(50, 50, v3f(100, 100, 100), 842, 3, 0.5, 2.0);
+	Noise direct(&np, 1337, 16, 16);
+	Noise cached(&np, 1337, 16, 16);
+	MapgenLayerCache cache(4);
+
+	direct.perlinMap2D(32, -48);
+	cache.perlinMap2D(&cached, "humidity", v2s16(32, -48));
+	UASSERTEQ(u64, cache.getMisses(), 1);
+
+	// The result of another noise is copied, not made again
+	for (int i = 0; i != 16 * 16; i++)
+		cached.result[i] = 0;
+	cache.perlinMap2D(&cached, "humidity", v2s16(32, -48));
+	UASSERTEQ(u64, cache.getHits(), 1);
+	for (int i = 0; i != 16 * 16; i++)
+		UASSERTEQ(float, cached.result[i], direct.result[i]);
+}
@@ -0,0 +1,234 @@
+/*
+  This file is part of Freeminer.
+
+  Freeminer is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Freeminer  is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Freeminer.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "test.h"
+
+#include "gamedef.h"
+#include "map.h"
+#include "mapgen.h"
+#include "mg_decoration.h"
+#include "mg_ore.h"
+#include "mg_schematic.h"
+#include "nodedef.h"
+#include "threading/worker_pool.h"
+#include "util/numeric.h"
+
+class TestMapgenPlacement : public TestBase {
+public:
+	TestMapgenPlacement() { TestManager::registerTestModule(this); }
+	const char *getName() { return "TestMapgenPlacement"; }
+
+	void runTests(IGameDef *gamedef);
+
+	void testParallelIsSerial(IGameDef *gamedef);
+};
+
+static TestMapgenPlacement g_test_instance;
+
+void TestMapgenPlacement::runTests(IGameDef *gamedef)
+{
+	TEST(testParallelIsSerial, gamedef);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+static void add_ore(OreManager &oremgr, Ore *ore, content_t c_ore,
+	content_t c_wherein, const NoiseParams &np)
+{
+	ore->c_ore          = c_ore;
+	ore->c_wherein.push_back(c_wherein);
+	ore->clust_scarcity = 8 * 8 * 8;
+	ore->clust_num_ores = 8;
+	ore->clust_size     = 3;
+	ore->y_min          = -100;
+	ore->y_max          = 100;
+	ore->ore_param2     = 0;
+	ore->nthresh        = 0;
+	ore->np             = np;
+	oremgr.add(ore);
+}
+
+static void add_deco(DecorationManager &decomgr, Decoration *deco,
+	s16 sidelen, float fill_ratio)
+{
+	deco->c_place_on.push_back(t_CONTENT_STONE);
+	deco->c_place_on.push_back(t_CONTENT_BRICK);
+	deco->c_place_on.push_back(t_CONTENT_GRASS);
+	deco->sidelen    = sidelen;
+	deco->fill_ratio = fill_ratio;
+	deco->y_min      = -100;
+	deco->y_max      = 100;
+	deco->nspawnby   = -1;
+	decomgr.add(deco);
+}
+
+void TestMapgenPlacement::testParallelIsSerial(IGameDef *gamedef)
+{
+	INodeDefManager *ndef = gamedef->getNodeDefManager();
+	const v3s16 nmin(0, 0, 0);
+	const v3s16 nmax(79, 79, 79);
+	const NoiseParams np(0, 1, v3f(20, 20, 20), 42, 2, 0.5, 2.0);
+
+	// Every kind of ore, the blob goes into what the scatter placed
+	OreManager oremgr(gamedef);
+	add_ore(oremgr, new OreScatter, t_CONTENT_BRICK, t_CONTENT_STONE, np);
+	OreSheet *sheet = new OreSheet;
+	sheet->column_height_min      = 1;
+	sheet->column_height_max      = 3;
+	sheet->column_midpoint_factor = 0.5;
+	add_ore(oremgr, sheet, t_CONTENT_GRASS, t_CONTENT_STONE, np);
+	OrePuff *puff = new OrePuff;
+	puff->np_puff_top    = NoiseParams(2, 1, v3f(10, 10, 10), 3, 2, 0.5, 2.0);
+	puff->np_puff_bottom = NoiseParams(2, 1, v3f(10, 10, 10), 4, 2, 0.5, 2.0);
+	add_ore(oremgr, puff, t_CONTENT_WATER, t_CONTENT_STONE, np);
+	Ore *blob = new OreBlob;
+	add_ore(oremgr, blob, t_CONTENT_LAVA, t_CONTENT_BRICK, np);
+	blob->clust_scarcity = 16 * 16 * 16;
+	blob->clust_size     = 5;
+	OreVein *vein = new OreVein;
+	vein->random_factor = 0.5;
+	add_ore(oremgr, vein, t_CONTENT_TORCH, t_CONTENT_STONE, np);
+	vein->nthresh = 0.4;
+
+	// A tree, placed centered and randomly rotated
+	Schematic schem;
+	schem.m_ndef      = ndef;
+	schem.size        = v3s16(5, 6, 3);
+	schem.schemdata   = new MapNode[5 * 6 * 3];
+	schem.slice_probs = new u8[6];
+	for (s16 z = 0; z != 3; z++)
+	for (s16 y = 0; y != 6; y++)
+	for (s16 x = 0; x != 5; x++) {
+		content_t c = (x == 2 && z == 1) ? t_CONTENT_BRICK :
+			y > 2 ? t_CONTENT_LAVA : CONTENT_IGNORE;
+		schem.schemdata[(z * 6 + y) * 5 + x] = MapNode(c, MTSCHEM_PROB_ALWAYS, 0);
+	}
+	for (s16 y = 0; y != 6; y++)
+		schem.slice_probs[y] = MTSCHEM_PROB_ALWAYS;
+
+	// A bush left to chance, node and slice probabilities draw the global
+	// random numbers
+	Schematic bush;
+	bush.m_ndef      = ndef;
+	bush.size        = v3s16(3, 3, 3);
+	bush.schemdata   = new MapNode[3 * 3 * 3];
+	bush.slice_probs = new u8[3];
+	for (u32 i = 0; i != 3 * 3 * 3; i++)
+		bush.schemdata[i] = MapNode(t_CONTENT_GRASS, i % 2 ? 64 : MTSCHEM_PROB_ALWAYS, 0);
+	bush.slice_probs[0] = MTSCHEM_PROB_ALWAYS;
+	bush.slice_probs[1] = 100;
+	bush.slice_probs[2] = 40;
+	UASSERT(bush.usesGlobalRandom());
+	UASSERT(!schem.usesGlobalRandom());
+
+	DecorationManager decomgr(gamedef);
+	DecoSimple *simple = new DecoSimple;
+	simple->c_decos.push_back(t_CONTENT_TORCH);
+	simple->deco_height     = 1;
+	simple->deco_height_max = 3;
+	simple->deco_param2     = 0;
+	add_deco(decomgr, simple, 8, 0.1);
+	simple->c_spawnby.push_back(t_CONTENT_STONE);
+	simple->nspawnby = 2;
+	DecoSchematic *tree = new DecoSchematic;
+	tree->schematic = &schem;
+	tree->rotation  = ROTATE_RAND;
+	add_deco(decomgr, tree, 16, 0.02);
+	tree->flags = DECO_PLACE_CENTER_X | DECO_PLACE_CENTER_Z;
+	// 7 doesn't divide the chunk, all of it is one division
+	DecoSimple *grass = new DecoSimple;
+	grass->c_decos.push_back(t_CONTENT_GRASS);
+	grass->deco_height     = 1;
+	grass->deco_height_max = 0;
+	grass->deco_param2     = 0;
+	add_deco(decomgr, grass, 7, 0.05);
+	DecoSchematic *wide = new DecoSchematic;
+	wide->schematic = &schem;
+	wide->rotation  = ROTATE_90;
+	add_deco(decomgr, wide, 80, 0.01);
+	// Two of them, their rows draw in the serial order
+	for (int i = 0; i != 2; i++) {
+		DecoSchematic *bushes = new DecoSchematic;
+		bushes->schematic = &bush;
+		bushes->rotation  = ROTATE_0;
+		add_deco(decomgr, bushes, 8, 0.05);
+		bushes->flags = DECO_FORCE_PLACEMENT;
+	}
+
+	std::set<u32> deco_ids;
+	for (u32 i = 0; i != decomgr.getNumObjects(); i++)
+		deco_ids.insert(i);
+
+	// Hills of stone with air pockets, a chunk with its border
+	MMVManip start(NULL);
+	start.addArea(VoxelArea(nmin - v3s16(16, 16, 16), nmax + v3s16(16, 16, 16)));
+	PcgRandom pr(1337);
+	for (s16 z = start.m_area.MinEdge.Z; z <= start.m_area.MaxEdge.Z; z++)
+	for (s16 x = start.m_area.MinEdge.X; x <= start.m_area.MaxEdge.X; x++) {
+		s16 ground = 40 + (x * 7 + z * 3) % 11 - (x * z) % 5;
+		for (s16 y = start.m_area.MinEdge.Y; y <= start.m_area.MaxEdge.Y; y++) {
+			bool solid = y <= ground && pr.range(0, 9) != 0;
+			start.setNodeNoRef(v3s16(x, y, z),
+				MapNode(solid ? t_CONTENT_STONE : CONTENT_AIR));
+		}
+	}
+
+	auto place = [&](int threads, MMVManip &vm,
+			std::map<std::string, std::vector<v3s16> > &events) {
+		vm.addArea(start.m_area);
+		vm.copyFrom(start.m_data, start.m_area, start.m_area.MinEdge,
+			start.m_area.MinEdge, start.m_area.getExtent());
+
+		Mapgen mg;
+		mg.vm   = &vm;
+		mg.ndef = ndef;
+		mg.seed = 1234;
+		mg.gennotify.setNotifyOn(1 << GENNOTIFY_DECORATION);
+		mg.gennotify.setNotifyOnDecoIds(&deco_ids);
+		if (threads > 1)
+			mg.placement_pool.reset(new WorkerPool("TestPlacement", threads - 1));
+		mysrand(4321);
+
+		UASSERTEQ(size_t, oremgr.placeAllOres(&mg, 99, nmin, nmax), 5);
+		decomgr.placeAllDecos(&mg, 99, nmin, nmax);
+		mg.gennotify.getEvents(events);
+	};
+
+	const u32 volume = start.m_area.getVolume();
+	MMVManip serial(NULL);
+	std::map<std::string, std::vector<v3s16> > serial_events;
+	place(1, serial, serial_events);
+
+	u32 changed = 0;
+	for (u32 i = 0; i != volume; i++)
+		changed += serial.m_data[i].getContent() != start.m_data[i].getContent();
+	UASSERT(changed > 0);
+	UASSERT(!serial_events.empty());
+
+	for (int threads = 2; threads <= 4; threads++) {
+		MMVManip parallel(NULL);
+		std::map<std::string, std::vector<v3s16> > parallel_events;
+		place(threads, parallel, parallel_events);
+
+		for (u32 i = 0; i != volume; i++) {
+			UASSERTEQ(content_t, parallel.m_data[i].getContent(),
+				serial.m_data[i].getContent());
+			UASSERTEQ(u8, parallel.m_data[i].param2, serial.m_data[i].param2);
+		}
+		UASSERT(parallel_events == serial_events);
+	}
+}
@@ -33,6 +33,7 @@ class TestNodeDef : public TestBase {
 	void runTests(IGameDef *gamedef);
 
 	void testContentFeaturesSerialization();
+	void testGroupRatings();
 };
 
 static TestNodeDef g_test_instance;
@@ -40,6 +41,7 @@ static TestNodeDef g_test_instance;
 void TestNodeDef::runTests(IGameDef *gamedef)
 {
 	TEST(testContentFeaturesSerialization);
+	TEST(testGroupRatings);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -64,3 +66,28 @@ void TestNodeDef::testContentFeaturesSerialization()
 	UASSERT(f.walkable == f2.walkable);
 	UASSERT(f.node_box.type == f2.node_box.type);
 }
+
+void TestNodeDef::testGroupRatings()
+{
+	ItemGroupList groups;
+	groups["cracky"] = 3;
+	groups["level"] = 2;
+	groups["oddly_breakable_by_hand"] = 1;
+
+	ItemGroupRatings ratings;
+	ratings.set(groups);
+
+	UASSERT(itemgroup_id("cracky") == itemgroup_id("cracky"));
+	UASSERT(itemgroup_id("cracky") != itemgroup_id("level"));
+	for (const auto &i : groups) {
+		UASSERT(ratings.has(itemgroup_id(i.first)));
+		UASSERTEQ(int, itemgroup_get(ratings, itemgroup_id(i.first)), i.second);
+	}
+	ItemGroupId crumbly = itemgroup_id("crumbly");
+	UASSERT(!ratings.has(crumbly));
+	UASSERTEQ(int, ratings.get(crumbly), 0);
+	// Ids past the bitset of this definition
+	for (int i = 0; i < 100; i++)
+		itemgroup_id("test_group_" + itos(i));
+	UASSERTEQ(int, ratings.get(itemgroup_id("test_group_99")), 0);
+}
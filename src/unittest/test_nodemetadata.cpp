@@ -0,0 +1,90 @@
+/*
+  This file is part of Freeminer.
+
+  Freeminer is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Freeminer  is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Freeminer.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "test.h"
+
+#include <sstream>
+#include "gamedef.h"
+#include "inventory.h"
+#include "nodemetadata.h"
+
+class TestNodeMetadata : public TestBase {
+public:
+	TestNodeMetadata() { TestManager::registerTestModule(this); }
+	const char *getName() { return "TestNodeMetadata"; }
+
+	void runTests(IGameDef *gamedef);
+
+	void testLazyRoundTrip(IItemDefManager *idef);
+};
+
+static TestNodeMetadata g_test_instance;
+
+void TestNodeMetadata::runTests(IGameDef *gamedef)
+{
+	TEST(testLazyRoundTrip, gamedef->getItemDefManager());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void TestNodeMetadata::testLazyRoundTrip(IItemDefManager *idef)
+{
+	NodeMetadataList list;
+	NodeMetadata *sign = new NodeMetadata(idef);
+	sign->setString("text", "hello");
+	list.set(v3s16(15, 0, 0), sign);
+	NodeMetadata *chest = new NodeMetadata(idef);
+	chest->setString("infotext", "Chest");
+	chest->getInventory()->addList("main", 32);
+	list.set(v3s16(1, 2, 3), chest);
+	// Empty ones are not saved
+	list.set(v3s16(0, 0, 1), new NodeMetadata(idef));
+
+	std::ostringstream os(std::ios::binary);
+	list.serialize(os);
+
+	NodeMetadataList loaded;
+	std::istringstream is(os.str(), std::ios::binary);
+	loaded.deSerialize(is, idef);
+	UASSERTEQ(size_t, loaded.size(), 2);
+	std::vector<v3s16> keys = loaded.getAllKeys();
+	UASSERT(keys[0] == v3s16(15, 0, 0));
+	UASSERT(keys[1] == v3s16(1, 2, 3));
+
+	// Untouched entries are written back as read
+	std::ostringstream os2(std::ios::binary);
+	loaded.serialize(os2);
+	UASSERT(os2.str() == os.str());
+
+	NodeMetadata *meta = loaded.get(v3s16(1, 2, 3));
+	UASSERT(meta);
+	UASSERTEQ(std::string, meta->getString("infotext"), "Chest");
+	UASSERT(meta->getInventory()->getList("main"));
+	UASSERTEQ(u32, meta->getInventory()->getList("main")->getSize(), 32);
+	UASSERT(!loaded.get(v3s16(2, 2, 3)));
+
+	meta->setString("infotext", "Locked chest");
+	loaded.remove(v3s16(15, 0, 0));
+	std::ostringstream os3(std::ios::binary);
+	loaded.serialize(os3);
+	NodeMetadataList reloaded;
+	std::istringstream is3(os3.str(), std::ios::binary);
+	reloaded.deSerialize(is3, idef);
+	UASSERTEQ(size_t, reloaded.size(), 1);
+	UASSERTEQ(std::string, reloaded.get(v3s16(1, 2, 3))->getString("infotext"),
+			"Locked chest");
+}
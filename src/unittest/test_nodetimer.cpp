@@ -0,0 +1,114 @@
+/*
+  This file is part of Freeminer.
+
+  Freeminer is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Freeminer  is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Freeminer.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "test.h"
+
+#include <sstream>
+#include "nodetimer.h"
+
+class TestNodeTimer : public TestBase {
+public:
+	TestNodeTimer() { TestManager::registerTestModule(this); }
+	const char *getName() { return "TestNodeTimer"; }
+
+	void runTests(IGameDef *gamedef);
+
+	void testSetGetRemove();
+	void testStep();
+	void testSerialize();
+};
+
+static TestNodeTimer g_test_instance;
+
+void TestNodeTimer::runTests(IGameDef *gamedef)
+{
+	TEST(testSetGetRemove);
+	TEST(testStep);
+	TEST(testSerialize);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void TestNodeTimer::testSetGetRemove()
+{
+	NodeTimerList list;
+	// Past the position index threshold
+	for (s16 i = 0; i < 100; ++i)
+		list.set(NodeTimer(10 + i, 1, v3s16(i % 16, i / 16, 0)));
+	list.set(NodeTimer(5, 2, v3s16(3, 0, 0)));
+	UASSERTEQ(size_t, list.size(), 100);
+
+	NodeTimer t = list.get(v3s16(3, 0, 0));
+	UASSERTEQ(f32, t.timeout, 5);
+	UASSERTEQ(f32, t.elapsed, 2);
+	UASSERT(t.position == v3s16(3, 0, 0));
+
+	list.remove(v3s16(3, 0, 0));
+	UASSERTEQ(size_t, list.size(), 99);
+	UASSERTEQ(f32, list.get(v3s16(3, 0, 0)).timeout, 0);
+	list.remove(v3s16(15, 15, 15));
+	UASSERTEQ(size_t, list.size(), 99);
+
+	list.clear();
+	UASSERTEQ(size_t, list.size(), 0);
+}
+
+void TestNodeTimer::testStep()
+{
+	NodeTimerList list;
+	list.set(NodeTimer(0.5, 0, v3s16(1, 0, 0)));
+	list.set(NodeTimer(3, 0, v3s16(2, 0, 0)));
+	// Further than the first wheel levels
+	list.set(NodeTimer(100000, 0, v3s16(3, 0, 0)));
+
+	UASSERTEQ(size_t, list.step(0.4).size(), 0);
+	std::vector<NodeTimer> elapsed = list.step(0.2);
+	UASSERTEQ(size_t, elapsed.size(), 1);
+	UASSERT(elapsed[0].position == v3s16(1, 0, 0));
+	UASSERT(fabs(elapsed[0].elapsed - 0.6) < 0.001);
+
+	// Time passing in small steps and in one big one
+	for (int i = 0; i < 23; ++i)
+		UASSERTEQ(size_t, list.step(0.1).size(), 0);
+	UASSERTEQ(size_t, list.step(0.1).size(), 1);
+	UASSERT(fabs(list.get(v3s16(3, 0, 0)).elapsed - 3) < 0.01);
+	UASSERTEQ(size_t, list.step(99990).size(), 0);
+	elapsed = list.step(10);
+	UASSERTEQ(size_t, elapsed.size(), 1);
+	UASSERT(elapsed[0].position == v3s16(3, 0, 0));
+	UASSERTEQ(size_t, list.size(), 0);
+}
+
+void TestNodeTimer::testSerialize()
+{
+	NodeTimerList list;
+	list.set(NodeTimer(4, 1, v3s16(1, 2, 3)));
+	list.set(NodeTimer(8, 3, v3s16(15, 15, 15)));
+	list.step(1);
+
+	std::ostringstream os(std::ios::binary);
+	list.serialize(os, 25);
+	std::istringstream is(os.str(), std::ios::binary);
+	NodeTimerList list2;
+	list2.deSerialize(is, 25);
+
+	UASSERTEQ(size_t, list2.size(), 2);
+	NodeTimer t = list2.get(v3s16(15, 15, 15));
+	UASSERTEQ(f32, t.timeout, 8);
+	UASSERT(fabs(t.elapsed - 4) < 0.001);
+	UASSERTEQ(size_t, list2.step(2).size(), 1);
+}
@@ -0,0 +1,235 @@
+/*
+  This file is part of Freeminer.
+
+  Freeminer is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Freeminer  is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Freeminer.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "test.h"
+
+#include <algorithm>
+#include "gamedef.h"
+#include "map.h"
+#include "mapblock.h"
+#include "metrics.h"
+#include "pathfinder.h"
+
+class TestPathfinder : public TestBase {
+public:
+	TestPathfinder() { TestManager::registerTestModule(this); }
+	const char *getName() { return "TestPathfinder"; }
+
+	void runTests(IGameDef *gamedef);
+
+	void testWalk(IGameDef *gamedef);
+	void testJump(IGameDef *gamedef);
+	void testDrop(IGameDef *gamedef);
+	void testUnreachable(IGameDef *gamedef);
+	void testCacheInvalidation(IGameDef *gamedef);
+};
+
+static TestPathfinder g_test_instance;
+
+void TestPathfinder::runTests(IGameDef *gamedef)
+{
+	TEST(testWalk, gamedef);
+	TEST(testJump, gamedef);
+	TEST(testDrop, gamedef);
+	TEST(testUnreachable, gamedef);
+	TEST(testCacheInvalidation, gamedef);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// 3x2x1 blocks of air over a stone floor, one stands at y = 4
+static void make_floor(Map &map)
+{
+	for (s16 by = 0; by != 2; by++)
+	for (s16 bx = 0; bx != 3; bx++) {
+		v3s16 blockpos(bx, by, 0);
+		MapBlock *block = map.createBlankBlock(blockpos);
+		for (s16 z = 0; z < MAP_BLOCKSIZE; z++)
+		for (s16 y = 0; y < MAP_BLOCKSIZE; y++)
+		for (s16 x = 0; x < MAP_BLOCKSIZE; x++) {
+			MapNode n(by == 0 && y < 4 ? t_CONTENT_STONE : CONTENT_AIR);
+			block->setNodeNoCheck(v3s16(x, y, z), n);
+		}
+	}
+}
+
+static void set_stone(Map &map, v3s16 p)
+{
+	MapNode n(t_CONTENT_STONE);
+	v3s16 blockpos = getNodeBlockPos(p);
+	map.getBlockNoCreateNoEx(blockpos)->setNodeNoCheck(
+			p - blockpos * MAP_BLOCKSIZE, n);
+}
+
+// A wall across the map at x from y = 4 up to top
+static void make_wall(Map &map, s16 x, s16 top)
+{
+	for (s16 z = 0; z < MAP_BLOCKSIZE; z++)
+	for (s16 y = 4; y <= top; y++)
+		set_stone(map, v3s16(x, y, z));
+}
+
+static PathRequest make_request(v3s16 source, v3s16 destination,
+		unsigned int max_jump, unsigned int max_drop)
+{
+	PathRequest request;
+	request.source = source;
+	request.destination = destination;
+	request.searchdistance = 8;
+	request.max_jump = max_jump;
+	request.max_drop = max_drop;
+	request.algo = PA_PLAIN;
+	return request;
+}
+
+// From source to destination, one node on the xz plane per step
+static bool is_path(const std::vector<v3s16> &path, v3s16 source,
+		v3s16 destination)
+{
+	if (path.empty() || path.front() != source || path.back() != destination)
+		return false;
+	for (size_t i = 1; i < path.size(); i++) {
+		v3s16 d = path[i] - path[i - 1];
+		if (abs(d.X) + abs(d.Z) != 1)
+			return false;
+	}
+	return true;
+}
+
+void TestPathfinder::testWalk(IGameDef *gamedef)
+{
+	Map map(gamedef);
+	make_floor(map);
+	PathfinderManager pathfinder(map, gamedef->ndef());
+
+	// Across all three blocks, the summaries guiding the search
+	const v3s16 source(1, 4, 8), destination(46, 4, 3);
+	for (PathAlgorithm algo : {PA_DIJKSTRA, PA_PLAIN, PA_PLAIN_NP}) {
+		PathRequest request = make_request(source, destination, 0, 0);
+		request.algo = algo;
+		std::vector<v3s16> path = pathfinder.getPath(request);
+		UASSERT(is_path(path, source, destination));
+		// Shortest, never leaving the floor
+		UASSERTEQ(size_t, path.size(), 45 + 5 + 1);
+		for (const auto &p : path)
+			UASSERTEQ(s16, p.Y, 4);
+	}
+}
+
+void TestPathfinder::testJump(IGameDef *gamedef)
+{
+	Map map(gamedef);
+	make_floor(map);
+	make_wall(map, 20, 4);
+	PathfinderManager pathfinder(map, gamedef->ndef());
+
+	const v3s16 source(10, 4, 8), destination(30, 4, 8);
+	std::vector<v3s16> path = pathfinder.getPath(
+			make_request(source, destination, 1, 1));
+	UASSERT(is_path(path, source, destination));
+	UASSERT(std::find(path.begin(), path.end(), v3s16(20, 5, 8)) != path.end());
+
+	UASSERT(pathfinder.getPath(make_request(source, destination, 0, 1)).empty());
+
+	// Two nodes high is too much for max_jump 1
+	make_wall(map, 20, 5);
+	UASSERT(pathfinder.getPath(make_request(source, destination, 1, 2)).empty());
+	path = pathfinder.getPath(make_request(source, destination, 2, 2));
+	UASSERT(is_path(path, source, destination));
+}
+
+void TestPathfinder::testDrop(IGameDef *gamedef)
+{
+	Map map(gamedef);
+	make_floor(map);
+	// One stands at y = 8 up to x = 19, four nodes above the floor after it
+	for (s16 x = 0; x < 20; x++)
+		make_wall(map, x, 7);
+	PathfinderManager pathfinder(map, gamedef->ndef());
+
+	const v3s16 source(10, 8, 8), destination(30, 4, 8);
+	std::vector<v3s16> path = pathfinder.getPath(
+			make_request(source, destination, 0, 4));
+	UASSERT(is_path(path, source, destination));
+	UASSERT(std::find(path.begin(), path.end(), v3s16(20, 4, 8)) != path.end());
+
+	UASSERT(pathfinder.getPath(make_request(source, destination, 0, 3)).empty());
+	// Nor back up
+	UASSERT(pathfinder.getPath(make_request(destination, source, 3, 4)).empty());
+}
+
+void TestPathfinder::testUnreachable(IGameDef *gamedef)
+{
+	Map map(gamedef);
+	make_floor(map);
+	make_wall(map, 20, 8);
+	PathfinderManager pathfinder(map, gamedef->ndef());
+
+	// Walled off, the map ending on both sides of the wall
+	const v3s16 source(10, 4, 8), destination(30, 4, 8);
+	UASSERT(pathfinder.getPath(make_request(source, destination, 2, 8)).empty());
+
+	// Destination in the floor or in the air, source outside the map
+	UASSERT(pathfinder.getPath(make_request(source, v3s16(15, 3, 8), 1, 1)).empty());
+	UASSERT(pathfinder.getPath(make_request(source, v3s16(15, 6, 8), 1, 1)).empty());
+	UASSERT(pathfinder.getPath(make_request(v3s16(10, 4, -8), v3s16(15, 4, 8),
+			1, 1)).empty());
+
+	// Still reachable on the same side of the wall
+	UASSERT(is_path(pathfinder.getPath(make_request(source, v3s16(15, 4, 8), 1, 1)),
+			source, v3s16(15, 4, 8)));
+}
+
+void TestPathfinder::testCacheInvalidation(IGameDef *gamedef)
+{
+	static const auto searches_cached = g_metrics->counter("freeminer_pathfinder_searches_total",
+			"Pathfinder searches", "result=\"cached\"");
+
+	Map map(gamedef);
+	make_floor(map);
+	PathfinderManager pathfinder(map, gamedef->ndef());
+
+	const v3s16 source(2, 4, 8), destination(40, 4, 8);
+	const PathRequest request = make_request(source, destination, 0, 0);
+	std::vector<v3s16> path = pathfinder.getPath(request);
+	UASSERT(is_path(path, source, destination));
+
+	u64 cached = searches_cached->get();
+	UASSERT(pathfinder.getPath(request) == path);
+	UASSERTEQ(u64, searches_cached->get(), cached + 1);
+
+	// A stone on the path, in the middle block: searched again, around it
+	v3s16 blocked;
+	for (const auto &p : path)
+		if (getNodeBlockPos(p).X == 1)
+			blocked = p;
+	set_stone(map, blocked);
+
+	cached = searches_cached->get();
+	std::vector<v3s16> detour = pathfinder.getPath(request);
+	UASSERTEQ(u64, searches_cached->get(), cached);
+	UASSERT(is_path(detour, source, destination));
+	UASSERT(std::find(detour.begin(), detour.end(), blocked) == detour.end());
+
+	// Walled off: searched again and failing, which is kept for a second
+	make_wall(map, 24, 4);
+	cached = searches_cached->get();
+	UASSERT(pathfinder.getPath(request).empty());
+	UASSERTEQ(u64, searches_cached->get(), cached);
+	UASSERT(pathfinder.getPath(request).empty());
+	UASSERTEQ(u64, searches_cached->get(), cached + 1);
+}
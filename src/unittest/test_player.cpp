@@ -19,7 +19,10 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 
 #include "test.h"
 
+#include "config.h"
 #include "exceptions.h"
+#include "key_value_storage.h"
+#include "player_records.h"
 #include "remoteplayer.h"
 #include "content_sao.h"
 #include "server.h"
@@ -33,6 +36,7 @@ class TestPlayer : public TestBase {
 
 	void testSave(IGameDef *gamedef);
 	void testLoad(IGameDef *gamedef);
+	void testRecords(IGameDef *gamedef);
 };
 
 static TestPlayer g_test_instance;
@@ -41,6 +45,7 @@ void TestPlayer::runTests(IGameDef *gamedef)
 {
 	TEST(testSave, gamedef);
 	TEST(testLoad, gamedef);
+	TEST(testRecords, gamedef);
 }
 
 void TestPlayer::testSave(IGameDef *gamedef)
@@ -90,3 +95,79 @@ void TestPlayer::testLoad(IGameDef *gamedef)
 	UASSERT(sao_load.getPitch() == 0.6f);
 	UASSERT(sao_load.getBasePosition() == v3f(450.2f, -15.7f, 68.1f));
 }
+
+void TestPlayer::testRecords(IGameDef *gamedef)
+{
+#if USE_LEVELDB
+	IItemDefManager *idef = gamedef->idef();
+	KeyValueStorage storage(getTestTempDirectory(), "players");
+	PlayerRecords records(storage);
+
+	RemotePlayer rplayer("testplayer_records", idef);
+	PlayerSAO sao(NULL, 1, false);
+	sao.initialize(&rplayer, std::set<std::string>());
+	rplayer.setPlayerSAO(&sao);
+	sao.setBreath(10);
+	sao.setHPRaw(8);
+	sao.setYaw(0.5f);
+	sao.setPitch(0.25f);
+	sao.setBasePosition(v3f(450.25f, -15.75f, 68.125f));
+	sao.setExtendedAttribute("mana", "20");
+	rplayer.inventory.getList("main")->changeItem(3,
+			ItemStack("default:stone", 5, 0, "", idef));
+
+	// Header, attributes and the five lists, then nothing
+	UASSERTEQ(u32, records.save(&rplayer), 7);
+	UASSERTEQ(u32, records.save(&rplayer), 0);
+
+	// Only what changed
+	sao.setBasePosition(v3f(451.0f, -15.75f, 68.125f));
+	UASSERTEQ(u32, records.save(&rplayer), 1);
+	rplayer.inventory.getList("craft")->changeItem(0,
+			ItemStack("default:torch", 2, 0, "", idef));
+	UASSERTEQ(u32, records.save(&rplayer), 1);
+	sao.setExtendedAttribute("mana", "20");
+	UASSERTEQ(u32, records.save(&rplayer), 0);
+	sao.setExtendedAttribute("mana", "19");
+	UASSERTEQ(u32, records.save(&rplayer), 1);
+	// The header has the list names
+	rplayer.inventory.deleteList("hand");
+	UASSERTEQ(u32, records.save(&rplayer), 1);
+
+	RemotePlayer rplayer_load("", idef);
+	PlayerSAO sao_load(NULL, 2, false);
+	sao_load.initialize(&rplayer_load, std::set<std::string>());
+	rplayer_load.setPlayerSAO(&sao_load);
+	UASSERT(records.load(&rplayer_load, "testplayer_records"));
+	UASSERT(rplayer_load.getName() == "testplayer_records");
+	UASSERT(sao_load.getBreath() == 10);
+	UASSERT(sao_load.getHP() == 8);
+	UASSERT(sao_load.getYaw() == 0.5f);
+	UASSERT(sao_load.getPitch() == 0.25f);
+	UASSERT(sao_load.getBasePosition() == v3f(451.0f, -15.75f, 68.125f));
+	std::string mana;
+	UASSERT(sao_load.getExtendedAttribute("mana", &mana));
+	UASSERTEQ(std::string, mana, "19");
+	UASSERT(rplayer_load.inventory == rplayer.inventory);
+	// What was loaded is what is saved
+	UASSERTEQ(u32, records.save(&rplayer_load), 0);
+	UASSERT(!records.load(&rplayer_load, "testplayer_nobody"));
+
+	// A JSON record of an older version, gone with the first save
+	Json::Value json;
+	json << rplayer;
+	json["name"] = "testplayer_json";
+	UASSERT(storage.put_json("p.testplayer_json", json));
+	RemotePlayer rplayer_json("", idef);
+	UASSERT(records.load(&rplayer_json, "testplayer_json"));
+	UASSERT(rplayer_json.getName() == "testplayer_json");
+	UASSERT(rplayer_json.inventory == rplayer.inventory);
+	PlayerSAO sao_json(NULL, 3, false);
+	sao_json.initialize(&rplayer_json, std::set<std::string>());
+	rplayer_json.setPlayerSAO(&sao_json);
+	UASSERTEQ(u32, records.save(&rplayer_json), 6);
+	records.flush();
+	UASSERT(!storage.get_json("p.testplayer_json", json));
+	UASSERT(records.load(&rplayer_json, "testplayer_json"));
+#endif
+}
@@ -19,7 +19,11 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 
 #include "test.h"
 
+#include <sstream>
+
 #include "profiler.h"
+#include "tracer.h"
+#include "metrics.h"
 
 class TestProfiler : public TestBase {
 public:
@@ -29,6 +33,8 @@ class TestProfiler : public TestBase {
 	void runTests(IGameDef *gamedef);
 
 	void testProfilerAverage();
+	void testTracerSpans();
+	void testMetrics();
 };
 
 static TestProfiler g_test_instance;
@@ -36,6 +42,8 @@ static TestProfiler g_test_instance;
 void TestProfiler::runTests(IGameDef *gamedef)
 {
 	TEST(testProfilerAverage);
+	TEST(testTracerSpans);
+	TEST(testMetrics);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -70,3 +78,52 @@ void TestProfiler::testProfilerAverage()
 
 	UASSERT(p.getValue("Test2") == 123.57f);
 }
+
+void TestProfiler::testTracerSpans()
+{
+	bool was_enabled = g_tracer_enabled;
+
+	g_tracer->enable(false);
+	{
+		TimeTaker t("TestTracer disabled");
+	}
+
+	g_tracer->enable(true);
+	{
+		TimeTaker t("TestTracer \"span\"");
+	}
+	g_tracer->enable(was_enabled);
+
+	std::ostringstream os;
+	g_tracer->dump(os);
+	std::string json = os.str();
+
+	UASSERT(json.find("\"traceEvents\"") != std::string::npos);
+	UASSERT(json.find("TestTracer \\\"span\\\"") != std::string::npos);
+	UASSERT(json.find("TestTracer disabled") == std::string::npos);
+}
+
+void TestProfiler::testMetrics()
+{
+	auto counter = g_metrics->counter("test_counter_total", "Test counter", "a=\"1\"");
+	UASSERT(counter == g_metrics->counter("test_counter_total", "Test counter", "a=\"1\""));
+	counter->add(3);
+	counter->add();
+	UASSERT(counter->get() == 4);
+
+	auto histogram = g_metrics->histogram("test_histogram_seconds", "Test histogram", {0.1, 1});
+	histogram->observe(0.05);
+	histogram->observe(0.5);
+	histogram->observe(5);
+
+	std::ostringstream os;
+	g_metrics->write(os);
+	std::string text = os.str();
+
+	UASSERT(text.find("# TYPE test_counter_total counter\n") != std::string::npos);
+	UASSERT(text.find("test_counter_total{a=\"1\"} 4\n") != std::string::npos);
+	UASSERT(text.find("test_histogram_seconds_bucket{le=\"0.1\"} 1\n") != std::string::npos);
+	UASSERT(text.find("test_histogram_seconds_bucket{le=\"1\"} 2\n") != std::string::npos);
+	UASSERT(text.find("test_histogram_seconds_bucket{le=\"+Inf\"} 3\n") != std::string::npos);
+	UASSERT(text.find("test_histogram_seconds_count 3\n") != std::string::npos);
+}
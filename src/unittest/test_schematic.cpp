@@ -21,6 +21,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 
 #include "mg_schematic.h"
 #include "gamedef.h"
+#include "map.h"
 #include "nodedef.h"
 
 class TestSchematic : public TestBase {
@@ -33,6 +34,7 @@ class TestSchematic : public TestBase {
 	void testMtsSerializeDeserialize(INodeDefManager *ndef);
 	void testLuaTableSerialize(INodeDefManager *ndef);
 	void testFileSerializeDeserialize(INodeDefManager *ndef);
+	void testBlitToVManip(INodeDefManager *ndef);
 
 	static const content_t test_schem1_data[7 * 6 * 4];
 	static const content_t test_schem2_data[3 * 3 * 3];
@@ -52,6 +54,7 @@ void TestSchematic::runTests(IGameDef *gamedef)
 	TEST(testMtsSerializeDeserialize, ndef);
 	TEST(testLuaTableSerialize, ndef);
 	TEST(testFileSerializeDeserialize, ndef);
+	TEST(testBlitToVManip, ndef);
 
 	ndef->resetNodeResolveState();
 }
@@ -181,6 +184,98 @@ void TestSchematic::testFileSerializeDeserialize(INodeDefManager *ndef)
 }
 
 
+// Node by node placement like blitToVManip did before schematics were compiled
+static void blit_node_by_node(const Schematic &schem, MMVManip *vm, v3s16 p,
+	Rotation rot, bool force_place, INodeDefManager *ndef)
+{
+	const v3s16 &size = schem.size;
+	for (s16 z = 0; z != size.Z; z++)
+	for (s16 y = 0; y != size.Y; y++)
+	for (s16 x = 0; x != size.X; x++) {
+		v3s16 r;
+		switch (rot) {
+			case ROTATE_90:  r = v3s16(z, y, size.X - 1 - x); break;
+			case ROTATE_180: r = v3s16(size.X - 1 - x, y, size.Z - 1 - z); break;
+			case ROTATE_270: r = v3s16(size.Z - 1 - z, y, x); break;
+			default:         r = v3s16(x, y, z);
+		}
+		if (!vm->m_area.contains(p + r))
+			continue;
+
+		const MapNode &n = schem.schemdata[(z * size.Y + y) * size.X + x];
+		u8 prob = n.param1 & MTSCHEM_PROB_MASK;
+		if (n.getContent() == CONTENT_IGNORE || prob == MTSCHEM_PROB_NEVER)
+			continue;
+
+		MapNode &dst = vm->getNodeRefUnsafe(p + r);
+		if (!force_place && !(n.param1 & MTSCHEM_FORCE_PLACE) &&
+				dst.getContent() != CONTENT_AIR && dst.getContent() != CONTENT_IGNORE)
+			continue;
+
+		dst = n;
+		dst.param1 = 0;
+		if (rot)
+			dst.rotateAlongYAxis(ndef, rot);
+	}
+}
+
+void TestSchematic::testBlitToVManip(INodeDefManager *ndef)
+{
+	static const v3s16 size(7, 6, 4);
+	static const u32 volume = size.X * size.Y * size.Z;
+	const content_t content_map[] = {
+		CONTENT_AIR,
+		t_CONTENT_STONE,
+		t_CONTENT_BRICK,
+		CONTENT_IGNORE,
+	};
+
+	Schematic schem;
+	schem.m_ndef      = ndef;
+	schem.size        = size;
+	schem.schemdata   = new MapNode[volume];
+	schem.slice_probs = new u8[size.Y];
+	for (size_t i = 0; i != volume; i++) {
+		content_t c = content_map[test_schem1_data[i]];
+		// Bricks are forced, some nodes never placed to break the runs
+		u8 param1 = i % 11 == 5 ? MTSCHEM_PROB_NEVER : MTSCHEM_PROB_ALWAYS;
+		if (c == t_CONTENT_BRICK)
+			param1 |= MTSCHEM_FORCE_PLACE;
+		schem.schemdata[i] = MapNode(c, param1, 0);
+	}
+	for (s16 y = 0; y != size.Y; y++)
+		schem.slice_probs[y] = MTSCHEM_PROB_ALWAYS;
+
+	// Inside, and clipped by every side of the vmanip
+	const v3s16 positions[] = {
+		v3s16(1, 1, 1),
+		v3s16(-3, -2, -1),
+		v3s16(5, 6, 7),
+		v3s16(-5, 3, 8),
+	};
+	VoxelArea area(v3s16(0, 0, 0), v3s16(9, 9, 9));
+
+	for (int rot = ROTATE_0; rot != ROTATE_RAND; rot++)
+	for (int force_place = 0; force_place != 2; force_place++)
+	for (size_t k = 0; k != ARRLEN(positions); k++) {
+		MMVManip vm(NULL), expected(NULL);
+		for (s16 z = area.MinEdge.Z; z <= area.MaxEdge.Z; z++)
+		for (s16 y = area.MinEdge.Y; y <= area.MaxEdge.Y; y++)
+		for (s16 x = area.MinEdge.X; x <= area.MaxEdge.X; x++) {
+			MapNode n((x + y + z) % 3 ? CONTENT_AIR : t_CONTENT_WATER);
+			vm.setNodeNoRef(v3s16(x, y, z), n);
+			expected.setNodeNoRef(v3s16(x, y, z), n);
+		}
+
+		schem.blitToVManip(&vm, positions[k], (Rotation)rot, force_place);
+		blit_node_by_node(schem, &expected, positions[k], (Rotation)rot,
+			force_place, ndef);
+
+		for (u32 i = 0; i != (u32)area.getVolume(); i++)
+			UASSERT(vm.m_data[i] == expected.m_data[i]);
+	}
+}
+
 // Should form a cross-shaped-thing...?
 const content_t TestSchematic::test_schem1_data[7 * 6 * 4] = {
 	3, 3, 1, 1, 1, 3, 3, // Y=0, Z=0
@@ -0,0 +1,93 @@
+/*
+  This file is part of Freeminer.
+
+  Freeminer is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Freeminer  is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Freeminer.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "test.h"
+
+#include "emerge.h"
+#include "filesys.h"
+#include "gamedef.h"
+#include "map.h"
+#include "mapblock.h"
+
+class TestServerMap : public TestBase {
+public:
+	TestServerMap() { TestManager::registerTestModule(this); }
+	const char *getName() { return "TestServerMap"; }
+
+	void runTests(IGameDef *gamedef);
+
+	void testReloadSavedBlock(IGameDef *gamedef);
+};
+
+static TestServerMap g_test_instance;
+
+void TestServerMap::runTests(IGameDef *gamedef)
+{
+	TEST(testReloadSavedBlock, gamedef);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void TestServerMap::testReloadSavedBlock(IGameDef *gamedef)
+{
+	std::string savedir = getTestTempDirectory() + DIR_DELIM "servermap";
+	fs::RecursiveDelete(savedir);
+	UASSERT(fs::CreateAllDirs(savedir));
+
+	EmergeManager emerge(gamedef);
+	ServerMap map(savedir, gamedef, &emerge);
+	const v3s16 p(1, 2, 3), border(1, 3, 3);
+	const v3s16 edited(4, 5, 6);
+	MapNode stone(t_CONTENT_STONE), water(t_CONTENT_WATER), lava(t_CONTENT_LAVA);
+	bool valid;
+
+	// Nothing saved yet, remembered as missing from the database
+	map.loadBlocks({p, border});
+	UASSERT(map.getBlockNoCreateNoEx(p) == NULL);
+	UASSERT(map.m_db_miss.count(p));
+
+	// Generated and edited this session, then saved
+	MapBlock *block = map.createBlock(p);
+	block->setGenerated(true);
+	block->setNodeNoCheck(edited, stone);
+	UASSERT(map.saveBlock(block));
+	UASSERT(!map.m_db_miss.count(p));
+
+	// Unloaded and emerged again: the saved copy is read back
+	map.Map::deleteBlock(block);
+	UASSERT(map.getBlockNoCreateNoEx(p) == NULL);
+	map.loadBlocks({p});
+	block = map.getBlockNoCreateNoEx(p);
+	UASSERT(block != NULL);
+	UASSERTEQ(content_t, block->getNodeNoCheck(edited, &valid).getContent(),
+			t_CONTENT_STONE);
+
+	// A saved block that is in memory again, not generated yet, is newer
+	// than the database and is not read over
+	MapBlock *b = map.createBlock(border);
+	b->setGenerated(true);
+	b->setNodeNoCheck(edited, water);
+	UASSERT(map.saveBlock(b));
+	map.Map::deleteBlock(b);
+	b = map.createBlock(border);
+	UASSERT(!b->isGenerated());
+	b->setNodeNoCheck(edited, lava);
+	map.loadBlocks({border});
+	UASSERT(map.getBlockNoCreateNoEx(border) == b);
+	UASSERTEQ(content_t, b->getNodeNoCheck(edited, &valid).getContent(),
+			t_CONTENT_LAVA);
+}
@@ -30,6 +30,7 @@ class TestSettings : public TestBase {
 	void runTests(IGameDef *gamedef);
 
 	void testAllSettings();
+	void testCachedSetting();
 
 	static const char *config_text_before;
 	static const std::string config_text_after;
@@ -40,6 +41,7 @@ static TestSettings g_test_instance;
 void TestSettings::runTests(IGameDef *gamedef)
 {
 	TEST(testAllSettings);
+	TEST(testCachedSetting);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -205,3 +207,41 @@ void TestSettings::testAllSettings()
 		UASSERT(!"Setting not found!");
 	}
 }
+
+void TestSettings::testCachedSetting()
+{
+	Settings s;
+	s.setDefault("relax", "2");
+	s.set("enabled", "true");
+
+	{
+		CachedSetting<s16> relax("relax", &s);
+		CachedSetting<bool> enabled("enabled", &s);
+		UASSERTEQ(s16, relax, 2);
+		UASSERT(enabled);
+
+		s.set("relax", "5");
+		s.setBool("enabled", false);
+		UASSERTEQ(s16, relax, 5);
+		UASSERT(!enabled);
+
+		s.remove("relax");
+		UASSERTEQ(s16, relax, 2);
+
+		s.setDefault("relax", "3");
+		UASSERTEQ(s16, relax, 3);
+
+		Settings other;
+		other.set("relax", "4");
+		s.update(other);
+		UASSERTEQ(s16, relax, 4);
+
+		std::istringstream is("relax = 6\nenabled = true\n");
+		s.parseConfigLines(is, "");
+		UASSERTEQ(s16, relax, 6);
+		UASSERT(enabled);
+	}
+
+	// Callbacks went away with the handles
+	s.set("relax", "7");
+}
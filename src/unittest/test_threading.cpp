@@ -22,6 +22,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "threading/atomic.h"
 #include "threading/semaphore.h"
 #include "threading/thread.h"
+#include "threading/worker_pool.h"
 
 
 class TestThreading : public TestBase {
@@ -33,6 +34,7 @@ class TestThreading : public TestBase {
 	void testStartStopWait();
 	void testThreadKill();
 	void testAtomicSemaphoreThread();
+	void testWorkerPool();
 };
 
 static TestThreading g_test_instance;
@@ -44,6 +46,7 @@ void TestThreading::runTests(IGameDef *gamedef)
 #endif
 	TEST(testThreadKill);
 	TEST(testAtomicSemaphoreThread);
+	TEST(testWorkerPool);
 }
 
 class SimpleTestThread : public Thread {
@@ -183,3 +186,16 @@ void TestThreading::testAtomicSemaphoreThread()
 	UASSERT(val == num_threads * 0x10000);
 }
 
+void TestThreading::testWorkerPool()
+{
+	WorkerPool pool("TestWorkers", 3);
+	UASSERTEQ(size_t, pool.workers.size(), 3);
+
+	for (size_t count : {0, 1, 7, 1000}) {
+		std::vector<u32> calls(count);
+		for (int pass = 0; pass < 3; ++pass)
+			pool.forEach(count, [&](size_t i) { ++calls[i]; });
+		for (size_t i = 0; i < count; ++i)
+			UASSERTEQ(u32, calls[i], 3);
+	}
+}
@@ -21,6 +21,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 
 #include "util/numeric.h"
 #include "util/string.h"
+#include "util/arena.h"
 
 class TestUtilities : public TestBase {
 public:
@@ -50,6 +51,7 @@ class TestUtilities : public TestBase {
 	void testIsNumber();
 	void testIsPowerOfTwo();
 	void testMyround();
+	void testArena();
 };
 
 static TestUtilities g_test_instance;
@@ -77,6 +79,7 @@ void TestUtilities::runTests(IGameDef *gamedef)
 	TEST(testIsNumber);
 	TEST(testIsPowerOfTwo);
 	TEST(testMyround);
+	TEST(testArena);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -326,3 +329,44 @@ void TestUtilities::testMyround()
 	UASSERT(myround(-6.5f) == -7);
 }
 
+
+void TestUtilities::testArena()
+{
+	Arena arena(64);
+	UASSERT(arena.used() == 0);
+
+	u64 *a = arena.allocateArray<u64>(4);
+	UASSERT(((uintptr_t)a % alignof(u64)) == 0);
+	UASSERT(arena.used() >= 4 * sizeof(u64));
+
+	Arena::Mark mark = arena.mark();
+	{
+		ArenaScope scope(&arena);
+		// bigger than a block
+		arena.allocate(1000);
+		UASSERT(arena.used() >= 1000);
+	}
+	UASSERT(arena.used() == mark.used);
+	UASSERT(arena.peak() >= 1000);
+
+	arena.reset();
+	UASSERT(arena.used() == 0);
+	size_t reserved = arena.reserved();
+	arena.allocate(1000);
+	// reset merged blocks, no new memory needed
+	UASSERT(arena.reserved() == reserved);
+
+	{
+		ArenaCurrentScope current(&arena);
+		std::vector<int, ArenaAllocator<int>> v;
+		for (int i = 0; i < 100; ++i)
+			v.push_back(i);
+		UASSERT(v.get_allocator().m_arena == &arena);
+		UASSERT(v[99] == 99);
+	}
+	UASSERT(Arena::current() == nullptr);
+
+	std::vector<int, ArenaAllocator<int>> heap;
+	heap.push_back(1);
+	UASSERT(heap.get_allocator().m_arena == nullptr);
+}
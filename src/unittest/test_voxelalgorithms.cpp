@@ -20,6 +20,10 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "test.h"
 
 #include "gamedef.h"
+#include "map.h"
+#include "mapgen.h"
+#include "nodedef.h"
+#include "noise.h"
 #include "voxelalgorithms.h"
 
 class TestVoxelAlgorithms : public TestBase {
@@ -31,6 +35,7 @@ class TestVoxelAlgorithms : public TestBase {
 
 	void testPropogateSunlight(INodeDefManager *ndef);
 	void testClearLightAndCollectSources(INodeDefManager *ndef);
+	void testMapgenLighting(INodeDefManager *ndef);
 };
 
 static TestVoxelAlgorithms g_test_instance;
@@ -41,6 +46,7 @@ void TestVoxelAlgorithms::runTests(IGameDef *gamedef)
 
 	TEST(testPropogateSunlight, ndef);
 	TEST(testClearLightAndCollectSources, ndef);
+	TEST(testMapgenLighting, ndef);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -202,3 +208,97 @@ void TestVoxelAlgorithms::testClearLightAndCollectSources(INodeDefManager *ndef)
 		UASSERT(unlight_from.size() == 1);
 	}
 }
+
+// Repeats "brightest neighbor minus one" over the whole area until nothing changes
+static void spread_light_slowly(VoxelManipulator &v, const VoxelArea &a,
+		u8 shift, INodeDefManager *ndef)
+{
+	const v3s16 dirs[6] = {
+		v3s16(1,0,0), v3s16(-1,0,0), v3s16(0,1,0),
+		v3s16(0,-1,0), v3s16(0,0,1), v3s16(0,0,-1),
+	};
+	bool changed = true;
+	while (changed) {
+		changed = false;
+		for (s16 z = a.MinEdge.Z; z <= a.MaxEdge.Z; z++)
+		for (s16 y = a.MinEdge.Y; y <= a.MaxEdge.Y; y++)
+		for (s16 x = a.MinEdge.X; x <= a.MaxEdge.X; x++) {
+			MapNode &n = v.getNodeRefUnsafe(v3s16(x, y, z));
+			if (!ndef->get(n).light_propagates)
+				continue;
+			u8 light = (n.param1 >> shift) & 0x0F;
+			for (int d = 0; d < 6; d++) {
+				v3s16 p2 = v3s16(x, y, z) + dirs[d];
+				if (!a.contains(p2))
+					continue;
+				u8 light2 = (v.getNodeRefUnsafe(p2).param1 >> shift) & 0x0F;
+				if (light2 > light + 1) {
+					light = light2 - 1;
+					n.param1 = (n.param1 & (0xF0 >> shift)) | (light << shift);
+					changed = true;
+				}
+			}
+		}
+	}
+}
+
+void TestVoxelAlgorithms::testMapgenLighting(INodeDefManager *ndef)
+{
+	// Caves of air in stone with some torches, open to the sky on top
+	VoxelArea a(v3s16(0,0,0), v3s16(23,23,23));
+	MMVManip vm(NULL);
+	PcgRandom pr(1337);
+	for (s16 z = a.MinEdge.Z; z <= a.MaxEdge.Z; z++)
+	for (s16 y = a.MinEdge.Y; y <= a.MaxEdge.Y + 1; y++)
+	for (s16 x = a.MinEdge.X; x <= a.MaxEdge.X; x++) {
+		u32 r = pr.range(0, 99);
+		MapNode n(r < 45 ? t_CONTENT_STONE : r < 46 ? t_CONTENT_TORCH : CONTENT_AIR);
+		if (y > a.MaxEdge.Y) {
+			n = MapNode(CONTENT_AIR);
+			n.param1 = LIGHT_SUN;
+		}
+		vm.setNodeNoRef(v3s16(x, y, z), n);
+	}
+
+	MMVManip expected(NULL);
+	expected.addArea(vm.m_area);
+	expected.copyFrom(vm.m_data, vm.m_area, vm.m_area.MinEdge,
+			vm.m_area.MinEdge, vm.m_area.getExtent());
+	for (s16 z = a.MinEdge.Z; z <= a.MaxEdge.Z; z++)
+	for (s16 x = a.MinEdge.X; x <= a.MaxEdge.X; x++)
+	for (s16 y = a.MaxEdge.Y; y >= a.MinEdge.Y; y--) {
+		MapNode &n = expected.getNodeRefUnsafe(v3s16(x, y, z));
+		if (!ndef->get(n).sunlight_propagates)
+			break;
+		n.param1 = LIGHT_SUN;
+	}
+	for (s16 z = a.MinEdge.Z; z <= a.MaxEdge.Z; z++)
+	for (s16 y = a.MinEdge.Y; y <= a.MaxEdge.Y; y++)
+	for (s16 x = a.MinEdge.X; x <= a.MaxEdge.X; x++) {
+		MapNode &n = expected.getNodeRefUnsafe(v3s16(x, y, z));
+		u8 source = ndef->get(n).light_source;
+		if (source)
+			n.param1 = MYMAX(n.param1 & 0x0F, source) | (source << 4);
+	}
+	spread_light_slowly(expected, a, 0, ndef);
+	spread_light_slowly(expected, a, 4, ndef);
+
+	Mapgen mg;
+	mg.vm = &vm;
+	mg.ndef = ndef;
+	mg.water_level = -100;
+	mg.calcLighting(a.MinEdge, a.MaxEdge, a.MinEdge, a.MaxEdge);
+
+	u32 lit = 0;
+	for (s16 z = a.MinEdge.Z; z <= a.MaxEdge.Z; z++)
+	for (s16 y = a.MinEdge.Y; y <= a.MaxEdge.Y; y++)
+	for (s16 x = a.MinEdge.X; x <= a.MaxEdge.X; x++) {
+		v3s16 p(x, y, z);
+		UASSERTEQ(int, vm.getNodeRefUnsafe(p).param1,
+				expected.getNodeRefUnsafe(p).param1);
+		lit += vm.getNodeRefUnsafe(p).param1 != 0;
+	}
+	// Not trivially all dark or all sunlit
+	UASSERT(lit > a.getVolume() / 4);
+	UASSERT(lit < a.getVolume());
+}
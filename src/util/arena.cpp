@@ -0,0 +1,94 @@
+/*
+  This file is part of Freeminer.
+
+  Freeminer is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Freeminer  is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Freeminer.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "util/arena.h"
+
+#include <cstdint>
+
+thread_local Arena *Arena::t_current = nullptr;
+
+Arena::Arena(size_t block_size) :
+	m_block_size(block_size)
+{
+}
+
+Arena::~Arena()
+{
+	for (auto &block : m_blocks)
+		::operator delete(block.data);
+}
+
+void Arena::addBlock(size_t size)
+{
+	m_blocks.push_back({static_cast<char *>(::operator new(size)), size});
+	m_reserved += size;
+}
+
+void *Arena::allocate(size_t size, size_t align)
+{
+	if (!size)
+		size = 1;
+
+	for (;;) {
+		if (m_block < m_blocks.size()) {
+			const auto &block = m_blocks[m_block];
+			uintptr_t base = reinterpret_cast<uintptr_t>(block.data);
+			size_t offset = ((base + m_offset + align - 1) & ~(uintptr_t)(align - 1)) - base;
+			if (offset + size <= block.size) {
+				m_used += offset + size - m_offset;
+				if (m_used > m_peak)
+					m_peak = m_used;
+				m_offset = offset + size;
+				return block.data + offset;
+			}
+			// Tail of this block is lost until rewind/reset
+			m_used += block.size - m_offset;
+			if (m_block + 1 < m_blocks.size()) {
+				++m_block;
+				m_offset = 0;
+				continue;
+			}
+		}
+		addBlock(size + align > m_block_size ? size + align : m_block_size);
+		m_block = m_blocks.size() - 1;
+		m_offset = 0;
+	}
+}
+
+void Arena::rewind(const Mark &mark)
+{
+	m_block = mark.block;
+	m_offset = mark.offset;
+	m_used = mark.used;
+}
+
+void Arena::reset()
+{
+	m_block = 0;
+	m_offset = 0;
+	m_used = 0;
+	if (m_blocks.size() <= 1)
+		return;
+
+	// Next round will probably need the same, keep it in one piece
+	size_t size = m_reserved;
+	for (auto &block : m_blocks)
+		::operator delete(block.data);
+	m_blocks.clear();
+	m_reserved = 0;
+	addBlock(size);
+}
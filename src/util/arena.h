@@ -0,0 +1,160 @@
+/*
+  This file is part of Freeminer.
+
+  Freeminer is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Freeminer  is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Freeminer.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef UTIL_ARENA_HEADER
+#define UTIL_ARENA_HEADER
+
+#include <cstddef>
+#include <new>
+#include <vector>
+
+/*
+	Bump allocator for short lived scratch data.
+
+	Allocation is a pointer increment, free is a no-op: memory comes back
+	only on rewind() or reset(). Not thread safe, every thread owns its arena.
+	Threads can publish their arena with Arena::setCurrent(), ArenaAllocator
+	then picks it up so std containers in deep code need no plumbing;
+	without a current arena ArenaAllocator is a plain heap allocator.
+*/
+
+class Arena
+{
+public:
+	struct Mark {
+		size_t block;
+		size_t offset;
+		size_t used;
+	};
+
+	Arena(size_t block_size = 1 << 20);
+	~Arena();
+
+	Arena(const Arena &) = delete;
+	Arena &operator=(const Arena &) = delete;
+
+	void *allocate(size_t size, size_t align = alignof(std::max_align_t));
+
+	template <typename T>
+	T *allocateArray(size_t count)
+	{
+		return static_cast<T *>(allocate(count * sizeof(T), alignof(T)));
+	}
+
+	Mark mark() const { return {m_block, m_offset, m_used}; }
+	// Free everything allocated after mark
+	void rewind(const Mark &mark);
+	// Free everything, keep memory for reuse (merged into one block)
+	void reset();
+
+	size_t used() const { return m_used; }
+	size_t peak() const { return m_peak; }
+	size_t reserved() const { return m_reserved; }
+	void resetPeak() { m_peak = m_used; }
+
+	static Arena *current() { return t_current; }
+	static void setCurrent(Arena *arena) { t_current = arena; }
+
+private:
+	struct Block {
+		char *data;
+		size_t size;
+	};
+
+	void addBlock(size_t size);
+
+	std::vector<Block> m_blocks;
+	size_t m_block_size;
+	size_t m_block = 0;
+	size_t m_offset = 0;
+	size_t m_used = 0;
+	size_t m_peak = 0;
+	size_t m_reserved = 0;
+
+	static thread_local Arena *t_current;
+};
+
+// Rewinds the arena on scope exit
+class ArenaScope
+{
+public:
+	ArenaScope(Arena *arena) :
+		m_arena(arena)
+	{
+		if (m_arena)
+			m_mark = m_arena->mark();
+	}
+	~ArenaScope()
+	{
+		if (m_arena)
+			m_arena->rewind(m_mark);
+	}
+private:
+	Arena *m_arena;
+	Arena::Mark m_mark;
+};
+
+// Sets the current arena of this thread for the scope
+class ArenaCurrentScope
+{
+public:
+	ArenaCurrentScope(Arena *arena) :
+		m_previous(Arena::current())
+	{
+		Arena::setCurrent(arena);
+	}
+	~ArenaCurrentScope()
+	{
+		Arena::setCurrent(m_previous);
+	}
+private:
+	Arena *m_previous;
+};
+
+template <typename T>
+class ArenaAllocator
+{
+public:
+	typedef T value_type;
+
+	ArenaAllocator() : m_arena(Arena::current()) {}
+	ArenaAllocator(Arena *arena) : m_arena(arena) {}
+	template <typename U>
+	ArenaAllocator(const ArenaAllocator<U> &other) : m_arena(other.m_arena) {}
+
+	T *allocate(size_t n)
+	{
+		if (m_arena)
+			return m_arena->allocateArray<T>(n);
+		return static_cast<T *>(::operator new(n * sizeof(T)));
+	}
+
+	void deallocate(T *p, size_t)
+	{
+		if (!m_arena)
+			::operator delete(p);
+	}
+
+	template <typename U>
+	bool operator==(const ArenaAllocator<U> &other) const { return m_arena == other.m_arena; }
+	template <typename U>
+	bool operator!=(const ArenaAllocator<U> &other) const { return m_arena != other.m_arena; }
+
+	Arena *m_arena;
+};
+
+#endif
@@ -60,13 +60,11 @@ bool packet_convert_safe(MsgpackPacket & packet, int field, T & to) {
 	return true;
 }
 
+// Unpacks zipped data as made by PACK_ZIP
 template<typename T>
-bool packet_convert_safe_zip(MsgpackPacket & packet, int field, T & to) {
-	if (!packet.count(field))
-		return false;
+bool msgpack_unzip(const std::string & sz, T & to) {
 	try {
-		std::string sz, s;
-		packet[field].convert(sz);
+		std::string s;
 		decompressZlib(sz, s);
 		msgpack::unpacked msg;
 		msgpack::unpack(msg, s.c_str(), s.size());
@@ -76,6 +74,17 @@ bool packet_convert_safe_zip(MsgpackPacket & packet, int field, T & to) {
 	return true;
 }
 
+template<typename T>
+bool packet_convert_safe_zip(MsgpackPacket & packet, int field, T & to) {
+	if (!packet.count(field))
+		return false;
+	std::string sz;
+	try {
+		packet[field].convert(sz);
+	} catch (...) { return false; }
+	return msgpack_unzip(sz, to);
+}
+
 class MsgpackPacketSafe : public MsgpackPacket {
 public:
 	template<typename T>
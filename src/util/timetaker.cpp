@@ -24,12 +24,18 @@ along with Freeminer.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "../gettime.h"
 #include "../log.h"
+#include "../tracer.h"
 #include <ostream>
 
 unsigned int g_time_taker_enabled = 0;
 
 TimeTaker::TimeTaker(const std::string &name, u32 *result, TimePrecision prec)
 {
+	m_tracing = g_tracer_enabled.load(std::memory_order_relaxed);
+	if (m_tracing) {
+		m_name = name;
+		m_trace_begin = Tracer::now();
+	}
 	if (!g_time_taker_enabled) {
 		m_running = false;
 		return;
@@ -43,6 +49,10 @@ TimeTaker::TimeTaker(const std::string &name, u32 *result, TimePrecision prec)
 
 u32 TimeTaker::stop(bool quiet)
 {
+	if (m_tracing) {
+		g_tracer->span(m_name, m_trace_begin, Tracer::now());
+		m_tracing = false;
+	}
 	if(m_running)
 	{
 		u32 time2 = getTime(m_precision);
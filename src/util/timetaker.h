@@ -52,6 +52,8 @@ class TimeTaker
 	bool m_running;
 	TimePrecision m_precision;
 	u32 *m_result;
+	bool m_tracing;
+	u64 m_trace_begin;
 };
 
 #endif
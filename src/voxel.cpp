@@ -25,6 +25,8 @@ along with Freeminer.  If not, see <http://www.gnu.org/licenses/>.
 #include "gettime.h"
 #include "nodedef.h"
 #include "util/timetaker.h"
+#include "util/arena.h"
+#include "voxelalgorithms.h"
 #include <string.h>  // memcpy, memset
 
 /*
@@ -52,6 +54,12 @@ void VoxelManipulator::clear()
 {
 	// Reset area to volume=0
 	m_area = VoxelArea();
+	if (m_arena) {
+		// memory is owned by arena
+		m_data = NULL;
+		m_flags = NULL;
+		return;
+	}
 	if(m_data)
 		delete m_data;
 	m_data = NULL;
@@ -176,14 +184,15 @@ void VoxelManipulator::addArea(const VoxelArea &area)
 	dstream<<std::endl;*/
 
 	// Allocate new data and clear flags
-	MapNode *new_data = reinterpret_cast<MapNode*>( ::operator new(new_size * sizeof(MapNode)));
+	MapNode *new_data = m_arena ? m_arena->allocateArray<MapNode>(new_size) :
+			reinterpret_cast<MapNode*>( ::operator new(new_size * sizeof(MapNode)));
 	if (!CONTENT_IGNORE)
 		memset(new_data, 0, new_size * sizeof(MapNode));
 	else
 		for(s32 i=0; i<new_size; i++)
 			new_data[i] = MapNode(CONTENT_IGNORE);
 
-	u8 *new_flags = new u8[new_size];
+	u8 *new_flags = m_arena ? m_arena->allocateArray<u8>(new_size) : new u8[new_size];
 	memset(new_flags, VOXELFLAG_NO_DATA, new_size);
 
 	// Copy old data
@@ -213,6 +222,9 @@ void VoxelManipulator::addArea(const VoxelArea &area)
 	m_data = new_data;
 	m_flags = new_flags;
 
+	if (m_arena)
+		return;
+
 	if(old_data)
 		delete old_data;
 	if(old_flags)
@@ -496,8 +508,8 @@ void VoxelManipulator::spreadLight(enum LightBank bank, v3s16 p,
 const MapNode VoxelManipulator::ContentIgnoreNode = MapNode(CONTENT_IGNORE);
 
 /*
-	Lights neighbors of from_nodes, collects all them and then
-	goes on recursively.
+	Spreads light from from_nodes and from their brighter neighbors
+	(which light up from_nodes on their turn) until nothing changes.
 */
 void VoxelManipulator::spreadLight(enum LightBank bank,
 		std::set<v3s16> & from_nodes, INodeDefManager *nodemgr)
@@ -514,78 +526,47 @@ void VoxelManipulator::spreadLight(enum LightBank bank,
 	if(from_nodes.empty())
 		return;
 
-	std::set<v3s16> lighted_nodes;
-
+	VoxelArea voxel_area;
 	for(std::set<v3s16>::iterator j = from_nodes.begin();
 		j != from_nodes.end(); ++j)
 	{
-		v3s16 pos = *j;
+		voxel_area.addPoint(*j - v3s16(1,1,1));
+		voxel_area.addPoint(*j + v3s16(1,1,1));
+	}
+	addArea(voxel_area);
 
-		VoxelArea voxel_area(pos - v3s16(1,1,1), pos + v3s16(1,1,1));
-		addArea(voxel_area);
+	// Light spreads no further than the loaded nodes, outside of them
+	// there is only VOXELFLAG_NO_DATA
+	voxalgo::LightSpreader spreader(*this, m_area, bank, nodemgr);
 
+	for(std::set<v3s16>::iterator j = from_nodes.begin();
+		j != from_nodes.end(); ++j)
+	{
+		v3s16 pos = *j;
 		u32 i = m_area.index(pos);
 
 		if(m_flags[i] & VOXELFLAG_NO_DATA)
 			continue;
 
-		MapNode &n = m_data[i];
-
-		u8 oldlight = n.getLight(bank, nodemgr);
-		u8 newlight = diminish_light(oldlight);
+		// Sunlight spreads sideways like LIGHT_MAX, see diminish_light()
+		u8 oldlight = m_data[i].getLight(bank, nodemgr);
+		spreader.addSource(pos, MYMIN(oldlight, LIGHT_MAX));
 
-		// Loop through 6 neighbors
-		for(u16 i=0; i<6; i++)
+		for(u16 d=0; d<6; d++)
 		{
-			// Get the position of the neighbor node
-			v3s16 n2pos = pos + dirs[i];
-
-			try
-			{
-				u32 n2i = m_area.index(n2pos);
-
-				if(m_flags[n2i] & VOXELFLAG_NO_DATA)
-					continue;
-
-				MapNode &n2 = m_data[n2i];
+			v3s16 n2pos = pos + dirs[d];
+			u32 n2i = m_area.index(n2pos);
 
-				u8 light2 = n2.getLight(bank, nodemgr);
-
-				/*
-					If the neighbor is brighter than the current node,
-					add to list (it will light up this node on its turn)
-				*/
-				if(light2 > undiminish_light(oldlight))
-				{
-					lighted_nodes.insert(n2pos);
-				}
-				/*
-					If the neighbor is dimmer than how much light this node
-					would spread on it, add to list
-				*/
-				if(light2 < newlight)
-				{
-					if(nodemgr->get(n2).light_propagates)
-					{
-						n2.setLight(bank, newlight, nodemgr);
-						lighted_nodes.insert(n2pos);
-					}
-				}
-			}
-			catch(InvalidPositionException &e)
-			{
+			if(m_flags[n2i] & VOXELFLAG_NO_DATA)
 				continue;
-			}
+
+			u8 light2 = m_data[n2i].getLight(bank, nodemgr);
+			if(light2 > undiminish_light(oldlight))
+				spreader.addSource(n2pos, MYMIN(light2, LIGHT_MAX));
 		}
 	}
 
-	/*dstream<<"spreadLight(): Changed block "
-			<<blockchangecount<<" times"
-			<<" for "<<from_nodes.size()<<" nodes"
-			<<std::endl;*/
-
-	if(!lighted_nodes.empty())
-		spreadLight(bank, lighted_nodes, nodemgr);
+	spreader.spread();
 }
 
 //END
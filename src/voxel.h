@@ -34,6 +34,7 @@ along with Freeminer.  If not, see <http://www.gnu.org/licenses/>.
 #include <map>
 
 class INodeDefManager;
+class Arena;
 
 // For VC++
 #undef min
@@ -518,6 +519,10 @@ class VoxelManipulator /*: public NodeContainer*/
 
 	virtual void clear();
 
+	// Take buffers from arena instead of heap, arena must outlive this and
+	// must be set before any data is added
+	void setArena(Arena *arena) { m_arena = arena; }
+
 	void print(std::ostream &o, INodeDefManager *nodemgr,
 			VoxelPrintMode mode=VOXELPRINT_MATERIAL);
 
@@ -580,6 +585,8 @@ class VoxelManipulator /*: public NodeContainer*/
 
 	static const MapNode ContentIgnoreNode;
 
+	Arena *m_arena = nullptr;
+
 	//TODO: Use these or remove them
 	//TODO: Would these make any speed improvement?
 	//bool m_pressure_route_valid;
@@ -42,6 +42,70 @@ void setLight(VoxelManipulator &v, VoxelArea a, u8 light,
 	}
 }
 
+LightSpreader::LightSpreader(VoxelManipulator &v, const VoxelArea &a,
+		enum LightBank bank, INodeDefManager *ndef) :
+	m_arena_scope(Arena::current()),
+	m_v(v),
+	m_a(a),
+	m_shift(bank == LIGHTBANK_DAY ? 0 : 4),
+	m_ndef(ndef),
+	m_done(v.m_area.getVolume(), false)
+{
+}
+
+void LightSpreader::addSource(v3s16 p, u8 light)
+{
+	light &= 0x0F;
+	if (light > 1)
+		m_buckets[light].push_back(Entry{(u32)m_v.m_area.index(p), p});
+}
+
+void LightSpreader::spread()
+{
+	const v3s16 dirs[6] = {
+		v3s16(1, 0, 0), v3s16(-1, 0, 0),
+		v3s16(0, 1, 0), v3s16(0, -1, 0),
+		v3s16(0, 0, 1), v3s16(0, 0, -1),
+	};
+	const v3s16 em = m_v.m_area.getExtent();
+	const s32 offsets[6] = {
+		1, -1,
+		em.X, -em.X,
+		em.X * em.Y, -em.X * em.Y,
+	};
+	const u8 keep_mask = 0xF0 >> m_shift;
+
+	for (u8 level = LIGHT_SUN; level > 1; level--) {
+		// Spreading only fills the dimmer buckets, this one stays as it is
+		Bucket &bucket = m_buckets[level];
+		const u8 light = level - 1;
+		for (size_t k = 0; k < bucket.size(); k++) {
+			const Entry e = bucket[k];
+			// Already spread from with as much or more light
+			if (m_done[e.i])
+				continue;
+			m_done[e.i] = true;
+
+			for (int d = 0; d < 6; d++) {
+				v3s16 p2 = e.p + dirs[d];
+				if (!m_a.contains(p2))
+					continue;
+				u32 i2 = e.i + offsets[d];
+				if (m_done[i2] || (m_v.m_flags[i2] & VOXELFLAG_NO_DATA))
+					continue;
+				MapNode &n2 = m_v.m_data[i2];
+				if (((n2.param1 >> m_shift) & 0x0F) >= light ||
+						!m_ndef->get(n2).light_propagates)
+					continue;
+				n2.param1 = (n2.param1 & keep_mask) | (light << m_shift);
+				if (light > 1)
+					m_buckets[light].push_back(Entry{i2, p2});
+			}
+		}
+		bucket.clear();
+	}
+}
+
 void clearLightAndCollectSources(VoxelManipulator &v, VoxelArea a,
 		enum LightBank bank, INodeDefManager *ndef,
 		std::set<v3s16> & light_sources,
@@ -25,8 +25,10 @@ along with Freeminer.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "voxel.h"
 #include "mapnode.h"
+#include "util/arena.h"
 #include <set>
 #include <map>
+#include <vector>
 
 class Map;
 class MapBlock;
@@ -34,7 +36,41 @@ class MapBlock;
 namespace voxalgo
 {
 
-// TODO: Move unspreadLight and spreadLight from VoxelManipulator to here
+// TODO: Move unspreadLight from VoxelManipulator to here
+
+/*
+	Spreads light of one bank from the added sources over the light
+	propagating nodes of area a (which must be inside v.m_area), dropping
+	by one per node. Sources wait in one bucket per light level and are
+	handled brightest first, so every node is visited once, when it has
+	its final light. Reads and writes param1 directly.
+	Scratch memory comes from the current arena of the thread.
+*/
+class LightSpreader
+{
+public:
+	LightSpreader(VoxelManipulator &v, const VoxelArea &a, enum LightBank bank,
+			INodeDefManager *ndef);
+
+	// light: what the node spreads, not necessarily its own light
+	void addSource(v3s16 p, u8 light);
+	void spread();
+
+private:
+	struct Entry {
+		u32 i;
+		v3s16 p;
+	};
+	typedef std::vector<Entry, ArenaAllocator<Entry> > Bucket;
+
+	ArenaScope m_arena_scope;
+	VoxelManipulator &m_v;
+	VoxelArea m_a;
+	u8 m_shift;
+	INodeDefManager *m_ndef;
+	Bucket m_buckets[LIGHT_SUN + 1];
+	std::vector<bool, ArenaAllocator<bool> > m_done;
+};
 
 void setLight(VoxelManipulator &v, VoxelArea a, u8 light,
 		INodeDefManager *ndef);